@@ -1,49 +1,83 @@
-#include <iomanip>  // for std::setw() and std::setfill()
+#include <cstdint>  // for uint32_t
 #include <iostream> // for std::ostream
-#include <sstream>  // for std::stringstream
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "ip_addr.h"
 
-ip_addr::ip_addr() : addr(IP_ADDR_LEN) {}
+static_assert(std::is_trivially_copyable<ip_addr>::value, "ip_addr must be copied as bytes");
 
-void ip_addr::from_string(const std::string& addr) {
-  char addr_host_bytes[addr_len_];
-  std::string::size_type pos_dot = 0;
-  std::string::size_type prev_pos_dot = -1;
-  for (int i = 0; i < addr_len_; ++i) {
-    std::string::size_type pos_start = prev_pos_dot + 1;
-    pos_dot = addr.find_first_of(".", pos_start);
-    if (i < addr_len_ - 1 &&  pos_dot == std::string::npos) {
-      throw std::invalid_argument("Failed to parse ip address string. \".\" is missing");
+namespace {
+// Write a number up to 255 without leading zeros.
+char *format_decimal(char *p, unsigned int n) {
+  if (n >= 100) {
+    *p++ = static_cast<char>('0' + n / 100);
+    n %= 100;
+    *p++ = static_cast<char>('0' + n / 10);
+  } else if (n >= 10) {
+    *p++ = static_cast<char>('0' + n / 10);
+  }
+  *p++ = static_cast<char>('0' + n % 10);
+  return p;
+}
+} // namespace
+
+bool ip_addr::parse(const char *first, const char *last) {
+  const char *p = first;
+  uint32_t value = 0;
+  for (int i = 0; i < IP_ADDR_LEN; ++i) {
+    if (i != 0) {
+      if (p == last || *p != '.') {
+        return false;
+      }
+      ++p;
     }
-    if (i == addr_len_ - 1 && pos_dot != std::string::npos) {
-      throw std::invalid_argument("Failed to parse ip address string. Extra \".\" is found");
+    unsigned int part = 0;
+    int digits = 0;
+    // (an unsigned difference is a digit test without two comparisons)
+    while (p != last && digits < 3 && static_cast<unsigned int>(*p - '0') < 10) {
+      part = part * 10 + static_cast<unsigned int>(*p - '0');
+      ++p;
+      ++digits;
     }
-    if (i == addr_len_ - 1 && pos_dot == std::string::npos) {
-      pos_dot = addr.length();
+    if (digits == 0 || part > 255) {
+      return false;
     }
-    std::string::size_type part_size = pos_dot - pos_start;
-    const auto base = 10;
-    addr_host_bytes[i] = std::stoi(addr.substr(pos_start, part_size), nullptr, base);
-    prev_pos_dot = pos_dot;
+    value = value << 8 | part;
   }
-  from_host_order(addr_host_bytes);
+  if (p != last) {
+    return false;
+  }
+  value_ = value;
+  return true;
 }
 
-std::string ip_addr::to_string() const {
-  std::stringstream ss;
-  for (int i = 0; i < addr_len_; ++i) {
-    ss << static_cast<unsigned int>(addr_[i]);
-    if (i != addr_len_ - 1) {
-      ss << ".";
-    }
+void ip_addr::from_string(const std::string& addr) {
+  if (!parse(addr.data(), addr.data() + addr.size())) {
+    throw std::invalid_argument("Failed to parse ip address string: " + addr);
   }
-  return ss.str();
+}
+
+char *ip_addr::format(char *first) const {
+  char *p = format_decimal(first, value_ >> 24);
+  *p++ = '.';
+  p = format_decimal(p, (value_ >> 16) & 0xff);
+  *p++ = '.';
+  p = format_decimal(p, (value_ >> 8) & 0xff);
+  *p++ = '.';
+  return format_decimal(p, value_ & 0xff);
+}
+
+std::string ip_addr::to_string() const {
+  char buf[IP_ADDR_STRING_LEN];
+  return std::string(buf, format(buf));
 }
 
 std::ostream& operator<<(std::ostream& os, const ip_addr& addr) {
-  os << addr.to_string();
+  char buf[IP_ADDR_STRING_LEN];
+  // (a string_view keeps the width and fill of the stream)
+  os << std::string_view(buf, addr.format(buf) - buf);
   return os;
 }
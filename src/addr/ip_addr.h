@@ -1,19 +1,88 @@
 #ifndef IP_ADDR_H_
 #define IP_ADDR_H_
 
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t, uint32_t
+#include <functional>  // for std::hash
 #include <iostream>
 #include <string>
 
-#include "addr.h"
-
 const int IP_ADDR_LEN = 4; // 4 bytes
+// Longest dotted-decimal notation ("255.255.255.255")
+const size_t IP_ADDR_STRING_LEN = 15;
 
-class ip_addr : public addr {
+// IPv4 address as a value type of 4 bytes (trivially copyable, no allocation),
+// so that it is passed by value and used as a key of hash tables for free.
+//
+// NOTE
+// "host order" in the names of the methods is the order in which the bytes
+// are written (10, 9, 0, 1 for 10.9.0.1), which is also the order on the
+// wire. "network order" is the reverse.
+class ip_addr {
+ private:
+  // the address as a number (0x0a090001 for 10.9.0.1), so that addresses
+  // are ordered like their numbers
+  uint32_t value_;
  public:
-  ip_addr();
+  constexpr ip_addr() : value_(0) {}
+  constexpr explicit ip_addr(const uint32_t value) : value_(value) {}
+  constexpr uint32_t get_value() const { return value_; }
+  constexpr void from_host_order(const uint8_t *addr) {
+    value_ = static_cast<uint32_t>(addr[0]) << 24 | static_cast<uint32_t>(addr[1]) << 16 |
+             static_cast<uint32_t>(addr[2]) << 8 | static_cast<uint32_t>(addr[3]);
+  }
+  void from_host_order(const char *addr) {
+    from_host_order(reinterpret_cast<const uint8_t *>(addr));
+  }
+  void from_network_order(const char *addr) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(addr);
+    const uint8_t reversed[IP_ADDR_LEN] = {bytes[3], bytes[2], bytes[1], bytes[0]};
+    from_host_order(reversed);
+  }
+  constexpr void host_order(uint8_t *addr) const {
+    addr[0] = static_cast<uint8_t>(value_ >> 24);
+    addr[1] = static_cast<uint8_t>(value_ >> 16);
+    addr[2] = static_cast<uint8_t>(value_ >> 8);
+    addr[3] = static_cast<uint8_t>(value_);
+  }
+  constexpr void network_order(uint8_t *addr) const {
+    addr[0] = static_cast<uint8_t>(value_);
+    addr[1] = static_cast<uint8_t>(value_ >> 8);
+    addr[2] = static_cast<uint8_t>(value_ >> 16);
+    addr[3] = static_cast<uint8_t>(value_ >> 24);
+  }
+  // Parse the dotted-decimal notation in [first, last) (e.g. "10.9.0.1").
+  // Returns false, leaving the address as it is, unless the whole range is
+  // four decimal numbers up to 255.
+  bool parse(const char *first, const char *last);
+  // Same as parse(), but throws std::invalid_argument.
   void from_string(const std::string& addr);
+  // Write the dotted-decimal notation (up to IP_ADDR_STRING_LEN characters,
+  // without a terminating null) at first, and return the end of it.
+  char *format(char *first) const;
   std::string to_string() const;
   friend std::ostream& operator<<(std::ostream& os, const ip_addr& addr);
 };
 
+constexpr bool operator==(const ip_addr& a, const ip_addr& b) {
+  return a.get_value() == b.get_value();
+}
+
+constexpr bool operator!=(const ip_addr& a, const ip_addr& b) {
+  return a.get_value() != b.get_value();
+}
+
+constexpr bool operator<(const ip_addr& a, const ip_addr& b) {
+  return a.get_value() < b.get_value();
+}
+
+namespace std {
+template <>
+struct hash<ip_addr> {
+  size_t operator()(const ip_addr& addr) const noexcept {
+    return hash<uint32_t>()(addr.get_value());
+  }
+};
+} // namespace std
+
 #endif  // IP_ADDR_H_
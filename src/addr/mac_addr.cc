@@ -1,50 +1,86 @@
-#include <iomanip>  // for std::setw() and std::setfill()
+#include <cstdint>  // for uint8_t
 #include <iostream> // for std::ostream
-#include <sstream>  // for std::stringstream
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "mac_addr.h"
 
-mac_addr::mac_addr() : addr(MAC_ADDR_LEN) {}
+static_assert(std::is_trivially_copyable<mac_addr>::value, "mac_addr must be copied as bytes");
 
-void mac_addr::from_string(const std::string& addr) {
-  char addr_host_bytes[addr_len_];
-  std::string::size_type pos_colon = 0;
-  std::string::size_type prev_pos_colon = -1;
-  for (int i = 0; i < addr_len_; ++i) {
-    std::string::size_type pos_start = prev_pos_colon + 1;
-    pos_colon = addr.find_first_of(":", pos_start);
-    if (i < addr_len_ - 1 &&  pos_colon == std::string::npos) {
-      throw std::invalid_argument("Failed to parse mac address string. \":\" is missing");
+namespace {
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Value of a hex digit, or -1.
+int hex_value(const char c) {
+  if (static_cast<unsigned int>(c - '0') < 10) {
+    return c - '0';
+  }
+  // (lower case by setting the bit which distinguishes cases)
+  const char lower = static_cast<char>(c | 0x20);
+  if (static_cast<unsigned int>(lower - 'a') < 6) {
+    return lower - 'a' + 10;
+  }
+  return -1;
+}
+} // namespace
+
+bool mac_addr::parse(const char *first, const char *last) {
+  const char *p = first;
+  uint8_t bytes[MAC_ADDR_LEN];
+  for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+    if (i != 0) {
+      if (p == last || *p != ':') {
+        return false;
+      }
+      ++p;
     }
-    if (i == addr_len_ - 1 && pos_colon != std::string::npos) {
-      throw std::invalid_argument("Failed to parse mac address string. Extra \":\" is found");
+    const int high = p != last ? hex_value(*p) : -1;
+    if (high < 0) {
+      return false;
     }
-    if (i == addr_len_ - 1 && pos_colon == std::string::npos) {
-      pos_colon = addr.length();
+    ++p;
+    const int low = p != last ? hex_value(*p) : -1;
+    if (low < 0) {
+      bytes[i] = static_cast<uint8_t>(high);
+    } else {
+      bytes[i] = static_cast<uint8_t>(high << 4 | low);
+      ++p;
     }
-    std::string::size_type part_size = pos_colon - pos_start;
-    const auto base = 16;
-    addr_host_bytes[i] = std::stoi(addr.substr(pos_start, part_size), nullptr, base);
-    prev_pos_colon = pos_colon;
   }
-  from_host_order(addr_host_bytes);
+  if (p != last) {
+    return false;
+  }
+  from_host_order(bytes);
+  return true;
 }
 
-std::string mac_addr::to_string() const {
-  std::stringstream ss;
-  for (int i = 0; i < addr_len_; ++i) {
-    ss << std::hex << std::setw(2) << std::setfill('0')
-       << static_cast<unsigned int>(addr_[i]);
-    if (i != addr_len_ - 1) {
-      ss << ":";
+void mac_addr::from_string(const std::string& addr) {
+  if (!parse(addr.data(), addr.data() + addr.size())) {
+    throw std::invalid_argument("Failed to parse mac address string: " + addr);
+  }
+}
+
+char *mac_addr::format(char *first) const {
+  char *p = first;
+  for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+    if (i != 0) {
+      *p++ = ':';
     }
+    *p++ = HEX_DIGITS[bytes_[i] >> 4];
+    *p++ = HEX_DIGITS[bytes_[i] & 0xf];
   }
-  return ss.str();
+  return p;
+}
+
+std::string mac_addr::to_string() const {
+  char buf[MAC_ADDR_STRING_LEN];
+  return std::string(buf, format(buf));
 }
 
 std::ostream& operator<<(std::ostream& os, const mac_addr& addr) {
-  os << addr.to_string();
+  char buf[MAC_ADDR_STRING_LEN];
+  os << std::string_view(buf, addr.format(buf) - buf);
   return os;
 }
@@ -1,20 +1,90 @@
 #ifndef MAC_ADDR_H_
 #define MAC_ADDR_H_
 
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint8_t, uint64_t
+#include <functional>  // for std::hash
 #include <iostream>
 #include <string>
-#include <vector>
-
-#include "addr.h"
 
 const int MAC_ADDR_LEN = 6; // 6 bytes
+// Length of the colon-separated notation ("c6:e2:d6:65:23:1f")
+const size_t MAC_ADDR_STRING_LEN = 17;
 
-class mac_addr : public addr {
+// MAC address as a value type of 6 bytes (trivially copyable, no allocation).
+// "host order" and "network order" mean the same as for ip_addr.
+class mac_addr {
+ private:
+  uint8_t bytes_[MAC_ADDR_LEN];
  public:
-  mac_addr();
+  constexpr mac_addr() : bytes_{} {}
+  constexpr mac_addr(
+      const uint8_t b0, const uint8_t b1, const uint8_t b2,
+      const uint8_t b3, const uint8_t b4, const uint8_t b5)
+    : bytes_{b0, b1, b2, b3, b4, b5} {}
+  // The address as a 48 bit number (the first byte is the most significant).
+  constexpr uint64_t get_value() const {
+    uint64_t value = 0;
+    for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+      value = value << 8 | bytes_[i];
+    }
+    return value;
+  }
+  constexpr void from_host_order(const uint8_t *addr) {
+    for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+      bytes_[i] = addr[i];
+    }
+  }
+  void from_host_order(const char *addr) {
+    from_host_order(reinterpret_cast<const uint8_t *>(addr));
+  }
+  void from_network_order(const char *addr) {
+    for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+      bytes_[i] = static_cast<uint8_t>(addr[MAC_ADDR_LEN - 1 - i]);
+    }
+  }
+  constexpr void host_order(uint8_t *addr) const {
+    for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+      addr[i] = bytes_[i];
+    }
+  }
+  constexpr void network_order(uint8_t *addr) const {
+    for (int i = 0; i < MAC_ADDR_LEN; ++i) {
+      addr[i] = bytes_[MAC_ADDR_LEN - 1 - i];
+    }
+  }
+  // Parse the colon-separated notation in [first, last) (e.g.
+  // "c6:e2:d6:65:23:1f", either case, one or two digits per byte).
+  // Returns false, leaving the address as it is, if the range is not an address.
+  bool parse(const char *first, const char *last);
+  // Same as parse(), but throws std::invalid_argument.
   void from_string(const std::string& addr);
+  // Write the colon-separated notation in lower case (MAC_ADDR_STRING_LEN
+  // characters, without a terminating null) at first, and return the end of it.
+  char *format(char *first) const;
   std::string to_string() const;
   friend std::ostream& operator<<(std::ostream& os, const mac_addr& addr);
 };
 
+constexpr bool operator==(const mac_addr& a, const mac_addr& b) {
+  return a.get_value() == b.get_value();
+}
+
+constexpr bool operator!=(const mac_addr& a, const mac_addr& b) {
+  return a.get_value() != b.get_value();
+}
+
+constexpr bool operator<(const mac_addr& a, const mac_addr& b) {
+  return a.get_value() < b.get_value();
+}
+
+namespace std {
+template <>
+struct hash<mac_addr> {
+  size_t operator()(const mac_addr& addr) const noexcept {
+    return hash<uint64_t>()(addr.get_value());
+  }
+};
+} // namespace std
+
 #endif  // MAC_ADDR_H_
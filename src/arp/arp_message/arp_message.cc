@@ -78,18 +78,38 @@ std::vector<uint8_t> arp_message::data() {
   return data;
 }
 
-void arp_message::get_sender_ip(uint8_t *sender_ip) {
+uint16_t arp_message::get_hw_type() const {
+  return hw_type_;
+}
+
+uint16_t arp_message::get_protocol_type() const {
+  return prtcl_type_;
+}
+
+uint8_t arp_message::get_hw_size() const {
+  return hw_size_;
+}
+
+uint8_t arp_message::get_protocol_size() const {
+  return prtcl_size_;
+}
+
+uint16_t arp_message::get_operation() const {
+  return operation_;
+}
+
+void arp_message::get_sender_ip(uint8_t *sender_ip) const {
   std::memcpy(sender_ip, sender_ip_, PROTOCOL_SIZE_IPV4);
 }
 
-void arp_message::get_target_ip(uint8_t *target_ip) {
+void arp_message::get_target_ip(uint8_t *target_ip) const {
   std::memcpy(target_ip, target_ip_, PROTOCOL_SIZE_IPV4);
 }
 
-void arp_message::get_sender_mac(uint8_t *sender_mac) {
+void arp_message::get_sender_mac(uint8_t *sender_mac) const {
   std::memcpy(sender_mac, sender_mac_, HW_SIZE_MAC);
 }
 
-void arp_message::get_target_mac(uint8_t *target_mac) {
+void arp_message::get_target_mac(uint8_t *target_mac) const {
   std::memcpy(target_mac, target_mac_, HW_SIZE_MAC);
 }
@@ -1,6 +1,7 @@
 #ifndef ARP_H_
 #define ARP_H_
 
+#include <cstddef>  // for size_t
 #include <string>
 #include <vector>
 
@@ -10,6 +11,8 @@ const uint8_t  HW_SIZE_MAC                 = 0x06;
 const uint8_t  PROTOCOL_SIZE_IPV4          = 0x04;
 const uint16_t OPERATION_CODE_ARP_REQUEST  = 0x0001;
 const uint16_t OPERATION_CODE_ARP_RESPONSE = 0x0002;
+// Size of an ARP message for IPv4 over Ethernet
+const size_t   ARP_MESSAGE_SIZE            = 28;
 
 /*
  * Format of ARP message.
@@ -57,10 +60,15 @@ class arp_message {
       const uint8_t *target_mac, const uint8_t *target_ip);
   arp_message(const std::vector<uint8_t> data);
   std::vector<uint8_t> data();
-  void get_sender_ip(uint8_t *sender_ip);
-  void get_target_ip(uint8_t *target_ip);
-  void get_sender_mac(uint8_t *sender_mac);
-  void get_target_mac(uint8_t *target_mac);
+  uint16_t get_hw_type() const;
+  uint16_t get_protocol_type() const;
+  uint8_t get_hw_size() const;
+  uint8_t get_protocol_size() const;
+  uint16_t get_operation() const;
+  void get_sender_ip(uint8_t *sender_ip) const;
+  void get_target_ip(uint8_t *target_ip) const;
+  void get_sender_mac(uint8_t *sender_mac) const;
+  void get_target_mac(uint8_t *target_mac) const;
 };
 
 #endif  // ARP_H_
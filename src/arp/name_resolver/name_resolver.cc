@@ -1,52 +1,514 @@
+#include <cerrno>             // for errno
+#include <chrono>
+#include <cstring>            // for std::memcpy(), std::memcmp(), std::memset()
+#include <functional>
+#include <memory>             // for std::shared_ptr
+#include <mutex>
 #include <net/ethernet.h>     // for ETH_P_ARP
+#include <net/if.h>           // for if_nametoindex()
+#include <poll.h>             // for poll()
+#include <stdexcept>
 #include <string>
+#include <utility>            // for std::move()
+#include <vector>
 
 #include "arp_message.h"
 #include "ip_addr.h"
 #include "mac_addr.h"
 #include "name_resolver.h"
+#include "route_table.h"
 #include "socket_wrapper.h"
 
+namespace chrono = std::chrono;
+
+namespace {
+const uint8_t MAC_BROADCAST[HW_SIZE_MAC] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+std::runtime_error no_reply(const ip_addr& ip) {
+  return std::runtime_error("No ARP reply from " + ip.to_string());
+}
+
+// Removes ip from ips (order is not kept).
+void remove_ip(std::vector<ip_addr>& ips, const ip_addr ip) {
+  for (size_t i = 0; i < ips.size(); ++i) {
+    if (ips[i] == ip) {
+      ips[i] = ips.back();
+      ips.pop_back();
+      return;
+    }
+  }
+}
+} // namespace
+
 name_resolver::name_resolver(const std::string src_ifname, const mac_addr src_mac, const ip_addr src_ip)
-  : src_ifname_(src_ifname), src_ip_(src_ip), src_mac_(src_mac) {}
+  : src_ip_(src_ip), src_mac_(src_mac),
+    ifindex_(if_nametoindex(src_ifname.c_str())), routes_(nullptr),
+    sock_(ETH_P_ARP), receiving_(false), next_send_() {
+  src_ip_.host_order(src_ip_bytes_);
+  src_mac_.host_order(src_mac_bytes_);
+  std::memset(&stats_, 0, sizeof(stats_));
+}
 
-void name_resolver::resolve(const ip_addr remote_ip, mac_addr& remote_mac) {
-  // src ip
-  uint8_t src_ip_bytes[PROTOCOL_SIZE_IPV4];
-  src_ip_.host_order(src_ip_bytes);
+name_resolver::name_resolver(
+    const std::string src_ifname, const mac_addr src_mac, const ip_addr src_ip,
+    const route_table& routes)
+  : name_resolver(src_ifname, src_mac, src_ip) {
+  routes_ = &routes;
+}
 
-  // src mac
-  uint8_t src_mac_bytes[HW_SIZE_MAC];
-  src_mac_.host_order(src_mac_bytes);
+bool name_resolver::update_state(neighbor& n, const chrono::steady_clock::time_point now) {
+  if (now < n.expiry) {
+    return true;
+  }
+  switch (n.state) {
+    case neighbor_state::INCOMPLETE:
+      // A lookup waiting for the reply marks it FAILED.
+      return true;
+    case neighbor_state::REACHABLE:
+      n.state = neighbor_state::STALE;
+      n.expiry += NEIGHBOR_STALE_TIME;
+      return now < n.expiry;
+    case neighbor_state::STALE:
+    case neighbor_state::FAILED:
+      return false;
+  }
+  return false;
+}
 
-  // remote ip
-  uint8_t remote_ip_bytes[PROTOCOL_SIZE_IPV4];
-  remote_ip.host_order(remote_ip_bytes);
+name_resolver::neighbor *name_resolver::find_usable(
+    const ip_addr ip, const chrono::steady_clock::time_point now) {
+  const auto it = neighbors_.find(ip);
+  if (it == neighbors_.end()) {
+    return nullptr;
+  }
+  if (!update_state(it->second, now)) {
+    neighbors_.erase(it);
+    return nullptr;
+  }
+  const neighbor_state state = it->second.state;
+  if (state != neighbor_state::REACHABLE && state != neighbor_state::STALE) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void name_resolver::remove_expired(const chrono::steady_clock::time_point now) {
+  for (auto it = neighbors_.begin(); it != neighbors_.end();) {
+    if (update_state(it->second, now)) {
+      ++it;
+    } else {
+      it = neighbors_.erase(it);
+    }
+  }
+}
 
-  // remote mac
-  uint8_t remote_mac_bytes_empty[HW_SIZE_MAC] = {0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
+void name_resolver::refresh_if_needed(
+    neighbor& n, const uint8_t *ip, const chrono::steady_clock::time_point now) {
+  const bool aging =
+    n.state == neighbor_state::STALE || now >= n.expiry - NEIGHBOR_REFRESH_MARGIN;
+  if (!aging || now - n.refreshed < NEIGHBOR_REFRESH_INTERVAL) {
+    return;
+  }
+  n.refreshed = now;
+  stats_.refreshes++;
+  send_request(ip, n.mac);
+}
 
-  // Create arp request
+void name_resolver::send_request(const uint8_t *target_ip, const uint8_t *dst_mac) {
+  const uint8_t target_mac_empty[HW_SIZE_MAC] = {0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
   arp_message req(
     HW_TYPE_ETHERNET, PROTOCOL_TYPE_IPV4,
     HW_SIZE_MAC, PROTOCOL_SIZE_IPV4, OPERATION_CODE_ARP_REQUEST,
-    src_mac_bytes, src_ip_bytes,
-    remote_mac_bytes_empty, remote_ip_bytes);
+    src_mac_bytes_, src_ip_bytes_,
+    target_mac_empty, target_ip);
+  sock_.send(ifindex_, dst_mac, req.data());
+}
+
+void name_resolver::receive_frames(std::vector<std::vector<uint8_t>>& frames) {
+  std::vector<uint8_t> frame;
+  while (sock_.try_recv(ARP_MESSAGE_SIZE, frame)) {
+    frames.push_back(std::move(frame));
+    frame.clear();
+  }
+}
+
+void name_resolver::learn(const std::vector<uint8_t>& frame, const chrono::steady_clock::time_point now) {
+  if (frame.size() < ARP_MESSAGE_SIZE) {
+    return;
+  }
+  const arp_message msg(frame);
+  if (msg.get_hw_type() != HW_TYPE_ETHERNET || msg.get_hw_size() != HW_SIZE_MAC ||
+      msg.get_protocol_type() != PROTOCOL_TYPE_IPV4 || msg.get_protocol_size() != PROTOCOL_SIZE_IPV4) {
+    return;
+  }
+  uint8_t sender_ip[PROTOCOL_SIZE_IPV4];
+  msg.get_sender_ip(sender_ip);
+  uint8_t target_ip[PROTOCOL_SIZE_IPV4];
+  msg.get_target_ip(target_ip);
+  uint8_t sender_mac[HW_SIZE_MAC];
+  msg.get_sender_mac(sender_mac);
+
+  ip_addr sender;
+  sender.from_host_order(sender_ip);
+  // Probes (rfc 5227) have no sender address, and our own frames are seen as well.
+  if (sender == ip_addr() || std::memcmp(sender_ip, src_ip_bytes_, PROTOCOL_SIZE_IPV4) == 0) {
+    return;
+  }
+  const bool for_me = std::memcmp(target_ip, src_ip_bytes_, PROTOCOL_SIZE_IPV4) == 0;
+  const bool gratuitous = std::memcmp(target_ip, sender_ip, PROTOCOL_SIZE_IPV4) == 0;
+
+  auto it = neighbors_.find(sender);
+  if (it == neighbors_.end()) {
+    if (!for_me && !gratuitous) {
+      return;
+    }
+    if (neighbors_.size() >= NEIGHBOR_TABLE_GC_THRESHOLD) {
+      remove_expired(now);
+      if (neighbors_.size() >= NEIGHBOR_TABLE_GC_THRESHOLD) {
+        return;
+      }
+    }
+    neighbor n;
+    n.state = neighbor_state::FAILED;
+    n.requests = 0;
+    std::memset(n.mac, 0, sizeof(n.mac));
+    n.expiry = now;
+    n.refreshed = now - NEIGHBOR_REFRESH_INTERVAL;
+    it = neighbors_.emplace(sender, n).first;
+  }
+  neighbor& n = it->second;
+  const bool changed = std::memcmp(n.mac, sender_mac, HW_SIZE_MAC) != 0;
+  std::memcpy(n.mac, sender_mac, HW_SIZE_MAC);
+  const neighbor_state old_state = n.state;
+  if (for_me && msg.get_operation() == OPERATION_CODE_ARP_RESPONSE) {
+    // Reply to our request: the neighbor is reachable.
+    n.state = neighbor_state::REACHABLE;
+    n.expiry = now + NEIGHBOR_REACHABLE_TIME;
+  } else if (changed || n.state == neighbor_state::INCOMPLETE || n.state == neighbor_state::FAILED) {
+    // The address is known, but not confirmed by a reply.
+    n.state = neighbor_state::STALE;
+    n.expiry = now + NEIGHBOR_STALE_TIME;
+  }
+  if (old_state == neighbor_state::INCOMPLETE) {
+    remove_ip(in_flight_, sender);
+    complete(sender, true, n.mac);
+  }
+  stats_.learned++;
+}
+
+void name_resolver::request(
+    const ip_addr& ip, resolve_callback callback, const chrono::steady_clock::time_point now) {
+  uint8_t ip_bytes[PROTOCOL_SIZE_IPV4];
+  ip.host_order(ip_bytes);
+  completion c;
+  c.ip = ip;
+
+  neighbor *n = find_usable(ip, now);
+  if (n != nullptr) {
+    stats_.hits++;
+    refresh_if_needed(*n, ip_bytes, now);
+    c.callback = std::move(callback);
+    c.resolved = true;
+    std::memcpy(c.mac, n->mac, HW_SIZE_MAC);
+    completed_.push_back(std::move(c));
+    return;
+  }
+  const auto it = neighbors_.find(ip);
+  if (it != neighbors_.end() && it->second.state == neighbor_state::FAILED) {
+    stats_.negative_hits++;
+    c.callback = std::move(callback);
+    c.resolved = false;
+    std::memset(c.mac, 0, HW_SIZE_MAC);
+    completed_.push_back(std::move(c));
+    return;
+  }
+  if (it != neighbors_.end()) {
+    // Share the requests of another lookup.
+    stats_.coalesced++;
+    callbacks_[ip].push_back(std::move(callback));
+    return;
+  }
+  if (neighbors_.size() >= NEIGHBOR_TABLE_GC_THRESHOLD) {
+    remove_expired(now);
+  }
+  bool reachable = false;
+  if (routes_ != nullptr && routes_->lookup_neighbor(ip_bytes, ifindex_, c.mac, reachable)) {
+    // The kernel knows the neighbor, so no request is needed (it is
+    // refreshed by us later like any other entry).
+    neighbor known;
+    known.state = reachable ? neighbor_state::REACHABLE : neighbor_state::STALE;
+    known.requests = 0;
+    std::memcpy(known.mac, c.mac, HW_SIZE_MAC);
+    known.expiry = now + (reachable ? NEIGHBOR_REACHABLE_TIME : NEIGHBOR_STALE_TIME);
+    known.refreshed = now - NEIGHBOR_REFRESH_INTERVAL;
+    neighbors_.emplace(ip, known);
+    stats_.kernel_hits++;
+    c.callback = std::move(callback);
+    c.resolved = true;
+    completed_.push_back(std::move(c));
+    return;
+  }
+  callbacks_[ip].push_back(std::move(callback));
+  neighbor incomplete;
+  incomplete.state = neighbor_state::INCOMPLETE;
+  incomplete.requests = 0;
+  std::memset(incomplete.mac, 0, sizeof(incomplete.mac));
+  incomplete.expiry = chrono::steady_clock::time_point::max();
+  incomplete.refreshed = now;
+  neighbors_.emplace(ip, incomplete);
+  send_queue_.push_back(ip);
+  stats_.misses++;
+}
+
+void name_resolver::complete(const ip_addr ip, const bool resolved, const uint8_t *mac) {
+  const auto it = callbacks_.find(ip);
+  if (it == callbacks_.end()) {
+    return;
+  }
+  for (resolve_callback& callback : it->second) {
+    completion c;
+    c.callback = std::move(callback);
+    c.ip = ip;
+    c.resolved = resolved;
+    std::memcpy(c.mac, mac, HW_SIZE_MAC);
+    completed_.push_back(std::move(c));
+  }
+  callbacks_.erase(it);
+}
 
-  // Send arp request
-  uint8_t dst_mac_bytes_broadcast[HW_SIZE_MAC] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
-  socket_wrapper sock_for_arp(ETH_P_ARP);
-  sock_for_arp.send(src_ifname_, dst_mac_bytes_broadcast, req.data());
+void name_resolver::service(const chrono::steady_clock::time_point now) {
+  const uint8_t mac_zero[HW_SIZE_MAC] = {0x0, 0x0, 0x0, 0x0, 0x0, 0x0};
+  // Send again, or give up, requests which were not replied in time.
+  for (size_t i = 0; i < in_flight_.size();) {
+    const ip_addr ip = in_flight_[i];
+    const auto it = neighbors_.find(ip);
+    neighbor *n = it == neighbors_.end() ? nullptr : &it->second;
+    if (n != nullptr && n->state == neighbor_state::INCOMPLETE && now < n->expiry) {
+      ++i;
+      continue;
+    }
+    in_flight_[i] = in_flight_.back();
+    in_flight_.pop_back();
+    if (n == nullptr || n->state != neighbor_state::INCOMPLETE) {
+      continue;
+    }
+    if (n->requests < ARP_MAX_REQUESTS) {
+      n->expiry = chrono::steady_clock::time_point::max();
+      send_queue_.push_back(ip);
+      stats_.retransmits++;
+    } else {
+      n->state = neighbor_state::FAILED;
+      n->expiry = now + NEIGHBOR_FAILED_TIME;
+      stats_.failures++;
+      complete(ip, false, mac_zero);
+    }
+  }
 
-  // Receive arp response
-  std::vector<uint8_t> arp_resp_data;
-  sock_for_arp.recv(sizeof(arp_message), arp_resp_data);
+  // Send queued requests, paced by a token bucket of ARP_REQUEST_BURST.
+  const chrono::steady_clock::time_point earliest = now - ARP_REQUEST_BURST * ARP_REQUEST_INTERVAL;
+  if (next_send_ < earliest) {
+    next_send_ = earliest;
+  }
+  while (!send_queue_.empty() && next_send_ <= now) {
+    const ip_addr ip = send_queue_.front();
+    send_queue_.pop_front();
+    const auto it = neighbors_.find(ip);
+    if (it == neighbors_.end() || it->second.state != neighbor_state::INCOMPLETE ||
+        it->second.expiry != chrono::steady_clock::time_point::max()) {
+      // Resolved (or queued twice) meanwhile
+      continue;
+    }
+    neighbor& n = it->second;
+    uint8_t ip_bytes[PROTOCOL_SIZE_IPV4];
+    ip.host_order(ip_bytes);
+    send_request(ip_bytes, MAC_BROADCAST);
+    n.expiry = now + ARP_RETRANSMIT_TIMEOUT * (1 << n.requests);
+    n.requests++;
+    in_flight_.push_back(ip);
+    stats_.requests++;
+    next_send_ += ARP_REQUEST_INTERVAL;
+  }
+}
+
+chrono::steady_clock::time_point name_resolver::next_expiry() const {
+  chrono::steady_clock::time_point next = chrono::steady_clock::time_point::max();
+  if (!send_queue_.empty()) {
+    next = next_send_;
+  }
+  for (const ip_addr ip : in_flight_) {
+    const auto it = neighbors_.find(ip);
+    if (it != neighbors_.end() && it->second.expiry < next) {
+      next = it->second.expiry;
+    }
+  }
+  return next;
+}
+
+void name_resolver::finish(std::unique_lock<std::mutex>& lock) {
+  if (completed_.empty()) {
+    return;
+  }
+  std::vector<completion> completed;
+  completed.swap(completed_);
+  lock.unlock();
+  for (const completion& c : completed) {
+    mac_addr mac;
+    mac.from_host_order(c.mac);
+    c.callback(c.ip, c.resolved, mac);
+  }
+  lock.lock();
+  learned_.notify_all();
+}
+
+void name_resolver::wait(std::unique_lock<std::mutex>& lock, const std::function<bool()>& done) {
+  while (!done()) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (receiving_) {
+      // Another thread receives ARP frames for us.
+      learned_.wait_until(lock, now + ARP_RETRANSMIT_TIMEOUT);
+      continue;
+    }
+    receiving_ = true;
+    service(now);
+    const chrono::steady_clock::time_point next =
+      std::min(next_expiry(), now + ARP_RETRANSMIT_TIMEOUT);
+    finish(lock);
+    if (done()) {
+      receiving_ = false;
+      learned_.notify_all();
+      break;
+    }
+    lock.unlock();
+    struct pollfd pfd = {};
+    pfd.fd = sock_.get_fd();
+    pfd.events = POLLIN;
+    const chrono::milliseconds timeout = std::max(
+        chrono::ceil<chrono::milliseconds>(next - chrono::steady_clock::now()),
+        chrono::milliseconds::zero());
+    const int ret = poll(&pfd, 1, timeout.count());
+    const int poll_errno = errno;
+    std::vector<std::vector<uint8_t>> frames;
+    try {
+      if (ret > 0) {
+        receive_frames(frames);
+      }
+    } catch (...) {
+      lock.lock();
+      receiving_ = false;
+      learned_.notify_all();
+      throw;
+    }
+    lock.lock();
+    receiving_ = false;
+    now = chrono::steady_clock::now();
+    for (const std::vector<uint8_t>& frame : frames) {
+      learn(frame, now);
+    }
+    service(now);
+    finish(lock);
+    learned_.notify_all();
+    if (ret == -1 && poll_errno != EINTR) {
+      std::string msg = "Failed to poll: ";
+      msg += std::strerror(poll_errno);
+      throw std::runtime_error(msg);
+    }
+  }
+}
+
+void name_resolver::resolve(const ip_addr remote_ip, mac_addr& remote_mac) {
+  if (lookup(remote_ip, remote_mac)) {
+    return;
+  }
+  const std::vector<resolve_result> results = resolve(std::vector<ip_addr>{remote_ip});
+  if (!results[0].resolved) {
+    throw no_reply(remote_ip);
+  }
+  remote_mac = results[0].mac;
+}
+
+std::vector<resolve_result> name_resolver::resolve(const std::vector<ip_addr>& remote_ips) {
+  struct batch {
+    std::vector<resolve_result> results;
+    size_t remaining;
+  };
+  // Shared with the callbacks, which may be called on another thread.
+  // (remaining is updated with mutex_ held)
+  const auto b = std::make_shared<batch>();
+  b->results.resize(remote_ips.size());
+  b->remaining = remote_ips.size();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  for (size_t i = 0; i < remote_ips.size(); ++i) {
+    request(remote_ips[i], [this, b, i](const ip_addr& ip, const bool resolved, const mac_addr& mac) {
+        resolve_result& r = b->results[i];
+        r.ip = ip;
+        r.resolved = resolved;
+        r.mac = mac;
+        std::lock_guard<std::mutex> lock(mutex_);
+        b->remaining--;
+      }, now);
+  }
+  wait(lock, [&b]() { return b->remaining == 0; });
+  return std::move(b->results);
+}
+
+void name_resolver::resolve_async(const std::vector<ip_addr>& remote_ips, const resolve_callback& callback) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  for (const ip_addr& ip : remote_ips) {
+    request(ip, callback, now);
+  }
+  service(now);
+  finish(lock);
+}
+
+bool name_resolver::lookup(const ip_addr remote_ip, mac_addr& remote_mac) {
+  uint8_t remote_ip_bytes[PROTOCOL_SIZE_IPV4];
+  remote_ip.host_order(remote_ip_bytes);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  neighbor *n = find_usable(remote_ip, now);
+  if (n == nullptr) {
+    return false;
+  }
+  stats_.hits++;
+  refresh_if_needed(*n, remote_ip_bytes, now);
+  remote_mac.from_host_order(n->mac);
+  return true;
+}
+
+void name_resolver::process() {
+  std::vector<std::vector<uint8_t>> frames;
+  receive_frames(frames);
+  std::unique_lock<std::mutex> lock(mutex_);
+  const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  for (const std::vector<uint8_t>& frame : frames) {
+    learn(frame, now);
+  }
+  service(now);
+  finish(lock);
+}
 
-  // Parse arp response
-  arp_message resp(arp_resp_data);
+chrono::steady_clock::time_point name_resolver::get_next_expiry() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_expiry();
+}
+
+int name_resolver::get_fd() const {
+  return sock_.get_fd();
+}
+
+void name_resolver::set_capture(pcapng_writer *capture) {
+  sock_.set_capture(capture);
+}
+
+size_t name_resolver::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return neighbors_.size();
+}
 
-  // Get remote mac address from arp response
-  uint8_t remote_mac_bytes[HW_SIZE_MAC];
-  resp.get_sender_mac(remote_mac_bytes);
-  remote_mac.from_host_order(reinterpret_cast<const char *>(remote_mac_bytes));
+name_resolver_stats name_resolver::get_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
 }
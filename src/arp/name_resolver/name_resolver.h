@@ -1,19 +1,248 @@
 #ifndef NAME_RESOLVER_H_
 #define NAME_RESOLVER_H_
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "arp_message.h"
 #include "ip_addr.h"
 #include "mac_addr.h"
+#include "route_table.h"
+#include "socket_wrapper.h"
 
+// An entry is used without asking the neighbor for this long after its
+// link address was confirmed (like base_reachable_time of Linux).
+const std::chrono::seconds NEIGHBOR_REACHABLE_TIME(30);
+// After that, the entry is still used (and refreshed) for this long.
+const std::chrono::seconds NEIGHBOR_STALE_TIME(60);
+// A used entry is refreshed when it is this close to becoming stale...
+const std::chrono::seconds NEIGHBOR_REFRESH_MARGIN(5);
+// ...but at most once in this interval.
+const std::chrono::seconds NEIGHBOR_REFRESH_INTERVAL(1);
+// A neighbor which did not reply is not asked again for this long.
+const std::chrono::seconds NEIGHBOR_FAILED_TIME(3);
+// Time to wait for the reply to the first ARP request. Doubled for each
+// request sent again.
+const std::chrono::milliseconds ARP_RETRANSMIT_TIMEOUT(250);
+// Requests sent to a neighbor before it is given up (like mcast_solicit of Linux).
+const uint8_t ARP_MAX_REQUESTS = 3;
+// Requests of a batch are paced: up to ARP_REQUEST_BURST at once, and then
+// one per ARP_REQUEST_INTERVAL.
+const std::chrono::microseconds ARP_REQUEST_INTERVAL(100);
+const int ARP_REQUEST_BURST = 16;
+// Expired entries are removed once the cache has this many entries. Neighbors
+// which are not asked for are not learned while it is still full.
+const size_t NEIGHBOR_TABLE_GC_THRESHOLD = 1024;
+
+enum class neighbor_state : uint8_t {
+  // The request is sent, and no reply has arrived yet.
+  INCOMPLETE,
+  // The link address was confirmed recently.
+  REACHABLE,
+  // The link address is used, but not confirmed recently.
+  STALE,
+  // No reply arrived (negative entry).
+  FAILED,
+};
+
+struct name_resolver_stats {
+  uint64_t hits;           // lookups answered by the cache
+  uint64_t misses;         // lookups which sent a request
+  uint64_t kernel_hits;    // lookups answered by the neighbor table of the kernel
+  uint64_t coalesced;      // lookups which waited for the request of another lookup
+  uint64_t negative_hits;  // lookups refused by a negative entry
+  uint64_t requests;       // requests sent (broadcast)
+  uint64_t retransmits;    // requests sent again as no reply arrived
+  uint64_t refreshes;      // requests sent to refresh an entry (unicast)
+  uint64_t learned;        // ARP frames which created or updated an entry
+  uint64_t failures;       // neighbors given up as no reply arrived
+};
+
+// Called once per target of resolve_async(). mac is all zero unless resolved.
+using resolve_callback =
+  std::function<void(const ip_addr& ip, const bool resolved, const mac_addr& mac)>;
+
+struct resolve_result {
+  ip_addr ip;
+  bool resolved;
+  mac_addr mac;
+};
+
+// NOTE
+// (rfc 826 - Packet Reception)
+//   ?Do I have the hardware type in ar$hrd?
+//   Yes: (almost definitely)
+//     [optionally check the hardware length ar$hln]
+//     ?Do I speak the protocol in ar$pro?
+//     Yes:
+//       [optionally check the protocol length ar$pln]
+//       Merge_flag := false
+//       If the pair <protocol type, sender protocol address> is
+//           already in my translation table, update the sender
+//           hardware address field of the entry with the new
+//           information in the packet and set Merge_flag to true.
+//       ?Am I the target protocol address?
+//       Yes:
+//         If Merge_flag is false, add the triplet <protocol type,
+//             sender protocol address, sender hardware address> to
+//             the translation table.
+//
+// (rfc 1122 - 2.3.2.1 ARP Cache Validation)
+//   (2)  Unicast Poll -- Actively poll the remote host by
+//        periodically sending a point-to-point ARP Request
+//        to it, and delete the entry if no ARP Reply is
+//        received from N successive polls.
+//
+// Neighbor cache in front of ARP. Lookups of cached neighbors are a hash
+// lookup, and only unknown neighbors wait for ARP:
+//
+//   INCOMPLETE --reply--> REACHABLE --30 s--> STALE --60 s--> (removed)
+//       |                     ^                  |
+//       |                     +------reply-------+
+//       +--no reply to 3 requests--> FAILED --3 s--> (removed)
+//
+// A used entry close to becoming stale is refreshed by a unicast request, and
+// its reply confirms the entry again. Any ARP frame received (including
+// gratuitous ARP) updates the cache as RFC 826 merges it. Only replies with
+// the sender IP of an INCOMPLETE entry resolve it.
+//
+// Before asking an unknown neighbor, the neighbor table of the kernel is
+// consulted if a route_table is given, so that neighbors the kernel already
+// knows cost no round trip.
+//
+// Unknown neighbors are resolved in batches: their requests are queued, sent
+// paced over the one ARP socket, and sent again with exponential backoff
+// (250, 500 and 1000 ms) until a reply arrives or ARP_MAX_REQUESTS is
+// reached. Concurrent lookups of the same neighbor share its requests.
+//
+// Work is driven by the callers: the blocking resolve() receives ARP frames
+// itself (one thread at a time, the others wait for it), and the owner of
+// resolve_async() calls process() when get_fd() is readable or at
+// get_next_expiry(). Callbacks run on the thread driving the resolver
+// without the lock, and may call the resolver again.
+//
+// All member functions may be called from any thread.
 class name_resolver {
  private:
+  struct neighbor {
+    neighbor_state state;
+    // requests sent while INCOMPLETE
+    uint8_t requests;
+    uint8_t mac[HW_SIZE_MAC];
+    // when the entry leaves the state (INCOMPLETE: when the request is sent
+    // again, or time_point::max() while the request is queued)
+    std::chrono::steady_clock::time_point expiry;
+    // when the last refresh request was sent
+    std::chrono::steady_clock::time_point refreshed;
+  };
+
   ip_addr  src_ip_;
   mac_addr src_mac_;
-  std::string src_ifname_;
+  int ifindex_;
+  // neighbors known by the kernel (nullptr if not used)
+  const route_table *routes_;
+  uint8_t src_ip_bytes_[PROTOCOL_SIZE_IPV4];
+  uint8_t src_mac_bytes_[HW_SIZE_MAC];
+  socket_wrapper sock_;
+  std::mutex mutex_;
+  // notified when an entry is learned or a request fails
+  std::condition_variable learned_;
+  // true while a thread is waiting for ARP frames on sock_
+  bool receiving_;
+  std::unordered_map<ip_addr, neighbor> neighbors_;
+  // Callbacks of INCOMPLETE entries
+  std::unordered_map<ip_addr, std::vector<resolve_callback>> callbacks_;
+  // INCOMPLETE entries whose request is to be sent
+  std::deque<ip_addr> send_queue_;
+  // INCOMPLETE entries whose request is sent
+  std::vector<ip_addr> in_flight_;
+  // when the next queued request may be sent
+  std::chrono::steady_clock::time_point next_send_;
+  // Callbacks to be called (without the lock)
+  struct completion {
+    resolve_callback callback;
+    ip_addr ip;
+    bool resolved;
+    uint8_t mac[HW_SIZE_MAC];
+  };
+  std::vector<completion> completed_;
+  name_resolver_stats stats_;
+
+  // Move the entry to the state it has at now, and return false if it
+  // should be removed.
+  static bool update_state(neighbor& n, const std::chrono::steady_clock::time_point now);
+  // Returns the entry if it can be used now (REACHABLE or STALE).
+  // Must be called with mutex_ held.
+  neighbor *find_usable(const ip_addr ip, const std::chrono::steady_clock::time_point now);
+  // Must be called with mutex_ held.
+  void remove_expired(const std::chrono::steady_clock::time_point now);
+  // Must be called with mutex_ held.
+  void refresh_if_needed(
+      neighbor& n, const uint8_t *ip, const std::chrono::steady_clock::time_point now);
+  void send_request(const uint8_t *target_ip, const uint8_t *dst_mac);
+  // Receive ARP frames until none is left. Must be called without mutex_ held.
+  void receive_frames(std::vector<std::vector<uint8_t>>& frames);
+  // Must be called with mutex_ held.
+  void learn(const std::vector<uint8_t>& frame, const std::chrono::steady_clock::time_point now);
+  // Start resolving the neighbor (or complete at once if it is cached).
+  // Must be called with mutex_ held.
+  void request(
+      const ip_addr& ip,
+      resolve_callback callback,
+      const std::chrono::steady_clock::time_point now);
+  // Queue the callbacks of an INCOMPLETE entry which left the state.
+  // Must be called with mutex_ held.
+  void complete(const ip_addr ip, const bool resolved, const uint8_t *mac);
+  // Send queued requests, and send again or give up requests without reply.
+  // Must be called with mutex_ held.
+  void service(const std::chrono::steady_clock::time_point now);
+  // Must be called with mutex_ held.
+  std::chrono::steady_clock::time_point next_expiry() const;
+  // Call the queued callbacks without the lock.
+  void finish(std::unique_lock<std::mutex>& lock);
+  // Drive the resolver until done() (called with mutex_ held) returns true.
+  void wait(std::unique_lock<std::mutex>& lock, const std::function<bool()>& done);
  public:
   name_resolver(const std::string src_ifname, const mac_addr src_mac, const ip_addr src_ip);
+  // Same as above, but neighbors known by the kernel are taken from routes
+  // instead of sending ARP requests.
+  name_resolver(
+      const std::string src_ifname, const mac_addr src_mac, const ip_addr src_ip,
+      const route_table& routes);
+  name_resolver(const name_resolver&) = delete;
+  name_resolver& operator=(const name_resolver&) = delete;
+  // Throws std::runtime_error if the neighbor does not reply (or did not
+  // reply recently).
   void resolve(const ip_addr remote_ip, mac_addr& remote_mac);
+  // Resolve all neighbors at once, and wait until each is resolved or given up.
+  std::vector<resolve_result> resolve(const std::vector<ip_addr>& remote_ips);
+  // Start resolving the neighbors without blocking. callback is called once
+  // per target, right away for cached ones.
+  void resolve_async(const std::vector<ip_addr>& remote_ips, const resolve_callback& callback);
+  // Cache only. Returns false unless the neighbor is cached and usable.
+  bool lookup(const ip_addr remote_ip, mac_addr& remote_mac);
+  // Learn from the ARP frames received so far, and send requests which are
+  // due, without blocking.
+  void process();
+  // When process() should be called next, or time_point::max() if nothing
+  // is pending.
+  std::chrono::steady_clock::time_point get_next_expiry();
+  // File descriptor of the ARP socket to wait for with poll()/epoll.
+  int get_fd() const;
+  // Capture the ARP frames sent and received (see socket_wrapper::set_capture()).
+  // Must be called while no other thread uses the resolver.
+  void set_capture(pcapng_writer *capture);
+  // Number of entries, including negative and incomplete ones.
+  size_t size();
+  name_resolver_stats get_stats();
 };
 
 #endif  // NAME_RESOLVER_H_
@@ -0,0 +1,61 @@
+#include <cstdlib>   // for std::malloc(), std::free(), std::aligned_alloc()
+#include <malloc.h>  // for malloc_usable_size()
+#include <new>
+
+#include "alloc_counter.h"
+
+namespace {
+thread_local uint64_t allocations = 0;
+thread_local size_t live_heap_bytes = 0;
+
+void *counted_alloc(void *p) {
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  allocations++;
+  live_heap_bytes += malloc_usable_size(p);
+  return p;
+}
+
+void counted_free(void *p) {
+  if (p == nullptr) {
+    return;
+  }
+  live_heap_bytes -= malloc_usable_size(p);
+  std::free(p);
+}
+} // namespace
+
+uint64_t thread_allocations() {
+  return allocations;
+}
+
+size_t thread_live_heap_bytes() {
+  return live_heap_bytes;
+}
+
+void *operator new(size_t size) {
+  return counted_alloc(std::malloc(size));
+}
+
+void *operator new[](size_t size) {
+  return counted_alloc(std::malloc(size));
+}
+
+void *operator new(size_t size, std::align_val_t al) {
+  const size_t align = static_cast<size_t>(al);
+  return counted_alloc(std::aligned_alloc(align, (size + align - 1) / align * align));
+}
+
+void *operator new[](size_t size, std::align_val_t al) {
+  return operator new(size, al);
+}
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
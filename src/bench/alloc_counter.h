@@ -0,0 +1,21 @@
+#ifndef ALLOC_COUNTER_H_
+#define ALLOC_COUNTER_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+// NOTE
+// Counters of the heap, kept by replacing the global allocation functions
+// (operator new and delete) in the programs linked with alloc_counter.
+// The counters are per thread, so that threads running in parallel neither
+// share them nor contend on them.
+
+// Allocations made by the calling thread so far.
+uint64_t thread_allocations();
+
+// Bytes of the blocks allocated and not freed yet by the calling thread
+// (their usable size, which malloc may round up). A block freed by another
+// thread is subtracted from the counter of that thread.
+size_t thread_live_heap_bytes();
+
+#endif  // ALLOC_COUNTER_H_
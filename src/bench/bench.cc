@@ -0,0 +1,266 @@
+#include <benchmark/benchmark.h>
+#include <cstring>   // for std::memcpy()
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "arp_message.h"
+#include "ip_addr.h"
+#include "ip_packet.h"
+#include "tcp_options.h"
+#include "tcp_segment.h"
+#include "transmission_control_block.h"
+
+namespace {
+const uint8_t LOCAL_IP[4]   = {10, 0, 0, 1};
+const uint8_t REMOTE_IP[4]  = {10, 0, 0, 2};
+const uint8_t LOCAL_MAC[6]  = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+const uint8_t REMOTE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+const uint16_t LOCAL_PORT   = 50000;
+const uint16_t REMOTE_PORT  = 80;
+const uint16_t WINDOW       = 64240;
+const uint16_t MSS          = 1460;
+const uint32_t REMOTE_ISS   = 1000;
+// Segments made ahead of the timed part of a receive benchmark at a time
+const size_t RECEIVE_BATCH  = 1024;
+
+// Count the allocations from construction to destruction, i.e. of the
+// benchmark loop when it is put right before the loop, and report them per
+// iteration as the "allocs" counter.
+class allocation_counter {
+ private:
+  benchmark::State& state_;
+  uint64_t begin_;
+  // allocations of the untimed parts of the loop
+  uint64_t skipped_;
+ public:
+  explicit allocation_counter(benchmark::State& state)
+    : state_(state), begin_(thread_allocations()), skipped_(0) {}
+  ~allocation_counter() {
+    state_.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(thread_allocations() - begin_ - skipped_),
+        benchmark::Counter::kAvgIterations);
+  }
+  // Do not count the allocations made since before (a thread_allocations()).
+  void skip_since(const uint64_t before) {
+    skipped_ += thread_allocations() - before;
+  }
+};
+
+std::vector<uint8_t> make_body(const size_t size) {
+  std::vector<uint8_t> body(size);
+  for (size_t i = 0; i < size; ++i) {
+    body[i] = static_cast<uint8_t>(i);
+  }
+  return body;
+}
+
+tcp_segment make_segment(const size_t size) {
+  return tcp_segment(
+      LOCAL_IP, REMOTE_IP, LOCAL_PORT, REMOTE_PORT, 1, 1,
+      false, false, false, false, true, true, false, false, false,
+      WINDOW, 0, std::vector<uint8_t>(), make_body(size));
+}
+
+// TCB in ESTABLISHED (SYN, SYN-ACK with the MSS option, ACK)
+void establish(transmission_control_block& tcb) {
+  tcb.set_nodelay(true);
+  const tcp_segment syn = tcb.create_send_segment(
+      LOCAL_IP, LOCAL_PORT, REMOTE_IP, REMOTE_PORT,
+      false, false, false, false, false, false, false, true, false,
+      WINDOW, 0, std::vector<uint8_t>(), std::vector<uint8_t>());
+  tcp_options options;
+  options.set_mss(MSS);
+  const tcp_segment syn_ack(
+      REMOTE_IP, LOCAL_IP, REMOTE_PORT, LOCAL_PORT,
+      REMOTE_ISS, syn.get_seq() + 1,
+      false, false, false, false, true, false, false, true, false,
+      WINDOW, 0, options.marshal(), std::vector<uint8_t>());
+  tcb.apply_receive_segment(syn_ack);
+  tcb.create_ack_segment(LOCAL_IP, LOCAL_PORT, REMOTE_IP, REMOTE_PORT, WINDOW);
+}
+
+void payload_sizes(benchmark::internal::Benchmark *b) {
+  b->Arg(0)->Arg(64)->Arg(512)->Arg(1460)->Arg(9000);
+}
+
+void BM_ip_checksum(benchmark::State& state) {
+  const ip_packet pkt(PROTOCOL_TCP, LOCAL_IP, REMOTE_IP, std::vector<uint8_t>());
+  const std::vector<uint8_t> marshaled = pkt.marshal();
+  struct iphdr header;
+  std::memcpy(&header, marshaled.data(), sizeof(header));
+  header.check = 0;
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(&header);
+    benchmark::DoNotOptimize(calc_checksum(&header));
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(header));
+}
+BENCHMARK(BM_ip_checksum);
+
+void BM_ip_packet_construct(benchmark::State& state) {
+  const std::vector<uint8_t> body = make_body(state.range(0));
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const ip_packet pkt(PROTOCOL_TCP, LOCAL_IP, REMOTE_IP, body);
+    benchmark::DoNotOptimize(&pkt);
+  }
+  state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_ip_packet_construct)->Apply(payload_sizes);
+
+void BM_ip_packet_marshal(benchmark::State& state) {
+  const ip_packet pkt(PROTOCOL_TCP, LOCAL_IP, REMOTE_IP, make_body(state.range(0)));
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const std::vector<uint8_t> marshaled = pkt.marshal();
+    benchmark::DoNotOptimize(marshaled.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ip_packet_marshal)->Apply(payload_sizes);
+
+void BM_ip_packet_parse(benchmark::State& state) {
+  const std::vector<uint8_t> marshaled =
+    ip_packet(PROTOCOL_TCP, LOCAL_IP, REMOTE_IP, make_body(state.range(0))).marshal();
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const ip_packet pkt(marshaled);
+    benchmark::DoNotOptimize(pkt.get_tot_len());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ip_packet_parse)->Apply(payload_sizes);
+
+// (including the checksum over the pseudo header and the body)
+void BM_tcp_segment_construct(benchmark::State& state) {
+  const std::vector<uint8_t> body = make_body(state.range(0));
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const tcp_segment seg(
+        LOCAL_IP, REMOTE_IP, LOCAL_PORT, REMOTE_PORT, 1, 1,
+        false, false, false, false, true, true, false, false, false,
+        WINDOW, 0, std::vector<uint8_t>(), body.data(), body.size());
+    benchmark::DoNotOptimize(seg.get_checksum());
+  }
+  state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_tcp_segment_construct)->Apply(payload_sizes);
+
+void BM_tcp_segment_marshal(benchmark::State& state) {
+  const tcp_segment seg = make_segment(state.range(0));
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const std::vector<uint8_t> marshaled = seg.marshal();
+    benchmark::DoNotOptimize(marshaled.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_tcp_segment_marshal)->Apply(payload_sizes);
+
+void BM_tcp_segment_parse(benchmark::State& state) {
+  const std::vector<uint8_t> marshaled = make_segment(state.range(0)).marshal();
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const tcp_segment seg(marshaled);
+    benchmark::DoNotOptimize(seg.get_body_size());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_tcp_segment_parse)->Apply(payload_sizes);
+
+void BM_arp_message_round_trip(benchmark::State& state) {
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    arp_message request(
+        HW_TYPE_ETHERNET, PROTOCOL_TYPE_IPV4, HW_SIZE_MAC, PROTOCOL_SIZE_IPV4,
+        OPERATION_CODE_ARP_REQUEST, LOCAL_MAC, LOCAL_IP, REMOTE_MAC, REMOTE_IP);
+    const arp_message parsed(request.data());
+    benchmark::DoNotOptimize(parsed.get_operation());
+  }
+}
+BENCHMARK(BM_arp_message_round_trip);
+
+void BM_ip_addr_from_string(benchmark::State& state) {
+  const std::string str = "192.168.100.200";
+  ip_addr addr;
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    addr.from_string(str);
+    benchmark::DoNotOptimize(addr);
+  }
+}
+BENCHMARK(BM_ip_addr_from_string);
+
+void BM_ip_addr_to_string(benchmark::State& state) {
+  ip_addr addr;
+  addr.from_string("192.168.100.200");
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(addr);
+    const std::string str = addr.to_string();
+    benchmark::DoNotOptimize(str.data());
+  }
+}
+BENCHMARK(BM_ip_addr_to_string);
+
+// Segment of new data (snd_nxt advances as if every segment were sent)
+void BM_create_send_segment(benchmark::State& state) {
+  transmission_control_block tcb;
+  establish(tcb);
+  const std::vector<uint8_t> body = make_body(state.range(0));
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    const tcp_segment seg = tcb.create_send_segment(
+        LOCAL_IP, LOCAL_PORT, REMOTE_IP, REMOTE_PORT,
+        false, false, false, false, true, true, false, false, false,
+        WINDOW, 0, std::vector<uint8_t>(), body);
+    benchmark::DoNotOptimize(seg.get_seq());
+  }
+  state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_create_send_segment)->Apply(payload_sizes);
+
+// In-order data from the peer, read right away so the window stays open.
+// The segments are made in batches with the timer paused.
+void BM_apply_receive_segment(benchmark::State& state) {
+  transmission_control_block tcb;
+  establish(tcb);
+  const std::vector<uint8_t> body = make_body(state.range(0));
+  const uint32_t ack_seq = tcb.create_ack_segment(
+      LOCAL_IP, LOCAL_PORT, REMOTE_IP, REMOTE_PORT, WINDOW).get_seq();
+  uint32_t seq = REMOTE_ISS + 1;
+  std::vector<tcp_segment> batch;
+  batch.reserve(RECEIVE_BATCH);
+  size_t next = 0;
+  allocation_counter counter(state);
+  for (auto _ : state) {
+    if (next == batch.size()) {
+      state.PauseTiming();
+      const uint64_t before = thread_allocations();
+      batch.clear();
+      for (size_t i = 0; i < RECEIVE_BATCH; ++i) {
+        batch.emplace_back(
+            REMOTE_IP, LOCAL_IP, REMOTE_PORT, LOCAL_PORT, seq, ack_seq,
+            false, false, false, false, true, true, false, false, false,
+            WINDOW, 0, std::vector<uint8_t>(), body.data(), body.size());
+        seq += body.size();
+      }
+      next = 0;
+      // (not counted either)
+      counter.skip_since(before);
+      state.ResumeTiming();
+    }
+    tcb.apply_receive_segment(batch[next++]);
+    const byte_range received = tcb.get_received();
+    if (received.size != 0) {
+      tcb.consume_received(received.size);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_apply_receive_segment)->Apply(payload_sizes);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,444 @@
+#include <algorithm>            // for std::sort(), std::min()
+#include <arpa/inet.h>          // for inet_pton(), htons()
+#include <cerrno>               // for errno
+#include <chrono>
+#include <csignal>              // for kill(), SIGKILL
+#include <cstdlib>              // for std::atoi(), std::exit()
+#include <cstring>              // for std::memset(), std::strerror()
+#include <fcntl.h>              // for open(), O_RDONLY
+#include <iomanip>              // for std::setprecision()
+#include <iostream>
+#include <linux/perf_event.h>   // for struct perf_event_attr, PERF_*
+#include <netinet/in.h>         // for struct sockaddr_in, IPPROTO_TCP
+#include <netinet/tcp.h>        // for TCP_NODELAY
+#include <sched.h>              // for setns(), CLONE_NEWNET
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>         // for socket(), bind(), listen(), accept()
+#include <sys/syscall.h>        // for SYS_perf_event_open
+#include <sys/wait.h>           // for waitpid()
+#include <thread>
+#include <time.h>               // for clock_gettime()
+#include <unistd.h>             // for fork(), execvp(), pipe(), access(), close()
+#include <vector>
+
+#include "event_loop.h"
+#include "ip_addr.h"
+#include "task.h"
+#include "tcp_connection.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const char *CLIENT_NETNS   = "raw_tcp_e2e_cli";
+const char *SERVER_NETNS   = "raw_tcp_e2e_srv";
+const char *CLIENT_IFNAME  = "e2e0";
+const char *SERVER_IFNAME  = "e2e1";
+const char *CLIENT_ADDRESS = "10.203.0.1/24";
+const char *SERVER_IP      = "10.203.0.2";
+const char *SERVER_ADDRESS = "10.203.0.2/24";
+// The server reads and discards on one port, and echoes on the other.
+const uint16_t SINK_PORT   = 5001;
+const uint16_t ECHO_PORT   = 5002;
+const size_t CHUNK_SIZE    = 65536;
+
+// Run a command (e.g. ip) and wait for it. Throws if it fails.
+void run_command(const std::vector<std::string>& args) {
+  std::vector<char *> argv;
+  for (const std::string& arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  const pid_t pid = fork();
+  if (pid == -1) {
+    std::string msg = "Failed to fork: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  if (pid == 0) {
+    execvp(argv[0], argv.data());
+    std::_Exit(127);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::string msg = "Failed to run:";
+    for (const std::string& arg : args) {
+      msg += " " + arg;
+    }
+    throw std::runtime_error(msg);
+  }
+}
+
+void enter_netns(const std::string& name) {
+  const std::string path = "/run/netns/" + name;
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1 || setns(fd, CLONE_NEWNET) == -1) {
+    std::string msg = "Failed to enter " + path + ": ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  close(fd);
+}
+
+// NOTE
+// Two network namespaces joined by a veth pair, so that the numbers do not
+// depend on the interfaces or the firewall of the host. They are deleted
+// (with the veth pair) when the network goes out of scope.
+//
+// The kernel of the client namespace owns the client address too, and
+// would reset the connections of this stack (see README). TCP from the
+// veth is blackholed by a routing rule put before the local table instead,
+// which the packet socket still sees.
+class test_network {
+ public:
+  test_network() {
+    remove();
+    run_command({"ip", "netns", "add", CLIENT_NETNS});
+    run_command({"ip", "netns", "add", SERVER_NETNS});
+    try {
+      run_command({"ip", "link", "add", CLIENT_IFNAME, "netns", CLIENT_NETNS, "type", "veth",
+                   "peer", "name", SERVER_IFNAME, "netns", SERVER_NETNS});
+      run_command({"ip", "-n", CLIENT_NETNS, "addr", "add", CLIENT_ADDRESS, "dev", CLIENT_IFNAME});
+      run_command({"ip", "-n", SERVER_NETNS, "addr", "add", SERVER_ADDRESS, "dev", SERVER_IFNAME});
+      run_command({"ip", "-n", CLIENT_NETNS, "link", "set", CLIENT_IFNAME, "up"});
+      run_command({"ip", "-n", SERVER_NETNS, "link", "set", SERVER_IFNAME, "up"});
+      run_command({"ip", "-n", CLIENT_NETNS, "rule", "add", "pref", "100",
+                   "iif", CLIENT_IFNAME, "ipproto", "tcp", "blackhole"});
+      run_command({"ip", "-n", CLIENT_NETNS, "rule", "add", "pref", "32765", "table", "local"});
+      run_command({"ip", "-n", CLIENT_NETNS, "rule", "del", "pref", "0"});
+    } catch (...) {
+      remove();
+      throw;
+    }
+  }
+  test_network(const test_network&) = delete;
+  test_network& operator=(const test_network&) = delete;
+  ~test_network() {
+    remove();
+  }
+  // Delete the namespaces (e.g. left by a run which was killed).
+  static void remove() {
+    for (const char *name : {CLIENT_NETNS, SERVER_NETNS}) {
+      if (access((std::string("/run/netns/") + name).c_str(), F_OK) == 0) {
+        run_command({"ip", "netns", "del", name});
+      }
+    }
+  }
+};
+
+int listen_on(const uint16_t port) {
+  const int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, SERVER_IP, &addr.sin_addr);
+  const int on = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (sock == -1
+      || bind(sock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1
+      || listen(sock, 1024) == -1) {
+    std::string msg = "Failed to listen: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  return sock;
+}
+
+// Serve the connections of a port one after another (the client runs one
+// at a time) until killed.
+void serve(const int listener, const bool echo) {
+  std::vector<uint8_t> buffer(CHUNK_SIZE);
+  while (true) {
+    const int conn = accept(listener, nullptr, nullptr);
+    if (conn == -1) {
+      continue;
+    }
+    const int on = 1;
+    setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    while (true) {
+      const ssize_t len = recv(conn, buffer.data(), buffer.size(), 0);
+      if (len <= 0) {
+        break;
+      }
+      if (echo && send(conn, buffer.data(), len, MSG_NOSIGNAL) != len) {
+        break;
+      }
+    }
+    close(conn);
+  }
+}
+
+// Start the kernel TCP server in the server namespace. Returns once it
+// listens.
+pid_t start_server() {
+  int ready[2];
+  if (pipe(ready) == -1) {
+    std::string msg = "Failed to create pipe: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  const pid_t pid = fork();
+  if (pid == -1) {
+    std::string msg = "Failed to fork: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  if (pid == 0) {
+    close(ready[0]);
+    try {
+      enter_netns(SERVER_NETNS);
+      const int sink = listen_on(SINK_PORT);
+      const int echo = listen_on(ECHO_PORT);
+      std::thread echo_server(serve, echo, true);
+      const char c = 0;
+      write(ready[1], &c, 1);
+      serve(sink, false);
+    } catch (const std::exception& e) {
+      std::cerr << "server: " << e.what() << std::endl;
+    }
+    std::_Exit(1);
+  }
+  close(ready[1]);
+  char c;
+  const bool started = read(ready[0], &c, 1) == 1;
+  close(ready[0]);
+  if (!started) {
+    waitpid(pid, nullptr, 0);
+    throw std::runtime_error("Failed to start the server");
+  }
+  return pid;
+}
+
+// CPU cycles of the calling thread (user and kernel if allowed, see
+// kernel.perf_event_paranoid). Not available in some VMs.
+class cycle_counter {
+ private:
+  int fd_;
+ public:
+  cycle_counter() : fd_(-1) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd_ == -1) {
+      attr.exclude_kernel = 1;
+      fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+  cycle_counter(const cycle_counter&) = delete;
+  cycle_counter& operator=(const cycle_counter&) = delete;
+  ~cycle_counter() {
+    if (fd_ != -1) {
+      close(fd_);
+    }
+  }
+  bool available() const {
+    return fd_ != -1;
+  }
+  uint64_t read_cycles() const {
+    uint64_t cycles = 0;
+    if (fd_ == -1 || read(fd_, &cycles, sizeof(cycles)) != sizeof(cycles)) {
+      return 0;
+    }
+    return cycles;
+  }
+};
+
+uint64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct run_result {
+  pacing_mode pacing;
+  // in microseconds
+  std::vector<double> handshakes;
+  std::vector<double> round_trips;
+  size_t bulk_bytes;
+  double bulk_seconds;
+  uint64_t bulk_cycles;
+  uint64_t bulk_cpu_ns;
+};
+
+task<void> measure_handshakes(event_loop& loop, const ip_addr dst_ip, const int count,
+                              std::vector<double>& samples) {
+  for (int i = 0; i < count; ++i) {
+    tcp_connection conn(loop);
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    co_await conn.connect(dst_ip, SINK_PORT, 0);
+    samples.push_back(
+        chrono::duration<double, std::micro>(chrono::steady_clock::now() - start).count());
+    co_await conn.close();
+  }
+}
+
+task<void> measure_round_trips(event_loop& loop, const ip_addr dst_ip, const int count,
+                               const size_t size, std::vector<double>& samples) {
+  tcp_connection conn(loop);
+  co_await conn.connect(dst_ip, ECHO_PORT, 0);
+  const std::vector<uint8_t> request(size, 'x');
+  std::vector<uint8_t> response(size);
+  for (int i = 0; i < count; ++i) {
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    co_await conn.write(request);
+    size_t received = 0;
+    while (received < size) {
+      const size_t len = co_await conn.read(std::span<uint8_t>(response).subspan(received));
+      if (len == 0) {
+        throw std::runtime_error("Echo server closed the connection");
+      }
+      received += len;
+    }
+    samples.push_back(
+        chrono::duration<double, std::micro>(chrono::steady_clock::now() - start).count());
+  }
+  co_await conn.close();
+}
+
+// From the first write until the server has read everything and closed.
+task<void> measure_bulk(event_loop& loop, const ip_addr dst_ip, const size_t bytes,
+                        const cycle_counter& cycles, run_result& result) {
+  tcp_connection conn(loop);
+  co_await conn.connect(dst_ip, SINK_PORT, 0);
+  const std::vector<uint8_t> chunk(CHUNK_SIZE, 'x');
+  const uint64_t start_cycles = cycles.read_cycles();
+  const uint64_t start_cpu_ns = thread_cpu_ns();
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  size_t sent = 0;
+  while (sent < bytes) {
+    const size_t len = std::min(chunk.size(), bytes - sent);
+    sent += co_await conn.write(std::span<const uint8_t>(chunk.data(), len));
+  }
+  co_await conn.close();
+  result.bulk_seconds =
+    chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  result.bulk_cpu_ns = thread_cpu_ns() - start_cpu_ns;
+  result.bulk_cycles = cycles.read_cycles() - start_cycles;
+  result.bulk_bytes = sent;
+}
+
+const char *pacing_name(const pacing_mode mode) {
+  switch (mode) {
+    case pacing_mode::NONE:
+      return "none";
+    case pacing_mode::INTERNAL:
+      return "internal";
+    case pacing_mode::TXTIME:
+      return "txtime";
+  }
+  return "unknown";
+}
+
+// Nearest rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, const double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t rank = static_cast<size_t>(p * sorted.size());
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+std::string latency_json(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (const double s : samples) {
+    sum += s;
+  }
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(1)
+     << "{\"count\": " << samples.size()
+     << ", \"mean\": " << (samples.empty() ? 0 : sum / samples.size())
+     << ", \"p50\": " << percentile(samples, 0.5)
+     << ", \"p99\": " << percentile(samples, 0.99)
+     << ", \"p999\": " << percentile(samples, 0.999)
+     << ", \"max\": " << (samples.empty() ? 0 : samples.back()) << "}";
+  return os.str();
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t bulk_bytes = argc > 1 ? std::atoi(argv[1]) : 100000000;
+  const int requests = argc > 2 ? std::atoi(argv[2]) : 10000;
+  const int connections = argc > 3 ? std::atoi(argv[3]) : 1000;
+  const size_t request_size = argc > 4 ? std::atoi(argv[4]) : 64;
+
+  test_network network;
+  const pid_t server = start_server();
+  std::vector<run_result> results;
+  bool cycles_available = false;
+  try {
+    enter_netns(CLIENT_NETNS);
+    ip_addr dst_ip;
+    dst_ip.from_string(SERVER_IP);
+    const cycle_counter cycles;
+    cycles_available = cycles.available();
+    // NOTE
+    // The only I/O backend is the packet socket of event_loop, so the runs
+    // differ in how its segments are sent (see pacing_mode).
+    for (const pacing_mode mode : {pacing_mode::NONE, pacing_mode::INTERNAL, pacing_mode::TXTIME}) {
+      event_loop loop(CLIENT_IFNAME);
+      loop.set_pacing(mode);
+      if (loop.get_pacing() != mode) {
+        std::cerr << pacing_name(mode) << " pacing is not supported, skipped" << std::endl;
+        continue;
+      }
+      std::cerr << "pacing " << pacing_name(mode) << " ..." << std::endl;
+      run_result result;
+      result.pacing = mode;
+      loop.spawn(measure_handshakes(loop, dst_ip, connections, result.handshakes));
+      loop.run();
+      loop.spawn(measure_round_trips(loop, dst_ip, requests, request_size, result.round_trips));
+      loop.run();
+      loop.spawn(measure_bulk(loop, dst_ip, bulk_bytes, cycles, result));
+      loop.run();
+      results.push_back(result);
+    }
+  } catch (const std::exception& e) {
+    kill(server, SIGKILL);
+    waitpid(server, nullptr, 0);
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  kill(server, SIGKILL);
+  waitpid(server, nullptr, 0);
+
+  // Latencies are in microseconds.
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "{" << std::endl;
+  std::cout << "  \"bulk_bytes\": " << bulk_bytes << "," << std::endl;
+  std::cout << "  \"requests\": " << requests << "," << std::endl;
+  std::cout << "  \"request_size\": " << request_size << "," << std::endl;
+  std::cout << "  \"connections\": " << connections << "," << std::endl;
+  std::cout << "  \"runs\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const run_result& r = results[i];
+    std::cout << "    {" << std::endl;
+    std::cout << "      \"backend\": \"af_packet\"," << std::endl;
+    std::cout << "      \"pacing\": \"" << pacing_name(r.pacing) << "\"," << std::endl;
+    std::cout << "      \"handshake_us\": " << latency_json(r.handshakes) << "," << std::endl;
+    std::cout << "      \"request_response_us\": " << latency_json(r.round_trips) << "," << std::endl;
+    std::cout << "      \"bulk\": {\"bytes\": " << r.bulk_bytes
+              << ", \"seconds\": " << r.bulk_seconds
+              << ", \"goodput_mbps\": " << r.bulk_bytes * 8 / r.bulk_seconds / 1e6
+              << ", \"cpu_ns_per_byte\": " << static_cast<double>(r.bulk_cpu_ns) / r.bulk_bytes
+              << ", \"cycles_per_byte\": ";
+    if (cycles_available) {
+      std::cout << static_cast<double>(r.bulk_cycles) / r.bulk_bytes;
+    } else {
+      std::cout << "null";
+    }
+    std::cout << "}" << std::endl;
+    std::cout << "    }" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  std::cout << "  ]" << std::endl;
+  std::cout << "}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>  // for std::max(), std::min()
+#include <chrono>
+#include <cstdlib>    // for std::atof(), std::atoi(), std::strtoull()
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "congestion_control.h"
+#include "connection_stats.h"
+#include "event_loop.h"
+#include "ip_addr.h"
+#include "link_model.h"
+#include "link_simulator.h"
+#include "sim_link.h"
+#include "sim_peer.h"
+#include "task.h"
+#include "tcp_clock.h"
+#include "tcp_connection.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const uint16_t MSS = 1460;
+const uint32_t MTU = 1500;
+const uint16_t SRC_PORT = 49152;
+
+double seconds(const chrono::steady_clock::duration d) {
+  return chrono::duration_cast<chrono::duration<double>>(d).count();
+}
+
+// Read what the peer echoes until it closes.
+task<void> read_all(tcp_connection& conn, uint64_t& read) {
+  std::vector<uint8_t> buffer(64 * 1024);
+  while (true) {
+    const size_t n = co_await conn.read(buffer);
+    if (n == 0) {
+      break;
+    }
+    read += n;
+  }
+}
+
+task<void> transfer(
+    event_loop& loop, tcp_connection& conn, const ip_addr dst_ip, const uint16_t dst_port,
+    const uint64_t total, const bool echo, uint64_t& read, bool& closed) {
+  co_await conn.connect(dst_ip, dst_port, SRC_PORT);
+  if (echo) {
+    loop.spawn(read_all(conn, read));
+  }
+  const std::vector<uint8_t> chunk(64 * 1024, 'x');
+  uint64_t written = 0;
+  while (written < total) {
+    const size_t size = std::min<uint64_t>(chunk.size(), total - written);
+    written += co_await conn.write(std::span<const uint8_t>(chunk.data(), size));
+  }
+  co_await conn.close();
+  closed = true;
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  const uint64_t total = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100 * 1024 * 1024;
+  const uint64_t bandwidth = (argc > 2 ? std::atoi(argv[2]) : 100) * 1000000ULL;
+  const auto rtt = chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 20);
+  const double loss = (argc > 4 ? std::atof(argv[4]) : 0) / 100;
+  const bool dctcp = argc > 5 && std::string(argv[5]) == "dctcp";
+  // The peer sends the data back, which the stack reads.
+  const bool echo = argc > 6 && std::string(argv[6]) == "echo";
+
+  // Bottleneck queue of one bandwidth-delay product; DCTCP marks above K
+  // (rfc 8257 - 4.1. Marking Congestion on the L3 Switches and Routers).
+  const size_t bdp = std::max<size_t>(bandwidth / 8 * chrono::duration_cast<chrono::microseconds>(rtt).count() / 1000000, 64 * 1024);
+  link_model_config forward = {};
+  forward.bandwidth     = bandwidth;
+  forward.delay         = rtt / 2;
+  forward.loss          = loss;
+  forward.queue_limit   = bdp;
+  forward.ecn_threshold = dctcp ? std::max<size_t>(bdp / 5, 2 * MSS) : 0;
+  forward.seed          = 1;
+  link_model_config backward = {};
+  backward.bandwidth    = bandwidth;
+  backward.delay        = rtt / 2;
+  backward.seed         = 2;
+  const sim_peer_config peer = {
+    {10, 0, 0, 2}, 80, echo ? sim_peer_mode::ECHO : sim_peer_mode::SINK, 1000, MSS, 7, 4 * 1024 * 1024, chrono::milliseconds(200),
+  };
+  std::cout << "transfer      : " << total << " bytes" << std::endl;
+  std::cout << "link          : " << bandwidth / 1000000 << " Mbit/s, rtt "
+            << rtt.count() << " ms, loss " << loss * 100 << " %, queue " << bdp << " bytes" << std::endl;
+  std::cout << "algorithm     : " << (dctcp ? "dctcp" : "reno") << std::endl;
+  std::cout << "peer          : " << (echo ? "echo" : "sink") << std::endl;
+
+  // The stack is the event_loop and tcp_connection of the client, on the
+  // virtual clock of the simulator.
+  link_simulator sim(forward, backward, peer);
+  ip_addr src_ip;
+  src_ip.from_string("10.0.0.1");
+  ip_addr dst_ip;
+  dst_ip.from_host_order(peer.ip);
+  sim_link link(sim, src_ip, MTU);
+  event_loop loop(link);
+  tcp_connection conn(loop);
+  conn.enable_stats();
+  if (dctcp) {
+    conn.set_ecn(true);
+    conn.set_congestion_algorithm(congestion_algorithm::DCTCP);
+  }
+
+  const auto wall_begin = chrono::steady_clock::now();
+  const auto begin = sim.now();
+  uint64_t read = 0;
+  bool closed = false;
+  std::string error;
+  loop.spawn(transfer(loop, conn, dst_ip, peer.port, total, echo, read, closed));
+  try {
+    loop.run();
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  }
+  const bool done = closed && (!echo || read >= total);
+  const double wall = seconds(chrono::steady_clock::now() - wall_begin);
+  const double elapsed = seconds(sim.now() - begin);
+
+  const connection_stats stats = conn.get_tcb().get_connection_stats()->snapshot();
+  const link_model_stats& link_stats = sim.get_forward_link().get_stats();
+  const sim_peer_stats& received = sim.get_peer().get_stats();
+  const congestion_control_stats& cc = conn.get_tcb().get_congestion_control_stats();
+  std::cout << "result        : " << (done ? "done" : "failed")
+            << (error.empty() ? "" : " (" + error + ")") << std::endl;
+  std::cout << "simulated     : " << elapsed << " s" << std::endl;
+  std::cout << "goodput       : " << received.bytes_received * 8 / elapsed / 1000000 << " Mbit/s" << std::endl;
+  std::cout << "wall          : " << wall << " s (" << elapsed / wall << "x real time)" << std::endl;
+  std::cout << "segments sent : " << stats.segments_out
+            << " (" << stats.bytes_retransmitted << " bytes again)" << std::endl;
+  std::cout << "timeouts      : " << cc.timeout_reductions
+            << " (fast retransmits: " << cc.fast_retransmits << ")" << std::endl;
+  std::cout << "lost          : " << link_stats.lost << " (queue drops: " << link_stats.queue_drops << ")" << std::endl;
+  std::cout << "max queue     : " << link_stats.max_queue << " bytes" << std::endl;
+  std::cout << "ce marked     : " << link_stats.ce_marked
+            << " (ecn reductions: " << cc.ecn_reductions << ")" << std::endl;
+  std::cout << "out of order  : " << received.out_of_order << std::endl;
+  if (echo) {
+    std::cout << "echoed        : " << read << " bytes (peer timeouts: "
+              << received.retransmissions << ")" << std::endl;
+  }
+  std::cout << "srtt          : " << conn.get_tcb().get_srtt().count() << " us" << std::endl;
+  return done ? 0 : 1;
+}
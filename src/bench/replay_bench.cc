@@ -0,0 +1,284 @@
+#include <algorithm> // for std::max()
+#include <chrono>
+#include <cstdlib>   // for std::atoi()
+#include <cstring>   // for std::memcpy(), std::memset()
+#include <functional> // for std::cref(), std::ref()
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "connection_table.h"
+#include "ip_packet.h"
+#include "pcap_reader.h"
+#include "tcb_slab.h"
+#include "tcp_options.h"
+#include "tcp_segment.h"
+#include "transmission_control_block.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// A connection of the capture. The client is the side which sent the first
+// SYN, and is played by a transmission_control_block.
+struct flow {
+  uint8_t client_ip[4];
+  uint16_t client_port;
+  uint8_t server_ip[4];
+  uint16_t server_port;
+  uint32_t iss;
+  // MSS option of the SYN, or 0
+  uint16_t mss;
+  bool ecn_setup;
+  // data of the SYN (TCP Fast Open), in the mapped file
+  const uint8_t *syn_data;
+  size_t syn_data_size;
+  size_t shard;
+};
+
+// IP packet of a flow, in the mapped file
+struct replay_frame {
+  const uint8_t *data;
+  size_t size;
+};
+
+struct shard {
+  std::vector<size_t> flows;
+  std::vector<replay_frame> frames;
+};
+
+struct shard_result {
+  uint64_t packets;      // TCP segments parsed
+  uint64_t inbound;      // segments applied to a TCB
+  uint64_t outbound;     // data segments of the client written again
+  uint64_t received;     // bytes read from the receive buffers
+  uint64_t allocations;
+  chrono::nanoseconds elapsed;
+};
+
+// Send the SYN of every flow of the shard, so that the TCBs wait for SYN-ACK
+// like they did in the capture.
+void open_flows(
+    const std::vector<flow>& flows, const shard& s,
+    tcb_slab& tcbs, connection_table& connections) {
+  connections.reserve(s.flows.size());
+  for (const size_t i : s.flows) {
+    const flow& f = flows[i];
+    const tcb_handle handle = tcbs.create();
+    transmission_control_block& tcb = tcbs.at(handle.index);
+    tcb.set_nodelay(true);
+    if (f.iss != tcb.get_iss()) {
+      tcb.set_iss(f.iss);
+    }
+    tcp_options options;
+    if (f.mss != 0) {
+      options.set_mss(f.mss);
+    }
+    options.set_window_scale(tcb.get_receive_window_scale());
+    if (f.syn_data_size != 0) {
+      tcb.write(f.syn_data, f.syn_data_size);
+    }
+    tcb.create_syn_segment(
+        f.client_ip, f.client_port, f.server_ip, f.server_port,
+        f.ecn_setup, tcb.get_receive_window(), options.marshal(), f.syn_data_size);
+    connections.insert(
+        make_connection_key(f.client_ip, f.client_port, f.server_ip, f.server_port), handle.index);
+  }
+}
+
+// Feed the frames of the shard through the receive path of the event loop:
+// parse, demux and apply to the TCB, and read the received data right away.
+void replay(const std::vector<flow>& flows, const shard& s, shard_result& result) {
+  tcb_slab tcbs;
+  connection_table connections;
+  open_flows(flows, s, tcbs, connections);
+  // (reused for every frame, like the receive buffer of the event loop)
+  std::vector<uint8_t> packet;
+  packet.reserve(65536);
+
+  std::memset(&result, 0, sizeof(result));
+  const uint64_t allocations_before = thread_allocations();
+  const auto begin = chrono::steady_clock::now();
+  for (const replay_frame& frame : s.frames) {
+    packet.assign(frame.data, frame.data + frame.size);
+    try {
+      const ip_packet pkt(packet);
+      if (pkt.get_protocol() != PROTOCOL_TCP) {
+        continue;
+      }
+      const tcp_segment seg(pkt.get_body());
+      uint8_t saddr[4];
+      pkt.get_saddr(saddr);
+      uint8_t daddr[4];
+      pkt.get_daddr(daddr);
+      result.packets++;
+
+      const uint32_t index = connections.find(
+          make_connection_key(daddr, seg.get_dst_port(), saddr, seg.get_src_port()));
+      if (index != CONNECTION_NOT_FOUND) {
+        transmission_control_block& tcb = tcbs.at(index);
+        tcb.apply_receive_segment(seg, pkt.get_ecn() == IP_ECN_CE);
+        const byte_range received = tcb.get_received();
+        if (received.size != 0) {
+          result.received += received.size;
+          tcb.consume_received(received.size);
+        }
+        result.inbound++;
+        continue;
+      }
+      // NOTE
+      // New data of the client is written and sent again, so that the server
+      // acknowledges data the TCB has sent. (rfc 793 - 3.9. SEGMENT ARRIVES)
+      //   If the ACK acks something not yet sent (SEG.ACK > SND.NXT) then
+      //   send an ACK, drop the segment, and return.
+      const uint32_t out = connections.find(
+          make_connection_key(saddr, seg.get_src_port(), daddr, seg.get_dst_port()));
+      if (out == CONNECTION_NOT_FOUND || seg.get_syn() || seg.get_body_size() == 0) {
+        continue;
+      }
+      transmission_control_block& tcb = tcbs.at(out);
+      const uint32_t written_end = tcb.get_snd_nxt() + tcb.get_unsent_size();
+      const int32_t new_data = static_cast<int32_t>(
+          seg.get_seq() + seg.get_body_size() - written_end);
+      if (new_data <= 0 || static_cast<size_t>(new_data) > seg.get_body_size()) {
+        continue;
+      }
+      tcb.write(seg.get_body_data() + seg.get_body_size() - new_data, new_data);
+      tcb.flush(saddr, seg.get_src_port(), daddr, seg.get_dst_port(), tcb.get_receive_window());
+      result.outbound++;
+    } catch (const std::invalid_argument&) {
+      // Malformed packet
+    }
+  }
+  result.elapsed = chrono::steady_clock::now() - begin;
+  result.allocations = thread_allocations() - allocations_before;
+}
+
+// Find the flows of the capture (by their SYNs) and deal them to the shards
+// with their frames. Returns the number of frames of no known flow.
+size_t prepare(pcap_reader& reader, std::vector<flow>& flows, std::vector<shard>& shards) {
+  connection_table flow_indexes;
+  size_t skipped = 0;
+  pcap_frame frame;
+  while (reader.next(frame)) {
+    try {
+      const ip_packet pkt(std::vector<uint8_t>(frame.data, frame.data + frame.size));
+      if (pkt.get_protocol() != PROTOCOL_TCP) {
+        skipped++;
+        continue;
+      }
+      const tcp_segment seg(pkt.get_body());
+      uint8_t saddr[4];
+      pkt.get_saddr(saddr);
+      uint8_t daddr[4];
+      pkt.get_daddr(daddr);
+      const connection_key out =
+        make_connection_key(saddr, seg.get_src_port(), daddr, seg.get_dst_port());
+      uint32_t index = flow_indexes.find(out);
+      if (index == CONNECTION_NOT_FOUND) {
+        index = flow_indexes.find(
+            make_connection_key(daddr, seg.get_dst_port(), saddr, seg.get_src_port()));
+      }
+      if (index == CONNECTION_NOT_FOUND && seg.get_syn() && !seg.get_ack()) {
+        flow f;
+        std::memcpy(f.client_ip, saddr, sizeof(saddr));
+        f.client_port = seg.get_src_port();
+        std::memcpy(f.server_ip, daddr, sizeof(daddr));
+        f.server_port = seg.get_dst_port();
+        f.iss = seg.get_seq();
+        const tcp_options options(seg.get_options());
+        f.mss = options.has_mss() ? options.get_mss() : 0;
+        // An ECN-setup SYN has both ECE and CWR (rfc 3168 - 6.1.1.)
+        f.ecn_setup = seg.get_ece() && seg.get_cwr();
+        // (frames may be padded after the packet, so the data is found from the front)
+        f.syn_data = frame.data + pkt.get_ihl() * 4 + seg.get_data_offset() * 4;
+        f.syn_data_size = seg.get_body_size();
+        // (dealt in turn, as flows of a capture are often alike)
+        f.shard = flows.size() % shards.size();
+        flow_indexes.insert(out, flows.size());
+        shards[f.shard].flows.push_back(flows.size());
+        flows.push_back(f);
+        // (the SYN is created by the TCB of the flow)
+        continue;
+      }
+      if (index == CONNECTION_NOT_FOUND) {
+        skipped++;
+        continue;
+      }
+      shards[flows[index].shard].frames.push_back(replay_frame{frame.data, frame.size});
+    } catch (const std::invalid_argument&) {
+      skipped++;
+    }
+  }
+  return skipped;
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <capture file> [threads] [rounds]" << std::endl;
+    return 1;
+  }
+  const size_t num_threads = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 1;
+  const size_t rounds = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 1;
+
+  pcap_reader reader(argv[1]);
+  std::vector<flow> flows;
+  std::vector<shard> shards(num_threads);
+  const size_t skipped = prepare(reader, flows, shards);
+  const pcap_reader_stats reader_stats = reader.get_stats();
+
+  std::cout << "frames        : " << reader_stats.frames
+            << " (not IPv4: " << reader_stats.skipped
+            << ", no flow: " << skipped << ")" << std::endl;
+  std::cout << "flows         : " << flows.size() << std::endl;
+  std::cout << "threads       : " << num_threads << std::endl;
+
+  // Each round replays the capture to new TCBs.
+  shard_result total;
+  std::memset(&total, 0, sizeof(total));
+  // time to replay the frames of the rounds (the slowest shard of each)
+  chrono::nanoseconds replay_time(0);
+  std::vector<shard_result> results(num_threads);
+  for (size_t round = 0; round < rounds; ++round) {
+    if (num_threads == 1) {
+      replay(flows, shards[0], results[0]);
+    } else {
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back(replay, std::cref(flows), std::cref(shards[i]), std::ref(results[i]));
+      }
+      for (std::thread& t : threads) {
+        t.join();
+      }
+    }
+    chrono::nanoseconds slowest(0);
+    for (const shard_result& r : results) {
+      total.packets     += r.packets;
+      total.inbound     += r.inbound;
+      total.outbound    += r.outbound;
+      total.received    += r.received;
+      total.allocations += r.allocations;
+      total.elapsed     += r.elapsed;
+      slowest = std::max(slowest, r.elapsed);
+    }
+    replay_time += slowest;
+  }
+  if (total.packets == 0) {
+    std::cerr << "No segments of a flow opened in the capture" << std::endl;
+    return 1;
+  }
+
+  const double packets = static_cast<double>(total.packets);
+  std::cout << "segments      : " << total.packets / rounds
+            << " (inbound: " << total.inbound / rounds
+            << ", outbound data: " << total.outbound / rounds << ")" << std::endl;
+  std::cout << "received      : " << total.received / rounds << " bytes" << std::endl;
+  std::cout << "rounds        : " << rounds << std::endl;
+  std::cout << "throughput    : " << packets * 1e9 / replay_time.count() << " packets/s" << std::endl;
+  // (time of one thread, so it does not shrink with more threads)
+  std::cout << "latency       : " << total.elapsed.count() / packets << " ns/packet" << std::endl;
+  std::cout << "allocations   : " << total.allocations / packets << " /packet" << std::endl;
+  return 0;
+}
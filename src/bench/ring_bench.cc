@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>  // for uint64_t
+#include <cstdlib>  // for std::atoi()
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "doorbell.h"
+#include "mpsc_ring.h"
+#include "spsc_ring.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// What a stack worker hands to an application thread for received payload
+// (and the other way round for send requests).
+struct payload_descriptor {
+  uint32_t connection;
+  uint32_t length;
+  const uint8_t *data;
+  uint64_t timestamp_ns;
+};
+
+const size_t RING_CAPACITY = 4096;
+const size_t BATCH_SIZE = 32;
+
+uint64_t now_ns() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Busy wait step. Yields after a while so that the other side can run even
+// when both threads share a CPU.
+void backoff(int& spins) {
+  if (++spins > 64) {
+    std::this_thread::yield();
+    spins = 0;
+  }
+}
+
+void report_throughput(const char *name, const size_t items, const chrono::steady_clock::duration elapsed) {
+  const double ns = chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+  std::cout << name << ns / items << " ns/item, "
+            << items / (ns / 1e9) / 1e6 << " M items/s" << std::endl;
+}
+
+void report_latency(const char *name, std::vector<uint64_t>& samples) {
+  std::sort(samples.begin(), samples.end());
+  std::cout << name << "p50 " << samples[samples.size() / 2] << " ns, "
+            << "p99 " << samples[samples.size() * 99 / 100] << " ns" << std::endl;
+}
+
+template <typename Ring>
+uint64_t consume(Ring& ring, const size_t items, const size_t batch) {
+  std::vector<payload_descriptor> buf(batch);
+  uint64_t sum = 0;
+  size_t received = 0;
+  int spins = 0;
+  while (received < items) {
+    const size_t n = ring.pop_batch(buf.data(), batch);
+    if (n == 0) {
+      backoff(spins);
+      continue;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      sum += buf[i].length;
+    }
+    received += n;
+  }
+  return sum;
+}
+
+template <typename Ring>
+void produce(Ring& ring, const size_t items, const size_t batch, const uint32_t id) {
+  std::vector<payload_descriptor> buf(batch);
+  size_t sent = 0;
+  int spins = 0;
+  while (sent < items) {
+    const size_t n = std::min(batch, items - sent);
+    for (size_t i = 0; i < n; ++i) {
+      buf[i] = payload_descriptor{id, 1, nullptr, 0};
+    }
+    size_t pushed = 0;
+    while (pushed < n) {
+      const size_t p = ring.push_batch(buf.data() + pushed, n - pushed);
+      if (p == 0) {
+        backoff(spins);
+      }
+      pushed += p;
+    }
+    sent += n;
+  }
+}
+
+void bench_spsc(const size_t items, const size_t batch) {
+  spsc_ring<payload_descriptor> ring(RING_CAPACITY);
+  const auto begin = chrono::steady_clock::now();
+  std::thread producer([&] { produce(ring, items, batch, 0); });
+  const uint64_t sum = consume(ring, items, batch);
+  producer.join();
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  if (sum != items) {
+    std::cout << "ERROR: lost items" << std::endl;
+  }
+  std::cout << "spsc  batch " << batch << "\t: ";
+  report_throughput("", items, elapsed);
+}
+
+void bench_mpsc(const size_t items, const int producers, const size_t batch) {
+  mpsc_ring<payload_descriptor> ring(RING_CAPACITY);
+  const size_t per_producer = items / producers;
+  const auto begin = chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] { produce(ring, per_producer, batch, p); });
+  }
+  const uint64_t sum = consume(ring, per_producer * producers, batch);
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  if (sum != per_producer * producers) {
+    std::cout << "ERROR: lost items" << std::endl;
+  }
+  std::cout << "mpsc  " << producers << "p batch " << batch << "\t: ";
+  report_throughput("", per_producer * producers, elapsed);
+}
+
+// Baseline: the same handoff through a mutex protected deque.
+void bench_mutex(const size_t items, const int producers) {
+  std::mutex mutex;
+  std::deque<payload_descriptor> queue;
+  const size_t per_producer = items / producers;
+  const auto begin = chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (size_t i = 0; i < per_producer; ++i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(payload_descriptor{static_cast<uint32_t>(p), 1, nullptr, 0});
+      }
+    });
+  }
+  size_t received = 0;
+  int spins = 0;
+  while (received < per_producer * producers) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty()) {
+      backoff(spins);
+      continue;
+    }
+    queue.pop_front();
+    received++;
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  std::cout << "mutex " << producers << "p\t\t: ";
+  report_throughput("", received, chrono::steady_clock::now() - begin);
+}
+
+// One way handoff latency by ping-pong over two rings (both sides polling).
+void bench_ping_pong(const size_t round_trips) {
+  spsc_ring<payload_descriptor> ping(RING_CAPACITY);
+  spsc_ring<payload_descriptor> pong(RING_CAPACITY);
+  std::thread echo([&] {
+    payload_descriptor d;
+    int spins = 0;
+    for (size_t i = 0; i < round_trips; ++i) {
+      while (!ping.try_pop(d)) {
+        backoff(spins);
+      }
+      while (!pong.try_push(d)) {
+        backoff(spins);
+      }
+    }
+  });
+  std::vector<uint64_t> samples;
+  samples.reserve(round_trips);
+  payload_descriptor d;
+  int spins = 0;
+  for (size_t i = 0; i < round_trips; ++i) {
+    const uint64_t sent = now_ns();
+    while (!ping.try_push(payload_descriptor{0, 1, nullptr, sent})) {
+      backoff(spins);
+    }
+    while (!pong.try_pop(d)) {
+      backoff(spins);
+    }
+    samples.push_back((now_ns() - d.timestamp_ns) / 2);
+  }
+  echo.join();
+  report_latency("handoff (polling)\t: ", samples);
+}
+
+// Latency to an idle consumer woken up by the doorbell.
+void bench_doorbell(const size_t items) {
+  spsc_ring<payload_descriptor> ring(RING_CAPACITY);
+  doorbell bell;
+  std::vector<uint64_t> samples;
+  samples.reserve(items);
+  std::thread consumer([&] {
+    payload_descriptor d;
+    for (size_t i = 0; i < items; ++i) {
+      while (!ring.try_pop(d)) {
+        bell.prepare_wait();
+        if (!ring.empty()) {
+          bell.cancel_wait();
+          continue;
+        }
+        bell.wait();
+      }
+      samples.push_back(now_ns() - d.timestamp_ns);
+    }
+  });
+  for (size_t i = 0; i < items; ++i) {
+    // Leave the consumer time to go to sleep.
+    std::this_thread::sleep_for(chrono::microseconds(100));
+    ring.try_push(payload_descriptor{0, 1, nullptr, now_ns()});
+    bell.notify();
+  }
+  consumer.join();
+  report_latency("handoff (doorbell)\t: ", samples);
+  std::cout << "  eventfd writes\t: " << bell.get_wakeups() << " for " << items << " items" << std::endl;
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t items = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  const size_t round_trips = argc > 2 ? std::atoi(argv[2]) : 100000;
+  std::cout << "items : " << items << ", cpus : " << std::thread::hardware_concurrency() << std::endl;
+
+  bench_spsc(items, 1);
+  bench_spsc(items, BATCH_SIZE);
+  for (const int producers : {1, 2, 4}) {
+    bench_mpsc(items, producers, 1);
+    bench_mpsc(items, producers, BATCH_SIZE);
+  }
+  bench_mutex(items, 1);
+  bench_mutex(items, 4);
+  bench_ping_pong(round_trips);
+  bench_doorbell(std::min<size_t>(round_trips, 2000));
+  return 0;
+}
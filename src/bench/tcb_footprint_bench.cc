@@ -0,0 +1,121 @@
+#include <algorithm> // for std::min()
+#include <cstdlib>   // for std::atoi()
+#include <iostream>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "buffer_pool.h"
+#include "connection_table.h"
+#include "tcb_slab.h"
+#include "tcp_options.h"
+#include "tcp_segment.h"
+#include "transmission_control_block.h"
+
+namespace {
+const uint8_t LOCAL_IP[4]  = {10, 0, 0, 1};
+const uint16_t LOCAL_PORT  = 80;
+const uint16_t WINDOW      = 64240;
+
+struct connection {
+  tcb_handle handle;
+  uint8_t remote_ip[4];
+  uint16_t remote_port;
+};
+
+void report(const char *phase, const size_t base, const size_t num_connections) {
+  const double per_connection =
+    static_cast<double>(thread_live_heap_bytes() - base) / num_connections;
+  std::cout << phase << per_connection << " bytes/connection" << std::endl;
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t num_connections = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const size_t max_active = argc > 2 ? std::atoi(argv[2]) : 10000;
+  // Warm up the thread local buffer pool so it is not counted as per connection memory.
+  default_buffer_pool();
+
+  std::cout << "connections        : " << num_connections << std::endl;
+  std::cout << "sizeof(tcb)        : " << sizeof(transmission_control_block) << " bytes" << std::endl;
+
+  const size_t base = thread_live_heap_bytes();
+  tcb_slab tcbs;
+  connection_table connections;
+  std::vector<connection> conns(num_connections);
+  const size_t bookkeeping = thread_live_heap_bytes();
+
+  // Create connections (CLOSED, nothing sent yet)
+  for (size_t i = 0; i < num_connections; ++i) {
+    connection& c = conns[i];
+    c.remote_ip[0] = 10;
+    c.remote_ip[1] = 1 + (i >> 16) % 254;
+    c.remote_ip[2] = (i >> 8) & 0xff;
+    c.remote_ip[3] = i & 0xff;
+    c.remote_port  = 1024 + i % 60000;
+    c.handle = tcbs.create();
+    connections.insert(
+        make_connection_key(LOCAL_IP, LOCAL_PORT, c.remote_ip, c.remote_port), c.handle.index);
+  }
+  report("created            : ", bookkeeping, num_connections);
+
+  // Handshake: SYN, SYN-ACK (with MSS option), ACK
+  tcp_options syn_ack_options;
+  syn_ack_options.set_mss(1460);
+  for (size_t i = 0; i < num_connections; ++i) {
+    connection& c = conns[i];
+    transmission_control_block& tcb = *tcbs.get(c.handle);
+    const tcp_segment syn = tcb.create_send_segment(
+        LOCAL_IP, LOCAL_PORT, c.remote_ip, c.remote_port,
+        false, false, false, false, false, false, false, true, false,
+        WINDOW, 0, std::vector<uint8_t>(), std::vector<uint8_t>());
+    const tcp_segment syn_ack(
+        c.remote_ip, LOCAL_IP, c.remote_port, LOCAL_PORT,
+        1000, syn.get_seq() + 1,
+        false, false, false, false, true, false, false, true, false,
+        WINDOW, 0, syn_ack_options.marshal(), std::vector<uint8_t>());
+    tcb.apply_receive_segment(tcp_segment(syn_ack.marshal()));
+    tcb.create_ack_segment(LOCAL_IP, LOCAL_PORT, c.remote_ip, c.remote_port, WINDOW);
+  }
+  report("idle (established) : ", bookkeeping, num_connections);
+  std::cout << "  cold state       : "
+            << tcbs.get(conns[0].handle)->get_memory_footprint() << " bytes" << std::endl;
+
+  // Active: 2000 bytes buffered by some of the connections.
+  // NOTE Each send ring costs two memory mappings (see vm.max_map_count),
+  // so not every connection is made active.
+  const size_t num_active = std::min(num_connections, max_active);
+  const size_t idle = thread_live_heap_bytes();
+  const std::vector<uint8_t> data(2000, 'x');
+  for (size_t i = 0; i < num_active; ++i) {
+    tcbs.get(conns[i].handle)->cork();
+    tcbs.get(conns[i].handle)->write(data);
+  }
+  const buffer_pool& pool = default_buffer_pool();
+  std::cout << "active connections : " << num_active << std::endl;
+  report("  heap (buffered)  : ", idle, num_active);
+  std::cout << "  rings (mapped)   : "
+            << static_cast<double>(pool.get_stats().rings_in_use * pool.get_ring_size()) / num_active
+            << " bytes/connection" << std::endl;
+
+  // Drain: buffered data is sent and acknowledged, and the rings go back to the pool
+  for (size_t i = 0; i < num_active; ++i) {
+    connection& c = conns[i];
+    transmission_control_block& tcb = *tcbs.get(c.handle);
+    tcb.uncork();
+    const std::vector<tcp_segment> segs =
+        tcb.flush(LOCAL_IP, LOCAL_PORT, c.remote_ip, c.remote_port, WINDOW);
+    const tcp_segment ack(
+        c.remote_ip, LOCAL_IP, c.remote_port, LOCAL_PORT,
+        1001, segs.back().get_seq() + segs.back().get_body_size(),
+        false, false, false, false, true, false, false, false, false,
+        WINDOW, 0, std::vector<uint8_t>(), std::vector<uint8_t>());
+    tcb.apply_receive_segment(ack);
+  }
+  report("idle (drained)     : ", bookkeeping, num_connections);
+  std::cout << "  rings in use     : " << pool.get_stats().rings_in_use << std::endl;
+  std::cout << "  rings cached     : "
+            << pool.get_stats().rings_allocated - pool.get_stats().rings_in_use
+            << " x " << pool.get_ring_size() << " bytes" << std::endl;
+  report("total incl. tables : ", base, num_connections);
+  return 0;
+}
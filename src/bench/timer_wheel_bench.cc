@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdlib>  // for std::atoi()
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+struct bench_timer {
+  // time given to the running advance(), i.e. the clock of the loop when
+  // the callback fires (not the tick of the wheel, which is the expiry)
+  const chrono::steady_clock::time_point *now;
+  chrono::steady_clock::time_point expiry;
+  unsigned long long *early;
+  unsigned long long *late_us;
+  timer_wheel_timer timer;
+  bench_timer() : now(nullptr), early(nullptr), late_us(nullptr), timer(on_expire, this) {}
+  static void on_expire(void *arg) {
+    auto *self = static_cast<bench_timer *>(arg);
+    if (*self->now < self->expiry) {
+      (*self->early)++;
+    } else {
+      *self->late_us += chrono::duration_cast<chrono::microseconds>(*self->now - self->expiry).count();
+    }
+  }
+};
+
+double ns_per_op(const chrono::steady_clock::time_point begin, const size_t ops) {
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) / ops;
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t num_timers = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const auto tick = chrono::milliseconds(1);
+  // Delays are spread like TCP timers: delayed ACK, RTO, keepalive and TIME_WAIT.
+  const auto max_delay_ms = 120000;
+
+  const auto start = chrono::steady_clock::time_point();
+  timer_wheel wheel(tick, start);
+  std::mt19937_64 rng(1);
+  std::uniform_int_distribution<int> delay_ms(1, max_delay_ms);
+
+  unsigned long long early = 0;
+  unsigned long long late_us = 0;
+  // clock of the loop below
+  chrono::steady_clock::time_point now = start;
+  std::unique_ptr<bench_timer[]> timers(new bench_timer[num_timers]);
+  std::vector<chrono::milliseconds> delays(num_timers);
+  for (size_t i = 0; i < num_timers; ++i) {
+    timers[i].now = &now;
+    timers[i].early = &early;
+    timers[i].late_us = &late_us;
+    delays[i] = chrono::milliseconds(delay_ms(rng));
+  }
+
+  std::cout << "timers        : " << num_timers << std::endl;
+
+  // arm
+  auto begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_timers; ++i) {
+    timers[i].expiry = start + delays[i];
+    wheel.arm(timers[i].timer, timers[i].expiry);
+  }
+  std::cout << "arm           : " << ns_per_op(begin, num_timers) << " ns/op" << std::endl;
+
+  // re-arm (e.g. RTO restarted by every ACK)
+  for (size_t i = 0; i < num_timers; ++i) {
+    delays[i] = chrono::milliseconds(delay_ms(rng));
+  }
+  begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_timers; ++i) {
+    timers[i].expiry = start + delays[i];
+    wheel.arm(timers[i].timer, timers[i].expiry);
+  }
+  std::cout << "re-arm        : " << ns_per_op(begin, num_timers) << " ns/op" << std::endl;
+
+  // cancel every other timer
+  begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < num_timers; i += 2) {
+    wheel.cancel(timers[i].timer);
+  }
+  std::cout << "cancel        : " << ns_per_op(begin, (num_timers + 1) / 2) << " ns/op" << std::endl;
+  std::cout << "armed         : " << wheel.size() << std::endl;
+
+  // Drive the wheel like an event loop polling every 10 ticks. Timers fire
+  // up to 10 ticks late, so the lateness shows the cost of the poll interval.
+  const size_t armed = wheel.size();
+  size_t expired = 0;
+  size_t polls = 0;
+  begin = chrono::steady_clock::now();
+  for (; wheel.size() != 0; now += tick * 10) {
+    expired += wheel.advance(now);
+    polls++;
+  }
+  const auto expire_ns = ns_per_op(begin, armed);
+  std::cout << "expire        : " << expire_ns << " ns/timer (" << polls << " polls)" << std::endl;
+  std::cout << "expired       : " << expired << std::endl;
+  std::cout << "early         : " << early << std::endl;
+  std::cout << "avg lateness  : "
+            << (expired ? static_cast<double>(late_us) / expired / 1000 : 0) << " ms" << std::endl;
+  return early == 0 && expired == armed ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <cstdlib>  // for std::atoi(), std::getenv()
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "connection_stats.h"
+#include "event_loop.h"
+#include "frame_allocator.h"
+#include "hdr_histogram.h"
+#include "ip_addr.h"
+#include "pcapng_writer.h"
+#include "task.h"
+#include "tcp_connection.h"
+#include "trace_writer.h"
+
+namespace {
+// Statistics of the connections are printed if RAW_TCP_STATS is set.
+const bool print_stats = std::getenv("RAW_TCP_STATS") != nullptr;
+
+void print_connection_stats(const tcp_connection& conn) {
+  const connection_stats_recorder *recorder = conn.get_tcb().get_connection_stats();
+  if (recorder == nullptr) {
+    return;
+  }
+  const connection_stats stats = recorder->snapshot();
+  const hdr_histogram& rtt = recorder->get_rtt_histogram();
+  const hdr_histogram& write_latency = recorder->get_write_latency_histogram();
+  std::cout << "port " << conn.get_src_port() << " :"
+            << " segments " << stats.segments_out << " out, " << stats.segments_in << " in,"
+            << " bytes " << stats.bytes_sent << " sent (" << stats.bytes_retransmitted
+            << " retransmitted), " << stats.bytes_received << " received,"
+            << " reordered " << stats.reorder_events << std::endl
+            << "  rtt min/avg/var " << stats.min_rtt_us << "/" << stats.srtt_us << "/"
+            << stats.rttvar_us << " us, p50/p99 " << rtt.get_percentile(0.5) << "/"
+            << rtt.get_percentile(0.99) << " us,"
+            << " write latency p50/p99 " << write_latency.get_percentile(0.5) / 1000 << "/"
+            << write_latency.get_percentile(0.99) / 1000 << " us" << std::endl
+            << "  cwnd " << stats.cwnd << ", limited by rwnd/cwnd/app "
+            << stats.rwnd_limited_us << "/" << stats.cwnd_limited_us << "/"
+            << stats.app_limited_us << " us" << std::endl;
+}
+
+// Send HELLO TCP and print what the server sends back until it closes.
+task<void> hello(
+    event_loop& loop, const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+    const std::string congestion, const bool fast_open) {
+  tcp_connection conn(loop);
+  if (print_stats) {
+    conn.enable_stats();
+  }
+  if (congestion == "ecn" || congestion == "dctcp") {
+    conn.set_ecn(true);
+  }
+  if (congestion == "dctcp") {
+    conn.set_congestion_algorithm(congestion_algorithm::DCTCP);
+  }
+  const std::string hello = "HELLO TCP";
+  const std::span<const uint8_t> hello_bytes(
+      reinterpret_cast<const uint8_t *>(hello.data()), hello.size());
+  if (fast_open) {
+    // HELLO TCP goes in SYN once the server has given us a cookie.
+    const size_t written = co_await conn.connect(dst_ip, dst_port, src_port, hello_bytes);
+    co_await conn.write(hello_bytes.subspan(written));
+  } else {
+    co_await conn.connect(dst_ip, dst_port, src_port);
+    co_await conn.write(hello_bytes);
+  }
+
+  std::vector<uint8_t> buffer(4096);
+  size_t received = 0;
+  while (true) {
+    const size_t len = co_await conn.read(buffer);
+    if (len == 0) {
+      break;
+    }
+    received += len;
+  }
+  co_await conn.close();
+  std::cout << "port " << conn.get_src_port() << " : received " << received << " bytes"
+            << (conn.get_tcb().ecn_capable() ? " (ecn)" : "")
+            << (conn.syn_data_acked() ? " (fast open)" : "") << std::endl;
+  print_connection_stats(conn);
+}
+
+// Connect one after another, so that later connections use the Fast Open
+// cookie given to the earlier ones.
+task<void> hello_sequentially(
+    event_loop& loop, const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+    const int num_connections, const std::string congestion) {
+  for (int i = 0; i < num_connections; ++i) {
+    co_await hello(loop, dst_ip, dst_port, src_port == 0 ? 0 : src_port + i, congestion, true);
+  }
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  if (argc < 5 || argc > 8) {
+    std::cout << "Usage: " << argv[0]
+              << " <src interface name> <src port> <dst ip address> <dst port> [connections]"
+              << " [reno|ecn|dctcp] [fastopen]"
+              << std::endl;
+    return 1;
+  }
+  const char *src_ifname = argv[1];
+  // 0 takes an ephemeral port for each connection
+  const uint16_t src_port = std::atoi(argv[2]);
+  ip_addr dst_ip;
+  dst_ip.from_string(argv[3]);
+  const uint16_t dst_port = std::atoi(argv[4]);
+  const int num_connections = argc >= 6 ? std::atoi(argv[5]) : 1;
+  const std::string congestion = argc >= 7 ? argv[6] : "reno";
+  const bool fast_open = argc == 8 && std::string(argv[7]) == "fastopen";
+
+  // Segments are traced to the file named by RAW_TCP_TRACE, and frames are
+  // captured to the one named by RAW_TCP_CAPTURE (see main.cc).
+  const char *trace_path = std::getenv("RAW_TCP_TRACE");
+  std::unique_ptr<trace_writer> tracer;
+  if (trace_path != nullptr) {
+    tracer = std::make_unique<trace_writer>(trace_path);
+  }
+  const char *capture_path = std::getenv("RAW_TCP_CAPTURE");
+  std::unique_ptr<pcapng_writer> capture;
+  if (capture_path != nullptr) {
+    capture = std::make_unique<pcapng_writer>(capture_path);
+  }
+
+  // All connections are driven by one thread.
+  event_loop loop(src_ifname);
+  loop.set_capture(capture.get());
+  if (fast_open) {
+    loop.spawn(hello_sequentially(loop, dst_ip, dst_port, src_port, num_connections, congestion));
+  } else {
+    for (int i = 0; i < num_connections; ++i) {
+      loop.spawn(hello(loop, dst_ip, dst_port, src_port == 0 ? 0 : src_port + i, congestion, false));
+    }
+  }
+  loop.run();
+
+  const frame_allocator_stats& stats = default_frame_allocator().get_stats();
+  std::cout << "coroutine frames : " << stats.heap_allocations << " allocated, "
+            << stats.reuses << " reused" << std::endl;
+  if (tracer && tracer->get_stats().dropped != 0) {
+    std::cout << "trace : " << tracer->get_stats().dropped << " events dropped" << std::endl;
+  }
+  if (capture && capture->get_stats().dropped != 0) {
+    std::cout << "capture : " << capture->get_stats().dropped << " frames dropped ("
+              << capture->get_error() << ")" << std::endl;
+  }
+}
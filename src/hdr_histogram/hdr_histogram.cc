@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstdint>  // for uint64_t, UINT64_MAX
+
+#include "hdr_histogram.h"
+
+namespace {
+const uint64_t MAX_VALUE = (static_cast<uint64_t>(1) << HDR_MAX_VALUE_BITS) - 1;
+} // namespace
+
+hdr_histogram::hdr_histogram() : total_(0), min_(UINT64_MAX), max_(0) {
+  for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t hdr_histogram::index_of(const uint64_t value) {
+  if (value < 2 * HALF_BUCKETS) {
+    return value;
+  }
+  // The top HDR_SUB_BUCKET_BITS bits of the value select the sub-bucket
+  // ([HALF_BUCKETS, 2 * HALF_BUCKETS)), and the bits shifted out the bucket.
+  const int shift = 64 - __builtin_clzll(value) - HDR_SUB_BUCKET_BITS;
+  return shift * HALF_BUCKETS + (value >> shift);
+}
+
+uint64_t hdr_histogram::highest_value_of(const size_t index) {
+  if (index < 2 * HALF_BUCKETS) {
+    return index;
+  }
+  const int shift = index / HALF_BUCKETS - 1;
+  const uint64_t sub_bucket = index - shift * HALF_BUCKETS;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void hdr_histogram::record(const uint64_t value) {
+  const uint64_t v = value < MAX_VALUE ? value : MAX_VALUE;
+  // (only this thread writes, so load and store instead of read-modify-write)
+  std::atomic<uint64_t>& count = counts_[index_of(v)];
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (v < min_.load(std::memory_order_relaxed)) {
+    min_.store(v, std::memory_order_relaxed);
+  }
+  if (v > max_.load(std::memory_order_relaxed)) {
+    max_.store(v, std::memory_order_relaxed);
+  }
+}
+
+uint64_t hdr_histogram::get_count() const {
+  return total_.load(std::memory_order_relaxed);
+}
+
+uint64_t hdr_histogram::get_min() const {
+  const uint64_t min = min_.load(std::memory_order_relaxed);
+  return min == UINT64_MAX ? 0 : min;
+}
+
+uint64_t hdr_histogram::get_max() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t hdr_histogram::get_percentile(const double fraction) const {
+  // Counters are read once, as they may change while being summed.
+  uint64_t counts[NUM_COUNTERS];
+  uint64_t total = 0;
+  for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double clamped = fraction < 0 ? 0 : (fraction > 1 ? 1 : fraction);
+  // (at least one value, so that the 0th percentile is the smallest one)
+  uint64_t rank = static_cast<uint64_t>(clamped * total + 0.5);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return highest_value_of(i);
+    }
+  }
+  return highest_value_of(NUM_COUNTERS - 1);
+}
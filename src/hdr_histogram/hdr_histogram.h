@@ -0,0 +1,58 @@
+#ifndef HDR_HISTOGRAM_H_
+#define HDR_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+// Values below 2^HDR_SUB_BUCKET_BITS are counted exactly, and larger ones
+// with a relative error below 2^-(HDR_SUB_BUCKET_BITS - 1) (6.25%).
+const int HDR_SUB_BUCKET_BITS = 5;
+// Values from 2^HDR_MAX_VALUE_BITS up are counted as the largest one
+// (about 18 minutes in nanoseconds).
+const int HDR_MAX_VALUE_BITS  = 40;
+
+// NOTE
+// High dynamic range histogram (log-linear, like HdrHistogram): every power
+// of 2 is split into the same number of linear sub-buckets, so that a fixed
+// number of counters covers nanoseconds to minutes with the same relative
+// precision, and recording is a shift and an increment.
+//
+//   value    : [0, 32) [32, 64) [64, 128) [128, 256) ...
+//   bucket   :  1 each  2 each   4 each    8 each    ...
+//
+// Values are recorded by one thread. The counters are relaxed atomics, so
+// other threads may read them at any time; a reader may see a value
+// recorded in the count but not in min/max yet (or the other way around),
+// but never a torn counter.
+class hdr_histogram {
+ private:
+  static const size_t HALF_BUCKETS = 1 << (HDR_SUB_BUCKET_BITS - 1);
+  static const size_t NUM_COUNTERS =
+    (HDR_MAX_VALUE_BITS - HDR_SUB_BUCKET_BITS + 2) * HALF_BUCKETS;
+
+  std::atomic<uint64_t> counts_[NUM_COUNTERS];
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> min_;
+  std::atomic<uint64_t> max_;
+
+  static size_t index_of(const uint64_t value);
+  // Largest value counted by the counter at the index.
+  static uint64_t highest_value_of(const size_t index);
+ public:
+  hdr_histogram();
+  hdr_histogram(const hdr_histogram&) = delete;
+  hdr_histogram& operator=(const hdr_histogram&) = delete;
+  // Writer
+  void record(const uint64_t value);
+  // Readers
+  uint64_t get_count() const;
+  // 0 if nothing has been recorded.
+  uint64_t get_min() const;
+  uint64_t get_max() const;
+  // Value which the given fraction (e.g. 0.99) of the recorded values are
+  // at or below, rounded up to the end of its bucket (0 if empty).
+  uint64_t get_percentile(const double fraction) const;
+};
+
+#endif  // HDR_HISTOGRAM_H_
@@ -9,10 +9,9 @@
 
 #include "ip_packet.h"
 
-namespace {
-uint16_t calc_checksum(struct iphdr *header) {
+uint16_t calc_checksum(const struct iphdr *header) {
   uint32_t sum = 0;
-  uint8_t *octets = (uint8_t *)header;
+  const uint8_t *octets = (const uint8_t *)header;
   size_t hdr_size = sizeof(struct iphdr);
 
   // Add each 16 bits
@@ -27,17 +26,24 @@ uint16_t calc_checksum(struct iphdr *header) {
   sum = (sum & 0xffff) + (sum >> 16);
   return ~sum;
 }
-} // namespace
 
 ip_packet::ip_packet(
       const uint16_t protocol,
       const uint8_t *src_addr,
       const uint8_t *dst_addr,
+      const std::vector<uint8_t> body)
+  : ip_packet(protocol, 0, src_addr, dst_addr, body) {}
+
+ip_packet::ip_packet(
+      const uint16_t protocol,
+      const uint8_t tos,
+      const uint8_t *src_addr,
+      const uint8_t *dst_addr,
       const std::vector<uint8_t> body) : body_(body) {
   std::memset(&header_, 0, sizeof(struct iphdr));
   header_.version = 4;
   header_.ihl = sizeof(struct iphdr) * 8 / 32;  // ip header length is 32bit unit.
-  header_.tos = 0;  // TODO
+  header_.tos = tos;
   header_.tot_len = htons(sizeof(struct iphdr) + body.size());
 
   // TODO cpp style
@@ -75,12 +81,19 @@ ip_packet::ip_packet(const std::vector<uint8_t> marshaled) {
   std::memcpy(&(header_.saddr), &(marshaled[12]), 4);
   std::memcpy(&(header_.daddr), &(marshaled[16]), 4);
 
-  const auto hdr_len  = header_.ihl * 4;  // NOTE ihl is in 4 bytes (= 32 bit) increments
-  const auto body_len = header_.tot_len - hdr_len;
-  if (body_len <= 0) {
+  const size_t hdr_len = header_.ihl * 4;  // NOTE ihl is in 4 bytes (= 32 bit) increments
+  // NOTE tot_len is stored in network byte order.
+  //      Frames shorter than the minimum ethernet payload are padded, so the
+  //      received data may be longer than tot_len. It must not be shorter.
+  const size_t tot_len = get_tot_len();
+  if (tot_len > marshaled.size()) {
+    std::string msg = "Invalid total length: " + std::to_string(tot_len);
+    throw std::invalid_argument(msg);
+  }
+  if (tot_len <= hdr_len) {
     return;
   }
-  std::copy(&marshaled[hdr_len], &marshaled[header_.tot_len], std::back_inserter(body_));
+  std::copy(marshaled.begin() + hdr_len, marshaled.begin() + tot_len, std::back_inserter(body_));
 }
 
 std::vector<uint8_t> ip_packet::marshal() const {
@@ -106,6 +119,10 @@ uint8_t ip_packet::get_tos() const {
   return header_.tos;
 }
 
+uint8_t ip_packet::get_ecn() const {
+  return header_.tos & IP_ECN_MASK;
+}
+
 uint16_t ip_packet::get_tot_len() const {
   return ntohs(header_.tot_len);
 }
@@ -8,6 +8,24 @@
 const uint8_t PROTOCOL_TCP = 6;
 const uint8_t PROTOCOL_UDP = 17;
 
+// NOTE
+// (rfc 3168 - 5. Explicit Congestion Notification in IP)
+//      +-----+-----+
+//      | ECN FIELD |
+//      +-----+-----+
+//        ECT   CE         [Obsolete] RFC 2481 names for the ECN bits.
+//         0     0         Not-ECT
+//         0     1         ECT(1)
+//         1     0         ECT(0)
+//         1     1         CE
+//
+// The ECN field is the lowest 2 bits of the TOS byte.
+const uint8_t IP_ECN_MASK    = 0x3;
+const uint8_t IP_ECN_NOT_ECT = 0x0;
+const uint8_t IP_ECN_ECT_1   = 0x1;
+const uint8_t IP_ECN_ECT_0   = 0x2;
+const uint8_t IP_ECN_CE      = 0x3;
+
 /*
  * IPv4 Header Format
  *   0                   1                   2                   3
@@ -27,6 +45,9 @@ const uint8_t PROTOCOL_UDP = 17;
  *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  */
 
+// Header checksum (in host byte order) of a header without options.
+uint16_t calc_checksum(const struct iphdr *header);
+
 class ip_packet {
  private:
   struct iphdr header_;
@@ -39,11 +60,19 @@ class ip_packet {
       const uint8_t *src_addr,
       const uint8_t *dst_addr,
       const std::vector<uint8_t> body);
+  ip_packet(
+      const uint16_t protocol,
+      const uint8_t tos,
+      const uint8_t *src_addr,
+      const uint8_t *dst_addr,
+      const std::vector<uint8_t> body);
   ip_packet(const std::vector<uint8_t>marshaled);
   std::vector<uint8_t> marshal() const;
   uint8_t  get_version() const;
   uint8_t  get_ihl() const;
   uint8_t  get_tos() const;
+  // ECN field of the TOS (IP_ECN_*)
+  uint8_t  get_ecn() const;
   uint16_t get_tot_len() const;
   uint16_t get_id() const;
   uint16_t get_frag_off() const;
@@ -0,0 +1,129 @@
+#include <algorithm>  // for std::max()
+#include <chrono>
+#include <cstring>    // for std::memset()
+#include <utility>
+#include <vector>
+
+#include "ip_packet.h"
+#include "link_model.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const size_t IP_TOS_OFFSET      = 1;
+const size_t IP_CHECKSUM_OFFSET = 10;
+
+uint16_t ones_complement_add(const uint32_t a, const uint32_t b) {
+  uint32_t sum = a + b;
+  sum = (sum & 0xffff) + (sum >> 16);
+  return static_cast<uint16_t>((sum & 0xffff) + (sum >> 16));
+}
+
+// Set CE in the IP header of an ECN capable packet.
+// Returns false if the packet is not ECN capable.
+bool mark_ce(std::vector<uint8_t>& packet) {
+  if (packet.size() < 20) {
+    return false;
+  }
+  const uint8_t ecn = packet[IP_TOS_OFFSET] & IP_ECN_MASK;
+  if (ecn != IP_ECN_ECT_0 && ecn != IP_ECN_ECT_1) {
+    return false;
+  }
+  const uint16_t old_word = static_cast<uint16_t>(packet[0] << 8 | packet[IP_TOS_OFFSET]);
+  packet[IP_TOS_OFFSET] |= IP_ECN_CE;
+  const uint16_t new_word = static_cast<uint16_t>(packet[0] << 8 | packet[IP_TOS_OFFSET]);
+  // NOTE
+  // (rfc 1624 - 3. Discussion)
+  //   HC' = ~(~HC + ~m + m')
+  const uint16_t check =
+    static_cast<uint16_t>(packet[IP_CHECKSUM_OFFSET] << 8 | packet[IP_CHECKSUM_OFFSET + 1]);
+  const uint16_t updated = ~ones_complement_add(
+      ones_complement_add(static_cast<uint16_t>(~check), static_cast<uint16_t>(~old_word)),
+      new_word);
+  packet[IP_CHECKSUM_OFFSET]     = updated >> 8;
+  packet[IP_CHECKSUM_OFFSET + 1] = updated & 0xff;
+  return true;
+}
+} // namespace
+
+link_model::link_model(const link_model_config& config)
+  : config_(config), rng_(config.seed), uniform_(0.0, 1.0), sequence_(0) {
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+bool link_model::chance(const double probability) {
+  // (no random number is drawn for a feature which is off, so that turning
+  // one on does not change the fate of the packets under the others)
+  return probability > 0 && uniform_(rng_) < probability;
+}
+
+void link_model::send(std::vector<uint8_t> packet, const chrono::steady_clock::time_point now) {
+  stats_.packets++;
+  stats_.bytes += packet.size();
+  if (chance(config_.loss)) {
+    stats_.lost++;
+    return;
+  }
+  const size_t queued = get_queue_size(now);
+  if (config_.queue_limit != 0 && queued + packet.size() > config_.queue_limit) {
+    stats_.queue_drops++;
+    return;
+  }
+  if (config_.ecn_threshold != 0 && queued > config_.ecn_threshold && mark_ce(packet)) {
+    stats_.ce_marked++;
+  }
+  stats_.max_queue = std::max<uint64_t>(stats_.max_queue, queued + packet.size());
+
+  chrono::steady_clock::time_point departure = std::max(now, busy_until_);
+  if (config_.bandwidth != 0) {
+    departure += chrono::nanoseconds(packet.size() * 8 * 1000000000 / config_.bandwidth);
+  }
+  busy_until_ = departure;
+  chrono::steady_clock::time_point arrival = departure + config_.delay;
+  if (config_.jitter.count() > 0) {
+    arrival += chrono::nanoseconds(static_cast<int64_t>(uniform_(rng_) * config_.jitter.count()));
+  }
+  arrival = std::max(arrival, last_arrival_);
+  last_arrival_ = arrival;
+  if (chance(config_.reorder)) {
+    stats_.reordered++;
+    arrival += config_.reorder_delay;
+  }
+  if (chance(config_.duplicate)) {
+    stats_.duplicated++;
+    in_flight_.emplace(std::make_pair(arrival, sequence_++), packet);
+  }
+  in_flight_.emplace(std::make_pair(arrival, sequence_++), std::move(packet));
+}
+
+chrono::steady_clock::time_point link_model::get_next_arrival() const {
+  if (in_flight_.empty()) {
+    return chrono::steady_clock::time_point::max();
+  }
+  return in_flight_.begin()->first.first;
+}
+
+bool link_model::receive(const chrono::steady_clock::time_point now, std::vector<uint8_t>& packet) {
+  if (in_flight_.empty() || in_flight_.begin()->first.first > now) {
+    return false;
+  }
+  packet = std::move(in_flight_.begin()->second);
+  in_flight_.erase(in_flight_.begin());
+  return true;
+}
+
+size_t link_model::get_queue_size(const chrono::steady_clock::time_point now) const {
+  if (config_.bandwidth == 0 || busy_until_ <= now) {
+    return 0;
+  }
+  const uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(busy_until_ - now).count();
+  return static_cast<size_t>(static_cast<unsigned __int128>(ns) * config_.bandwidth / 8 / 1000000000);
+}
+
+const link_model_config& link_model::get_config() const {
+  return config_;
+}
+
+const link_model_stats& link_model::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,83 @@
+#ifndef LINK_MODEL_H_
+#define LINK_MODEL_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+struct link_model_config {
+  // bits per second, or 0 for no limit
+  uint64_t bandwidth;
+  // one way propagation delay
+  std::chrono::nanoseconds delay;
+  // random extra delay, uniform in [0, jitter] (packets are kept in order)
+  std::chrono::nanoseconds jitter;
+  // probabilities (0 to 1) that a packet is lost, held back by
+  // reorder_delay (overtaken by the next packets) or delivered twice
+  double loss;
+  double reorder;
+  double duplicate;
+  std::chrono::nanoseconds reorder_delay;
+  // bytes waiting for the link above which packets are dropped (tail drop),
+  // or 0 for no limit
+  size_t queue_limit;
+  // bytes waiting for the link above which ECN capable packets are marked
+  // CE, or 0 never to mark
+  size_t ecn_threshold;
+  // seed of the random numbers, so that a run can be repeated exactly
+  uint64_t seed;
+};
+
+struct link_model_stats {
+  uint64_t packets;        // packets given to the link
+  uint64_t bytes;
+  uint64_t lost;           // dropped at random
+  uint64_t queue_drops;    // dropped as the queue was full
+  uint64_t reordered;
+  uint64_t duplicated;
+  uint64_t ce_marked;
+  uint64_t max_queue;      // most bytes waiting for the link
+};
+
+// NOTE
+// One direction of a link, like a netem qdisc in front of a link of the given
+// bandwidth: a packet waits in a FIFO queue for the transmission of the
+// packets before it, takes size / bandwidth to be transmitted, and arrives
+// after the propagation delay (and jitter).
+//
+// Time is given by the caller, so the link has no clock of its own and never
+// waits. All randomness comes from the seed.
+class link_model {
+ private:
+  link_model_config config_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_;
+  // time the packets queued so far are transmitted by
+  std::chrono::steady_clock::time_point busy_until_;
+  // arrival of the last packet in order (jitter does not reorder)
+  std::chrono::steady_clock::time_point last_arrival_;
+  // packets on the way, by arrival time and then by the order they were sent
+  std::map<std::pair<std::chrono::steady_clock::time_point, uint64_t>, std::vector<uint8_t>> in_flight_;
+  uint64_t sequence_;
+  link_model_stats stats_;
+
+  bool chance(const double probability);
+ public:
+  link_model(const link_model_config& config);
+  // Put an IP packet on the link at the time.
+  void send(std::vector<uint8_t> packet, const std::chrono::steady_clock::time_point now);
+  // Arrival time of the next packet, or time_point::max() if none is on the way.
+  std::chrono::steady_clock::time_point get_next_arrival() const;
+  // Take the next packet which has arrived by now. Returns false if there is none.
+  bool receive(const std::chrono::steady_clock::time_point now, std::vector<uint8_t>& packet);
+  // Bytes waiting for the link at the time.
+  size_t get_queue_size(const std::chrono::steady_clock::time_point now) const;
+  const link_model_config& get_config() const;
+  const link_model_stats& get_stats() const;
+};
+
+#endif  // LINK_MODEL_H_
@@ -0,0 +1,73 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "link_simulator.h"
+#include "tcp_clock.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// (not zero, so that the start is not taken for an unset time)
+const chrono::steady_clock::time_point SIMULATION_START(chrono::hours(1));
+} // namespace
+
+link_simulator::link_simulator(
+    const link_model_config& forward,
+    const link_model_config& backward,
+    const sim_peer_config& peer)
+  : now_(SIMULATION_START), forward_(forward), backward_(backward),
+    peer_(peer, [this](std::vector<uint8_t> packet) { backward_.send(std::move(packet), now_); }) {
+  set_tcp_virtual_clock(&now_);
+}
+
+link_simulator::~link_simulator() {
+  set_tcp_virtual_clock(nullptr);
+}
+
+void link_simulator::set_receive_handler(const sim_receive_handler& handler) {
+  receive_ = handler;
+}
+
+void link_simulator::send(std::vector<uint8_t> packet) {
+  forward_.send(std::move(packet), now_);
+}
+
+chrono::steady_clock::time_point link_simulator::now() const {
+  return now_;
+}
+
+bool link_simulator::advance(const chrono::steady_clock::time_point deadline) {
+  const chrono::steady_clock::time_point next = std::min({
+      forward_.get_next_arrival(), backward_.get_next_arrival(), peer_.get_next_timer(), deadline});
+  if (next == chrono::steady_clock::time_point::max()) {
+    return false;
+  }
+  if (next > now_) {
+    now_ = next;
+  }
+  // (what the peer sends over a link without delay arrives now as well)
+  while (forward_.receive(now_, packet_)) {
+    peer_.on_packet(packet_, now_);
+  }
+  peer_.on_timer(now_);
+  while (backward_.receive(now_, packet_)) {
+    if (receive_) {
+      receive_(packet_);
+    }
+  }
+  return true;
+}
+
+const link_model& link_simulator::get_forward_link() const {
+  return forward_;
+}
+
+const link_model& link_simulator::get_backward_link() const {
+  return backward_;
+}
+
+const sim_peer& link_simulator::get_peer() const {
+  return peer_;
+}
@@ -0,0 +1,58 @@
+#ifndef LINK_SIMULATOR_H_
+#define LINK_SIMULATOR_H_
+
+#include <chrono>
+#include <cstdint>  // for uint8_t
+#include <functional>
+#include <vector>
+
+#include "link_model.h"
+#include "sim_peer.h"
+
+// Receives an IP packet the peer sent to the stack.
+using sim_receive_handler = std::function<void(const std::vector<uint8_t>& packet)>;
+
+// NOTE
+// Discrete event simulation of the stack and a sim_peer connected by a link
+// (one link_model per direction), in place of the raw socket and the network.
+//
+// Time is virtual: advance() jumps the clock to the next event (a packet
+// arriving at either end, a timer of the peer, or a deadline of the stack),
+// so nothing waits and a run does the same thing every time for the same
+// seeds. While the simulator exists, tcp_clock_now() of its thread returns
+// the virtual time, which the TCBs use for RTT samples and delayed ACKs.
+//
+// A simulator must be used on the thread which created it.
+class link_simulator {
+ private:
+  std::chrono::steady_clock::time_point now_;
+  // stack to peer
+  link_model forward_;
+  // peer to stack
+  link_model backward_;
+  sim_peer peer_;
+  sim_receive_handler receive_;
+  std::vector<uint8_t> packet_;
+ public:
+  link_simulator(
+      const link_model_config& forward,
+      const link_model_config& backward,
+      const sim_peer_config& peer);
+  link_simulator(const link_simulator&) = delete;
+  link_simulator& operator=(const link_simulator&) = delete;
+  ~link_simulator();
+  void set_receive_handler(const sim_receive_handler& handler);
+  // Send an IP packet of the stack to the peer now.
+  void send(std::vector<uint8_t> packet);
+  std::chrono::steady_clock::time_point now() const;
+  // Move the clock to the earliest of the next event and the deadline (e.g.
+  // the next timer of the stack), and deliver the packets which have arrived
+  // by then. Returns false if nothing will ever happen (no packets on the
+  // way, no timers and no deadline).
+  bool advance(const std::chrono::steady_clock::time_point deadline);
+  const link_model& get_forward_link() const;
+  const link_model& get_backward_link() const;
+  const sim_peer& get_peer() const;
+};
+
+#endif  // LINK_SIMULATOR_H_
@@ -0,0 +1,67 @@
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "sim_link.h"
+
+namespace chrono = std::chrono;
+
+sim_link::sim_link(link_simulator& sim, const ip_addr src_ip, const uint32_t mtu)
+  : sim_(sim), src_ip_(src_ip), mtu_(mtu) {
+  sim_.set_receive_handler([this](const std::vector<uint8_t>& packet) {
+    received_.push_back(packet);
+  });
+}
+
+const ip_addr& sim_link::get_src_ip() const {
+  return src_ip_;
+}
+
+uint32_t sim_link::get_mtu() const {
+  return mtu_;
+}
+
+void sim_link::send(
+    const uint8_t *,
+    const std::vector<uint8_t>& packet,
+    const chrono::steady_clock::time_point) {
+  sim_.send(packet);
+}
+
+bool sim_link::try_recv(std::vector<uint8_t>& packet) {
+  if (received_.empty()) {
+    return false;
+  }
+  packet = std::move(received_.front());
+  received_.pop_front();
+  return true;
+}
+
+bool sim_link::wait(const chrono::steady_clock::time_point deadline) {
+  if (!received_.empty()) {
+    return true;
+  }
+  if (!sim_.advance(deadline)) {
+    throw std::runtime_error("Nothing left to simulate");
+  }
+  return !received_.empty();
+}
+
+bool sim_link::lookup_neighbor(const uint8_t *, mac_addr& mac) {
+  mac = mac_addr();
+  return true;
+}
+
+void sim_link::resolve_neighbor(const uint8_t *dst_ip_bytes, const neighbor_callback& callback) {
+  ip_addr next_hop;
+  next_hop.from_host_order(dst_ip_bytes);
+  callback(next_hop, true, mac_addr());
+}
+
+bool sim_link::enable_txtime() {
+  return false;
+}
+
+void sim_link::set_capture(pcapng_writer *) {
+}
@@ -0,0 +1,56 @@
+#ifndef SIM_LINK_H_
+#define SIM_LINK_H_
+
+#include <chrono>
+#include <cstdint>  // for uint8_t, uint32_t
+#include <deque>
+#include <vector>
+
+#include "ip_addr.h"
+#include "link_simulator.h"
+#include "mac_addr.h"
+#include "packet_link.h"
+
+// NOTE
+// packet_link of the stack side of a link_simulator, so that an event_loop
+// and its tcp_connections talk to the sim_peer over the simulated link:
+//
+//   link_simulator sim(forward, backward, peer);
+//   sim_link link(sim, src_ip, 1500);
+//   event_loop loop(link);
+//   loop.spawn(transfer(loop));
+//   loop.run();
+//
+// wait() advances the simulator to the deadline of the loop (or to the next
+// packet), so the loop runs on the virtual clock of the simulator. There is
+// no ARP: every destination is on the link, at a zero link address.
+// Departure times are not supported (pacing_mode::TXTIME falls back to
+// INTERNAL), and frames are not captured.
+class sim_link : public packet_link {
+ private:
+  link_simulator& sim_;
+  ip_addr src_ip_;
+  uint32_t mtu_;
+  // packets of the peer not received by the loop yet
+  std::deque<std::vector<uint8_t>> received_;
+ public:
+  sim_link(link_simulator& sim, const ip_addr src_ip, const uint32_t mtu);
+  sim_link(const sim_link&) = delete;
+  sim_link& operator=(const sim_link&) = delete;
+  const ip_addr& get_src_ip() const override;
+  uint32_t get_mtu() const override;
+  void send(
+      const uint8_t *dst_mac_bytes,
+      const std::vector<uint8_t>& packet,
+      const std::chrono::steady_clock::time_point departure) override;
+  bool try_recv(std::vector<uint8_t>& packet) override;
+  // Throws std::runtime_error if nothing will ever happen (no packets on the
+  // way, no timers of the peer and no deadline), as the loop would wait forever.
+  bool wait(const std::chrono::steady_clock::time_point deadline) override;
+  bool lookup_neighbor(const uint8_t *dst_ip_bytes, mac_addr& mac) override;
+  void resolve_neighbor(const uint8_t *dst_ip_bytes, const neighbor_callback& callback) override;
+  bool enable_txtime() override;
+  void set_capture(pcapng_writer *capture) override;
+};
+
+#endif  // SIM_LINK_H_
@@ -0,0 +1,300 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+#include <cstring>    // for std::memcmp(), std::memcpy(), std::memset()
+#include <stdexcept>
+#include <vector>
+
+#include "ip_packet.h"
+#include "sim_peer.h"
+#include "tcp_options.h"
+#include "tcp_segment.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// (rfc 9293 - 3.7.1. Maximum Segment Size Option)
+const uint16_t DEFAULT_MSS = 536;
+const uint8_t MAX_WINDOW_SCALE = 14;
+
+bool seq_lt(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+bool seq_le(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) <= 0;
+}
+} // namespace
+
+sim_peer::sim_peer(const sim_peer_config& config, const sim_send_handler& send)
+  : config_(config), send_(send), state_(state::LISTEN), remote_port_(0),
+    snd_wscale_(0), rcv_wscale_(0), snd_mss_(DEFAULT_MSS), ecn_(false), ece_pending_(false),
+    irs_(0), rcv_nxt_(0), fin_received_(false), syn_acked_(false),
+    snd_una_(0), snd_nxt_(0), snd_max_(0), snd_wnd_(0), fin_sent_(false),
+    rto_deadline_(chrono::steady_clock::time_point::max()) {
+  std::memset(remote_ip_, 0, sizeof(remote_ip_));
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+void sim_peer::on_packet(const std::vector<uint8_t>& packet, const chrono::steady_clock::time_point now) {
+  try {
+    const ip_packet pkt(packet);
+    uint8_t daddr[4];
+    pkt.get_daddr(daddr);
+    if (pkt.get_protocol() != PROTOCOL_TCP || std::memcmp(daddr, config_.ip, sizeof(daddr)) != 0) {
+      return;
+    }
+    const tcp_segment seg(pkt.get_body());
+    if (seg.get_dst_port() != config_.port) {
+      return;
+    }
+    uint8_t saddr[4];
+    pkt.get_saddr(saddr);
+    stats_.segments_received++;
+    if (seg.get_rst()) {
+      state_ = state::LISTEN;
+      rto_deadline_ = chrono::steady_clock::time_point::max();
+      return;
+    }
+    if (seg.get_syn()) {
+      on_syn(saddr, seg.get_src_port(), seg);
+      return;
+    }
+    if (state_ != state::ESTABLISHED ||
+        std::memcmp(saddr, remote_ip_, sizeof(saddr)) != 0 || seg.get_src_port() != remote_port_) {
+      return;
+    }
+    // (rfc 3168 - 6.1.3. The TCP Receiver)
+    //   When a CE packet is received by a data receiver, the receiver sets the
+    //   ECN-Echo flag in the TCP header of the subsequent ACK packet.
+    // ... until a segment with CWR arrives, which the CE of the same
+    // segment overrides.
+    if (seg.get_cwr()) {
+      ece_pending_ = false;
+    }
+    if (pkt.get_ecn() == IP_ECN_CE) {
+      stats_.ce_received++;
+      ece_pending_ = ecn_;
+    }
+    if (seg.get_ack()) {
+      on_ack(seg, now);
+    }
+    if (seg.get_body_size() != 0) {
+      on_data(seg.get_seq(), seg.get_body_data(), seg.get_body_size());
+    }
+    // (a FIN ahead of RCV.NXT is sent again by the stack)
+    if (seg.get_fin() && !fin_received_ && seg.get_seq() + seg.get_body_size() == rcv_nxt_) {
+      rcv_nxt_++;
+      fin_received_ = true;
+    }
+    if (seg.get_body_size() != 0 || seg.get_fin()) {
+      send_segment(snd_nxt_, false, false, std::vector<uint8_t>(), std::vector<uint8_t>());
+      stats_.acks_sent++;
+    }
+    transmit(now);
+  } catch (const std::invalid_argument&) {
+    // Malformed packet
+  }
+}
+
+void sim_peer::on_syn(const uint8_t *src_ip, const uint16_t src_port, const tcp_segment& seg) {
+  if (state_ == state::ESTABLISHED) {
+    // SYN-ACK was lost, so the stack sends SYN again.
+    if (!syn_acked_ && seg.get_seq() == irs_ &&
+        std::memcmp(src_ip, remote_ip_, sizeof(remote_ip_)) == 0 && src_port == remote_port_) {
+      snd_nxt_ = config_.iss;
+    } else {
+      // One connection at a time.
+      return;
+    }
+  } else {
+    std::memcpy(remote_ip_, src_ip, sizeof(remote_ip_));
+    remote_port_ = src_port;
+    irs_ = seg.get_seq();
+    // (data of SYN is not accepted without a Fast Open cookie, so the stack
+    // sends it again)
+    rcv_nxt_ = irs_ + 1;
+    const tcp_options options(seg.get_options());
+    snd_mss_ = std::min(options.has_mss() ? options.get_mss() : DEFAULT_MSS, config_.mss);
+    snd_wscale_ = options.has_window_scale() ? std::min(options.get_window_scale(), MAX_WINDOW_SCALE) : 0;
+    rcv_wscale_ = options.has_window_scale() ? config_.window_scale : 0;
+    snd_wnd_ = seg.get_window();
+    // An ECN-setup SYN has both ECE and CWR (rfc 3168 - 6.1.1.)
+    ecn_ = seg.get_ece() && seg.get_cwr();
+    ece_pending_ = false;
+    fin_received_ = false;
+    out_of_order_.clear();
+    syn_acked_ = false;
+    snd_una_ = config_.iss;
+    snd_nxt_ = config_.iss;
+    snd_max_ = config_.iss + 1;
+    send_queue_.clear();
+    fin_sent_ = false;
+    rto_deadline_ = chrono::steady_clock::time_point::max();
+    state_ = state::ESTABLISHED;
+  }
+  tcp_options options;
+  options.set_mss(config_.mss);
+  if (rcv_wscale_ != 0 || snd_wscale_ != 0) {
+    options.set_window_scale(config_.window_scale);
+  }
+  send_segment(snd_nxt_, true, false, options.marshal(), std::vector<uint8_t>());
+  snd_nxt_++;
+}
+
+void sim_peer::on_ack(const tcp_segment& seg, const chrono::steady_clock::time_point now) {
+  const uint32_t ack = seg.get_ack_seq();
+  if (!syn_acked_) {
+    if (ack != config_.iss + 1) {
+      return;
+    }
+    syn_acked_ = true;
+    snd_una_ = ack;
+  } else if (seq_lt(snd_una_, ack) && seq_le(ack, snd_max_)) {
+    // (the rest beyond the data is our FIN)
+    const size_t acked = std::min<size_t>(ack - snd_una_, send_queue_.size());
+    send_queue_.erase(send_queue_.begin(), send_queue_.begin() + acked);
+    snd_una_ = ack;
+    if (seq_lt(snd_nxt_, snd_una_)) {
+      snd_nxt_ = snd_una_;
+    }
+    rto_deadline_ = snd_una_ == snd_max_ ? chrono::steady_clock::time_point::max() : now + config_.rto;
+  }
+  snd_wnd_ = static_cast<uint32_t>(seg.get_window()) << snd_wscale_;
+}
+
+void sim_peer::on_data(uint32_t seq, const uint8_t *data, size_t size) {
+  if (seq_lt(seq, rcv_nxt_)) {
+    if (seq_le(seq + size, rcv_nxt_)) {
+      stats_.duplicates++;
+      return;
+    }
+    const uint32_t skip = rcv_nxt_ - seq;
+    seq += skip;
+    data += skip;
+    size -= skip;
+  }
+  if (seq != rcv_nxt_) {
+    stats_.out_of_order++;
+    out_of_order_.emplace(seq - irs_, std::vector<uint8_t>(data, data + size));
+    return;
+  }
+  accept(data, size);
+  // Segments kept which are now in order
+  while (!out_of_order_.empty()) {
+    const auto first = out_of_order_.begin();
+    const uint32_t first_seq = irs_ + first->first;
+    if (seq_lt(rcv_nxt_, first_seq)) {
+      break;
+    }
+    const std::vector<uint8_t>& kept = first->second;
+    if (seq_lt(rcv_nxt_, first_seq + kept.size())) {
+      const uint32_t skip = rcv_nxt_ - first_seq;
+      accept(kept.data() + skip, kept.size() - skip);
+    }
+    out_of_order_.erase(first);
+  }
+}
+
+void sim_peer::accept(const uint8_t *data, const size_t size) {
+  rcv_nxt_ += size;
+  stats_.bytes_received += size;
+  if (config_.mode == sim_peer_mode::ECHO) {
+    send_queue_.insert(send_queue_.end(), data, data + size);
+  }
+}
+
+uint16_t sim_peer::get_window() const {
+  return static_cast<uint16_t>(std::min<uint32_t>(config_.receive_window >> rcv_wscale_, 65535));
+}
+
+void sim_peer::send_segment(
+    const uint32_t seq, const bool syn, const bool fin,
+    const std::vector<uint8_t>& options, const std::vector<uint8_t>& body) {
+  // (the window of SYN-ACK is never scaled)
+  const uint16_t window = syn
+    ? static_cast<uint16_t>(std::min<uint32_t>(config_.receive_window, 65535))
+    : get_window();
+  const tcp_segment seg(
+      config_.ip, remote_ip_, config_.port, remote_port_,
+      seq, rcv_nxt_,
+      false,                        // ns
+      false,                        // cwr
+      syn ? ecn_ : ece_pending_,    // ece
+      false,                        // urg
+      true,                         // ack
+      !body.empty(),                // psh
+      false,                        // rst
+      syn,                          // syn
+      fin,                          // fin
+      window,
+      0,                            // urgent pointer
+      options,
+      body);
+  const ip_packet pkt(PROTOCOL_TCP, IP_ECN_NOT_ECT, config_.ip, remote_ip_, seg.marshal());
+  send_(pkt.marshal());
+}
+
+void sim_peer::transmit(const chrono::steady_clock::time_point now) {
+  if (state_ != state::ESTABLISHED || !syn_acked_) {
+    return;
+  }
+  while (true) {
+    const size_t offset = snd_nxt_ - snd_una_;
+    if (offset >= send_queue_.size() || offset >= snd_wnd_) {
+      break;
+    }
+    const size_t len = std::min<size_t>(
+        {snd_mss_, send_queue_.size() - offset, snd_wnd_ - offset});
+    const std::vector<uint8_t> body(
+        send_queue_.begin() + offset, send_queue_.begin() + offset + len);
+    send_segment(snd_nxt_, false, false, std::vector<uint8_t>(), body);
+    stats_.bytes_sent += len;
+    snd_nxt_ += len;
+    if (seq_lt(snd_max_, snd_nxt_)) {
+      snd_max_ = snd_nxt_;
+    }
+  }
+  // Closed after the stack, once everything is echoed.
+  if (fin_received_ && !fin_sent_ && snd_nxt_ - snd_una_ == send_queue_.size()) {
+    send_segment(snd_nxt_, false, true, std::vector<uint8_t>(), std::vector<uint8_t>());
+    snd_nxt_++;
+    if (seq_lt(snd_max_, snd_nxt_)) {
+      snd_max_ = snd_nxt_;
+    }
+    fin_sent_ = true;
+  }
+  if (snd_una_ != snd_max_ && rto_deadline_ == chrono::steady_clock::time_point::max()) {
+    rto_deadline_ = now + config_.rto;
+  }
+}
+
+chrono::steady_clock::time_point sim_peer::get_next_timer() const {
+  return rto_deadline_;
+}
+
+void sim_peer::on_timer(const chrono::steady_clock::time_point now) {
+  if (now < rto_deadline_) {
+    return;
+  }
+  rto_deadline_ = chrono::steady_clock::time_point::max();
+  if (state_ != state::ESTABLISHED || snd_una_ == snd_max_) {
+    return;
+  }
+  // Go back to the oldest byte not acknowledged.
+  stats_.retransmissions++;
+  snd_nxt_ = snd_una_;
+  fin_sent_ = false;
+  transmit(now);
+}
+
+bool sim_peer::fin_received() const {
+  return fin_received_;
+}
+
+const sim_peer_config& sim_peer::get_config() const {
+  return config_;
+}
+
+const sim_peer_stats& sim_peer::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,122 @@
+#ifndef SIM_PEER_H_
+#define SIM_PEER_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "tcp_segment.h"
+
+enum class sim_peer_mode {
+  // Received data is acknowledged and dropped.
+  SINK,
+  // Received data is sent back.
+  ECHO,
+};
+
+struct sim_peer_config {
+  // address and port the peer listens on
+  uint8_t ip[4];
+  uint16_t port;
+  sim_peer_mode mode;
+  uint32_t iss;
+  uint16_t mss;
+  // shift of the Window Scale option of SYN-ACK
+  uint8_t window_scale;
+  // receive window (bytes)
+  uint32_t receive_window;
+  // time before echoed data not acknowledged is sent again
+  std::chrono::nanoseconds rto;
+};
+
+struct sim_peer_stats {
+  uint64_t segments_received;
+  uint64_t bytes_received;      // data received in order
+  uint64_t out_of_order;        // segments received ahead of RCV.NXT
+  uint64_t duplicates;          // segments of data received already
+  uint64_t ce_received;         // segments marked CE
+  uint64_t acks_sent;
+  uint64_t bytes_sent;          // echoed data, with retransmissions
+  uint64_t retransmissions;     // timeouts of echoed data
+};
+
+// Sends an IP packet of the peer.
+using sim_send_handler = std::function<void(std::vector<uint8_t> packet)>;
+
+// NOTE
+// Scripted TCP endpoint on the far side of a link_simulator: it accepts one
+// connection at a time and acknowledges every segment at once, like a
+// receiver with delayed ACKs off.
+//
+// (rfc 9293 - 3.10.7.4. Other States)
+//   Segments with higher beginning sequence numbers SHOULD be held for later
+//   processing.
+// Out-of-order segments are kept and acknowledged by duplicate ACKs, and
+// CE marks are echoed by ECE until CWR is received (rfc 3168 - 6.1.3.).
+//
+// Echoed data is sent as the window of the stack allows, without congestion
+// control, and sent again from the oldest byte not acknowledged when rto
+// passes (go-back-N). It is sent Not-ECT.
+class sim_peer {
+ private:
+  enum class state {
+    LISTEN,
+    ESTABLISHED,
+  };
+
+  sim_peer_config config_;
+  sim_send_handler send_;
+  state state_;
+  uint8_t remote_ip_[4];
+  uint16_t remote_port_;
+  // shift of the window of the stack, 0 unless both offer the option
+  uint8_t snd_wscale_;
+  uint8_t rcv_wscale_;
+  uint16_t snd_mss_;
+  bool ecn_;
+  bool ece_pending_;
+  uint32_t irs_;
+  uint32_t rcv_nxt_;
+  bool fin_received_;
+  // segments received ahead of rcv_nxt_, by offset from irs_ (so that they
+  // are in order across the wrap of sequence numbers)
+  std::map<uint32_t, std::vector<uint8_t>> out_of_order_;
+  bool syn_acked_;
+  uint32_t snd_una_;
+  uint32_t snd_nxt_;
+  // highest sequence number sent (snd_nxt_ goes back on a timeout)
+  uint32_t snd_max_;
+  uint32_t snd_wnd_;
+  // data from snd_una_ on (not acknowledged or not sent yet)
+  std::deque<uint8_t> send_queue_;
+  bool fin_sent_;
+  std::chrono::steady_clock::time_point rto_deadline_;
+  sim_peer_stats stats_;
+
+  void on_syn(const uint8_t *src_ip, const uint16_t src_port, const tcp_segment& seg);
+  void on_ack(const tcp_segment& seg, const std::chrono::steady_clock::time_point now);
+  void on_data(uint32_t seq, const uint8_t *data, size_t size);
+  void accept(const uint8_t *data, const size_t size);
+  uint16_t get_window() const;
+  void send_segment(
+      const uint32_t seq, const bool syn, const bool fin,
+      const std::vector<uint8_t>& options, const std::vector<uint8_t>& body);
+  void transmit(const std::chrono::steady_clock::time_point now);
+ public:
+  sim_peer(const sim_peer_config& config, const sim_send_handler& send);
+  // Process an IP packet sent to the peer.
+  void on_packet(const std::vector<uint8_t>& packet, const std::chrono::steady_clock::time_point now);
+  // Time of the retransmission timer, or time_point::max() if it is not armed.
+  std::chrono::steady_clock::time_point get_next_timer() const;
+  void on_timer(const std::chrono::steady_clock::time_point now);
+  // Returns true if the stack has closed its side of the connection.
+  bool fin_received() const;
+  const sim_peer_config& get_config() const;
+  const sim_peer_stats& get_stats() const;
+};
+
+#endif  // SIM_PEER_H_
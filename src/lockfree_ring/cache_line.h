@@ -0,0 +1,12 @@
+#ifndef CACHE_LINE_H_
+#define CACHE_LINE_H_
+
+#include <cstddef>  // for size_t
+
+// NOTE
+// Fields written by different threads are aligned to this, so that a write by
+// one thread does not invalidate the line read by another (false sharing).
+// (std::hardware_destructive_interference_size is not stable across compilers.)
+const size_t CACHE_LINE_SIZE = 64;
+
+#endif  // CACHE_LINE_H_
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <cerrno>       // for errno
+#include <cstdint>      // for uint64_t
+#include <cstring>      // for std::strerror()
+#include <poll.h>       // for poll()
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>  // for eventfd()
+#include <unistd.h>     // for read(), write(), close()
+
+#include "doorbell.h"
+
+doorbell::doorbell() : fd_(-1), waiting_(false), wakeups_(0) {
+  fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd_ == -1) {
+    std::string msg = "Failed to create eventfd: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+}
+
+doorbell::~doorbell() {
+  close(fd_);
+}
+
+void doorbell::notify() {
+  // Order the publication of items before reading waiting_
+  // (pairs with the fence in prepare_wait()).
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!waiting_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  // Only one producer needs to write.
+  if (!waiting_.exchange(false, std::memory_order_relaxed)) {
+    return;
+  }
+  const uint64_t one = 1;
+  if (write(fd_, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+    std::string msg = "Failed to write eventfd: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  wakeups_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void doorbell::prepare_wait() {
+  waiting_.store(true, std::memory_order_relaxed);
+  // Order the store of waiting_ before the consumer re-checks its rings.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void doorbell::cancel_wait() {
+  waiting_.store(false, std::memory_order_relaxed);
+}
+
+void doorbell::wait() {
+  struct pollfd pfd = {};
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  while (poll(&pfd, 1, -1) == -1) {
+    if (errno != EINTR) {
+      std::string msg = "Failed to poll eventfd: ";
+      msg += std::strerror(errno);
+      throw std::runtime_error(msg);
+    }
+  }
+  clear();
+}
+
+int doorbell::get_fd() const {
+  return fd_;
+}
+
+void doorbell::clear() {
+  uint64_t count;
+  while (read(fd_, &count, sizeof(count)) == -1 && errno == EINTR) {}
+  waiting_.store(false, std::memory_order_relaxed);
+}
+
+uint64_t doorbell::get_wakeups() const {
+  return wakeups_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,57 @@
+#ifndef DOORBELL_H_
+#define DOORBELL_H_
+
+#include <atomic>
+#include <cstdint>  // for uint64_t
+
+#include "cache_line.h"
+
+// NOTE
+// Wakes up a consumer which sleeps while its rings are empty.
+// An eventfd is written only if the consumer announced it is going to sleep,
+// so a busy consumer costs producers no system call.
+//
+// Consumer:
+//   while (!ring.try_pop(item)) {
+//     bell.prepare_wait();
+//     if (!ring.empty()) {   // re-check after announcing
+//       bell.cancel_wait();
+//       continue;
+//     }
+//     bell.wait();
+//   }
+//
+// Producer:
+//   ring.try_push(item);     // or stage() items and publish() once
+//   bell.notify();
+//
+// The fences in prepare_wait() and notify() guarantee that either the
+// consumer sees the item in its re-check, or the producer sees the consumer
+// waiting and writes the eventfd.
+class doorbell {
+ private:
+  int fd_;
+  alignas(CACHE_LINE_SIZE) std::atomic<bool> waiting_;
+  std::atomic<uint64_t> wakeups_;
+ public:
+  doorbell();
+  doorbell(const doorbell&) = delete;
+  doorbell& operator=(const doorbell&) = delete;
+  ~doorbell();
+  // Producer: call after publishing items.
+  void notify();
+  // Consumer: announce that it is going to sleep.
+  void prepare_wait();
+  void cancel_wait();
+  // Consumer: sleep until notified.
+  void wait();
+  // Readable while the consumer should wake up (for poll()/epoll).
+  // Call prepare_wait() before polling it and clear() after waking up.
+  int get_fd() const;
+  // Consumer: drain the eventfd after it became readable.
+  void clear();
+  // Number of eventfd writes (system calls made by producers).
+  uint64_t get_wakeups() const;
+};
+
+#endif  // DOORBELL_H_
@@ -0,0 +1,136 @@
+#ifndef MPSC_RING_H_
+#define MPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for intptr_t
+#include <memory>
+#include <stdexcept>
+#include <utility>  // for std::move()
+
+#include "cache_line.h"
+
+// NOTE
+// Bounded lock-free ring from any number of producer threads to one consumer
+// thread (see: Dmitry Vyukov, "Bounded MPMC queue").
+//
+// Each slot has a sequence number telling whose turn it is:
+//   sequence == pos                : free, the producer claiming pos may write it
+//   sequence == pos + 1            : written, the consumer may take it
+//   sequence == pos + capacity     : taken, free for the next lap
+//
+// Producers claim positions by CAS on tail_ and publish each slot by storing
+// its sequence, so a slow producer delays only the consumer reaching its
+// slot, not the other producers. push_batch() claims a run of slots with one
+// CAS, which keeps the shared tail_ line from bouncing once per item.
+template <typename T>
+class mpsc_ring {
+ private:
+  struct slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  // producers side
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+  // consumer side
+  alignas(CACHE_LINE_SIZE) size_t head_;
+  // read only
+  alignas(CACHE_LINE_SIZE) size_t mask_;
+  std::unique_ptr<slot[]> slots_;
+
+  // Returns the number of free slots from pos (up to max_size), or 0 if pos
+  // has already been claimed by another producer.
+  size_t free_run(const size_t pos, const size_t max_size) const {
+    size_t run = 0;
+    while (run < max_size &&
+           slots_[(pos + run) & mask_].sequence.load(std::memory_order_acquire) == pos + run) {
+      run++;
+    }
+    return run;
+  }
+
+ public:
+  // capacity must be a power of 2.
+  explicit mpsc_ring(const size_t capacity)
+    : tail_(0), head_(0), mask_(capacity - 1), slots_(new slot[capacity]) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      throw std::invalid_argument("Capacity must be a power of 2");
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  mpsc_ring(const mpsc_ring&) = delete;
+  mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+  // Producer: returns false if full.
+  bool try_push(T item) {
+    return push_batch(&item, 1) == 1;
+  }
+
+  // Producer: push up to size items claimed at once. Returns the number of pushed items.
+  size_t push_batch(const T *items, const size_t size) {
+    if (size == 0) {
+      return 0;
+    }
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    size_t run;
+    while (true) {
+      const size_t sequence = slots_[pos & mask_].sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff < 0) {
+        // The consumer has not taken the item of the previous lap: full.
+        return 0;
+      }
+      if (diff == 0) {
+        run = free_run(pos, size);
+        if (run != 0 &&
+            tail_.compare_exchange_weak(pos, pos + run, std::memory_order_relaxed)) {
+          break;
+        }
+        // pos is updated by the failed CAS
+        continue;
+      }
+      // Another producer claimed pos
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < run; ++i) {
+      slot& s = slots_[(pos + i) & mask_];
+      s.value = items[i];
+      s.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return run;
+  }
+
+  // Consumer: returns false if empty (or the next item is not published yet).
+  bool try_pop(T& item) {
+    slot& s = slots_[head_ & mask_];
+    if (s.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      return false;
+    }
+    item = std::move(s.value);
+    s.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    head_++;
+    return true;
+  }
+
+  // Consumer: take up to max_size items. Returns the number of taken items.
+  size_t pop_batch(T *items, const size_t max_size) {
+    size_t size = 0;
+    while (size < max_size && try_pop(items[size])) {
+      size++;
+    }
+    return size;
+  }
+
+  // Consumer: true if the next item is not published yet.
+  bool empty() const {
+    return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+  }
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+};
+
+#endif  // MPSC_RING_H_
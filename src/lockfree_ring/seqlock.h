@@ -0,0 +1,79 @@
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <atomic>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <cstring>  // for std::memcpy()
+#include <type_traits>
+
+#include "cache_line.h"
+
+// NOTE
+// Value written by one thread and read by any number of threads, where the
+// writer never waits for the readers.
+//
+//   seq_ : odd while a store is in progress, and advanced by 2 per store
+//
+// A reader copies the value and retries if seq_ was odd or changed in the
+// meantime, so it always gets a value as of one store. The value is kept in
+// relaxed atomic words (not copied with memcpy), so that a torn read is
+// harmless to the language as well as discarded. Readers never write, so
+// they do not slow the writer down beyond sharing the lines.
+template <typename T>
+class seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+ private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> seq_;
+  std::atomic<uint64_t> words_[WORDS];
+
+ public:
+  seqlock() : seq_(0) {
+    for (size_t i = 0; i < WORDS; ++i) {
+      words_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+  explicit seqlock(const T& value) : seqlock() {
+    store(value);
+  }
+  seqlock(const seqlock&) = delete;
+  seqlock& operator=(const seqlock&) = delete;
+
+  // Writer (one thread at a time).
+  void store(const T& value) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Readers (any thread).
+  T load() const {
+    uint64_t words[WORDS];
+    uint64_t seq;
+    do {
+      seq = seq_.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq_.load(std::memory_order_relaxed) != seq);
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  // Number of stores so far.
+  uint64_t get_version() const {
+    return seq_.load(std::memory_order_acquire) / 2;
+  }
+};
+
+#endif  // SEQLOCK_H_
@@ -0,0 +1,135 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>  // for size_t
+#include <memory>
+#include <stdexcept>
+#include <utility>  // for std::move()
+
+#include "cache_line.h"
+
+// NOTE
+// Bounded lock-free ring between one producer thread and one consumer thread.
+//
+//   tail_ : written by the producer only (next slot to publish)
+//   head_ : written by the consumer only (next slot to take)
+//
+// Each side keeps its own index and a cached copy of the other one on its own
+// cache line, and reads the other side's index only when the cached copy says
+// the ring is full (or empty). In the common case an operation touches no
+// line written by the other thread except the slot itself.
+//
+// Doorbell batching: stage() fills slots without showing them to the
+// consumer, and publish() makes all staged items visible with one store
+// (and the producer rings the doorbell once). pop_batch() likewise frees
+// all taken slots with one store.
+template <typename T>
+class spsc_ring {
+ private:
+  // consumer side
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_;
+  size_t cached_tail_;
+  // producer side
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+  size_t staged_tail_;
+  size_t cached_head_;
+  // read only
+  alignas(CACHE_LINE_SIZE) size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+ public:
+  // capacity must be a power of 2.
+  explicit spsc_ring(const size_t capacity)
+    : head_(0), cached_tail_(0), tail_(0), staged_tail_(0), cached_head_(0),
+      mask_(capacity - 1), slots_(new T[capacity]) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      throw std::invalid_argument("Capacity must be a power of 2");
+    }
+  }
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+
+  // Producer: put an item without publishing it. Returns false if full.
+  bool stage(T item) {
+    if (staged_tail_ - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (staged_tail_ - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    slots_[staged_tail_ & mask_] = std::move(item);
+    staged_tail_++;
+    return true;
+  }
+
+  // Producer: make all staged items visible to the consumer.
+  void publish() {
+    tail_.store(staged_tail_, std::memory_order_release);
+  }
+
+  // Producer: stage and publish one item.
+  bool try_push(T item) {
+    if (!stage(std::move(item))) {
+      return false;
+    }
+    publish();
+    return true;
+  }
+
+  // Producer: stage and publish up to size items. Returns the number of pushed items.
+  size_t push_batch(const T *items, const size_t size) {
+    size_t pushed = 0;
+    while (pushed < size && stage(items[pushed])) {
+      pushed++;
+    }
+    if (pushed != 0) {
+      publish();
+    }
+    return pushed;
+  }
+
+  // Consumer: take one item. Returns false if empty.
+  bool try_pop(T& item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: take up to max_size items. Returns the number of taken items.
+  size_t pop_batch(T *items, const size_t max_size) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t size = cached_tail_ - head;
+    if (size > max_size) {
+      size = max_size;
+    }
+    for (size_t i = 0; i < size; ++i) {
+      items[i] = std::move(slots_[(head + i) & mask_]);
+    }
+    if (size != 0) {
+      head_.store(head + size, std::memory_order_release);
+    }
+    return size;
+  }
+
+  // Consumer: true if no published item is waiting.
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+};
+
+#endif  // SPSC_RING_H_
@@ -1,86 +1,58 @@
+#include <cstdlib>            // for std::getenv()
+#include <iomanip>            // for std::setw()
 #include <iostream>
+#include <memory>
 #include <net/ethernet.h>     // for ETH_P_ARP
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-#include "ioctl_util.h"
+#include "connection_table.h"
+#include "interface_table.h"
 #include "ip_addr.h"
 #include "ip_packet.h"
 #include "mac_addr.h"
 #include "name_resolver.h"
+#include "pcapng_writer.h"
+#include "port_allocator.h"
+#include "route_table.h"
 #include "socket_wrapper.h"
+#include "tcb_slab.h"
+#include "tcp_options.h"
 #include "tcp_segment.h"
+#include "trace_writer.h"
 #include "transmission_control_block.h"
 
 namespace {
-void print_ip_header(const ip_packet& pkt) {
-  std::cout << "version   : " << static_cast<unsigned>(pkt.get_version())  << std::endl;
-  std::cout << "ihl       : " << static_cast<unsigned>(pkt.get_ihl())      << std::endl;
-  std::cout << "tos       : " << static_cast<unsigned>(pkt.get_tos())      << std::endl;
-  std::cout << "tot_len   : " << static_cast<unsigned>(pkt.get_tot_len())  << std::endl;
-  std::cout << "id        : " << static_cast<unsigned>(pkt.get_id())       << std::endl;
-  std::cout << "frag_off  : " << static_cast<unsigned>(pkt.get_frag_off()) << std::endl;
-  std::cout << "ttl       : " << static_cast<unsigned>(pkt.get_ttl())      << std::endl;
-  std::cout << "protocol  : " << static_cast<unsigned>(pkt.get_protocol()) << std::endl;
-  std::cout << "check     : " << static_cast<unsigned>(pkt.get_check())    << std::endl;
-  uint8_t saddr[4];
-  pkt.get_saddr(saddr);
-  std::cout << "src addr  : "
-            << static_cast<unsigned>(saddr[0]) << "."
-            << static_cast<unsigned>(saddr[1]) << "."
-            << static_cast<unsigned>(saddr[2]) << "."
-            << static_cast<unsigned>(saddr[3]) << std::endl;
-  uint8_t daddr[4];
-  pkt.get_daddr(daddr);
-  std::cout << "dst addr  : "
-            << static_cast<unsigned>(daddr[0]) << "."
-            << static_cast<unsigned>(daddr[1]) << "."
-            << static_cast<unsigned>(daddr[2]) << "."
-            << static_cast<unsigned>(daddr[3]) << std::endl;
-}
-
-void print_tcp_header(const tcp_segment& segment) {
-  std::cout << "src port    : " << static_cast<unsigned>(segment.get_src_port())    << std::endl;
-  std::cout << "dst port    : " << static_cast<unsigned>(segment.get_dst_port())    << std::endl;
-  std::cout << "seq         : " << static_cast<unsigned>(segment.get_seq())         << std::endl;
-  std::cout << "ack seq     : " << static_cast<unsigned>(segment.get_ack_seq())     << std::endl;
-  std::cout << "data offset : " << static_cast<unsigned>(segment.get_data_offset()) << std::endl;
-  std::cout << "reserved    : " << static_cast<unsigned>(segment.get_reserved())    << std::endl;
-  if (segment.get_ns()) {
-    std::cout << "ns          : " << static_cast<unsigned>(segment.get_ns()) << std::endl;
-  }
-  if (segment.get_cwr()) {
-    std::cout << "cwr         : " << static_cast<unsigned>(segment.get_cwr()) << std::endl;
-  }
-  if (segment.get_ece()) {
-    std::cout << "ece         : " << static_cast<unsigned>(segment.get_ece()) << std::endl;
-  }
-  if (segment.get_urg()) {
-    std::cout << "urg         : " << static_cast<unsigned>(segment.get_urg()) << std::endl;
-  }
-  if (segment.get_ack()) {
-    std::cout << "ack         : " << static_cast<unsigned>(segment.get_ack()) << std::endl;
-  }
-  if (segment.get_psh()) {
-    std::cout << "psh         : " << static_cast<unsigned>(segment.get_psh()) << std::endl;
-  }
-  if (segment.get_rst()) {
-    std::cout << "rst         : " << static_cast<unsigned>(segment.get_rst()) << std::endl;
+// NOTE
+// (rfc 7413 - 4.1.3. Client Cookie Handling)
+//   Without a cached server MSS, the amount of data in the SYN packet is
+//   limited to the default MSS of 536 bytes for IPv4
+const uint16_t DEFAULT_SYN_DATA_MSS = 536;
+
+// Parse a Fast Open cookie given in hex (e.g. 0123456789abcdef).
+std::vector<uint8_t> parse_cookie(const std::string& hex) {
+  if (hex.size() % 2 != 0) {
+    throw std::invalid_argument("Invalid fast open cookie: " + hex);
   }
-  if (segment.get_syn()) {
-    std::cout << "syn         : " << static_cast<unsigned>(segment.get_syn()) << std::endl;
+  std::vector<uint8_t> cookie;
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    cookie.push_back(std::stoul(hex.substr(i, 2), nullptr, 16));
   }
-  if (segment.get_fin()) {
-    std::cout << "fin         : " << static_cast<unsigned>(segment.get_fin()) << std::endl;
-  }
-  std::cout << "window      : " << static_cast<unsigned>(segment.get_window()) << std::endl;
-  std::cout << "checksum    : " << static_cast<unsigned>(segment.get_checksum()) << std::endl;
-  if (segment.get_urg()) {
-    std::cout << "urg_pointer : " << static_cast<unsigned>(segment.get_urgent_pointer()) << std::endl;
+  return cookie;
+}
+
+void print_cookie(const std::vector<uint8_t>& cookie) {
+  std::cout << "fast open cookie : " << std::hex << std::setfill('0');
+  for (const uint8_t byte : cookie) {
+    std::cout << std::setw(2) << static_cast<unsigned>(byte);
   }
+  std::cout << std::dec << std::setfill(' ') << std::endl;
 }
 
 void send_tcp_segment(
     socket_wrapper &sock_wrapper,
-    const char *src_ifname, const uint8_t *dst_mac_bytes,
+    const int src_ifindex, const uint8_t *dst_mac_bytes,
     const uint8_t *src_ip_bytes, const uint8_t *dst_ip_bytes, const tcp_segment &seg) {
   // Create ip packet
   const ip_packet packet(
@@ -89,98 +61,101 @@ void send_tcp_segment(
       dst_ip_bytes,
       seg.marshal());
 
-  std::cout << "======= sent ip packet ======" << std::endl;
-  print_ip_header(packet);
-  std::cout << "=============================" << std::endl;
-
-  std::cout << "====== sent tcp segment =====" << std::endl;
-  print_tcp_header(seg);
-  std::cout << "=============================" << std::endl;
+  trace_segment(trace_direction::SENT, packet, seg);
 
   // Send ip packet
-  sock_wrapper.send(src_ifname, dst_mac_bytes, packet.marshal());
+  sock_wrapper.send(src_ifindex, dst_mac_bytes, packet.marshal());
 }
 
+// Receive tcp segment which belongs to one of the connections in the table.
 tcp_segment receive_tcp_segment(
-    socket_wrapper &sock_wrapper,
-    const uint8_t *local_ip_bytes, const uint16_t local_port,
-    const uint8_t *remote_ip_bytes, const uint16_t remote_port) {
+    socket_wrapper &sock_wrapper, const connection_table& connections) {
   std::vector<uint8_t> rcv_buf;
 
   while(true) {
     // Receive data from socket
+    rcv_buf.clear();
     sock_wrapper.recv(1024, rcv_buf);
 
     // Parse ip packet
     ip_packet pkt(rcv_buf);
-    // if packet is not from remote host, continue
-    uint8_t pkt_saddr[4];
-    pkt.get_saddr(pkt_saddr);
-    if (pkt_saddr[0] != remote_ip_bytes[0] ||
-        pkt_saddr[1] != remote_ip_bytes[1] ||
-        pkt_saddr[2] != remote_ip_bytes[2] ||
-        pkt_saddr[3] != remote_ip_bytes[3]) {
-      rcv_buf.clear();
-      continue;
-    }
-    // if packet is not for local host, continue
-    uint8_t pkt_daddr[4];
-    pkt.get_daddr(pkt_daddr);
-    if (pkt_daddr[0] != local_ip_bytes[0] ||
-        pkt_daddr[1] != local_ip_bytes[1] ||
-        pkt_daddr[2] != local_ip_bytes[2] ||
-        pkt_daddr[3] != local_ip_bytes[3]) {
-      rcv_buf.clear();
+    if (pkt.get_protocol() != PROTOCOL_TCP) {
       continue;
     }
 
     // Parse tcp segment
     tcp_segment seg(pkt.get_body());
-    // if segment is not from remote port, continue
-    const auto seg_src_port = seg.get_src_port();
-    if (seg_src_port != remote_port) {
-      rcv_buf.clear();
-      continue;
-    }
-    // if segment is not for local port, continue
-    const auto seg_dst_port = seg.get_dst_port();
-    if (seg_dst_port != local_port) {
-      rcv_buf.clear();
+
+    // if segment does not belong to any connection, continue
+    uint8_t pkt_saddr[4];
+    pkt.get_saddr(pkt_saddr);
+    uint8_t pkt_daddr[4];
+    pkt.get_daddr(pkt_daddr);
+    const connection_key key = make_connection_key(
+        pkt_daddr, seg.get_dst_port(), pkt_saddr, seg.get_src_port());
+    if (connections.find(key) == CONNECTION_NOT_FOUND) {
       continue;
     }
 
-    std::cout << "===== received ip packet ====" << std::endl;
-    print_ip_header(pkt);
-    std::cout << "=============================" << std::endl;
-
-    std::cout << "==== received tcp segment ===" << std::endl;
-    print_tcp_header(seg);
-    std::cout << "=============================" << std::endl;
+    trace_segment(trace_direction::RECEIVED, pkt, seg);
     return seg;
   }
 }
 } // namespace
 
 int main(int argc, const char **argv) {
-  if (argc != 5) {
-    std::cout << "Usage: " << argv[0] << " <src interface name> <src port> <dst ip address> <dst port>" << std::endl;
+  if (argc != 5 && argc != 6) {
+    std::cout << "Usage: " << argv[0] << " <src interface name> <src port> <dst ip address> <dst port>"
+              << " [fast open cookie]" << std::endl;
     return 1;
   }
   const char *src_ifname = argv[1];
-  const uint16_t src_port = std::atoi(argv[2]);
+  // 0 takes an ephemeral port
+  const uint16_t requested_src_port = std::atoi(argv[2]);
   const char *dst_ip_str = argv[3];
   const uint16_t dst_port = std::atoi(argv[4]);
+  // NOTE
+  // The cookie printed by an earlier run puts the data in SYN (TCP Fast Open).
+  // Without it, a cookie is requested from the server.
+  const std::vector<uint8_t> cookie =
+    argc == 6 ? parse_cookie(argv[5]) : std::vector<uint8_t>();
+  // NOTE
+  // Segments are traced to the file named by RAW_TCP_TRACE, and printed by
+  // trace_decode. Without it, tracing is off.
+  const char *trace_path = std::getenv("RAW_TCP_TRACE");
+  std::unique_ptr<trace_writer> tracer;
+  if (trace_path != nullptr) {
+    tracer = std::make_unique<trace_writer>(trace_path);
+  }
+  // Likewise, frames are captured to the pcapng file named by RAW_TCP_CAPTURE.
+  const char *capture_path = std::getenv("RAW_TCP_CAPTURE");
+  std::unique_ptr<pcapng_writer> capture;
+  if (capture_path != nullptr) {
+    capture = std::make_unique<pcapng_writer>(capture_path);
+  }
 
-  // Get src mac address from interface name
+  // Get the interface (index and addresses) from the kernel
+  interface_table interfaces;
+  interface_info src_interface;
+  if (!interfaces.find(src_ifname, src_interface)) {
+    throw std::runtime_error("No such interface: " + std::string(src_ifname));
+  }
+  if (src_interface.addresses.empty()) {
+    throw std::runtime_error("No IPv4 address on " + std::string(src_ifname));
+  }
+  const int src_ifindex = src_interface.ifindex;
+  std::cout << "mtu of " << src_ifname << " : " << src_interface.mtu << std::endl;
+
+  // Get src mac address of the interface
   mac_addr src_mac;
-  get_mac_addr_from_ifname(src_ifname, src_mac);
+  src_mac.from_host_order(src_interface.mac);
   std::cout << "mac address of " << src_ifname << " : " << src_mac << std::endl;
   uint8_t src_mac_bytes[MAC_ADDR_LEN];
   src_mac.host_order(src_mac_bytes);
 
-  // Get src ip address from interface name
+  // Get src ip address (the primary one) of the interface
   ip_addr src_ip;
-  get_ip_addr_from_ifname(src_ifname, src_ip);
+  src_ip.from_host_order(src_interface.addresses.front().ip);
   std::cout << "ip address of " << src_ifname << "  : " << src_ip << std::endl;
   uint8_t src_ip_bytes[IP_ADDR_LEN];
   src_ip.host_order(src_ip_bytes);
@@ -192,49 +167,78 @@ int main(int argc, const char **argv) {
   uint8_t dst_ip_bytes[IP_ADDR_LEN];
   dst_ip.host_order(dst_ip_bytes);
 
-  // Create dst mac address
+  // Find the next hop (the gateway unless dst is on-link)
+  route_table routes;
+  uint8_t next_hop_bytes[IP_ADDR_LEN];
+  if (!routes.lookup_route(dst_ip_bytes, src_ifindex, next_hop_bytes)) {
+    throw std::runtime_error("No route to " + dst_ip.to_string() + " via " + std::string(src_ifname));
+  }
+  ip_addr next_hop;
+  next_hop.from_host_order(next_hop_bytes);
+  std::cout << "next hop : " << next_hop << std::endl;
+
+  // Create dst mac address (the one of the next hop)
   mac_addr dst_mac;
-  name_resolver resolver(src_ifname, src_mac, src_ip);
-  resolver.resolve(dst_ip, dst_mac);
-  std::cout << "mac address of " << dst_ip << " : " << dst_mac << std::endl;
+  name_resolver resolver(src_ifname, src_mac, src_ip, routes);
+  resolver.set_capture(capture.get());
+  resolver.resolve(next_hop, dst_mac);
+  std::cout << "mac address of " << next_hop << " : " << dst_mac << std::endl;
   uint8_t dst_mac_bytes[MAC_ADDR_LEN];
   dst_mac.host_order(dst_mac_bytes);
 
-  // Create Transmission Control Block
-  transmission_control_block tcb;
+  // Create Transmission Control Block and register the connection
+  tcb_slab tcbs;
+  const tcb_handle handle = tcbs.create();
+  transmission_control_block& tcb = *tcbs.get(handle);
+  connection_table connections;
+  port_allocator ports;
+  const uint16_t src_port = requested_src_port != 0 ? requested_src_port :
+    ports.allocate(src_ip_bytes, dst_ip_bytes, dst_port, [&](const uint16_t port) {
+      return connections.find(make_connection_key(src_ip_bytes, port, dst_ip_bytes, dst_port)) ==
+             CONNECTION_NOT_FOUND;
+    });
+  std::cout << "src port : " << src_port << std::endl;
+  connections.insert(
+      make_connection_key(src_ip_bytes, src_port, dst_ip_bytes, dst_port), handle.index);
 
   // Create socket
   socket_wrapper sock_for_tcp(ETH_P_IP);
+  sock_for_tcp.set_capture(capture.get());
 
-  // Create tcp segment (SYN = 1)
-  const tcp_segment syn_seg = tcb.create_send_segment(
+  // Write HELLO TCP to the send buffer. It is sent in SYN if we have a cookie.
+  tcb.write({'H', 'E', 'L', 'L', 'O', ' ', 'T', 'C', 'P'});
+
+  // Create tcp segment (SYN = 1) with the Fast Open option
+  tcp_options syn_options;
+  syn_options.set_fast_open_cookie(cookie);
+  const std::vector<uint8_t> marshaled_syn_options = syn_options.marshal();
+  const tcp_segment syn_seg = tcb.create_syn_segment(
         src_ip_bytes,
         src_port,
         dst_ip_bytes,
         dst_port,
-        false,  // ns
-        false,  // cwr
-        false,  // ece
-        false,  // urg
-        false,  // ack
-        false,  // psh
-        false,  // rst
-        true,   // syn
-        false,  // fin
-        64240,  // window
-        0,      // urgent pointer
-        std::vector<uint8_t>(), // option
-        std::vector<uint8_t>()  // body
+        false,  // ecn
+        tcb.get_receive_window(),
+        marshaled_syn_options,
+        cookie.empty() ? 0 : DEFAULT_SYN_DATA_MSS - marshaled_syn_options.size()
       );
 
   send_tcp_segment(
-      sock_for_tcp, src_ifname, dst_mac_bytes,
+      sock_for_tcp, src_ifindex, dst_mac_bytes,
       src_ip_bytes, dst_ip_bytes, syn_seg);
 
   // Receive tcp segment (ACK = 1 and SYN = 1)
-  tcp_segment ack_syn_seg = receive_tcp_segment(
-      sock_for_tcp, src_ip_bytes, src_port, dst_ip_bytes, dst_port);
+  tcp_segment ack_syn_seg = receive_tcp_segment(sock_for_tcp, connections);
+  // (the SYN takes one sequence number, the rest is data)
+  const uint32_t syn_data = tcb.get_snd_nxt() - tcb.get_iss() - 1;
+  const bool syn_data_acked = syn_data != 0 && ack_syn_seg.get_ack_seq() == tcb.get_snd_nxt();
   tcb.apply_receive_segment(ack_syn_seg);
+  const tcp_options syn_ack_options(ack_syn_seg.get_options());
+  if (syn_ack_options.has_fast_open() && !syn_ack_options.get_fast_open_cookie().empty()) {
+    print_cookie(syn_ack_options.get_fast_open_cookie());
+  }
+  std::cout << "data in SYN      : "
+            << (syn_data == 0 ? "not sent" : syn_data_acked ? "accepted" : "not accepted") << std::endl;
 
   // Create tcp segment (ACK = 1)
   const tcp_segment ack_for_syn_seg = tcb.create_send_segment(
@@ -251,45 +255,36 @@ int main(int argc, const char **argv) {
         false,  // rst
         false,  // syn
         false,  // fin
-        64240,  // window
+        tcb.get_receive_window(),
         0,      // urgent pointer
         std::vector<uint8_t>(), // option
         std::vector<uint8_t>()  // body
       );
 
   send_tcp_segment(
-      sock_for_tcp, src_ifname, dst_mac_bytes,
+      sock_for_tcp, src_ifindex, dst_mac_bytes,
       src_ip_bytes, dst_ip_bytes, ack_for_syn_seg);
 
-  // Create tcp segment (body = HELLO TCP)
-  const tcp_segment data_seg = tcb.create_send_segment(
+  // Send HELLO TCP unless the server accepted it in SYN
+  const std::vector<tcp_segment> data_segs = tcb.flush(
         src_ip_bytes,
         src_port,
         dst_ip_bytes,
         dst_port,
-        false,  // ns
-        false,  // cwr
-        false,  // ece
-        false,  // urg
-        true,   // ack
-        true,   // psh
-        false,  // rst
-        false,  // syn
-        false,  // fin
-        64240,  // window
-        0,      // urgent pointer
-        std::vector<uint8_t>(), // option
-        {'H', 'E', 'L', 'L', 'O', ' ', 'T', 'C', 'P'} // body
+        tcb.get_receive_window()
       );
 
-  send_tcp_segment(
-      sock_for_tcp, src_ifname, dst_mac_bytes,
-      src_ip_bytes, dst_ip_bytes, data_seg);
+  for (const auto& data_seg : data_segs) {
+    send_tcp_segment(
+        sock_for_tcp, src_ifindex, dst_mac_bytes,
+        src_ip_bytes, dst_ip_bytes, data_seg);
+  }
 
   // Receive tcp segment (ACK = 1)
-  tcp_segment ack_for_data_seg = receive_tcp_segment(
-      sock_for_tcp, src_ip_bytes, src_port, dst_ip_bytes, dst_port);
-  tcb.apply_receive_segment(ack_for_data_seg);
+  if (!data_segs.empty()) {
+    tcp_segment ack_for_data_seg = receive_tcp_segment(sock_for_tcp, connections);
+    tcb.apply_receive_segment(ack_for_data_seg);
+  }
 
   // Create tcp segment (FIN = 1)
   const tcp_segment fin_seg = tcb.create_send_segment(
@@ -306,19 +301,18 @@ int main(int argc, const char **argv) {
         false,  // rst
         false,  // syn
         true,   // fin
-        64240,  // window
+        tcb.get_receive_window(),
         0,      // urgent pointer
         std::vector<uint8_t>(), // option
         std::vector<uint8_t>()  // body
       );
 
   send_tcp_segment(
-      sock_for_tcp, src_ifname, dst_mac_bytes,
+      sock_for_tcp, src_ifindex, dst_mac_bytes,
       src_ip_bytes, dst_ip_bytes, fin_seg);
 
   // Receive tcp segment (ACK = 1 and FIN = 1)
-  tcp_segment ack_fin_seg = receive_tcp_segment(
-      sock_for_tcp, src_ip_bytes, src_port, dst_ip_bytes, dst_port);
+  tcp_segment ack_fin_seg = receive_tcp_segment(sock_for_tcp, connections);
   tcb.apply_receive_segment(ack_fin_seg);
 
   // Create tcp segment (ACK = 1)
@@ -336,13 +330,13 @@ int main(int argc, const char **argv) {
         false,  // rst
         false,  // syn
         false,   // fin
-        64240,  // window
+        tcb.get_receive_window(),
         0,      // urgent pointer
         std::vector<uint8_t>(), // option
         std::vector<uint8_t>()  // body
       );
 
   send_tcp_segment(
-      sock_for_tcp, src_ifname, dst_mac_bytes,
+      sock_for_tcp, src_ifindex, dst_mac_bytes,
       src_ip_bytes, dst_ip_bytes, ack_for_fin_seg);
 }
@@ -0,0 +1,297 @@
+#include <cerrno>               // for errno
+#include <cstring>              // for std::memcpy(), std::memset(), std::strncpy()
+#include <linux/ethtool.h>      // for struct ethtool_value, ETHTOOL_*
+#include <linux/if_addr.h>      // for struct ifaddrmsg, IFA_*
+#include <linux/if_link.h>      // for IFLA_*
+#include <linux/netlink.h>      // for struct nlmsghdr
+#include <linux/rtnetlink.h>    // for struct ifinfomsg, RTM_*
+#include <linux/sockios.h>      // for SIOCETHTOOL
+#include <mutex>
+#include <net/if.h>             // for struct ifreq
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>          // for ioctl()
+#include <sys/socket.h>         // for socket(), AF_INET
+#include <unistd.h>             // for close()
+
+#include "interface_table.h"
+#include "netlink_socket.h"
+
+namespace {
+bool same_address(const interface_address& a, const interface_address& b) {
+  return std::memcmp(a.ip, b.ip, sizeof(a.ip)) == 0 && a.prefix_len == b.prefix_len;
+}
+} // namespace
+
+interface_table::interface_table()
+  : sock_(NETLINK_ROUTE, RTMGRP_LINK | RTMGRP_IPV4_IFADDR), ioctl_sock_(-1) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  ioctl_sock_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (ioctl_sock_ == -1) {
+    std::string msg = "Failed to create socket: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  try {
+    load();
+  } catch (...) {
+    close(ioctl_sock_);
+    throw;
+  }
+}
+
+interface_table::~interface_table() {
+  close(ioctl_sock_);
+}
+
+void interface_table::load() {
+  interfaces_.clear();
+  indexes_.clear();
+  const netlink_handler handler = [this](const struct nlmsghdr& msg) { on_message(msg); };
+
+  // Links first, as addresses are attached to known links only.
+  struct ifinfomsg ifi;
+  std::memset(&ifi, 0, sizeof(ifi));
+  ifi.ifi_family = AF_UNSPEC;
+  sock_.dump(RTM_GETLINK, &ifi, sizeof(ifi), handler);
+
+  struct ifaddrmsg ifa;
+  std::memset(&ifa, 0, sizeof(ifa));
+  ifa.ifa_family = AF_INET;
+  sock_.dump(RTM_GETADDR, &ifa, sizeof(ifa), handler);
+}
+
+void interface_table::on_message(const struct nlmsghdr& msg) {
+  switch (msg.nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+      on_link(msg);
+      break;
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+      on_address(msg);
+      break;
+    default:
+      break;
+  }
+}
+
+void interface_table::on_link(const struct nlmsghdr& msg) {
+  if (msg.nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+    return;
+  }
+  const struct ifinfomsg *ifi = static_cast<const struct ifinfomsg *>(NLMSG_DATA(&msg));
+  // (AF_BRIDGE messages are about bridge ports, not the links themselves)
+  if (ifi->ifi_family != AF_UNSPEC) {
+    return;
+  }
+  const int ifindex = ifi->ifi_index;
+  const auto found = interfaces_.find(ifindex);
+  if (msg.nlmsg_type == RTM_DELLINK) {
+    if (found != interfaces_.end()) {
+      indexes_.erase(found->second.name);
+      interfaces_.erase(found);
+    }
+    return;
+  }
+
+  const bool is_new = found == interfaces_.end();
+  interface_info& info = interfaces_[ifindex];
+  const std::string old_name = info.name;
+  const uint32_t old_flags = info.flags;
+  if (is_new) {
+    info.ifindex = ifindex;
+    std::memset(info.mac, 0, sizeof(info.mac));
+    info.mtu = 0;
+  }
+  info.flags = ifi->ifi_flags;
+  int attr_len = IFLA_PAYLOAD(&msg);
+  for (const struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+    const size_t len = RTA_PAYLOAD(rta);
+    switch (rta->rta_type) {
+      case IFLA_IFNAME: {
+        const char *name = static_cast<const char *>(RTA_DATA(rta));
+        info.name.assign(name, strnlen(name, len));
+        break;
+      }
+      case IFLA_ADDRESS:
+        // (only ethernet-like addresses; e.g. tunnels have none or IPv4 ones)
+        if (len == sizeof(info.mac)) {
+          std::memcpy(info.mac, RTA_DATA(rta), sizeof(info.mac));
+        }
+        break;
+      case IFLA_MTU:
+        if (len >= sizeof(info.mtu)) {
+          std::memcpy(&info.mtu, RTA_DATA(rta), sizeof(info.mtu));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  if (info.name != old_name) {
+    if (!old_name.empty()) {
+      indexes_.erase(old_name);
+    }
+    indexes_[info.name] = ifindex;
+  }
+  // A driver may change its offloads when the device goes up or down.
+  if (is_new || info.name != old_name || info.flags != old_flags) {
+    query_features(info);
+  }
+}
+
+void interface_table::on_address(const struct nlmsghdr& msg) {
+  if (msg.nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+    return;
+  }
+  const struct ifaddrmsg *ifa = static_cast<const struct ifaddrmsg *>(NLMSG_DATA(&msg));
+  if (ifa->ifa_family != AF_INET) {
+    return;
+  }
+  const auto found = interfaces_.find(ifa->ifa_index);
+  if (found == interfaces_.end()) {
+    return;
+  }
+  interface_address addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.prefix_len = ifa->ifa_prefixlen;
+  uint32_t flags = ifa->ifa_flags;
+  bool has_local = false;
+  bool has_address = false;
+  int attr_len = IFA_PAYLOAD(&msg);
+  for (const struct rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+    const size_t len = RTA_PAYLOAD(rta);
+    switch (rta->rta_type) {
+      // NOTE
+      // IFA_ADDRESS is the peer of a point-to-point link, and IFA_LOCAL the
+      // address of this host. Both are the same on broadcast links.
+      case IFA_LOCAL:
+        if (len == sizeof(addr.ip)) {
+          std::memcpy(addr.ip, RTA_DATA(rta), sizeof(addr.ip));
+          has_local = true;
+        }
+        break;
+      case IFA_ADDRESS:
+        if (len == sizeof(addr.ip) && !has_local) {
+          std::memcpy(addr.ip, RTA_DATA(rta), sizeof(addr.ip));
+          has_address = true;
+        }
+        break;
+      case IFA_FLAGS:
+        // (the flags which do not fit in ifa_flags)
+        if (len >= sizeof(flags)) {
+          std::memcpy(&flags, RTA_DATA(rta), sizeof(flags));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  if (!has_local && !has_address) {
+    return;
+  }
+  addr.secondary = (flags & IFA_F_SECONDARY) != 0;
+
+  std::vector<interface_address>& addresses = found->second.addresses;
+  for (auto it = addresses.begin(); it != addresses.end(); ++it) {
+    if (same_address(*it, addr)) {
+      addresses.erase(it);
+      break;
+    }
+  }
+  if (msg.nlmsg_type == RTM_DELADDR) {
+    return;
+  }
+  // Primary addresses are kept before the secondary ones. A secondary
+  // address promoted when its primary is deleted is notified again.
+  auto it = addresses.begin();
+  while (it != addresses.end() && (addr.secondary || !it->secondary)) {
+    ++it;
+  }
+  addresses.insert(it, addr);
+}
+
+void interface_table::query_features(interface_info& info) {
+  info.features.scatter_gather = query_feature(info.name, ETHTOOL_GSG);
+  info.features.tx_checksum    = query_feature(info.name, ETHTOOL_GTXCSUM);
+  info.features.rx_checksum    = query_feature(info.name, ETHTOOL_GRXCSUM);
+  info.features.tso            = query_feature(info.name, ETHTOOL_GTSO);
+  info.features.gso            = query_feature(info.name, ETHTOOL_GGSO);
+  info.features.gro            = query_feature(info.name, ETHTOOL_GGRO);
+  stats_.feature_queries++;
+}
+
+bool interface_table::query_feature(const std::string& name, const uint32_t cmd) {
+  struct ethtool_value value;
+  value.cmd  = cmd;
+  value.data = 0;
+  struct ifreq ifr;
+  std::memset(&ifr, 0, sizeof(ifr));
+  std::strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+  ifr.ifr_data = reinterpret_cast<char *>(&value);
+  if (ioctl(ioctl_sock_, SIOCETHTOOL, &ifr) == -1) {
+    return false;
+  }
+  return value.data != 0;
+}
+
+bool interface_table::find(const std::string& name, interface_info& info) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto found = indexes_.find(name);
+  if (found == indexes_.end()) {
+    return false;
+  }
+  info = interfaces_.at(found->second);
+  return true;
+}
+
+bool interface_table::find(const int ifindex, interface_info& info) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto found = interfaces_.find(ifindex);
+  if (found == interfaces_.end()) {
+    return false;
+  }
+  info = found->second;
+  return true;
+}
+
+bool interface_table::get_primary_address(const int ifindex, uint8_t *ip) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto found = interfaces_.find(ifindex);
+  if (found == interfaces_.end() || found->second.addresses.empty()) {
+    return false;
+  }
+  const interface_address& addr = found->second.addresses.front();
+  std::memcpy(ip, addr.ip, sizeof(addr.ip));
+  return true;
+}
+
+void interface_table::process() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const bool complete = sock_.process([this](const struct nlmsghdr& msg) {
+      on_message(msg);
+      stats_.notifications++;
+    });
+  if (!complete) {
+    // Some changes are lost, so start over.
+    stats_.resyncs++;
+    load();
+  }
+}
+
+int interface_table::get_fd() const {
+  return sock_.get_fd();
+}
+
+size_t interface_table::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return interfaces_.size();
+}
+
+interface_table_stats interface_table::get_stats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return stats_;
+}
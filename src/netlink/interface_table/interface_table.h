@@ -0,0 +1,104 @@
+#ifndef INTERFACE_TABLE_H_
+#define INTERFACE_TABLE_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "netlink_socket.h"
+
+struct interface_table_stats {
+  uint64_t notifications;    // link and address notifications applied
+  uint64_t resyncs;          // dumps again as notifications were dropped
+  uint64_t feature_queries;  // interfaces whose offload features were queried
+};
+
+struct interface_address {
+  // network byte order
+  uint8_t ip[4];
+  uint8_t prefix_len;
+  // IFA_F_SECONDARY: an alias in the subnet of another address
+  bool secondary;
+};
+
+// Offloads of the device (ethtool). false if the driver does not tell.
+struct interface_features {
+  bool scatter_gather;
+  bool tx_checksum;
+  bool rx_checksum;
+  // TCP segmentation offload
+  bool tso;
+  // generic segmentation / receive offload
+  bool gso;
+  bool gro;
+};
+
+struct interface_info {
+  int ifindex;
+  std::string name;
+  uint8_t mac[6];
+  uint32_t mtu;
+  // IFF_* flags (e.g. IFF_UP)
+  uint32_t flags;
+  // IPv4 addresses in the order of the kernel (primary addresses first)
+  std::vector<interface_address> addresses;
+  interface_features features;
+};
+
+// NOTE
+// (rfc 3549 - 3.1.2. Link Layer Service Module)
+//   This service provides the ability to retrieve and/or change
+//   information about network interfaces on the system.
+//
+// Network interfaces of the kernel, loaded by rtnetlink dumps (RTM_GETLINK and
+// RTM_GETADDR) at construction and kept current by the RTM_NEWLINK/RTM_DELLINK
+// and RTM_NEWADDR/RTM_DELADDR notifications, which are applied by process().
+//
+// Offload features are not carried by rtnetlink, so they are queried with
+// ethtool ioctls when an interface appears or its flags change, over one
+// socket held by the table.
+//
+// Lookups take a shared lock and never call the kernel, so they may be called
+// from any thread.
+class interface_table {
+ private:
+  netlink_socket sock_;
+  // socket for the ethtool ioctls
+  int ioctl_sock_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<int, interface_info> interfaces_;
+  // name -> ifindex
+  std::unordered_map<std::string, int> indexes_;
+  interface_table_stats stats_;
+
+  // Must be called with mutex_ held exclusively.
+  void load();
+  void on_message(const struct nlmsghdr& msg);
+  void on_link(const struct nlmsghdr& msg);
+  void on_address(const struct nlmsghdr& msg);
+  void query_features(interface_info& info);
+  // Returns false if the feature is off or the driver does not tell.
+  bool query_feature(const std::string& name, const uint32_t cmd);
+ public:
+  interface_table();
+  interface_table(const interface_table&) = delete;
+  interface_table& operator=(const interface_table&) = delete;
+  ~interface_table();
+  // Returns false if there is no interface of the name (or index).
+  bool find(const std::string& name, interface_info& info) const;
+  bool find(const int ifindex, interface_info& info) const;
+  // Primary IPv4 address of the interface (network byte order).
+  // Returns false if the interface is unknown or has no IPv4 address.
+  bool get_primary_address(const int ifindex, uint8_t *ip) const;
+  // Apply the notifications received so far without blocking.
+  void process();
+  // File descriptor of the netlink socket to wait for with poll()/epoll.
+  int get_fd() const;
+  size_t size() const;
+  interface_table_stats get_stats() const;
+};
+
+#endif  // INTERFACE_TABLE_H_
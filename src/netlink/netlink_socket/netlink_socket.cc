@@ -0,0 +1,120 @@
+#include <cerrno>               // for errno
+#include <cstring>              // for std::memcpy(), std::memset(), std::strerror()
+#include <linux/netlink.h>      // for struct nlmsghdr, struct sockaddr_nl
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>         // for socket(), bind(), send(), recv()
+#include <unistd.h>             // for close()
+#include <utility>              // for std::exchange()
+#include <vector>
+
+#include "netlink_socket.h"
+
+namespace {
+std::runtime_error system_error(const char *what) {
+  std::string msg = what;
+  msg += std::strerror(errno);
+  return std::runtime_error(msg);
+}
+} // namespace
+
+netlink_socket::netlink_socket(const int protocol, const uint32_t groups)
+  : sock_(-1), port_id_(0), seq_(0), overrun_(false), interrupted_(false),
+    buf_(NETLINK_RECEIVE_BUFFER_SIZE) {
+  sock_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+  if (sock_ == -1) {
+    throw system_error("Failed to create netlink socket: ");
+  }
+  struct sockaddr_nl addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = groups;
+  socklen_t addr_len = sizeof(addr);
+  if (bind(sock_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1 ||
+      getsockname(sock_, reinterpret_cast<struct sockaddr *>(&addr), &addr_len) == -1) {
+    const std::runtime_error e = system_error("Failed to bind netlink socket: ");
+    close(sock_);
+    throw e;
+  }
+  port_id_ = addr.nl_pid;
+}
+
+netlink_socket::~netlink_socket() {
+  close(sock_);
+}
+
+ssize_t netlink_socket::receive(
+    const uint32_t seq, const netlink_handler& handler, const bool dont_wait, bool& done) {
+  const ssize_t len = recv(sock_, buf_.data(), buf_.size(), dont_wait ? MSG_DONTWAIT : 0);
+  if (len == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      return -1;
+    }
+    if (errno == ENOBUFS) {
+      overrun_ = true;
+      return -2;
+    }
+    throw system_error("Failed to recv from netlink socket: ");
+  }
+  size_t remaining = len;
+  for (const struct nlmsghdr *nh = reinterpret_cast<const struct nlmsghdr *>(buf_.data());
+       NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+    const bool ours = seq != 0 && nh->nlmsg_seq == seq && nh->nlmsg_pid == port_id_;
+    if (nh->nlmsg_type == NLMSG_DONE) {
+      if (ours) {
+        done = true;
+      }
+      continue;
+    }
+    if (nh->nlmsg_type == NLMSG_ERROR) {
+      struct nlmsgerr err;
+      std::memcpy(&err, NLMSG_DATA(nh), sizeof(err));
+      if (ours && err.error != 0) {
+        std::string msg = "Netlink dump failed: ";
+        msg += std::strerror(-err.error);
+        throw std::runtime_error(msg);
+      }
+      continue;
+    }
+    if (ours && (nh->nlmsg_flags & NLM_F_DUMP_INTR) != 0) {
+      // The table changed during the dump, so it may be inconsistent.
+      interrupted_ = true;
+    }
+    handler(*nh);
+  }
+  return len;
+}
+
+void netlink_socket::dump(
+    const uint16_t type, const void *header, const size_t header_len, const netlink_handler& handler) {
+  // (dumped again while the kernel reports it inconsistent)
+  do {
+    interrupted_ = false;
+    std::vector<uint8_t> req(NLMSG_SPACE(header_len), 0);
+    struct nlmsghdr *nh = reinterpret_cast<struct nlmsghdr *>(req.data());
+    nh->nlmsg_len   = NLMSG_LENGTH(header_len);
+    nh->nlmsg_type  = type;
+    nh->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    nh->nlmsg_seq   = ++seq_;
+    nh->nlmsg_pid   = port_id_;
+    std::memcpy(NLMSG_DATA(nh), header, header_len);
+    if (send(sock_, req.data(), req.size(), 0) == -1) {
+      throw system_error("Failed to send to netlink socket: ");
+    }
+    bool done = false;
+    while (!done) {
+      receive(nh->nlmsg_seq, handler, false, done);
+    }
+  } while (interrupted_);
+}
+
+bool netlink_socket::process(const netlink_handler& handler) {
+  bool done = false;
+  while (receive(0, handler, true, done) != -1) {
+  }
+  return !std::exchange(overrun_, false);
+}
+
+int netlink_socket::get_fd() const {
+  return sock_;
+}
@@ -0,0 +1,66 @@
+#ifndef NETLINK_SOCKET_H_
+#define NETLINK_SOCKET_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+#include <functional>
+#include <sys/types.h>  // for ssize_t
+#include <vector>
+
+struct nlmsghdr;
+
+// Size of the receive buffer. Dumps are sent in messages of up to a page
+// (or 32 KiB if the kernel was told so), and 64 KiB fits any of them.
+const size_t NETLINK_RECEIVE_BUFFER_SIZE = 65536;
+
+// Called for each message received (except NLMSG_DONE and NLMSG_ERROR).
+using netlink_handler = std::function<void(const struct nlmsghdr& msg)>;
+
+// NOTE
+// (rfc 3549 - 2.3.2. Netlink Message Format)
+//   Netlink messages consist of a byte stream with one or multiple
+//   Netlink headers and associated payloads.
+//
+// Socket of one netlink protocol (e.g. NETLINK_ROUTE). Dumps are requested and
+// received synchronously, and notifications of the subscribed multicast
+// groups are received without blocking when get_fd() is readable. Both are
+// passed to the same handler, so a notification received during a dump is not
+// lost.
+//
+// If the kernel drops notifications because the socket buffer was full,
+// process() returns false, and the owner should dump again.
+class netlink_socket {
+ private:
+  int sock_;
+  // port id of the socket (assigned by the kernel)
+  uint32_t port_id_;
+  uint32_t seq_;
+  // true if notifications were dropped since the last process()
+  bool overrun_;
+  // true if the dump in progress was interrupted by a change
+  bool interrupted_;
+  std::vector<uint8_t> buf_;
+
+  // Receive one datagram and pass its messages to handler.
+  //   seq  : sequence number of the dump in progress (0 if none)
+  //   done : set to true if the dump of seq has finished
+  // Returns -1 if nothing was received (only if dont_wait is true), -2 if
+  // notifications were dropped, and the received size otherwise.
+  ssize_t receive(const uint32_t seq, const netlink_handler& handler, const bool dont_wait, bool& done);
+ public:
+  // groups : multicast groups to subscribe (e.g. RTMGRP_NEIGH), or 0
+  netlink_socket(const int protocol, const uint32_t groups);
+  netlink_socket(const netlink_socket&) = delete;
+  netlink_socket& operator=(const netlink_socket&) = delete;
+  ~netlink_socket();
+  // Request a dump of type (e.g. RTM_GETROUTE) and pass every message of the
+  // dump to handler. header is the family header of the request (e.g. struct rtmsg).
+  void dump(const uint16_t type, const void *header, const size_t header_len, const netlink_handler& handler);
+  // Pass the notifications received so far to handler without blocking.
+  // Returns false if notifications were dropped (ENOBUFS).
+  bool process(const netlink_handler& handler);
+  // File descriptor to wait for with poll()/epoll.
+  int get_fd() const;
+};
+
+#endif  // NETLINK_SOCKET_H_
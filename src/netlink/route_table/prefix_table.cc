@@ -0,0 +1,94 @@
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t, uint64_t
+#include <stdexcept>
+
+#include "prefix_table.h"
+
+namespace {
+uint32_t prefix_mask(const unsigned int len) {
+  return len == 0 ? 0 : ~static_cast<uint32_t>(0) << (32 - len);
+}
+} // namespace
+
+prefix_table::prefix_table() : prefix_lengths_(0) {
+}
+
+void prefix_table::add(const uint32_t prefix, const unsigned int len, const prefix_route& route) {
+  if (len > 32) {
+    throw std::invalid_argument("Prefix length must be 32 or less");
+  }
+  std::vector<prefix_route>& same_prefix = routes_[len][prefix & prefix_mask(len)];
+  auto it = same_prefix.begin();
+  while (it != same_prefix.end() && it->priority < route.priority) {
+    ++it;
+  }
+  if (it != same_prefix.end() && it->priority == route.priority) {
+    *it = route;
+  } else {
+    same_prefix.insert(it, route);
+  }
+  prefix_lengths_ |= static_cast<uint64_t>(1) << len;
+}
+
+bool prefix_table::remove(const uint32_t prefix, const unsigned int len, const uint32_t priority) {
+  if (len > 32) {
+    return false;
+  }
+  std::unordered_map<uint32_t, std::vector<prefix_route>>& routes = routes_[len];
+  const auto found = routes.find(prefix & prefix_mask(len));
+  if (found == routes.end()) {
+    return false;
+  }
+  std::vector<prefix_route>& same_prefix = found->second;
+  bool removed = false;
+  for (auto it = same_prefix.begin(); it != same_prefix.end(); ++it) {
+    if (it->priority == priority) {
+      same_prefix.erase(it);
+      removed = true;
+      break;
+    }
+  }
+  if (same_prefix.empty()) {
+    routes.erase(found);
+    if (routes.empty()) {
+      prefix_lengths_ &= ~(static_cast<uint64_t>(1) << len);
+    }
+  }
+  return removed;
+}
+
+const prefix_route *prefix_table::lookup(const uint32_t dst, const int ifindex) const {
+  uint64_t lengths = prefix_lengths_;
+  while (lengths != 0) {
+    // the longest prefix length left
+    const unsigned int len = 63 - __builtin_clzll(lengths);
+    lengths &= ~(static_cast<uint64_t>(1) << len);
+    const auto found = routes_[len].find(dst & prefix_mask(len));
+    if (found == routes_[len].end()) {
+      continue;
+    }
+    for (const prefix_route& route : found->second) {
+      if (route.ifindex == ifindex) {
+        return &route;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void prefix_table::clear() {
+  for (auto& routes : routes_) {
+    routes.clear();
+  }
+  prefix_lengths_ = 0;
+}
+
+size_t prefix_table::size() const {
+  size_t count = 0;
+  for (const auto& routes : routes_) {
+    for (const auto& same_prefix : routes) {
+      count += same_prefix.second.size();
+    }
+  }
+  return count;
+}
@@ -0,0 +1,51 @@
+#ifndef PREFIX_TABLE_H_
+#define PREFIX_TABLE_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t, uint64_t
+#include <unordered_map>
+#include <vector>
+
+struct prefix_route {
+  // gateway (network byte order), 0 if the prefix is on-link
+  uint32_t gateway;
+  int ifindex;
+  // metric (lower is preferred)
+  uint32_t priority;
+};
+
+// NOTE
+// (rfc 1812 - 5.2.4.3 Next Hop Address)
+//   (1) Basic Match: Discard any routes where:
+//       IP.DestinationAddress & Route.Mask != Route.Prefix
+//       If this yields an empty set of candidate routes, the packet is
+//       undeliverable.
+//   (2) Longest Match: Discard all routes except those with the longest
+//       (i.e., most specific) mask.
+//
+// Routes are kept in one hash table per prefix length, and a lookup tries the
+// lengths which have routes from the longest. Among routes of the same prefix
+// the one of the lowest metric wins, as in the kernel.
+//
+// Not thread-safe (route_table locks it).
+class prefix_table {
+ private:
+  // routes_[len]: prefix (host byte order) -> routes by priority
+  std::unordered_map<uint32_t, std::vector<prefix_route>> routes_[33];
+  // bit len is set while routes_[len] is not empty
+  uint64_t prefix_lengths_;
+ public:
+  prefix_table();
+  // Add a route, or replace the one of the same prefix and priority.
+  //   prefix : host byte order (bits beyond len are ignored)
+  void add(const uint32_t prefix, const unsigned int len, const prefix_route& route);
+  // Returns false if there is no such route.
+  bool remove(const uint32_t prefix, const unsigned int len, const uint32_t priority);
+  // Find the route to dst (host byte order) out of the interface by the
+  // longest prefix match. Returns nullptr if there is no route.
+  const prefix_route *lookup(const uint32_t dst, const int ifindex) const;
+  void clear();
+  size_t size() const;
+};
+
+#endif  // PREFIX_TABLE_H_
@@ -0,0 +1,235 @@
+#include <arpa/inet.h>          // for ntohl()
+#include <cstring>              // for std::memcpy(), std::memset()
+#include <linux/neighbour.h>    // for struct ndmsg, NDA_*
+#include <linux/netlink.h>      // for struct nlmsghdr
+#include <linux/rtnetlink.h>    // for struct rtmsg, RTA_*, RTM_*
+#include <mutex>
+#include <shared_mutex>
+#include <sys/socket.h>         // for AF_INET
+
+#include "netlink_socket.h"
+#include "prefix_table.h"
+#include "route_table.h"
+
+namespace {
+// Usable link addresses of the kernel neighbor table
+const uint16_t NUD_VALID_STATES =
+  NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT | NUD_NOARP;
+// Link addresses confirmed recently (or not to be confirmed at all)
+const uint16_t NUD_CONFIRMED_STATES = NUD_REACHABLE | NUD_PERMANENT | NUD_NOARP;
+
+uint64_t make_neighbor_key(const int ifindex, const uint32_t ip) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(ifindex)) << 32 | ip;
+}
+} // namespace
+
+route_table::route_table()
+  : sock_(NETLINK_ROUTE, RTMGRP_IPV4_ROUTE | RTMGRP_NEIGH) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  load();
+}
+
+void route_table::load() {
+  routes_.clear();
+  neighbors_.clear();
+  const netlink_handler handler = [this](const struct nlmsghdr& msg) { on_message(msg); };
+
+  struct rtmsg rtm;
+  std::memset(&rtm, 0, sizeof(rtm));
+  rtm.rtm_family = AF_INET;
+  sock_.dump(RTM_GETROUTE, &rtm, sizeof(rtm), handler);
+
+  struct ndmsg ndm;
+  std::memset(&ndm, 0, sizeof(ndm));
+  ndm.ndm_family = AF_INET;
+  sock_.dump(RTM_GETNEIGH, &ndm, sizeof(ndm), handler);
+}
+
+void route_table::on_message(const struct nlmsghdr& msg) {
+  switch (msg.nlmsg_type) {
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+      on_route(msg);
+      break;
+    case RTM_NEWNEIGH:
+    case RTM_DELNEIGH:
+      on_neighbor(msg);
+      break;
+    default:
+      break;
+  }
+}
+
+void route_table::on_route(const struct nlmsghdr& msg) {
+  if (msg.nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg))) {
+    return;
+  }
+  const struct rtmsg *rtm = static_cast<const struct rtmsg *>(NLMSG_DATA(&msg));
+  if (rtm->rtm_family != AF_INET || rtm->rtm_dst_len > 32) {
+    return;
+  }
+  uint32_t table = rtm->rtm_table;
+  uint32_t dst = 0;
+  prefix_route r = {0, 0, 0};
+  int attr_len = RTM_PAYLOAD(&msg);
+  for (const struct rtattr *rta = RTM_RTA(rtm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+    const size_t len = RTA_PAYLOAD(rta);
+    switch (rta->rta_type) {
+      case RTA_TABLE:
+        if (len >= sizeof(table)) {
+          std::memcpy(&table, RTA_DATA(rta), sizeof(table));
+        }
+        break;
+      case RTA_DST:
+        if (len >= sizeof(dst)) {
+          std::memcpy(&dst, RTA_DATA(rta), sizeof(dst));
+        }
+        break;
+      case RTA_GATEWAY:
+        if (len >= sizeof(r.gateway)) {
+          std::memcpy(&r.gateway, RTA_DATA(rta), sizeof(r.gateway));
+        }
+        break;
+      case RTA_OIF:
+        if (len >= sizeof(r.ifindex)) {
+          std::memcpy(&r.ifindex, RTA_DATA(rta), sizeof(r.ifindex));
+        }
+        break;
+      case RTA_PRIORITY:
+        if (len >= sizeof(r.priority)) {
+          std::memcpy(&r.priority, RTA_DATA(rta), sizeof(r.priority));
+        }
+        break;
+      case RTA_MULTIPATH: {
+        // NOTE Only the first next hop of a multipath route is used.
+        const struct rtnexthop *nh = static_cast<const struct rtnexthop *>(RTA_DATA(rta));
+        if (len < sizeof(*nh) || nh->rtnh_len < sizeof(*nh) || nh->rtnh_len > len) {
+          break;
+        }
+        r.ifindex = nh->rtnh_ifindex;
+        int nh_attr_len = nh->rtnh_len - RTNH_LENGTH(0);
+        for (const struct rtattr *a = RTNH_DATA(nh); RTA_OK(a, nh_attr_len); a = RTA_NEXT(a, nh_attr_len)) {
+          if (a->rta_type == RTA_GATEWAY && RTA_PAYLOAD(a) >= sizeof(r.gateway)) {
+            std::memcpy(&r.gateway, RTA_DATA(a), sizeof(r.gateway));
+          }
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  // Routes of other tables are used only by policy rules, and the local
+  // table has the addresses of this host. Only unicast routes are kept: the
+  // kernel stack may be kept from sending to our peers by a prohibit or
+  // blackhole route, which must not hide the route used by the raw sockets.
+  if (table != RT_TABLE_MAIN || rtm->rtm_type != RTN_UNICAST) {
+    return;
+  }
+
+  if (msg.nlmsg_type == RTM_NEWROUTE) {
+    routes_.add(ntohl(dst), rtm->rtm_dst_len, r);
+  } else {
+    routes_.remove(ntohl(dst), rtm->rtm_dst_len, r.priority);
+  }
+}
+
+void route_table::on_neighbor(const struct nlmsghdr& msg) {
+  if (msg.nlmsg_len < NLMSG_LENGTH(sizeof(struct ndmsg))) {
+    return;
+  }
+  const struct ndmsg *ndm = static_cast<const struct ndmsg *>(NLMSG_DATA(&msg));
+  if (ndm->ndm_family != AF_INET) {
+    return;
+  }
+  uint32_t ip = 0;
+  bool has_ip = false;
+  neighbor n;
+  n.state = ndm->ndm_state;
+  bool has_mac = false;
+  int attr_len = NLMSG_PAYLOAD(&msg, sizeof(struct ndmsg));
+  const struct rtattr *first = reinterpret_cast<const struct rtattr *>(
+      reinterpret_cast<const char *>(ndm) + NLMSG_ALIGN(sizeof(struct ndmsg)));
+  for (const struct rtattr *rta = first; RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+    if (rta->rta_type == NDA_DST && RTA_PAYLOAD(rta) == sizeof(ip)) {
+      std::memcpy(&ip, RTA_DATA(rta), sizeof(ip));
+      has_ip = true;
+    } else if (rta->rta_type == NDA_LLADDR && RTA_PAYLOAD(rta) == sizeof(n.mac)) {
+      std::memcpy(n.mac, RTA_DATA(rta), sizeof(n.mac));
+      has_mac = true;
+    }
+  }
+  if (!has_ip) {
+    return;
+  }
+  const uint64_t key = make_neighbor_key(ndm->ndm_ifindex, ip);
+  if (msg.nlmsg_type == RTM_DELNEIGH || !has_mac || (n.state & NUD_VALID_STATES) == 0) {
+    neighbors_.erase(key);
+  } else {
+    neighbors_[key] = n;
+  }
+}
+
+bool route_table::lookup_route(const uint8_t *dst_ip, const int ifindex, uint8_t *next_hop) const {
+  uint32_t dst_n;
+  std::memcpy(&dst_n, dst_ip, sizeof(dst_n));
+  const uint32_t dst = ntohl(dst_n);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const prefix_route *r = routes_.lookup(dst, ifindex);
+  if (r == nullptr) {
+    return false;
+  }
+  if (r->gateway != 0) {
+    std::memcpy(next_hop, &r->gateway, sizeof(r->gateway));
+  } else {
+    std::memcpy(next_hop, dst_ip, sizeof(dst_n));
+  }
+  return true;
+}
+
+bool route_table::lookup_neighbor(
+    const uint8_t *ip, const int ifindex, uint8_t *mac, bool& reachable) const {
+  uint32_t ip_n;
+  std::memcpy(&ip_n, ip, sizeof(ip_n));
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto found = neighbors_.find(make_neighbor_key(ifindex, ip_n));
+  if (found == neighbors_.end()) {
+    return false;
+  }
+  std::memcpy(mac, found->second.mac, sizeof(found->second.mac));
+  reachable = (found->second.state & NUD_CONFIRMED_STATES) != 0;
+  return true;
+}
+
+void route_table::process() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const bool complete = sock_.process([this](const struct nlmsghdr& msg) {
+      on_message(msg);
+      stats_.notifications++;
+    });
+  if (!complete) {
+    // Some changes are lost, so start over.
+    stats_.resyncs++;
+    load();
+  }
+}
+
+int route_table::get_fd() const {
+  return sock_.get_fd();
+}
+
+size_t route_table::get_route_count() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return routes_.size();
+}
+
+size_t route_table::get_neighbor_count() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return neighbors_.size();
+}
+
+route_table_stats route_table::get_stats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return stats_;
+}
@@ -0,0 +1,64 @@
+#ifndef ROUTE_TABLE_H_
+#define ROUTE_TABLE_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "netlink_socket.h"
+#include "prefix_table.h"
+
+struct route_table_stats {
+  uint64_t notifications;  // route and neighbor notifications applied
+  uint64_t resyncs;        // dumps again as notifications were dropped
+};
+
+// IPv4 routes (main table) and neighbors of the kernel, loaded by rtnetlink
+// dumps at construction and kept current by the RTM_NEWROUTE/RTM_DELROUTE
+// and RTM_NEWNEIGH/RTM_DELNEIGH notifications, which are applied by process().
+// Routes are matched by the longest prefix (see prefix_table).
+//
+// Lookups take a shared lock, so they may be called from any thread.
+class route_table {
+ private:
+  struct neighbor {
+    uint8_t mac[6];
+    // NUD_* state of the kernel
+    uint16_t state;
+  };
+
+  netlink_socket sock_;
+  mutable std::shared_mutex mutex_;
+  prefix_table routes_;
+  // key: ifindex << 32 | IP address (network byte order)
+  std::unordered_map<uint64_t, neighbor> neighbors_;
+  route_table_stats stats_;
+
+  // Must be called with mutex_ held exclusively.
+  void load();
+  void on_message(const struct nlmsghdr& msg);
+  void on_route(const struct nlmsghdr& msg);
+  void on_neighbor(const struct nlmsghdr& msg);
+ public:
+  route_table();
+  route_table(const route_table&) = delete;
+  route_table& operator=(const route_table&) = delete;
+  // Find the route to dst_ip out of the interface by the longest prefix match.
+  // next_hop is set to the gateway, or to dst_ip itself if it is on-link.
+  // Returns false if there is no route.
+  bool lookup_route(const uint8_t *dst_ip, const int ifindex, uint8_t *next_hop) const;
+  // Link address of a neighbor on the interface known by the kernel.
+  //   reachable : set to true if the kernel confirmed it recently
+  // Returns false if the kernel does not know the neighbor.
+  bool lookup_neighbor(const uint8_t *ip, const int ifindex, uint8_t *mac, bool& reachable) const;
+  // Apply the notifications received so far without blocking.
+  void process();
+  // File descriptor of the netlink socket to wait for with poll()/epoll.
+  int get_fd() const;
+  size_t get_route_count() const;
+  size_t get_neighbor_count() const;
+  route_table_stats get_stats() const;
+};
+
+#endif  // ROUTE_TABLE_H_
@@ -0,0 +1,341 @@
+#include <algorithm>    // for std::min()
+#include <cerrno>       // for errno
+#include <cstring>      // for std::memcpy(), std::memset(), std::strerror()
+#include <fcntl.h>      // for open()
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>   // for mmap(), munmap()
+#include <sys/stat.h>   // for fstat()
+#include <unistd.h>     // for close()
+
+#include "pcap_reader.h"
+
+namespace {
+const uint32_t PCAP_MAGIC_MICROSECONDS     = 0xa1b2c3d4;
+const uint32_t PCAP_MAGIC_NANOSECONDS      = 0xa1b23c4d;
+const size_t   PCAP_FILE_HEADER_SIZE       = 24;
+const size_t   PCAP_RECORD_HEADER_SIZE     = 16;
+// (the same in both byte orders, so that a reader finds the section first)
+const uint32_t BLOCK_TYPE_SECTION_HEADER   = 0x0a0d0d0a;
+const uint32_t BLOCK_TYPE_INTERFACE        = 0x00000001;
+const uint32_t BLOCK_TYPE_SIMPLE_PACKET    = 0x00000003;
+const uint32_t BLOCK_TYPE_ENHANCED_PACKET  = 0x00000006;
+const uint32_t BYTE_ORDER_MAGIC            = 0x1a2b3c4d;
+// block type, block length and trailing block length
+const size_t   BLOCK_OVERHEAD              = 12;
+const uint16_t OPTION_END                  = 0;
+const uint16_t OPTION_IF_TSRESOL           = 9;
+
+const uint16_t LINKTYPE_ETHERNET           = 1;
+const uint16_t LINKTYPE_RAW                = 101;
+const uint16_t LINKTYPE_LINUX_SLL          = 113;
+const uint16_t LINKTYPE_IPV4               = 228;
+const uint16_t LINKTYPE_LINUX_SLL2         = 276;
+const uint16_t ETHERTYPE_IP                = 0x0800;
+const uint16_t ETHERTYPE_VLAN              = 0x8100;
+
+const uint64_t MICROSECONDS                = 1000000;
+const uint64_t NANOSECONDS                 = 1000000000;
+
+size_t pad4(const size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+uint16_t read_be16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+std::runtime_error system_error(const std::string& what) {
+  return std::runtime_error(what + std::strerror(errno));
+}
+} // namespace
+
+pcap_reader::pcap_reader(const std::string& path)
+  : map_(nullptr), size_(0), offset_(0), pcapng_(false), swapped_(false) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    throw system_error("Failed to open " + path + ": ");
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    const std::runtime_error e = system_error("Failed to stat " + path + ": ");
+    close(fd);
+    throw e;
+  }
+  size_ = st.st_size;
+  if (size_ < sizeof(uint32_t)) {
+    close(fd);
+    throw std::runtime_error("Failed to read " + path + ": not a capture file");
+  }
+  // (the pages are read now, so that replaying does not wait for the disk)
+  void *map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  // (the mapping keeps the file)
+  close(fd);
+  if (map == MAP_FAILED) {
+    throw system_error("Failed to mmap " + path + ": ");
+  }
+  map_ = static_cast<const uint8_t *>(map);
+  try {
+    read_file_header();
+  } catch (const std::runtime_error& e) {
+    munmap(const_cast<uint8_t *>(map_), size_);
+    throw std::runtime_error("Failed to read " + path + ": " + e.what());
+  }
+}
+
+pcap_reader::~pcap_reader() {
+  munmap(const_cast<uint8_t *>(map_), size_);
+}
+
+uint16_t pcap_reader::read_u16(const size_t offset) const {
+  uint16_t v;
+  std::memcpy(&v, map_ + offset, sizeof(v));
+  return swapped_ ? __builtin_bswap16(v) : v;
+}
+
+uint32_t pcap_reader::read_u32(const size_t offset) const {
+  uint32_t v;
+  std::memcpy(&v, map_ + offset, sizeof(v));
+  return swapped_ ? __builtin_bswap32(v) : v;
+}
+
+void pcap_reader::read_file_header() {
+  interfaces_.clear();
+  swapped_ = false;
+  const uint32_t magic = read_u32(0);
+  if (magic == BLOCK_TYPE_SECTION_HEADER) {
+    // The byte order is read from each section header.
+    pcapng_ = true;
+    offset_ = 0;
+    return;
+  }
+  if (size_ < PCAP_FILE_HEADER_SIZE) {
+    throw std::runtime_error("not a capture file");
+  }
+  pcapng_ = false;
+  uint32_t resolution_magic = magic;
+  if (magic != PCAP_MAGIC_MICROSECONDS && magic != PCAP_MAGIC_NANOSECONDS) {
+    swapped_ = true;
+    resolution_magic = __builtin_bswap32(magic);
+    if (resolution_magic != PCAP_MAGIC_MICROSECONDS && resolution_magic != PCAP_MAGIC_NANOSECONDS) {
+      throw std::runtime_error("not a capture file");
+    }
+  }
+  // (the upper bits of the link type tell about the FCS of the frames)
+  interface iface;
+  iface.link_type = read_u32(20) & 0xffff;
+  iface.resolution = resolution_magic == PCAP_MAGIC_NANOSECONDS ? NANOSECONDS : MICROSECONDS;
+  interfaces_.push_back(iface);
+  offset_ = PCAP_FILE_HEADER_SIZE;
+}
+
+bool pcap_reader::read_pcap_record(pcap_frame& frame, size_t& interface_id) {
+  if (offset_ + PCAP_RECORD_HEADER_SIZE > size_) {
+    return false;
+  }
+  const uint32_t captured_len = read_u32(offset_ + 8);
+  if (offset_ + PCAP_RECORD_HEADER_SIZE + captured_len > size_) {
+    return false;
+  }
+  const uint64_t seconds = read_u32(offset_);
+  const uint64_t fraction = read_u32(offset_ + 4);
+  frame.timestamp_ns = seconds * interfaces_[0].resolution + fraction;
+  frame.data = map_ + offset_ + PCAP_RECORD_HEADER_SIZE;
+  frame.size = captured_len;
+  frame.original_size = read_u32(offset_ + 12);
+  interface_id = 0;
+  offset_ += PCAP_RECORD_HEADER_SIZE + captured_len;
+  return true;
+}
+
+bool pcap_reader::read_pcapng_block(pcap_frame& frame, size_t& interface_id) {
+  if (offset_ + BLOCK_OVERHEAD > size_) {
+    return false;
+  }
+  uint32_t type;
+  std::memcpy(&type, map_ + offset_, sizeof(type));
+  if (type == BLOCK_TYPE_SECTION_HEADER) {
+    uint32_t magic;
+    std::memcpy(&magic, map_ + offset_ + 8, sizeof(magic));
+    if (magic == BYTE_ORDER_MAGIC) {
+      swapped_ = false;
+    } else if (__builtin_bswap32(magic) == BYTE_ORDER_MAGIC) {
+      swapped_ = true;
+    } else {
+      return false;
+    }
+    interfaces_.clear();
+  } else {
+    type = read_u32(offset_);
+  }
+  const size_t block_len = read_u32(offset_ + 4);
+  // (a zero length is the unwritten rest of a file being written)
+  if (block_len < BLOCK_OVERHEAD || block_len % 4 != 0 || offset_ + block_len > size_) {
+    return false;
+  }
+  switch (type) {
+    case BLOCK_TYPE_INTERFACE:
+      read_interface_block(offset_, block_len);
+      break;
+    case BLOCK_TYPE_ENHANCED_PACKET: {
+      const size_t header_len = 28;
+      if (block_len < header_len + 4) {
+        break;
+      }
+      const uint32_t captured_len = read_u32(offset_ + 20);
+      if (header_len + captured_len + 4 > block_len) {
+        break;
+      }
+      interface_id = read_u32(offset_ + 8);
+      frame.timestamp_ns =
+        static_cast<uint64_t>(read_u32(offset_ + 12)) << 32 | read_u32(offset_ + 16);
+      frame.data = map_ + offset_ + header_len;
+      frame.size = captured_len;
+      frame.original_size = read_u32(offset_ + 24);
+      break;
+    }
+    case BLOCK_TYPE_SIMPLE_PACKET: {
+      const size_t header_len = 12;
+      if (block_len < header_len + 4) {
+        break;
+      }
+      // (no captured length: the frame fills the block up to the padding)
+      interface_id = 0;
+      frame.timestamp_ns = 0;
+      frame.data = map_ + offset_ + header_len;
+      frame.original_size = read_u32(offset_ + 8);
+      frame.size = std::min(frame.original_size, block_len - header_len - 4);
+      break;
+    }
+    default:
+      // e.g. name resolution and statistics blocks
+      break;
+  }
+  offset_ += block_len;
+  return true;
+}
+
+void pcap_reader::read_interface_block(const size_t offset, const size_t block_len) {
+  interface iface;
+  iface.link_type = read_u16(offset + 8);
+  // (draft-ietf-opsawg-pcapng - 4.2. Interface Description Block)
+  //   If the Option is missing, the resolution is 10^-6.
+  iface.resolution = MICROSECONDS;
+  size_t p = offset + 16;
+  const size_t end = offset + block_len - 4;
+  while (p + 4 <= end) {
+    const uint16_t code = read_u16(p);
+    const uint16_t len = read_u16(p + 2);
+    if (code == OPTION_END || p + 4 + len > end) {
+      break;
+    }
+    if (code == OPTION_IF_TSRESOL && len >= 1) {
+      // NOTE
+      // (draft-ietf-opsawg-pcapng - 4.2. Interface Description Block)
+      //   If the Most Significant Bit is equal to zero, the remaining bits
+      //   indicates the resolution of the timestamp as a negative power of
+      //   10 ... If the Most Significant Bit is equal to one, the remaining
+      //   bits indicates the resolution as negative power of 2
+      const uint8_t tsresol = map_[p + 4];
+      const unsigned int exponent = tsresol & 0x7f;
+      if ((tsresol & 0x80) != 0) {
+        iface.resolution = static_cast<uint64_t>(1) << std::min(exponent, 63u);
+      } else {
+        iface.resolution = 1;
+        for (unsigned int i = 0; i < exponent && i < 19; ++i) {
+          iface.resolution *= 10;
+        }
+      }
+    }
+    p += 4 + pad4(len);
+  }
+  interfaces_.push_back(iface);
+}
+
+bool pcap_reader::strip_link_header(const uint16_t link_type, pcap_frame& frame) const {
+  size_t header_len;
+  uint16_t protocol;
+  switch (link_type) {
+    case LINKTYPE_ETHERNET:
+      if (frame.size < 14) {
+        return false;
+      }
+      header_len = 14;
+      protocol = read_be16(frame.data + 12);
+      if (protocol == ETHERTYPE_VLAN && frame.size >= 18) {
+        header_len = 18;
+        protocol = read_be16(frame.data + 16);
+      }
+      break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+      // (raw IP may be IPv6 too)
+      header_len = 0;
+      protocol = frame.size >= 1 && frame.data[0] >> 4 == 4 ? ETHERTYPE_IP : 0;
+      break;
+    case LINKTYPE_LINUX_SLL:
+      if (frame.size < 16) {
+        return false;
+      }
+      header_len = 16;
+      protocol = read_be16(frame.data + 14);
+      break;
+    case LINKTYPE_LINUX_SLL2:
+      if (frame.size < 20) {
+        return false;
+      }
+      header_len = 20;
+      protocol = read_be16(frame.data);
+      break;
+    default:
+      return false;
+  }
+  if (protocol != ETHERTYPE_IP) {
+    return false;
+  }
+  frame.data += header_len;
+  frame.size -= header_len;
+  frame.original_size -= std::min(frame.original_size, header_len);
+  return true;
+}
+
+bool pcap_reader::next(pcap_frame& frame) {
+  while (true) {
+    frame.data = nullptr;
+    size_t interface_id = 0;
+    const bool more = pcapng_
+      ? read_pcapng_block(frame, interface_id)
+      : read_pcap_record(frame, interface_id);
+    if (!more) {
+      return false;
+    }
+    if (frame.data == nullptr) {
+      continue;
+    }
+    if (interface_id >= interfaces_.size() ||
+        !strip_link_header(interfaces_[interface_id].link_type, frame)) {
+      stats_.skipped++;
+      continue;
+    }
+    const uint64_t resolution = interfaces_[interface_id].resolution;
+    if (resolution != NANOSECONDS) {
+      const uint64_t ts = frame.timestamp_ns;
+      frame.timestamp_ns = ts / resolution * NANOSECONDS +
+        static_cast<uint64_t>(static_cast<unsigned __int128>(ts % resolution) * NANOSECONDS / resolution);
+    }
+    stats_.frames++;
+    if (frame.size < frame.original_size) {
+      stats_.truncated++;
+    }
+    return true;
+  }
+}
+
+void pcap_reader::rewind() {
+  read_file_header();
+}
+
+pcap_reader_stats pcap_reader::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,80 @@
+#ifndef PCAP_READER_H_
+#define PCAP_READER_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <string>
+#include <vector>
+
+struct pcap_frame {
+  // IPv4 packet of the frame (the link header is skipped). Points into the
+  // mapped file, so it is valid as long as the reader is.
+  const uint8_t *data;
+  // bytes captured
+  size_t size;
+  // bytes on the wire (greater than size if the frame was cut to the snaplen)
+  size_t original_size;
+  // since the epoch
+  uint64_t timestamp_ns;
+};
+
+struct pcap_reader_stats {
+  uint64_t frames;     // IPv4 frames returned
+  uint64_t skipped;    // frames of other protocols or unknown link types
+  uint64_t truncated;  // IPv4 frames cut to the snaplen
+};
+
+// NOTE
+// (draft-ietf-opsawg-pcap - 4. Packet Records)
+//   Each packet record comprises a packet record header ... and the
+//   captured packet data.
+//
+// Reader of capture files, both pcap and pcapng (e.g. written by
+// pcapng_writer or tcpdump). The whole file is mapped, and frames are
+// returned as pointers into the mapping without copying.
+//
+// Frames of the link types Ethernet (with or without a VLAN tag), raw IP and
+// Linux cooked capture (v1 and v2) are read. Only IPv4 frames are returned,
+// and the others are counted as skipped. A file cut in the middle of a
+// record (e.g. still being written) ends at the last whole one.
+class pcap_reader {
+ private:
+  struct interface {
+    uint16_t link_type;
+    // timestamp units per second
+    uint64_t resolution;
+  };
+
+  const uint8_t *map_;
+  size_t size_;
+  size_t offset_;
+  bool pcapng_;
+  // true if the file was written on a host of the other byte order
+  bool swapped_;
+  // interfaces of the current section (one for pcap)
+  std::vector<interface> interfaces_;
+  pcap_reader_stats stats_;
+
+  uint16_t read_u16(const size_t offset) const;
+  uint32_t read_u32(const size_t offset) const;
+  void read_file_header();
+  // Read the record at offset_ and advance. Returns false at the end of the
+  // file; a record of no frame (e.g. an interface) leaves frame.data nullptr.
+  bool read_pcap_record(pcap_frame& frame, size_t& interface_id);
+  bool read_pcapng_block(pcap_frame& frame, size_t& interface_id);
+  void read_interface_block(const size_t offset, const size_t block_len);
+  // Skip the link header. Returns false if the frame is not IPv4.
+  bool strip_link_header(const uint16_t link_type, pcap_frame& frame) const;
+ public:
+  explicit pcap_reader(const std::string& path);
+  pcap_reader(const pcap_reader&) = delete;
+  pcap_reader& operator=(const pcap_reader&) = delete;
+  ~pcap_reader();
+  // Returns false if there are no more frames.
+  bool next(pcap_frame& frame);
+  // Start over from the first frame.
+  void rewind();
+  pcap_reader_stats get_stats() const;
+};
+
+#endif  // PCAP_READER_H_
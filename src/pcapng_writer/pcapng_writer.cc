@@ -0,0 +1,339 @@
+#include <algorithm>    // for std::max()
+#include <cerrno>       // for errno
+#include <chrono>
+#include <cstring>      // for std::memcpy(), std::memset(), std::strerror()
+#include <fcntl.h>      // for open(), posix_fallocate()
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>   // for mmap(), munmap()
+#include <unistd.h>     // for close(), ftruncate(), unlink()
+
+#include "pcapng_writer.h"
+
+namespace {
+const uint32_t BLOCK_TYPE_SECTION_HEADER   = 0x0a0d0d0a;
+const uint32_t BLOCK_TYPE_INTERFACE        = 0x00000001;
+const uint32_t BLOCK_TYPE_ENHANCED_PACKET  = 0x00000006;
+const uint32_t BYTE_ORDER_MAGIC            = 0x1a2b3c4d;
+const uint16_t OPTION_END                  = 0;
+const uint16_t OPTION_IF_TSRESOL           = 9;
+const uint16_t OPTION_EPB_FLAGS            = 2;
+// (draft-ietf-opsawg-pcapng - 4.3.1. Enhanced Packet Block Flags Word)
+//   Bits 0-1: Inbound / Outbound packet (00 = information not available,
+//   01 = inbound, 10 = outbound)
+const uint32_t EPB_FLAGS_INBOUND           = 0x1;
+const uint32_t EPB_FLAGS_OUTBOUND          = 0x2;
+// Linux cooked capture (v1)
+const uint16_t LINKTYPE_LINUX_SLL          = 113;
+const size_t   SLL_HEADER_SIZE             = 16;
+// sll_pkttype of <linux/if_packet.h>
+const uint16_t SLL_PACKET_HOST             = 0;
+const uint16_t SLL_PACKET_OUTGOING         = 4;
+const uint16_t ARPHRD_ETHER_TYPE           = 1;
+const uint16_t MAC_SIZE                    = 6;
+
+// Section Header Block without options
+const size_t SECTION_HEADER_SIZE = 28;
+// Interface Description Block with if_tsresol
+const size_t INTERFACE_SIZE = 32;
+// Enhanced Packet Block without the data: header, epb_flags, end of options
+// and trailing length
+const size_t ENHANCED_PACKET_OVERHEAD = 28 + 8 + 4 + 4;
+
+constexpr size_t pad4(const size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+const size_t HEADERS_SIZE = SECTION_HEADER_SIZE + INTERFACE_SIZE;
+// Largest frame written (an IPv4 packet of 64 KiB); larger ones are dropped.
+const size_t MAX_FRAME_SIZE = 65535;
+const size_t MAX_BLOCK_SIZE = ENHANCED_PACKET_OVERHEAD + pad4(SLL_HEADER_SIZE + MAX_FRAME_SIZE);
+
+// Writes the fields of a block one after another.
+class block_writer {
+ private:
+  uint8_t *p_;
+ public:
+  explicit block_writer(uint8_t *p) : p_(p) {}
+  void u16(const uint16_t v) { std::memcpy(p_, &v, sizeof(v)); p_ += sizeof(v); }
+  void u32(const uint32_t v) { std::memcpy(p_, &v, sizeof(v)); p_ += sizeof(v); }
+  void u64(const uint64_t v) { std::memcpy(p_, &v, sizeof(v)); p_ += sizeof(v); }
+  void u16_be(const uint16_t v) { u16(static_cast<uint16_t>(v << 8 | v >> 8)); }
+  void bytes(const uint8_t *data, const size_t size) {
+    std::memcpy(p_, data, size);
+    std::memset(p_ + size, 0, pad4(size) - size);
+    p_ += pad4(size);
+  }
+  void zero(const size_t size) { std::memset(p_, 0, size); p_ += size; }
+};
+
+std::runtime_error system_error(const std::string& what) {
+  return std::runtime_error(what + std::strerror(errno));
+}
+
+// The SLL header is always kept, so a smaller snaplen is raised to its size
+// (the interface block then gives the length the frames really have).
+pcapng_writer_config with_snaplen_of_header(pcapng_writer_config config) {
+  if (config.snaplen != 0 && config.snaplen < SLL_HEADER_SIZE) {
+    config.snaplen = SLL_HEADER_SIZE;
+  }
+  return config;
+}
+} // namespace
+
+pcapng_writer::pcapng_writer(const std::string& path)
+  : pcapng_writer(pcapng_writer_config{path, PCAPNG_DEFAULT_FILE_SIZE, 0, 0, true, true}) {}
+
+pcapng_writer::pcapng_writer(const pcapng_writer_config& config)
+  : config_(with_snaplen_of_header(config)), capture_inbound_(config.capture_inbound),
+    capture_outbound_(config.capture_outbound),
+    current_{"", -1, nullptr, 0, 0}, file_index_(0),
+    spare_{"", -1, nullptr, 0, 0}, spare_wanted_(true), stopping_(false) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  current_ = open_file(get_file_name(0));
+  files_.push_back(current_.name);
+  // The next file is made at once.
+  preparer_ = std::thread([this]() { prepare_loop(); });
+}
+
+pcapng_writer::~pcapng_writer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_.notify_one();
+  preparer_.join();
+  close_file(current_);
+  // The next file was never written.
+  if (spare_.fd != -1) {
+    close_file(spare_);
+    unlink(spare_.name.c_str());
+  }
+}
+
+std::string pcapng_writer::get_file_name(const size_t index) const {
+  if (index == 0) {
+    return config_.path;
+  }
+  const std::string::size_type slash = config_.path.rfind('/');
+  std::string::size_type dot = config_.path.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = config_.path.size();
+  }
+  return config_.path.substr(0, dot) + "_" + std::to_string(index) + config_.path.substr(dot);
+}
+
+pcapng_writer::mapped_file pcapng_writer::open_file(const std::string& name) const {
+  mapped_file file{name, -1, nullptr, 0, 0};
+  file.fd = open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (file.fd == -1) {
+    throw system_error("Failed to open " + name + ": ");
+  }
+  // (every file has room for the largest frame)
+  file.size = std::max(config_.file_size, HEADERS_SIZE + MAX_BLOCK_SIZE);
+  // (blocks are allocated now, so that a full disk fails here and not with
+  // SIGBUS while writing into the mapping)
+  const int err = posix_fallocate(file.fd, 0, file.size);
+  if (err != 0) {
+    errno = err;
+    const std::runtime_error e = system_error("Failed to allocate " + name + ": ");
+    close(file.fd);
+    unlink(name.c_str());
+    throw e;
+  }
+  // (the pages are faulted in now rather than on the first frame written
+  // to each of them, which halves the cost of a write)
+  void *map = mmap(nullptr, file.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file.fd, 0);
+  if (map == MAP_FAILED) {
+    const std::runtime_error e = system_error("Failed to mmap " + name + ": ");
+    close(file.fd);
+    unlink(name.c_str());
+    throw e;
+  }
+  file.map = static_cast<uint8_t *>(map);
+  write_headers(file);
+  return file;
+}
+
+void pcapng_writer::close_file(mapped_file& file) {
+  if (file.fd == -1) {
+    return;
+  }
+  munmap(file.map, file.size);
+  file.map = nullptr;
+  // The rest of the file is zeros, which readers take for a broken block.
+  if (ftruncate(file.fd, file.offset) == -1) {
+    // Nothing better to do: the blocks written are still readable.
+  }
+  close(file.fd);
+  file.fd = -1;
+}
+
+void pcapng_writer::write_headers(mapped_file& file) const {
+  block_writer shb(file.map + file.offset);
+  shb.u32(BLOCK_TYPE_SECTION_HEADER);
+  shb.u32(SECTION_HEADER_SIZE);
+  shb.u32(BYTE_ORDER_MAGIC);
+  shb.u16(1);  // major version
+  shb.u16(0);  // minor version
+  // section length (unknown)
+  shb.u64(~static_cast<uint64_t>(0));
+  shb.u32(SECTION_HEADER_SIZE);
+  file.offset += SECTION_HEADER_SIZE;
+
+  block_writer idb(file.map + file.offset);
+  idb.u32(BLOCK_TYPE_INTERFACE);
+  idb.u32(INTERFACE_SIZE);
+  idb.u16(LINKTYPE_LINUX_SLL);
+  idb.u16(0);  // reserved
+  idb.u32(config_.snaplen);
+  // timestamps in nanoseconds
+  const uint8_t tsresol = 9;
+  idb.u16(OPTION_IF_TSRESOL);
+  idb.u16(sizeof(tsresol));
+  idb.bytes(&tsresol, sizeof(tsresol));
+  idb.u16(OPTION_END);
+  idb.u16(0);
+  idb.u32(INTERFACE_SIZE);
+  file.offset += INTERFACE_SIZE;
+}
+
+bool pcapng_writer::rotate(std::unique_lock<std::mutex>& lock) {
+  // (waits only if frames fill files faster than the thread makes them)
+  while (spare_wanted_) {
+    spare_ready_.wait(lock);
+  }
+  retired_.push_back(current_);
+  current_.fd = -1;
+  if (spare_.fd == -1) {
+    error_ = spare_error_;
+  } else {
+    current_ = spare_;
+    spare_.fd = -1;
+    file_index_++;
+    stats_.rotations++;
+    files_.push_back(current_.name);
+    if (config_.max_files != 0 && files_.size() > config_.max_files) {
+      unlink(files_.front().c_str());
+      files_.pop_front();
+    }
+    spare_wanted_ = true;
+  }
+  work_.notify_one();
+  return current_.fd != -1;
+}
+
+void pcapng_writer::prepare_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_.wait(lock, [this]() { return stopping_ || spare_wanted_ || !retired_.empty(); });
+    std::vector<mapped_file> retired;
+    retired.swap(retired_);
+    const bool prepare = spare_wanted_ && !stopping_;
+    const std::string name = get_file_name(file_index_ + 1);
+    lock.unlock();
+    for (mapped_file& file : retired) {
+      close_file(file);
+    }
+    mapped_file spare{name, -1, nullptr, 0, 0};
+    std::string error;
+    if (prepare) {
+      try {
+        spare = open_file(name);
+      } catch (const std::runtime_error& e) {
+        error = e.what();
+      }
+    }
+    lock.lock();
+    if (prepare) {
+      spare_ = spare;
+      spare_error_ = error;
+      spare_wanted_ = false;
+      spare_ready_.notify_all();
+    }
+    if (stopping_ && retired_.empty()) {
+      break;
+    }
+  }
+}
+
+void pcapng_writer::write(
+    const capture_direction direction, const uint16_t protocol, const uint8_t *mac,
+    const uint8_t *data, const size_t size) {
+  if (!capture_enabled(direction)) {
+    return;
+  }
+  const uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  const size_t original_len = SLL_HEADER_SIZE + size;
+  size_t captured_len = original_len;
+  if (config_.snaplen != 0 && captured_len > config_.snaplen) {
+    captured_len = config_.snaplen;
+  }
+  const size_t block_size = ENHANCED_PACKET_OVERHEAD + pad4(captured_len);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (current_.fd == -1 || block_size > MAX_BLOCK_SIZE) {
+    stats_.dropped++;
+    return;
+  }
+  if (current_.offset + block_size > current_.size && !rotate(lock)) {
+    stats_.dropped++;
+    return;
+  }
+  block_writer epb(current_.map + current_.offset);
+  epb.u32(BLOCK_TYPE_ENHANCED_PACKET);
+  epb.u32(block_size);
+  epb.u32(0);  // interface id
+  epb.u32(static_cast<uint32_t>(timestamp >> 32));
+  epb.u32(static_cast<uint32_t>(timestamp));
+  epb.u32(captured_len);
+  epb.u32(original_len);
+  // Linux cooked header (network byte order)
+  epb.u16_be(direction == capture_direction::INBOUND ? SLL_PACKET_HOST : SLL_PACKET_OUTGOING);
+  epb.u16_be(ARPHRD_ETHER_TYPE);
+  if (mac != nullptr) {
+    epb.u16_be(MAC_SIZE);
+    uint8_t addr[8] = {};
+    std::memcpy(addr, mac, MAC_SIZE);
+    epb.bytes(addr, sizeof(addr));
+  } else {
+    epb.u16_be(0);
+    epb.zero(8);
+  }
+  epb.u16_be(protocol);
+  epb.bytes(data, captured_len - SLL_HEADER_SIZE);
+  epb.u16(OPTION_EPB_FLAGS);
+  epb.u16(sizeof(uint32_t));
+  epb.u32(direction == capture_direction::INBOUND ? EPB_FLAGS_INBOUND : EPB_FLAGS_OUTBOUND);
+  epb.u16(OPTION_END);
+  epb.u16(0);
+  epb.u32(block_size);
+  current_.offset += block_size;
+
+  stats_.packets++;
+  stats_.bytes += size;
+  if (captured_len < original_len) {
+    stats_.truncated++;
+  }
+}
+
+
+void pcapng_writer::set_capture_enabled(const capture_direction direction, const bool enabled) {
+  if (direction == capture_direction::INBOUND) {
+    capture_inbound_.store(enabled, std::memory_order_relaxed);
+  } else {
+    capture_outbound_.store(enabled, std::memory_order_relaxed);
+  }
+}
+
+pcapng_writer_stats pcapng_writer::get_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::string pcapng_writer::get_error() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
@@ -0,0 +1,144 @@
+#ifndef PCAPNG_WRITER_H_
+#define PCAPNG_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Size of each capture file before the next one is started
+const size_t PCAPNG_DEFAULT_FILE_SIZE = 64 * 1024 * 1024;
+
+enum class capture_direction {
+  INBOUND,
+  OUTBOUND,
+};
+
+struct pcapng_writer_config {
+  // Files are named path, then path with _1, _2, ... before its extension
+  // (e.g. capture.pcapng, capture_1.pcapng).
+  std::string path;
+  // Size of each file, preallocated and mapped at once.
+  size_t file_size;
+  // Files kept (the oldest ones are removed), or 0 to keep all.
+  size_t max_files;
+  // Bytes kept of each frame with its 16 byte SLL header (at least the
+  // header is kept), or 0 to keep all.
+  uint32_t snaplen;
+  bool capture_inbound;
+  bool capture_outbound;
+};
+
+struct pcapng_writer_stats {
+  uint64_t packets;    // frames written
+  uint64_t bytes;      // bytes of the frames on the wire
+  uint64_t truncated;  // frames cut to snaplen
+  uint64_t rotations;  // files started after the first one
+  uint64_t dropped;    // frames not written (too large, or the writer failed)
+};
+
+// NOTE
+// (draft-ietf-opsawg-pcapng - 3.1. General Block Structure)
+//   A capture file is organized in blocks, that are appended one to
+//   another to form the file.
+//
+// Capture of the frames sent and received by socket_wrappers, written as
+// pcapng (Wireshark and tcpdump read it). Frames are written as they were
+// passed to (or returned by) the socket, so the capture shows what this stack
+// sent, not what another process saw on the interface.
+//
+// The frames of AF_PACKET datagram sockets have no link header, so each one
+// gets a Linux cooked header (LINKTYPE_LINUX_SLL) with its direction and
+// protocol, and IP and ARP frames share one file.
+//
+// Each file is preallocated to file_size and mapped, so writing a frame is a
+// copy into the page cache without a system call. When a frame does not fit,
+// writing moves on to the next file, which a thread of the writer has
+// already preallocated and mapped, and the same thread cuts the previous one
+// to the written size and closes it. So the packet path neither allocates
+// nor unmaps a file (unless it catches up with the thread), and one file
+// more than those written is on disk at a time.
+//
+// write() never throws: if the next file cannot be created (e.g. the disk is
+// full), the writer stops capturing, and frames are counted as dropped.
+//
+// write() may be called from any thread (it takes a lock).
+class pcapng_writer {
+ private:
+  struct mapped_file {
+    std::string name;
+    int fd;
+    uint8_t *map;
+    size_t size;
+    // bytes written
+    size_t offset;
+  };
+
+  pcapng_writer_config config_;
+  std::atomic<bool> capture_inbound_;
+  std::atomic<bool> capture_outbound_;
+  // guards all members below
+  std::mutex mutex_;
+  mapped_file current_;
+  // index of the current file (0 for path itself)
+  size_t file_index_;
+  // names of the files kept, the oldest first
+  std::deque<std::string> files_;
+  pcapng_writer_stats stats_;
+  // reason why the writer stopped capturing (empty while it works)
+  std::string error_;
+  // The next file (fd is -1 while it is not ready)
+  mapped_file spare_;
+  // true from when the next file is wanted until it is ready (or failed)
+  bool spare_wanted_;
+  std::string spare_error_;
+  // files to be cut to the written size and closed
+  std::vector<mapped_file> retired_;
+  bool stopping_;
+  std::condition_variable work_;
+  std::condition_variable spare_ready_;
+  std::thread preparer_;
+
+  std::string get_file_name(const size_t index) const;
+  // Create, preallocate and map a file, and write the headers.
+  // Throws std::runtime_error on failure.
+  mapped_file open_file(const std::string& name) const;
+  // Cut the file to the written size and close it.
+  static void close_file(mapped_file& file);
+  void write_headers(mapped_file& file) const;
+  // Move on to the next file. Returns false if it could not be created.
+  // Must be called with mutex_ held.
+  bool rotate(std::unique_lock<std::mutex>& lock);
+  void prepare_loop();
+ public:
+  // Capture both directions without snaplen, into files of PCAPNG_DEFAULT_FILE_SIZE.
+  explicit pcapng_writer(const std::string& path);
+  explicit pcapng_writer(const pcapng_writer_config& config);
+  pcapng_writer(const pcapng_writer&) = delete;
+  pcapng_writer& operator=(const pcapng_writer&) = delete;
+  ~pcapng_writer();
+  // Write a frame of the protocol (e.g. ETH_P_IP, host byte order) without
+  // link header. mac is the link address of the peer if known (or nullptr).
+  void write(
+      const capture_direction direction,
+      const uint16_t protocol,
+      const uint8_t *mac,
+      const uint8_t *data,
+      const size_t size);
+  void set_capture_enabled(const capture_direction direction, const bool enabled);
+  bool capture_enabled(const capture_direction direction) const {
+    return direction == capture_direction::INBOUND
+      ? capture_inbound_.load(std::memory_order_relaxed)
+      : capture_outbound_.load(std::memory_order_relaxed);
+  }
+  pcapng_writer_stats get_stats();
+  // Why capturing stopped, or an empty string while it works.
+  std::string get_error();
+};
+
+#endif  // PCAPNG_WRITER_H_
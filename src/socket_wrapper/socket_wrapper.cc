@@ -2,6 +2,8 @@
 #include <arpa/inet.h>        // for htons()
 #include <cerrno>             // for errno
 #include <cstring>            // for std::strerror()
+#include <ctime>              // for CLOCK_MONOTONIC
+#include <linux/net_tstamp.h> // for struct sock_txtime
 #include <netpacket/packet.h> // for struct sockaddr_ll
 #include <net/ethernet.h>     // for ETH_P_ALL
 #include <net/if.h>           // for if_nametoindex
@@ -12,10 +14,11 @@
 #include <vector>
 #include <iostream>           // XXX tmp
 
+#include "pcapng_writer.h"
 #include "socket_wrapper.h"
 
 socket_wrapper::socket_wrapper(const unsigned short ether_prtcl_type)
-  : ether_prtcl_type_(ether_prtcl_type) {
+  : ether_prtcl_type_(ether_prtcl_type), capture_(nullptr) {
   sock_ = socket(AF_PACKET, SOCK_DGRAM, htons(ether_prtcl_type_));
   if (sock_ == -1) {
     std::string msg = "Failed to create socket: ";
@@ -24,22 +27,34 @@ socket_wrapper::socket_wrapper(const unsigned short ether_prtcl_type)
   }
 }
 
-void socket_wrapper::send(
-    const std::string& ifname, const uint8_t *target_mac,
-    const std::vector<uint8_t>& data) const {
+void socket_wrapper::make_address(
+    const int ifindex, const uint8_t *target_mac,
+    struct sockaddr_ll& addr) const {
   // The sockaddr_ll structure is a device-independent physical-layer address.
-  struct sockaddr_ll addr;
   memset(&addr, 0, sizeof(addr));
   // always AF_PACKET
   addr.sll_family   = AF_PACKET;
   // the standard ethernet protocol type in network byte order as defined in the <linux/if_ether.h>.
   addr.sll_protocol = htons(ether_prtcl_type_);
   // Interface number
-  addr.sll_ifindex  = if_nametoindex(ifname.c_str());
+  addr.sll_ifindex  = ifindex;
   // Length of address
   addr.sll_halen    = IFHWADDRLEN;
   // Physical-layer address
   memcpy(&addr.sll_addr, target_mac, IFHWADDRLEN);
+}
+
+void socket_wrapper::send(
+    const std::string& ifname, const uint8_t *target_mac,
+    const std::vector<uint8_t>& data) const {
+  send(static_cast<int>(if_nametoindex(ifname.c_str())), target_mac, data);
+}
+
+void socket_wrapper::send(
+    const int ifindex, const uint8_t *target_mac,
+    const std::vector<uint8_t>& data) const {
+  struct sockaddr_ll addr;
+  make_address(ifindex, target_mac, addr);
 
   int flags = 0;
   int send_size =
@@ -50,18 +65,115 @@ void socket_wrapper::send(
     msg += std::strerror(errno);
     throw std::runtime_error(msg);
   }
+  if (capture_ != nullptr) {
+    capture_->write(capture_direction::OUTBOUND, ether_prtcl_type_, target_mac, data.data(), data.size());
+  }
+}
+
+void socket_wrapper::send(
+    const int ifindex, const uint8_t *target_mac,
+    const std::vector<uint8_t>& data, const uint64_t txtime_ns) const {
+  struct sockaddr_ll addr;
+  make_address(ifindex, target_mac, addr);
+
+  struct iovec iov;
+  iov.iov_base = const_cast<uint8_t *>(data.data());
+  iov.iov_len  = data.size();
+  // Departure time as SCM_TXTIME control message
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint64_t))];
+  memset(control, 0, sizeof(control));
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_name       = &addr;
+  hdr.msg_namelen    = sizeof(addr);
+  hdr.msg_iov        = &iov;
+  hdr.msg_iovlen     = 1;
+  hdr.msg_control    = control;
+  hdr.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_TXTIME;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(uint64_t));
+  memcpy(CMSG_DATA(cmsg), &txtime_ns, sizeof(uint64_t));
+
+  if (sendmsg(sock_, &hdr, 0) < 0) {
+    std::string msg = "Failed to sendmsg: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  // (captured when handed to the kernel, not at the departure time)
+  if (capture_ != nullptr) {
+    capture_->write(capture_direction::OUTBOUND, ether_prtcl_type_, target_mac, data.data(), data.size());
+  }
+}
+
+void socket_wrapper::enable_txtime() const {
+  struct sock_txtime config;
+  memset(&config, 0, sizeof(config));
+  // std::chrono::steady_clock is CLOCK_MONOTONIC
+  config.clockid = CLOCK_MONOTONIC;
+  config.flags   = 0;
+  if (setsockopt(sock_, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) == -1) {
+    std::string msg = "Failed to enable SO_TXTIME: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
 }
 
 void socket_wrapper::recv(const size_t size, std::vector<uint8_t>& data) const {
   char buf[size];
   int flags = 0;
-  size_t recv_size = ::recv(sock_, buf, size, flags);
+  const ssize_t recv_size = ::recv(sock_, buf, size, flags);
   if (recv_size < 0) {
     std::string msg = "Failed to recv: ";
     msg += std::strerror(errno);
     throw std::runtime_error(msg);
   }
   std::copy(&buf[0], &buf[recv_size], back_inserter(data));
+  if (capture_ != nullptr) {
+    capture_->write(capture_direction::INBOUND, ether_prtcl_type_, nullptr,
+                    reinterpret_cast<const uint8_t *>(buf), recv_size);
+  }
+}
+
+bool socket_wrapper::try_recv(const size_t size, std::vector<uint8_t>& data) const {
+  const size_t offset = data.size();
+  data.resize(offset + size);
+  const ssize_t recv_size = ::recv(sock_, data.data() + offset, size, MSG_DONTWAIT);
+  if (recv_size < 0) {
+    data.resize(offset);
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return false;
+    }
+    std::string msg = "Failed to recv: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  data.resize(offset + recv_size);
+  if (capture_ != nullptr) {
+    capture_->write(capture_direction::INBOUND, ether_prtcl_type_, nullptr,
+                    data.data() + offset, recv_size);
+  }
+  return true;
+}
+
+void socket_wrapper::set_receive_buffer_size(const int size) const {
+  if (setsockopt(sock_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == 0) {
+    return;
+  }
+  if (setsockopt(sock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == -1) {
+    std::string msg = "Failed to set receive buffer size: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+}
+
+void socket_wrapper::set_capture(pcapng_writer *capture) {
+  capture_ = capture;
+}
+
+int socket_wrapper::get_fd() const {
+  return sock_;
 }
 
 socket_wrapper::~socket_wrapper() {
@@ -1,20 +1,58 @@
 #ifndef SOCKET_WRAPPER_H_
 #define SOCKET_WRAPPER_H_
 
+#include <cstdint>  // for uint64_t
 #include <string>
 #include <vector>
 
+class pcapng_writer;
+struct sockaddr_ll;
+
 class socket_wrapper {
  private:
   int sock_;
   unsigned short ether_prtcl_type_;
+  // tap of the frames sent and received (nullptr if not captured)
+  pcapng_writer *capture_;
+
+  void make_address(
+    const int ifindex,
+    const uint8_t *target_mac,
+    struct sockaddr_ll& addr) const;
  public:
   socket_wrapper(const unsigned short ether_prtcl_type);
+  // Send out of the interface of the given name. The name is resolved to its
+  // index by the kernel at each call, so senders of many frames should keep
+  // the index (e.g. from interface_table) and use the overloads below.
   void send(
     const std::string& ifname,
     const uint8_t *target_mac,
     const std::vector<uint8_t>& data) const;
+  void send(
+    const int ifindex,
+    const uint8_t *target_mac,
+    const std::vector<uint8_t>& data) const;
+  // Same as send(), but the packet leaves the host at txtime_ns
+  // (CLOCK_MONOTONIC) if SO_TXTIME is enabled and the qdisc supports it
+  // (e.g. fq or etf). Otherwise it is sent right away.
+  void send(
+    const int ifindex,
+    const uint8_t *target_mac,
+    const std::vector<uint8_t>& data,
+    const uint64_t txtime_ns) const;
+  // Enable departure times (SO_TXTIME). Throws if the kernel does not support it.
+  void enable_txtime() const;
   void recv(const size_t size, std::vector<uint8_t>& data) const;
+  // Same as recv(), but returns false instead of blocking if no data is available.
+  bool try_recv(const size_t size, std::vector<uint8_t>& data) const;
+  // Set the size of the kernel receive queue, so that bursts are not dropped
+  // while the owner is busy. Above net.core.rmem_max only with CAP_NET_ADMIN.
+  void set_receive_buffer_size(const int size) const;
+  // Write the frames sent and received from now on to capture (nullptr to
+  // stop). The writer must outlive the socket or be unset first.
+  void set_capture(pcapng_writer *capture);
+  // File descriptor to wait for with poll()/epoll.
+  int get_fd() const;
   ~socket_wrapper();
 };
 
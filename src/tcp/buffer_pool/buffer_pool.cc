@@ -0,0 +1,55 @@
+#include <stdexcept>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+
+buffer_pool::buffer_pool(const size_t ring_size, const size_t max_cached_rings)
+  : ring_size_(ring_size), max_cached_rings_(max_cached_rings), stats_{0, 0} {
+  if (ring_size_ == 0) {
+    throw std::invalid_argument("Ring size must not be 0");
+  }
+}
+
+buffer_pool::~buffer_pool() {
+  for (byte_ring *ring : free_rings_) {
+    delete ring;
+  }
+}
+
+byte_ring *buffer_pool::acquire() {
+  byte_ring *ring;
+  if (!free_rings_.empty()) {
+    ring = free_rings_.back();
+    free_rings_.pop_back();
+  } else {
+    ring = new byte_ring(ring_size_);
+    stats_.rings_allocated++;
+  }
+  stats_.rings_in_use++;
+  return ring;
+}
+
+void buffer_pool::release(byte_ring *ring) {
+  stats_.rings_in_use--;
+  if (free_rings_.size() < max_cached_rings_) {
+    ring->clear();
+    free_rings_.push_back(ring);
+    return;
+  }
+  delete ring;
+  stats_.rings_allocated--;
+}
+
+size_t buffer_pool::get_ring_size() const {
+  return ring_size_;
+}
+
+const buffer_pool_stats& buffer_pool::get_stats() const {
+  return stats_;
+}
+
+buffer_pool& default_buffer_pool() {
+  thread_local buffer_pool pool(DEFAULT_BUFFER_RING_SIZE, DEFAULT_BUFFER_MAX_CACHED_RINGS);
+  return pool;
+}
@@ -0,0 +1,46 @@
+#ifndef BUFFER_POOL_H_
+#define BUFFER_POOL_H_
+
+#include <cstddef>  // for size_t
+#include <vector>
+
+#include "byte_ring.h"
+
+const size_t DEFAULT_BUFFER_RING_SIZE = 64 * 1024;
+const size_t DEFAULT_BUFFER_MAX_CACHED_RINGS = 256;
+
+struct buffer_pool_stats {
+  size_t rings_allocated;  // rings currently mapped
+  size_t rings_in_use;     // rings handed out and not released yet
+};
+
+// NOTE
+// Stream rings shared by the buffers of all connections.
+// Connections take a ring only while they have buffered data and give it
+// back as soon as the data is consumed, so idle connections hold no buffer memory.
+// Released rings are cached for reuse up to max_cached_rings, because
+// creating a ring takes several system calls.
+//
+// A pool is not thread safe. Use one pool per thread (see default_buffer_pool()).
+class buffer_pool {
+ private:
+  size_t ring_size_;
+  size_t max_cached_rings_;
+  std::vector<byte_ring *> free_rings_;
+  buffer_pool_stats stats_;
+ public:
+  buffer_pool(const size_t ring_size, const size_t max_cached_rings);
+  buffer_pool(const buffer_pool&) = delete;
+  buffer_pool& operator=(const buffer_pool&) = delete;
+  ~buffer_pool();
+  // Returns an empty ring.
+  byte_ring *acquire();
+  void release(byte_ring *ring);
+  size_t get_ring_size() const;
+  const buffer_pool_stats& get_stats() const;
+};
+
+// Pool of the calling thread.
+buffer_pool& default_buffer_pool();
+
+#endif  // BUFFER_POOL_H_
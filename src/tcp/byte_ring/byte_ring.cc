@@ -0,0 +1,114 @@
+#include <algorithm>    // for std::min()
+#include <cerrno>       // for errno
+#include <cstring>      // for std::memcpy(), std::strerror()
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>   // for memfd_create(), mmap(), munmap()
+#include <unistd.h>     // for ftruncate(), close(), sysconf()
+
+#include "byte_ring.h"
+
+namespace {
+std::runtime_error system_error(const char *what) {
+  std::string msg = what;
+  msg += std::strerror(errno);
+  return std::runtime_error(msg);
+}
+} // namespace
+
+byte_ring::byte_ring(const size_t capacity)
+  : base_(nullptr), capacity_(0), head_(0), size_(0) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  if (capacity == 0) {
+    throw std::invalid_argument("Capacity must not be 0");
+  }
+  capacity_ = (capacity + page_size - 1) / page_size * page_size;
+
+  const int fd = memfd_create("byte_ring", MFD_CLOEXEC);
+  if (fd == -1) {
+    throw system_error("Failed to memfd_create: ");
+  }
+  if (ftruncate(fd, capacity_) == -1) {
+    const std::runtime_error error = system_error("Failed to ftruncate: ");
+    close(fd);
+    throw error;
+  }
+  // Reserve address space for both views first, then map the file over it twice.
+  void *area = mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (area == MAP_FAILED) {
+    const std::runtime_error error = system_error("Failed to reserve ring: ");
+    close(fd);
+    throw error;
+  }
+  uint8_t *base = static_cast<uint8_t *>(area);
+  for (int i = 0; i < 2; ++i) {
+    if (mmap(base + i * capacity_, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      const std::runtime_error error = system_error("Failed to map ring: ");
+      munmap(area, 2 * capacity_);
+      close(fd);
+      throw error;
+    }
+  }
+  // The mappings keep the memory alive.
+  close(fd);
+  base_ = base;
+}
+
+byte_ring::~byte_ring() {
+  munmap(base_, 2 * capacity_);
+}
+
+size_t byte_ring::capacity() const {
+  return capacity_;
+}
+
+size_t byte_ring::size() const {
+  return size_;
+}
+
+size_t byte_ring::available() const {
+  return capacity_ - size_;
+}
+
+bool byte_ring::empty() const {
+  return size_ == 0;
+}
+
+byte_range byte_ring::peek(const size_t offset, const size_t size) const {
+  if (offset > size_ || size > size_ - offset) {
+    throw std::out_of_range(
+        "Range exceeds ring: " + std::to_string(offset) + "+" + std::to_string(size));
+  }
+  return byte_range{base_ + head_ + offset, size};
+}
+
+uint8_t *byte_ring::write_area() {
+  return base_ + head_ + size_;
+}
+
+void byte_ring::commit(const size_t size) {
+  if (size > available()) {
+    throw std::out_of_range("Commit exceeds ring: " + std::to_string(size));
+  }
+  size_ += size;
+}
+
+size_t byte_ring::write(const uint8_t *data, const size_t size) {
+  const size_t len = std::min(size, available());
+  std::memcpy(write_area(), data, len);
+  size_ += len;
+  return len;
+}
+
+void byte_ring::consume(const size_t size) {
+  if (size > size_) {
+    throw std::out_of_range("Consume exceeds ring: " + std::to_string(size));
+  }
+  head_ = (head_ + size) % capacity_;
+  size_ -= size;
+}
+
+void byte_ring::clear() {
+  head_ = 0;
+  size_ = 0;
+}
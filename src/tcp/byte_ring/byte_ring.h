@@ -0,0 +1,56 @@
+#ifndef BYTE_RING_H_
+#define BYTE_RING_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+
+// Contiguous range of bytes owned by someone else (e.g. a byte_ring).
+struct byte_range {
+  const uint8_t *data;
+  size_t size;
+};
+
+// NOTE
+// Ring buffer of a byte stream whose memory is mapped twice back to back
+// ("magic ring"):
+//
+//   virtual  | page 0 .. page N-1 | page 0 .. page N-1 |
+//            ^ base               ^ base + capacity
+//
+// Any capacity bytes starting from any offset are contiguous in the virtual
+// address space, so readers and writers never have to split at the wraparound.
+//
+// Each ring costs two mappings (see vm.max_map_count) and is created with
+// system calls, so rings should be reused through a buffer_pool.
+class byte_ring {
+ private:
+  uint8_t *base_;
+  size_t capacity_;
+  // offset of the first byte in [0, capacity_)
+  size_t head_;
+  size_t size_;
+ public:
+  // The capacity is rounded up to a multiple of the page size.
+  byte_ring(const size_t capacity);
+  byte_ring(const byte_ring&) = delete;
+  byte_ring& operator=(const byte_ring&) = delete;
+  ~byte_ring();
+  size_t capacity() const;
+  size_t size() const;
+  // Free space in bytes.
+  size_t available() const;
+  bool empty() const;
+  // Returns the bytes [offset, offset + size) from the head without copying.
+  byte_range peek(const size_t offset, const size_t size) const;
+  // Space after the last byte, available() bytes long.
+  uint8_t *write_area();
+  // Append size bytes written to write_area().
+  void commit(const size_t size);
+  // Append up to available() bytes and return the number of appended bytes.
+  size_t write(const uint8_t *data, const size_t size);
+  // Remove size bytes from the head.
+  void consume(const size_t size);
+  void clear();
+};
+
+#endif  // BYTE_RING_H_
@@ -0,0 +1,433 @@
+#include <algorithm>  // for std::min(), std::max()
+#include <chrono>
+#include <cstring>    // for std::memset()
+#include <stdexcept>
+
+#include "congestion_control.h"
+
+namespace {
+// NOTE
+// (rfc 5681 - 3.1. Slow Start and Congestion Avoidance)
+//   If SMSS > 2190 bytes:
+//       IW = 2 * SMSS bytes and MUST NOT be more than 2 segments
+//   If (SMSS > 1095 bytes) and (SMSS <= 2190 bytes):
+//       IW = 3 * SMSS bytes and MUST NOT be more than 3 segments
+//   if SMSS <= 1095 bytes:
+//       IW = 4 * SMSS bytes and MUST NOT be more than 4 segments
+uint32_t initial_window(const uint32_t mss) {
+  if (mss > 2190) {
+    return 2 * mss;
+  }
+  if (mss > 1095) {
+    return 3 * mss;
+  }
+  return 4 * mss;
+}
+
+// NOTE
+// (rfc 8257 - 4.2. Estimation Gain)
+//   The estimation gain g MUST satisfy the following inequality:
+//   ...
+//   A reasonable choice is 1/16
+//
+// (rfc 8257 - 3.3. Action Required at the Sender)
+//   Initialize DCTCP.Alpha to 1
+const uint32_t ALPHA_SHIFT = 10;
+const uint32_t MAX_ALPHA = 1 << ALPHA_SHIFT;
+const uint32_t DCTCP_SHIFT_G = 4;
+
+// (rfc 5681 - 3.2.) the arrival of 3 duplicate ACKs
+const uint8_t DUPLICATE_ACK_THRESHOLD = 3;
+
+// NOTE
+// (rfc 6298 - 2. The Basic Algorithm)
+//   (2.1) Until a round-trip time (RTT) measurement has been made for a
+//         segment sent between the sender and receiver, the sender SHOULD
+//         set RTO <- 1 second
+//   ...
+//   (2.3) ... RTO <- SRTT + max (G, K*RTTVAR) where K = 4.
+//   ...
+//   (2.4) Whenever RTO is computed, if it is less than 1 second, then the
+//         RTO SHOULD be rounded up to 1 second.
+//
+// Like Linux (TCP_RTO_MIN), RTO is rounded up to 200 ms instead of 1 second.
+// G is the tick of the timers of the event_loop.
+const std::chrono::microseconds INITIAL_RTO(1000000);
+const std::chrono::microseconds MIN_RTO(200000);
+const uint32_t CLOCK_GRANULARITY_US = 1000;
+
+// (rfc 9406 - 4.3. Tuning Constants and Other Considerations)
+//   MIN_RTT_THRESH = 4 msec
+//   MAX_RTT_THRESH = 16 msec
+//   MIN_RTT_DIVISOR = 8
+const uint32_t MIN_RTT_THRESH_US = 4000;
+const uint32_t MAX_RTT_THRESH_US = 16000;
+const uint32_t MIN_RTT_DIVISOR = 8;
+
+// (rfc 3742 - 2. Limited Slow-Start) max_ssthresh of 100 MSS
+const uint32_t MAX_SSTHRESH_SEGMENTS = 100;
+
+bool seq_lt(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+} // namespace
+
+congestion_control::congestion_control(const congestion_algorithm algorithm, const uint32_t mss)
+  : srtt_us_(0), rttvar_us_(0), latest_rtt_us_(0), min_rtt_us_(0), last_round_rtt_us_(0),
+    rtt_seq_(0), rtt_timing_(false),
+    algorithm_(algorithm), mss_(mss),
+    cwnd_(initial_window(mss)), ssthresh_(UINT32_MAX),
+    bytes_acked_(0), recover_(0),
+    alpha_(MAX_ALPHA), window_end_(0), window_acked_(0), window_marked_(0),
+    in_recovery_(false), loss_recover_(0), loss_recover_set_(false),
+    in_fast_recovery_(false), duplicate_acks_(0),
+    window_started_(false), cwr_pending_(false) {
+  if (mss == 0) {
+    throw std::invalid_argument("MSS must not be 0");
+  }
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+void congestion_control::set_algorithm(const congestion_algorithm algorithm) {
+  algorithm_ = algorithm;
+}
+
+congestion_algorithm congestion_control::get_algorithm() const {
+  return algorithm_;
+}
+
+void congestion_control::set_mss(const uint32_t mss) {
+  if (mss == 0) {
+    throw std::invalid_argument("MSS must not be 0");
+  }
+  if (stats_.acked_bytes == 0 && ssthresh_ == UINT32_MAX) {
+    cwnd_ = initial_window(mss);
+  }
+  mss_ = mss;
+}
+
+void congestion_control::on_ack(
+    const uint32_t acked,
+    const bool ece,
+    const uint32_t snd_una,
+    const uint32_t snd_nxt,
+    const std::chrono::steady_clock::time_point now) {
+  if (rtt_timing_ && !seq_lt(snd_una, rtt_seq_)) {
+    rtt_timing_ = false;
+    update_rtt(now - rtt_time_);
+  }
+  stats_.acked_bytes += acked;
+  if (ece) {
+    stats_.ece_acked_bytes += acked;
+  }
+  if (acked != 0) {
+    duplicate_acks_ = 0;
+  }
+  // true if this ACK ends fast recovery (cwnd is not grown by it)
+  bool recovered = false;
+  if (in_fast_recovery_ && acked != 0) {
+    if (!seq_lt(snd_una, loss_recover_)) {
+      // NOTE
+      // (rfc 6582 - 3.2. Specification)
+      //   Full acknowledgments:
+      //   ...
+      //   Set cwnd to either (1) min (ssthresh, max(FlightSize, SMSS) + SMSS)
+      //   or (2) ssthresh, where ssthresh is the value set when fast
+      //   retransmit was entered
+      cwnd_ = ssthresh_;
+      in_fast_recovery_ = false;
+      recovered = true;
+    } else {
+      // (rfc 6582 - 3.2.) Partial acknowledgments:
+      //   deflate the congestion window by the amount of new data
+      //   acknowledged by the Cumulative Acknowledgment field.  If the partial
+      //   ACK acknowledges at least one SMSS of new data, then add back SMSS
+      //   bytes to the congestion window.
+      cwnd_ = (cwnd_ > acked ? cwnd_ - acked : 0) + (acked >= mss_ ? mss_ : 0);
+      cwnd_ = std::max(cwnd_, mss_);
+    }
+  }
+  if (in_recovery_ && !seq_lt(snd_una, recover_)) {
+    in_recovery_ = false;
+  }
+
+  if (algorithm_ == congestion_algorithm::DCTCP) {
+    // (rfc 8257 - 3.3. Action Required at the Sender)
+    //   The sender MUST update the count of bytes acknowledged with ECE ...
+    if (!window_started_) {
+      window_started_ = true;
+      window_end_ = snd_nxt;
+    }
+    window_acked_ += acked;
+    if (ece) {
+      window_marked_ += acked;
+    }
+    update_alpha(snd_una, snd_nxt);
+    if (ece && !in_recovery_) {
+      // cwnd * (1 - alpha / 2)
+      const uint64_t cut = static_cast<uint64_t>(cwnd_) * alpha_ >> (ALPHA_SHIFT + 1);
+      reduce(cwnd_ - static_cast<uint32_t>(cut), snd_nxt);
+      return;
+    }
+  } else if (ece && !in_recovery_) {
+    // (rfc 3168 - 6.1.2. The TCP Sender)
+    //   the TCP source halves the congestion window "cwnd" and reduces the
+    //   slow start threshold "ssthresh".
+    reduce(cwnd_ / 2, snd_nxt);
+    return;
+  }
+
+  if (acked == 0 || in_recovery_ || recovered) {
+    return;
+  }
+  if (cwnd_ < ssthresh_) {
+    // (rfc 5681 - 3.1.) cwnd += min (N, SMSS)
+    // (rfc 3742 - 2.)
+    //   For each arriving ACK in slow-start, where N is the number of
+    //   previously unacknowledged bytes acknowledged in the arriving ACK:
+    //   If (cwnd <= max_ssthresh)
+    //     cwnd += MSS
+    //   Else
+    //     K = int(cwnd / (0.5 max_ssthresh))
+    //     cwnd += int(MSS / K)
+    const uint32_t max_ssthresh = MAX_SSTHRESH_SEGMENTS * mss_;
+    if (cwnd_ <= max_ssthresh) {
+      cwnd_ += std::min(acked, mss_);
+    } else {
+      cwnd_ += static_cast<uint32_t>(
+          static_cast<uint64_t>(std::min(acked, mss_)) * (max_ssthresh / 2) / cwnd_);
+    }
+    return;
+  }
+  // (rfc 5681 - 3.1.) cwnd += SMSS*SMSS/cwnd, counted in bytes (rfc 3465)
+  bytes_acked_ += acked;
+  if (bytes_acked_ >= cwnd_) {
+    bytes_acked_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+bool congestion_control::on_duplicate_ack(
+    const uint32_t in_flight, const uint32_t snd_una, const uint32_t snd_nxt) {
+  if (in_fast_recovery_) {
+    // (rfc 5681 - 3.2.)
+    //   5. For each additional duplicate ACK received (after the third),
+    //      cwnd MUST be incremented by SMSS.  This artificially inflates the
+    //      congestion window in order to reflect the additional segment that
+    //      has left the network.
+    cwnd_ += mss_;
+    return false;
+  }
+  if (duplicate_acks_ < DUPLICATE_ACK_THRESHOLD) {
+    duplicate_acks_++;
+  }
+  if (duplicate_acks_ != DUPLICATE_ACK_THRESHOLD) {
+    return false;
+  }
+  // NOTE
+  // (rfc 6582 - 3.2. Specification)
+  //   2) Three duplicate ACKs:
+  //      When the third duplicate ACK is received, the TCP sender first
+  //      checks the value of recover to see if the Cumulative
+  //      Acknowledgment field covers more than recover.  If so, the value of
+  //      recover is incremented to the value of the highest sequence number
+  //      transmitted by the TCP so far.  The TCP then enters fast retransmit
+  //      (step 2 of Section 3.2 of [RFC5681]).  If not, the TCP does not
+  //      enter fast retransmit and does not reset ssthresh.
+  if (loss_recover_set_ && !seq_lt(loss_recover_, snd_una)) {
+    return false;
+  }
+  // (rfc 5681 - 3.2.)
+  //   2. ... ssthresh = max (FlightSize / 2, 2*SMSS)
+  //   3. The lost segment starting at SND.UNA MUST be retransmitted and
+  //      cwnd set to ssthresh plus 3*SMSS.
+  // (a window already reduced for ECN-Echo in this window is not reduced again)
+  if (!in_recovery_) {
+    ssthresh_ = std::max(in_flight / 2, 2 * mss_);
+  }
+  cwnd_ = ssthresh_ + DUPLICATE_ACK_THRESHOLD * mss_;
+  bytes_acked_ = 0;
+  recover_ = snd_nxt;
+  loss_recover_ = snd_nxt;
+  loss_recover_set_ = true;
+  in_recovery_ = true;
+  in_fast_recovery_ = true;
+  // Karn's algorithm (the segment being timed may be the retransmitted one)
+  rtt_timing_ = false;
+  stats_.fast_retransmits++;
+  return true;
+}
+
+bool congestion_control::in_fast_recovery() const {
+  return in_fast_recovery_;
+}
+
+void congestion_control::update_alpha(const uint32_t snd_una, const uint32_t snd_nxt) {
+  if (seq_lt(snd_una, window_end_)) {
+    return;
+  }
+  // (rfc 8257 - 3.3. Action Required at the Sender)
+  //   M = DCTCP.BytesMarked / DCTCP.BytesAcked
+  //   DCTCP.Alpha = DCTCP.Alpha * (1 - g) + g * M
+  uint32_t fraction = 0;
+  if (window_acked_ != 0) {
+    fraction = static_cast<uint32_t>(
+        (static_cast<uint64_t>(window_marked_) << ALPHA_SHIFT) / window_acked_);
+  }
+  alpha_ = alpha_ - (alpha_ >> DCTCP_SHIFT_G) + (fraction >> DCTCP_SHIFT_G);
+  alpha_ = std::min(alpha_, MAX_ALPHA);
+  window_end_ = snd_nxt;
+  window_acked_ = 0;
+  window_marked_ = 0;
+}
+
+void congestion_control::reduce(const uint32_t cwnd, const uint32_t snd_nxt) {
+  // (rfc 3168 - 6.1.2. The TCP Sender)
+  //   the congestion window "cwnd" should never be reduced below one
+  //   segment, ... cwnd should be reduced to at most one maximum sized
+  //   segment. (this implementation keeps at least 2 segments, as rfc 5681
+  //   does for ssthresh)
+  cwnd_ = std::max(cwnd, 2 * mss_);
+  ssthresh_ = cwnd_;
+  bytes_acked_ = 0;
+  recover_ = snd_nxt;
+  in_recovery_ = true;
+  cwr_pending_ = true;
+  stats_.ecn_reductions++;
+}
+
+void congestion_control::on_data_sent(
+    const uint32_t snd_nxt, const std::chrono::steady_clock::time_point now) {
+  if (!rtt_timing_) {
+    rtt_timing_ = true;
+    rtt_seq_ = snd_nxt;
+    rtt_time_ = now;
+  }
+}
+
+void congestion_control::update_rtt(const std::chrono::steady_clock::duration rtt) {
+  const uint32_t r = std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(rtt).count(), 1);
+  latest_rtt_us_ = r;
+  if (min_rtt_us_ == 0 || r < min_rtt_us_) {
+    min_rtt_us_ = r;
+  }
+  stats_.rtt_samples++;
+  if (cwnd_ < ssthresh_ && !in_recovery_) {
+    if (last_round_rtt_us_ != 0) {
+      const uint32_t thresh = std::max(
+          MIN_RTT_THRESH_US, std::min(last_round_rtt_us_ / MIN_RTT_DIVISOR, MAX_RTT_THRESH_US));
+      if (r >= last_round_rtt_us_ + thresh) {
+        // The queue is building: go on in congestion avoidance.
+        ssthresh_ = cwnd_;
+        stats_.slow_start_exits++;
+      }
+    }
+    last_round_rtt_us_ = r;
+  }
+  // NOTE
+  // (rfc 6298 - 2. The Basic Algorithm)
+  //   (2.2) When the first RTT measurement R is made, the host MUST set
+  //       SRTT <- R
+  //       RTTVAR <- R/2
+  //   (2.3) When a subsequent RTT measurement R' is made, a host MUST set
+  //       RTTVAR <- (1 - beta) * RTTVAR + beta * |SRTT - R'|
+  //       SRTT <- (1 - alpha) * SRTT + alpha * R'
+  //   ... using alpha=1/8 and beta=1/4
+  if (srtt_us_ == 0) {
+    srtt_us_ = r;
+    rttvar_us_ = r / 2;
+    return;
+  }
+  const uint32_t delta = srtt_us_ > r ? srtt_us_ - r : r - srtt_us_;
+  rttvar_us_ = rttvar_us_ - rttvar_us_ / 4 + delta / 4;
+  srtt_us_ = srtt_us_ - srtt_us_ / 8 + r / 8;
+  if (srtt_us_ == 0) {
+    srtt_us_ = 1;
+  }
+}
+
+void congestion_control::on_retransmission_timeout(
+    const uint32_t in_flight, const uint32_t snd_nxt) {
+  // (rfc 6298 - 3. Taking RTT Samples) Karn's algorithm: RTT samples MUST
+  // NOT be made using segments that were retransmitted
+  rtt_timing_ = false;
+  // NOTE
+  // (rfc 5681 - 3.1. Slow Start and Congestion Avoidance)
+  //   ssthresh = max (FlightSize / 2, 2*SMSS)
+  //   ...
+  //   Furthermore, upon a timeout (as specified in [RFC2988]) cwnd MUST be
+  //   set to no more than the loss window, LW, which equals 1 full-sized
+  //   segment
+  ssthresh_ = std::max(in_flight / 2, 2 * mss_);
+  cwnd_ = mss_;
+  bytes_acked_ = 0;
+  // (the RTT before the timeout is no baseline for the next slow start)
+  last_round_rtt_us_ = 0;
+  in_recovery_ = false;
+  in_fast_recovery_ = false;
+  duplicate_acks_ = 0;
+  // (rfc 6582 - 3.2.)
+  //   After a retransmit timeout, record the highest sequence number
+  //   transmitted in the variable recover
+  loss_recover_ = snd_nxt;
+  loss_recover_set_ = true;
+  stats_.timeout_reductions++;
+}
+
+bool congestion_control::take_cwr() {
+  const bool cwr = cwr_pending_;
+  cwr_pending_ = false;
+  return cwr;
+}
+
+uint32_t congestion_control::get_cwnd() const {
+  return cwnd_;
+}
+
+uint32_t congestion_control::get_ssthresh() const {
+  return ssthresh_;
+}
+
+std::chrono::microseconds congestion_control::get_srtt() const {
+  return std::chrono::microseconds(srtt_us_);
+}
+
+std::chrono::microseconds congestion_control::get_rttvar() const {
+  return std::chrono::microseconds(rttvar_us_);
+}
+
+std::chrono::microseconds congestion_control::get_latest_rtt() const {
+  return std::chrono::microseconds(latest_rtt_us_);
+}
+
+std::chrono::microseconds congestion_control::get_min_rtt() const {
+  return std::chrono::microseconds(min_rtt_us_);
+}
+
+std::chrono::microseconds congestion_control::get_rto() const {
+  if (srtt_us_ == 0) {
+    return INITIAL_RTO;
+  }
+  const std::chrono::microseconds rto(
+      srtt_us_ + std::max(CLOCK_GRANULARITY_US, 4 * rttvar_us_));
+  return std::max(rto, MIN_RTO);
+}
+
+uint64_t congestion_control::get_pacing_rate() const {
+  if (srtt_us_ == 0) {
+    return 0;
+  }
+  // NOTE Like Linux's tcp_update_pacing_rate()
+  //   (net.ipv4.tcp_pacing_ss_ratio = 200, tcp_pacing_ca_ratio = 120)
+  const uint64_t ratio = cwnd_ < ssthresh_ / 2 ? 200 : 120;
+  return static_cast<uint64_t>(cwnd_) * 1000000 * ratio / 100 / srtt_us_;
+}
+
+uint32_t congestion_control::get_alpha() const {
+  return alpha_;
+}
+
+const congestion_control_stats& congestion_control::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,179 @@
+#ifndef CONGESTION_CONTROL_H_
+#define CONGESTION_CONTROL_H_
+
+#include <chrono>
+#include <cstdint>  // for uint32_t
+
+// Response of the sender to congestion signals (ECN-Echo, duplicate ACKs and
+// retransmission timeout).
+enum class congestion_algorithm : uint8_t {
+  // (rfc 5681) slow start and congestion avoidance, and the window is
+  // halved once per window of data when ECN-Echo is received (rfc 3168).
+  RENO,
+  // (rfc 8257) the window is reduced in proportion to the fraction of
+  // bytes marked with CE.
+  DCTCP,
+};
+
+struct congestion_control_stats {
+  uint64_t acked_bytes;         // bytes acknowledged
+  uint64_t ece_acked_bytes;     // bytes acknowledged by segments with ECE
+  uint64_t ecn_reductions;      // window reductions in response to ECE
+  uint64_t timeout_reductions;  // window reductions in response to retransmission timeouts
+  uint64_t fast_retransmits;    // window reductions in response to 3 duplicate ACKs
+  uint64_t slow_start_exits;    // slow starts ended by a rise of the RTT (rfc 9406)
+  uint64_t rtt_samples;         // round trip times measured
+};
+
+// NOTE
+// (rfc 5681 - 3.1. Slow Start and Congestion Avoidance)
+//   The slow start algorithm is used when cwnd < ssthresh, while the
+//   congestion avoidance algorithm is used when cwnd > ssthresh.
+//
+// (rfc 3168 - 6.1.2. The TCP Sender)
+//   If the sender receives an ECN-Echo (ECE) ACK
+//   packet (that is, an ACK packet with the ECN-Echo flag set in the TCP
+//   header), then the sender knows that congestion was encountered in the
+//   network on the path from the sender to the receiver.  The indication
+//   of congestion should be treated just as a congestion loss in non-
+//   ECN-Capable TCP. That is, the TCP source halves the congestion window
+//   "cwnd" and reduces the slow start threshold "ssthresh".
+//   ...
+//   the TCP sender should react to congestion at most once per window of data
+//
+// (rfc 8257 - 3.3. Action Required at the Sender)
+//   DCTCP.Alpha = DCTCP.Alpha * (1 - g) + g * M
+//   ...
+//   cwnd = cwnd * (1 - DCTCP.Alpha / 2)
+//
+// (rfc 5681 - 3.2. Fast Retransmit/Fast Recovery)
+//   The TCP sender SHOULD use the "fast retransmit" algorithm to detect
+//   and repair loss, based on incoming duplicate ACKs.  The fast
+//   retransmit algorithm uses the arrival of 3 duplicate ACKs ... as an
+//   indication that a segment has been lost.
+//
+// with the NewReno response to partial ACKs (rfc 6582), so that several
+// segments lost in one window are retransmitted without a timeout.
+//
+// (rfc 9406 - 4.2. Algorithm Details)
+//   if ((currentRoundMinRTT != infinity) &&
+//       (lastRoundMinRTT != infinity))
+//     RttThresh = max(MIN_RTT_THRESH,
+//       min(lastRoundMinRTT / MIN_RTT_DIVISOR, MAX_RTT_THRESH))
+//     if (currentRoundMinRTT >= (lastRoundMinRTT + RttThresh))
+//       cssBaselineMinRtt = currentRoundMinRTT
+//       exit slow start and enter CSS
+//
+// Without SACK every segment lost in one window costs a round trip of
+// recovery, so slow start should end before the bottleneck queue
+// overflows. The RTT is sampled once per round, so the sample of a round
+// stands for its minimum, and slow start goes straight to congestion
+// avoidance (as Linux's HyStart does) instead of Conservative Slow Start.
+// As the sample is taken on the first segment of a round, before the queue
+// builds up in it, slow start is also limited above 100 segments (rfc 3742,
+// at most 50 segments more per round), which bounds the overshoot when the
+// rise of the RTT is seen late.
+//
+// The round trip time is measured on one segment at a time (rfc 6298, with
+// Karn's algorithm). It gives the retransmission timeout, and the pacing
+// rate: like Linux, cwnd per RTT scaled by 2 in slow start and by 1.2 in
+// congestion avoidance, so that the window still grows while segments are
+// spread over the RTT.
+class congestion_control {
+ private:
+  std::chrono::steady_clock::time_point rtt_time_;
+  // (rfc 6298) SRTT and RTTVAR in microseconds (0 until measured)
+  uint32_t srtt_us_;
+  uint32_t rttvar_us_;
+  // latest and smallest RTT measured in microseconds (0 until measured)
+  uint32_t latest_rtt_us_;
+  uint32_t min_rtt_us_;
+  // RTT of the previous round in slow start in microseconds (0 if none)
+  uint32_t last_round_rtt_us_;
+  // The round trip being timed ends when SND.UNA passes rtt_seq_.
+  uint32_t rtt_seq_;
+  bool rtt_timing_;
+  congestion_algorithm algorithm_;
+  uint32_t mss_;
+  uint32_t cwnd_;
+  uint32_t ssthresh_;
+  // bytes acknowledged in congestion avoidance and not counted in cwnd_ yet
+  uint32_t bytes_acked_;
+  // The window is not reduced again until SND.UNA passes recover_.
+  uint32_t recover_;
+  // DCTCP.Alpha in 1/1024 units
+  uint32_t alpha_;
+  // The observation window of DCTCP ends when SND.UNA passes window_end_.
+  uint32_t window_end_;
+  uint32_t window_acked_;
+  uint32_t window_marked_;
+  bool in_recovery_;
+  // (rfc 6582) "recover": duplicate ACKs do not start fast retransmit again
+  // until SND.UNA passes loss_recover_ (valid if loss_recover_set_).
+  uint32_t loss_recover_;
+  bool loss_recover_set_;
+  // true from the 3rd duplicate ACK until loss_recover_ is acknowledged
+  bool in_fast_recovery_;
+  // duplicate ACKs in a row
+  uint8_t duplicate_acks_;
+  bool window_started_;
+  // true if CWR must be set on the next new data segment
+  bool cwr_pending_;
+  congestion_control_stats stats_;
+
+  void reduce(const uint32_t cwnd, const uint32_t snd_nxt);
+  void update_rtt(const std::chrono::steady_clock::duration rtt);
+  void update_alpha(const uint32_t snd_una, const uint32_t snd_nxt);
+ public:
+  congestion_control(const congestion_algorithm algorithm, const uint32_t mss);
+  void set_algorithm(const congestion_algorithm algorithm);
+  congestion_algorithm get_algorithm() const;
+  // The initial window follows the MSS until data is acknowledged.
+  void set_mss(const uint32_t mss);
+  // Called for each acceptable ACK.
+  //   acked   : bytes newly acknowledged by the segment (0 for duplicates)
+  //   ece     : true if ECN-Echo was set (and ECN is negotiated)
+  //   snd_una : SND.UNA after the segment is applied
+  //   snd_nxt : SND.NXT
+  //   now     : time the segment arrived (for RTT measurement)
+  void on_ack(
+      const uint32_t acked,
+      const bool ece,
+      const uint32_t snd_una,
+      const uint32_t snd_nxt,
+      const std::chrono::steady_clock::time_point now);
+  // Called for each duplicate ACK (rfc 5681 - 2.) after on_ack(). Returns
+  // true at the 3rd one in a row, when the oldest unacknowledged segment
+  // should be retransmitted (fast retransmit).
+  //   in_flight : SND.NXT - SND.UNA
+  bool on_duplicate_ack(const uint32_t in_flight, const uint32_t snd_una, const uint32_t snd_nxt);
+  // Returns true while lost segments are being repaired after a fast
+  // retransmit. An ACK of new data in this state is partial, and the oldest
+  // unacknowledged segment should be retransmitted as well.
+  bool in_fast_recovery() const;
+  // Called when new data is sent (up to SND.NXT = snd_nxt).
+  void on_data_sent(const uint32_t snd_nxt, const std::chrono::steady_clock::time_point now);
+  // Called when the retransmission timer expires.
+  void on_retransmission_timeout(const uint32_t in_flight, const uint32_t snd_nxt);
+  // Returns true once after each reduction in response to ECE, when CWR
+  // should be set on the next new data segment.
+  bool take_cwr();
+  uint32_t get_cwnd() const;
+  uint32_t get_ssthresh() const;
+  // Smoothed round trip time (0 until measured).
+  std::chrono::microseconds get_srtt() const;
+  std::chrono::microseconds get_rttvar() const;
+  // Latest and smallest RTT measured (0 until measured). A new measurement
+  // is counted in the rtt_samples of the stats.
+  std::chrono::microseconds get_latest_rtt() const;
+  std::chrono::microseconds get_min_rtt() const;
+  // Retransmission timeout (rfc 6298) before any backoff.
+  std::chrono::microseconds get_rto() const;
+  // Bytes per second, or 0 if not known yet (sending must not be paced).
+  uint64_t get_pacing_rate() const;
+  // DCTCP.Alpha in 1/1024 units
+  uint32_t get_alpha() const;
+  const congestion_control_stats& get_stats() const;
+};
+
+#endif  // CONGESTION_CONTROL_H_
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstring>  // for std::memset()
+
+#include "connection_stats.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+bool seq_leq(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) <= 0;
+}
+} // namespace
+
+connection_stats_recorder::connection_stats_recorder()
+  : limit_(send_limit::NONE), first_write_(0), num_writes_(0) {
+  std::memset(&counters_, 0, sizeof(counters_));
+  published_.store(counters_);
+}
+
+connection_stats& connection_stats_recorder::counters() {
+  return counters_;
+}
+
+void connection_stats_recorder::on_rtt_sample(const chrono::microseconds rtt) {
+  rtt_.record(rtt.count());
+}
+
+void connection_stats_recorder::on_write(
+    const uint32_t end_seq, const chrono::steady_clock::time_point now) {
+  if (num_writes_ == MAX_PENDING_WRITES) {
+    return;
+  }
+  writes_[(first_write_ + num_writes_) % MAX_PENDING_WRITES] = pending_write{end_seq, now};
+  num_writes_++;
+}
+
+void connection_stats_recorder::on_acked(
+    const uint32_t snd_una, const chrono::steady_clock::time_point now) {
+  while (num_writes_ != 0 && seq_leq(writes_[first_write_].end_seq, snd_una)) {
+    write_latency_.record(
+        chrono::duration_cast<chrono::nanoseconds>(now - writes_[first_write_].time).count());
+    first_write_ = (first_write_ + 1) % MAX_PENDING_WRITES;
+    num_writes_--;
+  }
+}
+
+void connection_stats_recorder::publish(
+    const send_limit limit, const chrono::steady_clock::time_point now) {
+  if (limit_ != send_limit::NONE) {
+    const uint64_t elapsed_us =
+      chrono::duration_cast<chrono::microseconds>(now - limit_since_).count();
+    switch (limit_) {
+      case send_limit::BUSY:
+        counters_.busy_us += elapsed_us;
+        break;
+      case send_limit::RWND:
+        counters_.rwnd_limited_us += elapsed_us;
+        break;
+      case send_limit::CWND:
+        counters_.cwnd_limited_us += elapsed_us;
+        break;
+      case send_limit::APP:
+        counters_.app_limited_us += elapsed_us;
+        break;
+      default:
+        break;
+    }
+  }
+  limit_ = limit;
+  limit_since_ = now;
+  published_.store(counters_);
+}
+
+connection_stats connection_stats_recorder::snapshot() const {
+  return published_.load();
+}
+
+uint64_t connection_stats_recorder::get_version() const {
+  return published_.get_version();
+}
+
+const hdr_histogram& connection_stats_recorder::get_rtt_histogram() const {
+  return rtt_;
+}
+
+const hdr_histogram& connection_stats_recorder::get_write_latency_histogram() const {
+  return write_latency_;
+}
@@ -0,0 +1,114 @@
+#ifndef CONNECTION_STATS_H_
+#define CONNECTION_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+#include "hdr_histogram.h"
+#include "seqlock.h"
+
+// Why a connection is not sending more data (see connection_stats).
+enum class send_limit : uint8_t {
+  // the handshake is not done
+  NONE,
+  // data is being sent (or held back by Nagle's algorithm, cork or pacing)
+  BUSY,
+  // the receive window of the peer is full
+  RWND,
+  // the congestion window is full
+  CWND,
+  // all data written by the application has been sent
+  APP,
+};
+
+// Counters and gauges of a connection, like Linux's struct tcp_info.
+struct connection_stats {
+  uint64_t bytes_sent;           // data bytes sent, including retransmissions
+  uint64_t bytes_retransmitted;  // data bytes retransmitted
+  uint64_t bytes_acked;          // bytes acknowledged by the peer
+  uint64_t bytes_received;       // in-order data bytes received
+  uint64_t segments_out;
+  uint64_t segments_in;
+  uint64_t data_segments_out;    // segments carrying data, including retransmissions
+  uint64_t data_segments_in;
+  uint64_t retransmits;          // segments retransmitted
+  uint64_t timeouts;             // retransmission timeouts
+  uint64_t reorder_events;       // data segments received out of order
+  uint64_t duplicate_acks;       // ACKs acknowledging nothing new while data is in flight
+  uint64_t rtt_samples;          // round trip times measured
+  // round trip time in microseconds (0 until measured)
+  uint32_t min_rtt_us;
+  uint32_t srtt_us;
+  uint32_t rttvar_us;
+  uint32_t cwnd;
+  uint32_t ssthresh;
+  uint32_t snd_wnd;
+  uint32_t send_mss;
+  uint32_t bytes_in_flight;
+  uint64_t pacing_rate;          // bytes per second (0 if not known yet)
+  // time spent in each send_limit, in microseconds
+  uint64_t busy_us;
+  uint64_t rwnd_limited_us;
+  uint64_t cwnd_limited_us;
+  uint64_t app_limited_us;
+};
+
+// NOTE
+// Statistics of one connection, written by the thread driving it and read by
+// any thread without stopping it.
+//
+// The writer updates its own copy of the counters (counters()) as events
+// happen, and publish() stores a copy in a seqlock, which readers take with
+// snapshot(). The writer never waits for a reader, and a reader always gets
+// the counters as of one publish(). The histograms are written in place;
+// each counter of a histogram is read atomically, but not all of them as of
+// one instant.
+//
+// Write latency is the time from write() until the last byte written is
+// acknowledged. Only MAX_PENDING_WRITES writes are timed at a time, and
+// later ones are not sampled until the earlier ones are acknowledged.
+class connection_stats_recorder {
+ private:
+  static const size_t MAX_PENDING_WRITES = 32;
+  struct pending_write {
+    uint32_t end_seq;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  connection_stats counters_;
+  send_limit limit_;
+  std::chrono::steady_clock::time_point limit_since_;
+  // ring of timed writes, oldest first
+  std::array<pending_write, MAX_PENDING_WRITES> writes_;
+  size_t first_write_;
+  size_t num_writes_;
+  // round trip time in microseconds
+  hdr_histogram rtt_;
+  // write latency in nanoseconds
+  hdr_histogram write_latency_;
+  seqlock<connection_stats> published_;
+ public:
+  connection_stats_recorder();
+  connection_stats_recorder(const connection_stats_recorder&) = delete;
+  connection_stats_recorder& operator=(const connection_stats_recorder&) = delete;
+  // Writer
+  connection_stats& counters();
+  void on_rtt_sample(const std::chrono::microseconds rtt);
+  // Called when data up to end_seq (exclusive) has been written.
+  void on_write(const uint32_t end_seq, const std::chrono::steady_clock::time_point now);
+  // Called when SND.UNA advances.
+  void on_acked(const uint32_t snd_una, const std::chrono::steady_clock::time_point now);
+  // Account the time up to now to the current limit, switch to limit, and
+  // make the counters visible to readers.
+  void publish(const send_limit limit, const std::chrono::steady_clock::time_point now);
+  // Readers
+  connection_stats snapshot() const;
+  // Number of publish() calls so far (to tell if a snapshot is new).
+  uint64_t get_version() const;
+  const hdr_histogram& get_rtt_histogram() const;
+  const hdr_histogram& get_write_latency_histogram() const;
+};
+
+#endif  // CONNECTION_STATS_H_
@@ -0,0 +1,253 @@
+#include <cstdint>  // for uint8_t
+#include <cstring>  // for std::memcpy()
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>   // for std::to_string()
+#ifdef __SSE2__
+#include <emmintrin.h>  // for _mm_cmpeq_epi32(), _mm_movemask_ps()
+#endif
+
+#include "connection_table.h"
+
+namespace {
+const uint32_t VALUE_EMPTY   = UINT32_MAX;
+const uint32_t VALUE_DELETED = UINT32_MAX - 1;
+const size_t   MIN_CAPACITY  = 4 * CONNECTION_TABLE_GROUP_SIZE;
+
+// Returns a bit mask whose n-th bit is set if the n-th element of the field equals to c.
+uint32_t match_field(const uint32_t *field, const uint32_t c) {
+#ifdef __SSE2__
+  const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(field));
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, _mm_set1_epi32(static_cast<int>(c)))));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < CONNECTION_TABLE_GROUP_SIZE; ++i) {
+    if (field[i] == c) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+// Returns a bit mask of EMPTY or DELETED slots of the values of a group.
+uint32_t match_free(const uint32_t *values) {
+#ifdef __SSE2__
+  // NOTE EMPTY and DELETED differ only in the lowest bit.
+  const __m128i v = _mm_or_si128(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(values)), _mm_set1_epi32(1));
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, _mm_set1_epi32(-1))));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < CONNECTION_TABLE_GROUP_SIZE; ++i) {
+    if (values[i] > CONNECTION_TABLE_MAX_VALUE) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+uint32_t pack_ports(const connection_key& key) {
+  return (static_cast<uint32_t>(key.local_port) << 16) | key.remote_port;
+}
+
+uint64_t mix(uint64_t x) {
+  // finalizer of MurmurHash3
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+size_t round_up_capacity(const size_t n) {
+  // keep the load factor at most 7/8
+  const size_t min_slots = n + n / 7 + 1;
+  size_t capacity = MIN_CAPACITY;
+  while (capacity < min_slots) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+} // namespace
+
+bool operator==(const connection_key& lhs, const connection_key& rhs) {
+  return lhs.local_ip    == rhs.local_ip    &&
+         lhs.remote_ip   == rhs.remote_ip   &&
+         lhs.local_port  == rhs.local_port  &&
+         lhs.remote_port == rhs.remote_port;
+}
+
+bool operator!=(const connection_key& lhs, const connection_key& rhs) {
+  return !(lhs == rhs);
+}
+
+connection_key make_connection_key(
+    const uint8_t *local_ip_bytes, const uint16_t local_port,
+    const uint8_t *remote_ip_bytes, const uint16_t remote_port) {
+  connection_key key;
+  std::memcpy(&key.local_ip, local_ip_bytes, sizeof(key.local_ip));
+  std::memcpy(&key.remote_ip, remote_ip_bytes, sizeof(key.remote_ip));
+  key.local_port  = local_port;
+  key.remote_port = remote_port;
+  return key;
+}
+
+connection_table::connection_table() : connection_table(MIN_CAPACITY) {}
+
+connection_table::connection_table(const size_t capacity)
+  : capacity_(0), size_(0), tombstones_(0) {
+  // NOTE
+  // The seed is random so that remote hosts can not choose ports which
+  // collide in the table.
+  std::random_device rd;
+  seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+  rehash(round_up_capacity(capacity));
+}
+
+uint64_t connection_table::hash(const connection_key& key) const {
+  const uint64_t ips   = (static_cast<uint64_t>(key.local_ip) << 32) | key.remote_ip;
+  const uint64_t ports = (static_cast<uint64_t>(key.local_port) << 16) | key.remote_port;
+  return mix(mix(ips ^ seed_) ^ ports);
+}
+
+size_t connection_table::find_index(const connection_key& key, const uint64_t h) const {
+  const size_t num_groups = capacity_ / CONNECTION_TABLE_GROUP_SIZE;
+  const uint32_t ports = pack_ports(key);
+  size_t index = h & (num_groups - 1);
+  for (size_t probe = 0; probe < num_groups; ++probe) {
+    const group& g = groups_[index];
+    const uint32_t match =
+      match_field(g.local_ips, key.local_ip) & match_field(g.remote_ips, key.remote_ip) &
+      match_field(g.ports, ports) & ~match_free(g.values);
+    if (match != 0) {
+      return index * CONNECTION_TABLE_GROUP_SIZE + __builtin_ctz(match);
+    }
+    // A group with an empty slot has never overflowed to the next group.
+    if (match_field(g.values, VALUE_EMPTY) != 0) {
+      break;
+    }
+    index = (index + 1) & (num_groups - 1);
+  }
+  return capacity_;
+}
+
+void connection_table::insert_unique(
+    const connection_key& key, const uint32_t value, const uint64_t h) {
+  const size_t num_groups = capacity_ / CONNECTION_TABLE_GROUP_SIZE;
+  size_t index = h & (num_groups - 1);
+  for (size_t probe = 0; probe < num_groups; ++probe) {
+    group& g = groups_[index];
+    const uint32_t free = match_free(g.values);
+    if (free != 0) {
+      const size_t offset = __builtin_ctz(free);
+      if (g.values[offset] == VALUE_DELETED) {
+        tombstones_--;
+      }
+      g.local_ips[offset]  = key.local_ip;
+      g.remote_ips[offset] = key.remote_ip;
+      g.ports[offset]      = pack_ports(key);
+      g.values[offset]     = value;
+      size_++;
+      return;
+    }
+    index = (index + 1) & (num_groups - 1);
+  }
+  throw std::runtime_error("Connection table is full");
+}
+
+void connection_table::rehash(const size_t capacity) {
+  std::unique_ptr<group[]> old_groups = std::move(groups_);
+  const size_t old_num_groups = capacity_ / CONNECTION_TABLE_GROUP_SIZE;
+
+  const size_t num_groups = capacity / CONNECTION_TABLE_GROUP_SIZE;
+  groups_.reset(new group[num_groups]);
+  for (size_t i = 0; i < num_groups; ++i) {
+    for (uint32_t& value : groups_[i].values) {
+      value = VALUE_EMPTY;
+    }
+  }
+  capacity_   = capacity;
+  size_       = 0;
+  tombstones_ = 0;
+
+  for (size_t i = 0; i < old_num_groups; ++i) {
+    const group& g = old_groups[i];
+    for (size_t j = 0; j < CONNECTION_TABLE_GROUP_SIZE; ++j) {
+      if (g.values[j] <= CONNECTION_TABLE_MAX_VALUE) {
+        connection_key key;
+        key.local_ip    = g.local_ips[j];
+        key.remote_ip   = g.remote_ips[j];
+        key.local_port  = g.ports[j] >> 16;
+        key.remote_port = g.ports[j] & 0xffff;
+        insert_unique(key, g.values[j], hash(key));
+      }
+    }
+  }
+}
+
+bool connection_table::insert(const connection_key& key, const uint32_t value) {
+  if (value > CONNECTION_TABLE_MAX_VALUE) {
+    throw std::invalid_argument("Invalid connection table value: " + std::to_string(value));
+  }
+  const uint64_t h = hash(key);
+  if (find_index(key, h) != capacity_) {
+    return false;
+  }
+  if ((size_ + tombstones_ + 1) * 8 > capacity_ * 7) {
+    // Grow only if live entries need it, otherwise just drop tombstones.
+    rehash((size_ + 1) * 2 > capacity_ ? capacity_ * 2 : capacity_);
+  }
+  insert_unique(key, value, h);
+  return true;
+}
+
+uint32_t connection_table::find(const connection_key& key) const {
+  const size_t index = find_index(key, hash(key));
+  if (index == capacity_) {
+    return CONNECTION_NOT_FOUND;
+  }
+  return groups_[index / CONNECTION_TABLE_GROUP_SIZE].values[index % CONNECTION_TABLE_GROUP_SIZE];
+}
+
+bool connection_table::erase(const connection_key& key) {
+  const size_t index = find_index(key, hash(key));
+  if (index == capacity_) {
+    return false;
+  }
+  group& g = groups_[index / CONNECTION_TABLE_GROUP_SIZE];
+  // NOTE
+  // If the group still has an empty slot, no probe has ever passed through it,
+  // so the slot can become empty again instead of a tombstone.
+  if (match_field(g.values, VALUE_EMPTY) != 0) {
+    g.values[index % CONNECTION_TABLE_GROUP_SIZE] = VALUE_EMPTY;
+  } else {
+    g.values[index % CONNECTION_TABLE_GROUP_SIZE] = VALUE_DELETED;
+    tombstones_++;
+  }
+  size_--;
+  return true;
+}
+
+void connection_table::prefetch(const connection_key& key) const {
+  const size_t num_groups = capacity_ / CONNECTION_TABLE_GROUP_SIZE;
+  __builtin_prefetch(&groups_[hash(key) & (num_groups - 1)]);
+}
+
+void connection_table::reserve(const size_t n) {
+  const size_t capacity = round_up_capacity(n);
+  if (capacity > capacity_) {
+    rehash(capacity);
+  }
+}
+
+size_t connection_table::size() const {
+  return size_;
+}
+
+size_t connection_table::capacity() const {
+  return capacity_;
+}
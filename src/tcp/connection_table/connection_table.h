@@ -0,0 +1,88 @@
+#ifndef CONNECTION_TABLE_H_
+#define CONNECTION_TABLE_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <memory>
+
+// NOTE
+// Identifies a connection.
+// (rfc 793 - 2.7. Connection Establishment and Clearing)
+//   A pair of sockets uniquely identifies each connection.
+//
+// Addresses are kept in network byte order (as they are in the ip header),
+// ports in host byte order.
+struct connection_key {
+  uint32_t local_ip;
+  uint32_t remote_ip;
+  uint16_t local_port;
+  uint16_t remote_port;
+};
+
+bool operator==(const connection_key& lhs, const connection_key& rhs);
+bool operator!=(const connection_key& lhs, const connection_key& rhs);
+
+connection_key make_connection_key(
+    const uint8_t *local_ip_bytes, const uint16_t local_port,
+    const uint8_t *remote_ip_bytes, const uint16_t remote_port);
+
+const uint32_t CONNECTION_NOT_FOUND = UINT32_MAX;
+// Largest value of a connection_table (the values above mark free slots).
+const uint32_t CONNECTION_TABLE_MAX_VALUE = UINT32_MAX - 2;
+const size_t CONNECTION_TABLE_GROUP_SIZE = 4;
+
+// NOTE
+// Open addressing hash table from connection_key to a 32 bit value (e.g. an index
+// of tcb_slab). Slots are kept in groups of 4, and each group is one 64 byte
+// cache line which holds everything a probe reads, field by field:
+//
+//   local_ips, remote_ips, ports : the keys of the 4 slots.
+//   values                       : their values. EMPTY and DELETED slots have
+//                                  one of the two values above
+//                                  CONNECTION_TABLE_MAX_VALUE.
+//
+// A key hashes to a group, and the groups after it are probed in turn. Each
+// field of the 4 keys is compared with the key at once (SSE2 when available),
+// so there is no need for the 7 bit tags of SwissTable, nor for an array of
+// control bytes apart from the entries. A hit reads one cache line (rarely
+// the next one too), and prefetch() fetches that line.
+class connection_table {
+ private:
+  struct alignas(64) group {
+    uint32_t local_ips[CONNECTION_TABLE_GROUP_SIZE];
+    uint32_t remote_ips[CONNECTION_TABLE_GROUP_SIZE];
+    uint32_t ports[CONNECTION_TABLE_GROUP_SIZE];  // local port << 16 | remote port
+    uint32_t values[CONNECTION_TABLE_GROUP_SIZE];
+  };
+  static_assert(sizeof(group) == 64, "a group must fill one cache line");
+  std::unique_ptr<group[]> groups_;
+  size_t capacity_;   // number of slots (a multiple of the group size)
+  size_t size_;
+  size_t tombstones_;
+  uint64_t seed_;
+
+  uint64_t hash(const connection_key& key) const;
+  size_t find_index(const connection_key& key, const uint64_t h) const;
+  void rehash(const size_t capacity);
+  void insert_unique(const connection_key& key, const uint32_t value, const uint64_t h);
+ public:
+  connection_table();
+  connection_table(const size_t capacity);
+  connection_table(const connection_table&) = delete;
+  connection_table& operator=(const connection_table&) = delete;
+  // Returns false if the key already exists.
+  // Throws std::invalid_argument if value is above CONNECTION_TABLE_MAX_VALUE.
+  bool insert(const connection_key& key, const uint32_t value);
+  // Returns CONNECTION_NOT_FOUND if the key does not exist.
+  uint32_t find(const connection_key& key) const;
+  // Returns false if the key does not exist.
+  bool erase(const connection_key& key);
+  // Prefetch the group which find(key) will read first.
+  void prefetch(const connection_key& key) const;
+  // Make room for at least n connections without rehashing.
+  void reserve(const size_t n);
+  size_t size() const;
+  size_t capacity() const;
+};
+
+#endif  // CONNECTION_TABLE_H_
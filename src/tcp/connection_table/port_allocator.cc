@@ -0,0 +1,101 @@
+#include <cstdint>  // for uint64_t
+#include <cstring>  // for std::memcpy(), std::memset()
+#include <random>
+#include <stdexcept>
+
+#include "port_allocator.h"
+
+namespace {
+// (rfc 6056 - 3.3.4.) TABLE_LENGTH
+const size_t TABLE_LENGTH = 1024;
+
+uint64_t rotl(const uint64_t x, const int b) {
+  return (x << b) | (x >> (64 - b));
+}
+
+void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+  v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+  v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+  v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+  v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+// SipHash-2-4 of a 16 byte message (see: Aumasson and Bernstein, "SipHash:
+// a fast short-input PRF", 2012).
+uint64_t siphash(const uint64_t key[2], const uint64_t m0, const uint64_t m1) {
+  uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+  // message blocks, and the last block with the message length
+  const uint64_t blocks[3] = {m0, m1, static_cast<uint64_t>(16) << 56};
+  for (const uint64_t m : blocks) {
+    v3 ^= m;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+  v2 ^= 0xff;
+  for (int i = 0; i < 4; ++i) {
+    sip_round(v0, v1, v2, v3);
+  }
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t hash_destination(
+    const uint64_t key[2], const uint8_t *local_ip_bytes, const uint8_t *remote_ip_bytes,
+    const uint16_t remote_port) {
+  uint32_t local_ip;
+  uint32_t remote_ip;
+  std::memcpy(&local_ip, local_ip_bytes, sizeof(local_ip));
+  std::memcpy(&remote_ip, remote_ip_bytes, sizeof(remote_ip));
+  return siphash(key, (static_cast<uint64_t>(local_ip) << 32) | remote_ip, remote_port);
+}
+
+uint64_t random64(std::random_device& rd) {
+  return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+} // namespace
+
+port_allocator::port_allocator()
+  : port_allocator(DEFAULT_EPHEMERAL_PORT_MIN, DEFAULT_EPHEMERAL_PORT_MAX) {}
+
+port_allocator::port_allocator(const uint16_t min, const uint16_t max)
+  : min_(min), max_(max), table_(TABLE_LENGTH) {
+  if (min == 0 || min > max) {
+    throw std::invalid_argument("Invalid ephemeral port range");
+  }
+  std::random_device rd;
+  offset_key_[0] = random64(rd);
+  offset_key_[1] = random64(rd);
+  index_key_[0]  = random64(rd);
+  index_key_[1]  = random64(rd);
+  for (uint16_t& next : table_) {
+    next = rd();
+  }
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+uint32_t port_allocator::offset(
+    const uint8_t *local_ip_bytes, const uint8_t *remote_ip_bytes,
+    const uint16_t remote_port) const {
+  return hash_destination(offset_key_, local_ip_bytes, remote_ip_bytes, remote_port);
+}
+
+size_t port_allocator::index(
+    const uint8_t *local_ip_bytes, const uint8_t *remote_ip_bytes,
+    const uint16_t remote_port) const {
+  return hash_destination(index_key_, local_ip_bytes, remote_ip_bytes, remote_port) % TABLE_LENGTH;
+}
+
+uint16_t port_allocator::get_min() const {
+  return min_;
+}
+
+uint16_t port_allocator::get_max() const {
+  return max_;
+}
+
+const port_allocator_stats& port_allocator::get_stats() const {
+  return stats_;
+}
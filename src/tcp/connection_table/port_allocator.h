@@ -0,0 +1,100 @@
+#ifndef PORT_ALLOCATOR_H_
+#define PORT_ALLOCATOR_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint16_t
+#include <vector>
+
+// (rfc 6335 - 6. Port Number Ranges) the Dynamic Ports, also known as the
+// Private or Ephemeral Ports, from 49152-65535.
+// Like Linux (net.ipv4.ip_local_port_range), a larger range is used by default.
+const uint16_t DEFAULT_EPHEMERAL_PORT_MIN = 32768;
+const uint16_t DEFAULT_EPHEMERAL_PORT_MAX = 60999;
+
+struct port_allocator_stats {
+  uint64_t allocations;  // ports allocated
+  uint64_t probes;       // candidate ports checked
+  uint64_t failures;     // allocations which found no free port
+};
+
+// NOTE
+// (rfc 6056 - 3.3.4. Algorithm 4: Double-Hash Port Selection Algorithm)
+//   /* Initialization at system boot time */
+//   for(i = 0; i < TABLE_LENGTH; i++)
+//       table[i] = random() % 65536;
+//
+//   /* Ephemeral port selection function */
+//   num_ephemeral = max_ephemeral - min_ephemeral + 1;
+//   offset = F(local_IP, remote_IP, remote_port, secret_key1);
+//   index = G(local_IP, remote_IP, remote_port, secret_key2);
+//   count = num_ephemeral;
+//
+//   do {
+//       port = min_ephemeral + (offset + table[index]) % num_ephemeral;
+//       table[index]++;
+//
+//       if(check_suitable_port(port))
+//           return port;
+//
+//       count--;
+//
+//   } while (count > 0);
+//
+//   return ERROR;
+//
+// Ports to different destinations are independent and unpredictable from
+// outside (F and G are SipHash-2-4 with random keys), while consecutive
+// connections to one destination walk the range in order, so that a port
+// is reused as late as possible (which keeps clear of TIME-WAIT).
+// A free port is usually found by the first probe.
+class port_allocator {
+ private:
+  uint16_t min_;
+  uint16_t max_;
+  uint64_t offset_key_[2];
+  uint64_t index_key_[2];
+  std::vector<uint16_t> table_;
+  port_allocator_stats stats_;
+
+  // F() and G() of the algorithm
+  uint32_t offset(const uint8_t *local_ip_bytes, const uint8_t *remote_ip_bytes,
+                  const uint16_t remote_port) const;
+  size_t index(const uint8_t *local_ip_bytes, const uint8_t *remote_ip_bytes,
+               const uint16_t remote_port) const;
+ public:
+  port_allocator();
+  // Ports are taken from [min, max].
+  port_allocator(const uint16_t min, const uint16_t max);
+  port_allocator(const port_allocator&) = delete;
+  port_allocator& operator=(const port_allocator&) = delete;
+  // Returns a local port for a connection to the remote address, or 0 if
+  // none is available.
+  //   suitable : bool(uint16_t port), returns true if the port can be used
+  //              (e.g. no connection and no TIME-WAIT on the 4-tuple)
+  template <typename Suitable>
+  uint16_t allocate(
+      const uint8_t *local_ip_bytes,
+      const uint8_t *remote_ip_bytes,
+      const uint16_t remote_port,
+      Suitable suitable) {
+    const uint32_t num_ephemeral = static_cast<uint32_t>(max_) - min_ + 1;
+    const uint32_t off = offset(local_ip_bytes, remote_ip_bytes, remote_port);
+    uint16_t& next = table_[index(local_ip_bytes, remote_ip_bytes, remote_port)];
+    for (uint32_t count = num_ephemeral; count > 0; --count) {
+      const uint16_t port = min_ + (off + next) % num_ephemeral;
+      next++;
+      stats_.probes++;
+      if (suitable(port)) {
+        stats_.allocations++;
+        return port;
+      }
+    }
+    stats_.failures++;
+    return 0;
+  }
+  uint16_t get_min() const;
+  uint16_t get_max() const;
+  const port_allocator_stats& get_stats() const;
+};
+
+#endif  // PORT_ALLOCATOR_H_
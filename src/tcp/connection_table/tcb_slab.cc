@@ -0,0 +1,75 @@
+#include <cstdint>  // for uint32_t
+#include <new>      // for placement new
+#include <stdexcept>
+#include <string>
+
+#include "tcb_slab.h"
+#include "transmission_control_block.h"
+
+tcb_slab::tcb_slab() {}
+
+tcb_slab::~tcb_slab() {
+  for (uint32_t index = 0; index < storage_.size(); ++index) {
+    if (live_[index]) {
+      block(index)->~transmission_control_block();
+    }
+  }
+}
+
+transmission_control_block *tcb_slab::block(const uint32_t index) {
+  return reinterpret_cast<transmission_control_block *>(storage_[index].bytes);
+}
+
+tcb_handle tcb_slab::create() {
+  uint32_t index;
+  if (!free_indexes_.empty()) {
+    index = free_indexes_.back();
+    free_indexes_.pop_back();
+  } else {
+    if (storage_.size() >= UINT32_MAX) {
+      throw std::runtime_error("Too many transmission control blocks");
+    }
+    index = storage_.size();
+    storage_.emplace_back();
+    generations_.push_back(0);
+    live_.push_back(false);
+  }
+  new (storage_[index].bytes) transmission_control_block();
+  live_[index] = true;
+  return tcb_handle{index, generations_[index]};
+}
+
+transmission_control_block *tcb_slab::get(const tcb_handle handle) {
+  if (handle.index >= storage_.size() ||
+      generations_[handle.index] != handle.generation ||
+      !live_[handle.index]) {
+    return nullptr;
+  }
+  return block(handle.index);
+}
+
+transmission_control_block& tcb_slab::at(const uint32_t index) {
+  if (index >= storage_.size() || !live_[index]) {
+    throw std::out_of_range("No transmission control block at " + std::to_string(index));
+  }
+  return *block(index);
+}
+
+tcb_handle tcb_slab::handle_of(const uint32_t index) const {
+  return tcb_handle{index, generations_.at(index)};
+}
+
+void tcb_slab::release(const tcb_handle handle) {
+  transmission_control_block *tcb = get(handle);
+  if (tcb == nullptr) {
+    return;
+  }
+  tcb->~transmission_control_block();
+  live_[handle.index] = false;
+  generations_[handle.index]++;
+  free_indexes_.push_back(handle.index);
+}
+
+size_t tcb_slab::size() const {
+  return storage_.size() - free_indexes_.size();
+}
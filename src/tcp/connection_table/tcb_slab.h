@@ -0,0 +1,54 @@
+#ifndef TCB_SLAB_H_
+#define TCB_SLAB_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+#include <deque>
+#include <vector>
+
+#include "transmission_control_block.h"
+
+// NOTE
+// Stable reference to a transmission_control_block in a tcb_slab.
+// The generation changes every time a slot is reused, so a handle kept by
+// e.g. a timer or the application does not refer to a newer connection.
+struct tcb_handle {
+  uint32_t index;
+  uint32_t generation;
+};
+
+// Storage of transmission control blocks. Blocks never move once created, so
+// pointers and handles stay valid until release().
+// Blocks (64 bytes each) are kept in a std::deque, i.e. in chunks found
+// through a map of chunk pointers (512 bytes, 8 blocks, per chunk with
+// libstdc++): the blocks of a chunk are contiguous, but the slab is not one
+// array, and at() reads the map before the block. Generations and liveness
+// are kept in separate arrays so that they do not pad the blocks.
+class tcb_slab {
+ private:
+  struct alignas(transmission_control_block) storage {
+    unsigned char bytes[sizeof(transmission_control_block)];
+  };
+  std::deque<storage> storage_;
+  std::vector<uint32_t> generations_;
+  std::vector<bool> live_;
+  std::vector<uint32_t> free_indexes_;
+
+  transmission_control_block *block(const uint32_t index);
+ public:
+  tcb_slab();
+  tcb_slab(const tcb_slab&) = delete;
+  tcb_slab& operator=(const tcb_slab&) = delete;
+  ~tcb_slab();
+  tcb_handle create();
+  // Returns nullptr if the handle is stale.
+  transmission_control_block *get(const tcb_handle handle);
+  // Returns the block at the index without generation check
+  // (e.g. for indexes stored in a connection_table).
+  transmission_control_block& at(const uint32_t index);
+  tcb_handle handle_of(const uint32_t index) const;
+  void release(const tcb_handle handle);
+  size_t size() const;
+};
+
+#endif  // TCB_SLAB_H_
@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdint>  // for uint32_t
+#include <cstring>  // for std::memset()
+#include <stdexcept>
+
+#include "connection_table.h"
+#include "time_wait_table.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// (see tcp_twsk_unique() of Linux) a new connection on the 4-tuple starts
+// beyond the largest window of the old one.
+const uint32_t REUSE_ISS_GAP = 65535 + 2;
+
+bool seq_lt(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+// Time comparison in milliseconds, modulo 2^32 (about 49 days).
+bool time_before(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+} // namespace
+
+time_wait_table::time_wait_table(const chrono::steady_clock::time_point now)
+  : start_(now) {
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+uint32_t time_wait_table::to_ms(const chrono::steady_clock::time_point t) const {
+  return chrono::duration_cast<chrono::milliseconds>(t - start_).count();
+}
+
+time_wait_table::entry *time_wait_table::find(const connection_key& key, const uint32_t now_ms) {
+  const uint32_t index = index_.find(key);
+  if (index == CONNECTION_NOT_FOUND) {
+    return nullptr;
+  }
+  entry& e = entries_[index];
+  if (!time_before(now_ms, e.expiry_ms)) {
+    // (its expiry record is skipped by expire(), as the entry is not live)
+    remove(index);
+    stats_.expired++;
+    return nullptr;
+  }
+  return &e;
+}
+
+void time_wait_table::remove(const uint32_t index) {
+  index_.erase(entries_[index].key);
+  entries_[index].live = false;
+  free_indexes_.push_back(index);
+}
+
+void time_wait_table::insert(
+    const connection_key& key,
+    const time_wait_entry& state,
+    const chrono::steady_clock::time_point now) {
+  expire(now);
+  const uint32_t now_ms = to_ms(now);
+  uint32_t index = index_.find(key);
+  if (index == CONNECTION_NOT_FOUND) {
+    if (!free_indexes_.empty()) {
+      index = free_indexes_.back();
+      free_indexes_.pop_back();
+    } else {
+      if (entries_.size() >= UINT32_MAX) {
+        throw std::runtime_error("Too many connections in TIME-WAIT");
+      }
+      index = entries_.size();
+      entries_.emplace_back();
+    }
+    index_.insert(key, index);
+  }
+  entry& e = entries_[index];
+  e.key        = key;
+  e.snd_nxt    = state.snd_nxt;
+  e.rcv_nxt    = state.rcv_nxt;
+  e.window     = state.window;
+  e.entered_ms = now_ms;
+  e.expiry_ms  = now_ms + chrono::duration_cast<chrono::milliseconds>(TIME_WAIT_DURATION).count();
+  e.live       = true;
+  expiry_queue_.push_back(expiry_record{index, e.expiry_ms});
+  stats_.entered++;
+}
+
+bool time_wait_table::contains(const connection_key& key, const chrono::steady_clock::time_point now) {
+  return find(key, to_ms(now)) != nullptr;
+}
+
+bool time_wait_table::on_segment(
+    const connection_key& key,
+    const bool fin,
+    const chrono::steady_clock::time_point now,
+    time_wait_entry& state,
+    bool& ack) {
+  const uint32_t now_ms = to_ms(now);
+  entry *e = find(key, now_ms);
+  if (e == nullptr) {
+    return false;
+  }
+  ack = fin;
+  if (fin) {
+    state.snd_nxt = e->snd_nxt;
+    state.rcv_nxt = e->rcv_nxt;
+    state.window  = e->window;
+    // restart the 2 MSL timeout (the old expiry record becomes stale)
+    e->expiry_ms = now_ms + chrono::duration_cast<chrono::milliseconds>(TIME_WAIT_DURATION).count();
+    expiry_queue_.push_back(expiry_record{static_cast<uint32_t>(e - entries_.data()), e->expiry_ms});
+    stats_.fin_acks++;
+  }
+  return true;
+}
+
+bool time_wait_table::reuse(
+    const connection_key& key,
+    const chrono::steady_clock::time_point now,
+    uint32_t& iss) {
+  const uint32_t now_ms = to_ms(now);
+  entry *e = find(key, now_ms);
+  if (e == nullptr) {
+    return true;
+  }
+  const uint32_t reuse_ms =
+    e->entered_ms + chrono::duration_cast<chrono::milliseconds>(TIME_WAIT_REUSE_DELAY).count();
+  if (time_before(now_ms, reuse_ms)) {
+    return false;
+  }
+  if (seq_lt(iss, e->snd_nxt + REUSE_ISS_GAP)) {
+    iss = e->snd_nxt + REUSE_ISS_GAP;
+  }
+  remove(e - entries_.data());
+  stats_.reused++;
+  return true;
+}
+
+void time_wait_table::expire(const chrono::steady_clock::time_point now) {
+  const uint32_t now_ms = to_ms(now);
+  while (!expiry_queue_.empty() && !time_before(now_ms, expiry_queue_.front().expiry_ms)) {
+    const expiry_record record = expiry_queue_.front();
+    expiry_queue_.pop_front();
+    const entry& e = entries_[record.index];
+    // skip records of entries restarted, reused or removed since
+    if (e.live && e.expiry_ms == record.expiry_ms) {
+      remove(record.index);
+      stats_.expired++;
+    }
+  }
+}
+
+size_t time_wait_table::size() const {
+  return index_.size();
+}
+
+const time_wait_stats& time_wait_table::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,130 @@
+#ifndef TIME_WAIT_TABLE_H_
+#define TIME_WAIT_TABLE_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+#include <deque>
+#include <vector>
+
+#include "connection_table.h"
+
+// (rfc 793 - 3.5. Closing a Connection) 2 MSL. Like Linux (TCP_TIMEWAIT_LEN),
+// an MSL of 30 seconds is assumed.
+const std::chrono::seconds TIME_WAIT_DURATION(60);
+// A 4-tuple in TIME-WAIT may be used by a new outgoing connection after this
+// long (like net.ipv4.tcp_tw_reuse).
+const std::chrono::seconds TIME_WAIT_REUSE_DELAY(1);
+
+struct time_wait_stats {
+  uint64_t entered;      // connections which entered TIME-WAIT
+  uint64_t expired;      // entries dropped after 2 MSL
+  uint64_t reused;       // entries taken over by a new connection
+  uint64_t fin_acks;     // retransmitted FINs acknowledged again
+};
+
+// State a connection in TIME-WAIT needs to acknowledge a retransmitted FIN.
+struct time_wait_entry {
+  uint32_t snd_nxt;
+  uint32_t rcv_nxt;
+  uint16_t window;
+};
+
+// NOTE
+// (rfc 793 - 3.9. Event Processing - SEGMENT ARRIVES)
+//   TIME-WAIT STATE
+//     The only thing that can arrive in this state is a
+//     retransmission of the remote FIN.  Acknowledge it, and restart
+//     the 2 MSL timeout.
+//
+// Connections in TIME-WAIT are kept here instead of in a transmission
+// control block: 32 bytes each, in a flat array indexed by a connection_table.
+// Entries expire in the order they were inserted, so expiry is a FIFO of
+// (index, expiry) pairs. Records made stale by a restart or reuse are skipped
+// when they reach the front.
+//
+// (rfc 1122 - 4.2.2.13 Closing a Connection)
+//   When a connection is closed actively, it MUST linger in
+//   TIME-WAIT state for a time 2xMSL (Maximum Segment Lifetime).
+//   However, it MAY accept a new SYN from the remote TCP to
+//   reopen the connection directly from TIME-WAIT state, if it:
+//
+//   (1)  assigns its initial sequence number for the new
+//        connection to be larger than the largest sequence
+//        number it used on the previous connection incarnation,
+//
+// The same rule makes reusing the 4-tuple for a new outgoing connection safe
+// enough: the new connection starts above the sequence space of the old one
+// (by a maximum window, like Linux), so no old segment is acceptable to
+// either side. Linux also requires the TCP timestamps option (rfc 7323) to
+// reject old duplicates by PAWS; it is not implemented here, so the 4-tuple
+// is only reused after TIME_WAIT_REUSE_DELAY, by which the segments of the
+// old connection in flight on a local network are gone.
+class time_wait_table {
+ private:
+  struct entry {
+    connection_key key;
+    uint32_t snd_nxt;
+    uint32_t rcv_nxt;
+    // milliseconds from start_
+    uint32_t entered_ms;
+    uint32_t expiry_ms;
+    uint16_t window;
+    bool live;
+  };
+  static_assert(sizeof(entry) == 32, "entry of time_wait_table is expected to be 32 bytes");
+  struct expiry_record {
+    uint32_t index;
+    uint32_t expiry_ms;
+  };
+  std::chrono::steady_clock::time_point start_;
+  connection_table index_;
+  std::vector<entry> entries_;
+  std::vector<uint32_t> free_indexes_;
+  std::deque<expiry_record> expiry_queue_;
+  time_wait_stats stats_;
+
+  uint32_t to_ms(const std::chrono::steady_clock::time_point t) const;
+  // Returns nullptr if the connection is not in TIME-WAIT. An entry whose
+  // 2 MSL has passed is dropped here if expire() has not dropped it yet.
+  entry *find(const connection_key& key, const uint32_t now_ms);
+  void remove(const uint32_t index);
+ public:
+  // now : current time of the clock the table is given (e.g. tcp_clock_now())
+  explicit time_wait_table(const std::chrono::steady_clock::time_point now);
+  time_wait_table(const time_wait_table&) = delete;
+  time_wait_table& operator=(const time_wait_table&) = delete;
+  // Record a connection which entered TIME-WAIT.
+  void insert(
+      const connection_key& key,
+      const time_wait_entry& state,
+      const std::chrono::steady_clock::time_point now);
+  // Returns true if the connection is in TIME-WAIT.
+  bool contains(const connection_key& key, const std::chrono::steady_clock::time_point now);
+  // Handle a segment for the connection. Returns false if the connection is
+  // not in TIME-WAIT. Otherwise, if the segment is a (retransmitted) FIN,
+  // state is set to what the ACK should carry and ack is set to true, and
+  // the 2 MSL timeout is restarted.
+  // Other segments (including RST, see rfc 1337) are ignored.
+  bool on_segment(
+      const connection_key& key,
+      const bool fin,
+      const std::chrono::steady_clock::time_point now,
+      time_wait_entry& state,
+      bool& ack);
+  // Take the 4-tuple for a new outgoing connection. Returns false if the
+  // 4-tuple is in TIME-WAIT and may not be reused yet.
+  //   iss : initial send sequence number chosen for the new connection, which
+  //         is raised above the sequence space of the old connection if needed
+  bool reuse(
+      const connection_key& key,
+      const std::chrono::steady_clock::time_point now,
+      uint32_t& iss);
+  // Drop the entries whose 2 MSL has passed. Call it periodically (e.g. from
+  // a timer), as insert() is the only other caller.
+  void expire(const std::chrono::steady_clock::time_point now);
+  size_t size() const;
+  const time_wait_stats& get_stats() const;
+};
+
+#endif  // TIME_WAIT_TABLE_H_
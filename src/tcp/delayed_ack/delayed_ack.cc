@@ -0,0 +1,97 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+
+#include "delayed_ack.h"
+
+namespace {
+uint8_t quick_ack_limit(const delayed_ack_policy& policy) {
+  return std::min<uint32_t>(policy.quick_ack_segments, UINT8_MAX);
+}
+} // namespace
+
+delayed_ack::delayed_ack(const delayed_ack_policy& policy)
+  : unacked_bytes_(0), unacked_segments_(0),
+    quick_ack_remaining_(quick_ack_limit(policy)),
+    ack_now_(false), quick_ack_now_(false), in_burst_(false) {}
+
+void delayed_ack::apply_policy(const delayed_ack_policy& policy) {
+  quick_ack_remaining_ = std::min(quick_ack_remaining_, quick_ack_limit(policy));
+}
+
+void delayed_ack::enter_quick_ack(const delayed_ack_policy& policy) {
+  quick_ack_remaining_ = quick_ack_limit(policy);
+}
+
+void delayed_ack::begin_burst() {
+  in_burst_ = true;
+}
+
+void delayed_ack::end_burst() {
+  in_burst_ = false;
+}
+
+void delayed_ack::on_segment_received(
+    const delayed_ack_policy& policy,
+    delayed_ack_stats& stats,
+    const uint32_t seg_len,
+    const uint32_t mss,
+    const bool immediate,
+    const std::chrono::steady_clock::time_point now) {
+  stats.segments_received++;
+  if (unacked_segments_ == 0) {
+    // The timer starts at the arrival of the first unacknowledged segment.
+    deadline_ = now + policy.timeout;
+  }
+  if (unacked_segments_ < UINT16_MAX) {
+    unacked_segments_++;
+  }
+  unacked_bytes_ += seg_len;
+
+  if (!policy.enabled || immediate) {
+    ack_now_ = true;
+  } else if (quick_ack_remaining_ > 0) {
+    ack_now_ = true;
+    quick_ack_now_ = true;
+  } else if (unacked_bytes_ >= policy.max_unacked_segments * mss) {
+    ack_now_ = true;
+  } else {
+    stats.acks_delayed++;
+  }
+}
+
+bool delayed_ack::ack_due(const std::chrono::steady_clock::time_point now) const {
+  if (unacked_segments_ == 0 || in_burst_) {
+    return false;
+  }
+  return ack_now_ || now >= deadline_;
+}
+
+bool delayed_ack::ack_pending() const {
+  return unacked_segments_ != 0;
+}
+
+std::chrono::steady_clock::time_point delayed_ack::get_deadline() const {
+  return deadline_;
+}
+
+void delayed_ack::on_ack_sent(
+    delayed_ack_stats& stats, const std::chrono::steady_clock::time_point now) {
+  stats.acks_sent++;
+  if (unacked_segments_ == 0) {
+    return;
+  }
+  if (quick_ack_now_) {
+    stats.quick_acks++;
+    if (quick_ack_remaining_ > 0) {
+      quick_ack_remaining_--;
+    }
+  } else if (!ack_now_ && now >= deadline_) {
+    stats.timeout_acks++;
+  }
+  stats.acks_coalesced += unacked_segments_ - 1;
+
+  unacked_segments_ = 0;
+  unacked_bytes_    = 0;
+  ack_now_          = false;
+  quick_ack_now_    = false;
+}
@@ -0,0 +1,102 @@
+#ifndef DELAYED_ACK_H_
+#define DELAYED_ACK_H_
+
+#include <chrono>
+#include <cstdint>  // for uint32_t
+
+// NOTE
+// (rfc 1122 - 4.2.3.2 When to Send an ACK Segment)
+//   A host that is receiving a stream of TCP data segments can
+//   increase efficiency in both the Internet and the hosts by
+//   sending fewer than one ACK (acknowledgment) segment per data
+//   segment received; this is known as a "delayed ACK".
+//   ...
+//   in a stream of full-sized segments there SHOULD be an ACK for
+//   at least every second segment.
+//
+// (rfc 5681 - 4.2. Generating Acknowledgments)
+//   an ACK SHOULD be generated for at least every second full-sized
+//   segment, and MUST be generated within 500 ms of the arrival of the
+//   first unacknowledged packet.
+//   ...
+//   A TCP receiver SHOULD send an immediate duplicate ACK when an out-
+//   of-order segment arrives.
+struct delayed_ack_policy {
+  // false means that every segment is acknowledged immediately.
+  bool enabled;
+  // An ACK is sent as soon as this many full-sized segments worth of bytes are unacknowledged.
+  uint32_t max_unacked_segments;
+  // An ACK is sent at latest this long after the first unacknowledged segment arrived.
+  std::chrono::milliseconds timeout;
+  // Number of segments acknowledged immediately after the connection is established
+  // or after an out-of-order segment, so that the sender's slow start is not slowed down.
+  // (at most 255)
+  uint32_t quick_ack_segments;
+};
+
+const delayed_ack_policy DEFAULT_DELAYED_ACK_POLICY = {
+  true,                         // enabled
+  2,                            // max_unacked_segments
+  std::chrono::milliseconds(40),  // timeout
+  16,                           // quick_ack_segments
+};
+
+struct delayed_ack_stats {
+  uint64_t segments_received;  // segments which require acknowledgment
+  uint64_t acks_sent;          // ACKs sent (standalone or piggybacked)
+  uint64_t acks_delayed;       // segments whose ACK was not sent immediately
+  uint64_t acks_coalesced;     // segments covered by an ACK of a later segment
+  uint64_t quick_acks;         // ACKs sent immediately in quick-ack mode
+  uint64_t timeout_acks;       // ACKs sent because the delayed ACK timer expired
+};
+
+// NOTE
+// Only the per-segment state is kept here (16 bytes), so that it fits in the hot
+// part of the transmission control block. The policy and the statistics are kept
+// by the owner and passed to each call.
+class delayed_ack {
+ private:
+  std::chrono::steady_clock::time_point deadline_;
+  // bytes and segments received since the last ACK
+  uint32_t unacked_bytes_;
+  uint16_t unacked_segments_;
+  uint8_t  quick_ack_remaining_;
+  // true if the next ACK must not be delayed any more
+  bool ack_now_ : 1;
+  // true if the ack_now_ decision was made by quick-ack mode
+  bool quick_ack_now_ : 1;
+  // true while a burst of received segments is being processed
+  bool in_burst_ : 1;
+ public:
+  delayed_ack(const delayed_ack_policy& policy);
+  // Must be called when the policy of the owner is changed.
+  void apply_policy(const delayed_ack_policy& policy);
+  // Re-enter quick-ack mode (e.g. on connection establishment).
+  void enter_quick_ack(const delayed_ack_policy& policy);
+  // Segments received between begin_burst() and end_burst() are acknowledged
+  // by (at most) one ACK, which becomes due after end_burst().
+  void begin_burst();
+  void end_burst();
+  // Record a received segment that occupies sequence space.
+  //   seg_len     : payload length of the segment
+  //   mss         : current receive MSS estimation (used to detect full-sized segments)
+  //   immediate   : true if the segment must be acknowledged immediately
+  //                 (e.g. SYN, FIN or out-of-order segment)
+  void on_segment_received(
+      const delayed_ack_policy& policy,
+      delayed_ack_stats& stats,
+      const uint32_t seg_len,
+      const uint32_t mss,
+      const bool immediate,
+      const std::chrono::steady_clock::time_point now);
+  // Returns true if an ACK should be sent at the given time.
+  bool ack_due(const std::chrono::steady_clock::time_point now) const;
+  // Returns true if there is any received segment which is not acknowledged yet.
+  bool ack_pending() const;
+  // Time by which the pending ACK must be sent.
+  std::chrono::steady_clock::time_point get_deadline() const;
+  // Must be called whenever a segment with ACK flag is sent.
+  void on_ack_sent(delayed_ack_stats& stats, const std::chrono::steady_clock::time_point now);
+};
+
+#endif  // DELAYED_ACK_H_
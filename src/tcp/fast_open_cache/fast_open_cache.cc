@@ -0,0 +1,130 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+#include <cstring>    // for std::memcpy(), std::memset()
+#include <stdexcept>
+#include <vector>
+
+#include "fast_open_cache.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// (see tcp_fastopen_cookie_check() of Linux) SYN data is held back for
+// 60 seconds << losses after the second consecutive loss.
+const chrono::seconds SYN_LOSS_HOLD_TIME(60);
+const uint8_t MIN_SYN_LOSSES_TO_HOLD = 2;
+const uint8_t MAX_SYN_LOSS_SHIFT = 10;
+
+uint32_t make_key(const uint8_t *ip_bytes) {
+  uint32_t key;
+  std::memcpy(&key, ip_bytes, sizeof(key));
+  return key;
+}
+} // namespace
+
+fast_open_cache::fast_open_cache()
+  : fast_open_cache(DEFAULT_FAST_OPEN_CACHE_CAPACITY) {}
+
+fast_open_cache::fast_open_cache(const size_t capacity)
+  : capacity_(capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("Capacity of fast open cache must not be 0");
+  }
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+fast_open_cache::entry *fast_open_cache::find(const uint8_t *ip_bytes) {
+  const auto it = index_.find(make_key(ip_bytes));
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  // move to the front (most recently used)
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &*it->second;
+}
+
+bool fast_open_cache::lookup(
+    const uint8_t *ip_bytes,
+    const chrono::steady_clock::time_point now,
+    std::vector<uint8_t>& cookie,
+    uint16_t& mss) {
+  stats_.lookups++;
+  cookie.clear();
+  mss = 0;
+  const entry *e = find(ip_bytes);
+  if (e == nullptr) {
+    return false;
+  }
+  cookie.assign(e->cookie, e->cookie + e->cookie_len);
+  mss = e->mss;
+  if (e->syn_losses >= MIN_SYN_LOSSES_TO_HOLD &&
+      now < e->last_syn_loss + SYN_LOSS_HOLD_TIME * (1 << std::min(e->syn_losses, MAX_SYN_LOSS_SHIFT))) {
+    stats_.loss_holds++;
+    return false;
+  }
+  if (e->cookie_len == 0) {
+    return false;
+  }
+  stats_.hits++;
+  return true;
+}
+
+void fast_open_cache::update(
+    const uint8_t *ip_bytes,
+    const uint16_t mss,
+    const std::vector<uint8_t>& cookie,
+    const bool syn_lost,
+    const chrono::steady_clock::time_point now) {
+  if (cookie.size() > sizeof(entry::cookie)) {
+    throw std::invalid_argument("Fast open cookie is too long");
+  }
+  stats_.updates++;
+  entry *e = find(ip_bytes);
+  if (e == nullptr) {
+    if (entries_.size() >= capacity_) {
+      index_.erase(entries_.back().ip);
+      entries_.pop_back();
+      stats_.evictions++;
+    }
+    entries_.push_front(entry{});
+    e = &entries_.front();
+    e->ip = make_key(ip_bytes);
+    index_.emplace(e->ip, entries_.begin());
+  }
+  if (mss != 0) {
+    e->mss = mss;
+  }
+  if (!cookie.empty()) {
+    std::memcpy(e->cookie, cookie.data(), cookie.size());
+    e->cookie_len = cookie.size();
+  }
+  if (syn_lost) {
+    if (e->syn_losses < UINT8_MAX) {
+      e->syn_losses++;
+    }
+    e->last_syn_loss = now;
+  } else {
+    e->syn_losses = 0;
+  }
+}
+
+void fast_open_cache::erase(const uint8_t *ip_bytes) {
+  const auto it = index_.find(make_key(ip_bytes));
+  if (it == index_.end()) {
+    return;
+  }
+  entries_.erase(it->second);
+  index_.erase(it);
+}
+
+size_t fast_open_cache::size() const {
+  return entries_.size();
+}
+
+size_t fast_open_cache::capacity() const {
+  return capacity_;
+}
+
+const fast_open_cache_stats& fast_open_cache::get_stats() const {
+  return stats_;
+}
@@ -0,0 +1,95 @@
+#ifndef FAST_OPEN_CACHE_H_
+#define FAST_OPEN_CACHE_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+const size_t DEFAULT_FAST_OPEN_CACHE_CAPACITY = 1024;
+
+struct fast_open_cache_stats {
+  uint64_t lookups;       // lookup() calls
+  uint64_t hits;          // lookups which allowed data in SYN
+  uint64_t loss_holds;    // lookups refused because SYNs with data were lost recently
+  uint64_t updates;       // update() calls
+  uint64_t evictions;     // servers dropped to keep the cache bounded
+};
+
+// NOTE
+// (rfc 7413 - 4.1. Fast Open Cookie)
+//   The client caches cookies from servers for later Fast Open connections.
+//   ...
+// (rfc 7413 - 4.1.3. Client Cookie Handling)
+//   The client MUST cache cookies from servers for later Fast Open
+//   connections.  For a multihomed client, the cookies are dependent on
+//   the client and server IP addresses.  Hence, the client should cache
+//   at most one (most recently received) cookie per client and server IP
+//   address pair.
+//
+//   When caching cookies, we recommend that the client also cache the
+//   Maximum Segment Size (MSS) advertised by the server.
+//   ...
+//   the client should cache negative responses from the server in order to
+//   avoid potential connection failures.
+//
+// One entry per server IP (the client has one address). The least recently
+// used entry is dropped when the table is full. Like Linux, data is not sent
+// in SYN for a while after SYNs with data to the server were lost (the
+// middlebox or the server may drop them): the hold time doubles with every
+// loss, from 60 seconds << 2.
+class fast_open_cache {
+ private:
+  struct entry {
+    // server IP (network byte order)
+    uint32_t ip;
+    uint8_t cookie[16];
+    // 0 if no cookie is cached
+    uint8_t cookie_len;
+    // consecutive handshakes whose SYN with data was lost
+    uint8_t syn_losses;
+    // MSS of the server (0 if unknown)
+    uint16_t mss;
+    std::chrono::steady_clock::time_point last_syn_loss;
+  };
+  size_t capacity_;
+  // most recently used first
+  std::list<entry> entries_;
+  std::unordered_map<uint32_t, std::list<entry>::iterator> index_;
+  fast_open_cache_stats stats_;
+
+  // Returns nullptr if the server is not cached.
+  entry *find(const uint8_t *ip_bytes);
+ public:
+  fast_open_cache();
+  fast_open_cache(const size_t capacity);
+  fast_open_cache(const fast_open_cache&) = delete;
+  fast_open_cache& operator=(const fast_open_cache&) = delete;
+  // Returns true if data may be sent in SYN to the server.
+  //   cookie : the cached cookie (empty if none: a cookie should be requested)
+  //   mss    : the cached MSS of the server (0 if unknown)
+  bool lookup(
+      const uint8_t *ip_bytes,
+      const std::chrono::steady_clock::time_point now,
+      std::vector<uint8_t>& cookie,
+      uint16_t& mss);
+  // Record the result of a handshake in which Fast Open was used.
+  //   mss      : MSS option of SYN-ACK (0 if none)
+  //   cookie   : cookie of SYN-ACK (empty keeps the cached cookie)
+  //   syn_lost : true if SYN with data had to be retransmitted and the data
+  //              was not acknowledged
+  void update(
+      const uint8_t *ip_bytes,
+      const uint16_t mss,
+      const std::vector<uint8_t>& cookie,
+      const bool syn_lost,
+      const std::chrono::steady_clock::time_point now);
+  void erase(const uint8_t *ip_bytes);
+  size_t size() const;
+  size_t capacity() const;
+  const fast_open_cache_stats& get_stats() const;
+};
+
+#endif  // FAST_OPEN_CACHE_H_
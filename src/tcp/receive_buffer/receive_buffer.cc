@@ -0,0 +1,92 @@
+#include <stdexcept>
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+#include "receive_buffer.h"
+
+receive_buffer::receive_buffer(buffer_pool& pool)
+  : pool_(&pool), ring_(nullptr), capacity_(pool.get_ring_size()) {}
+
+receive_buffer::~receive_buffer() {
+  if (owns_ring()) {
+    delete ring_;
+    ring_ = nullptr;
+  }
+  release_ring();
+}
+
+bool receive_buffer::owns_ring() const {
+  return capacity_ > pool_->get_ring_size();
+}
+
+void receive_buffer::release_ring() {
+  if (ring_ != nullptr && !owns_ring()) {
+    pool_->release(ring_);
+    ring_ = nullptr;
+  }
+}
+
+size_t receive_buffer::write(const uint8_t *data, const size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  if (ring_ == nullptr) {
+    ring_ = owns_ring() ? new byte_ring(capacity_) : pool_->acquire();
+  }
+  return ring_->write(data, size);
+}
+
+byte_range receive_buffer::peek() const {
+  if (ring_ == nullptr) {
+    return byte_range{nullptr, 0};
+  }
+  return ring_->peek(0, ring_->size());
+}
+
+void receive_buffer::consume(const size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (ring_ == nullptr) {
+    throw std::out_of_range("Receive buffer is empty");
+  }
+  ring_->consume(size);
+  if (ring_->empty()) {
+    release_ring();
+  }
+}
+
+size_t receive_buffer::size() const {
+  return ring_ == nullptr ? 0 : ring_->size();
+}
+
+size_t receive_buffer::available() const {
+  return ring_ == nullptr ? capacity_ : ring_->available();
+}
+
+void receive_buffer::set_capacity(const size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  byte_ring *ring = new byte_ring(capacity);
+  if (ring_ != nullptr) {
+    const byte_range buffered = ring_->peek(0, ring_->size());
+    ring->write(buffered.data, buffered.size);
+    if (owns_ring()) {
+      delete ring_;
+    } else {
+      pool_->release(ring_);
+    }
+  }
+  ring_ = ring;
+  // The ring may be larger than requested (rounded up to pages).
+  capacity_ = ring->capacity();
+}
+
+size_t receive_buffer::get_capacity() const {
+  return capacity_;
+}
+
+size_t receive_buffer::get_memory_footprint() const {
+  return ring_ == nullptr ? 0 : ring_->capacity();
+}
@@ -0,0 +1,51 @@
+#ifndef RECEIVE_BUFFER_H_
+#define RECEIVE_BUFFER_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+
+// NOTE
+// In-order data received from the peer and not read by the application yet.
+// Data is kept in a byte_ring taken from a buffer_pool, which is given back
+// once everything has been read.
+//
+// The capacity starts at the ring size of the pool and can be grown (receive
+// buffer auto-tuning). A buffer larger than the pool rings has a ring of its
+// own, which is kept until the buffer is destroyed because a fast connection
+// empties and refills it all the time.
+class receive_buffer {
+ private:
+  buffer_pool *pool_;
+  // nullptr while nothing is buffered
+  byte_ring *ring_;
+  size_t capacity_;
+
+  bool owns_ring() const;
+  void release_ring();
+ public:
+  receive_buffer(buffer_pool& pool);
+  receive_buffer(const receive_buffer&) = delete;
+  receive_buffer& operator=(const receive_buffer&) = delete;
+  ~receive_buffer();
+  // Append up to the free space and return the number of appended bytes.
+  size_t write(const uint8_t *data, const size_t size);
+  // Returns all readable bytes without copying. The range stays valid until
+  // consume() or set_capacity().
+  byte_range peek() const;
+  // Drop size bytes read by the application.
+  void consume(const size_t size);
+  size_t size() const;
+  // Bytes which can be received without exceeding the buffer.
+  size_t available() const;
+  // Grow the buffer to at least capacity bytes (it never shrinks).
+  // Buffered data is moved to the new ring.
+  void set_capacity(const size_t capacity);
+  size_t get_capacity() const;
+  // Memory held by the buffer (the ring while data is buffered).
+  size_t get_memory_footprint() const;
+};
+
+#endif  // RECEIVE_BUFFER_H_
@@ -0,0 +1,154 @@
+#include <algorithm>  // for std::min(), std::max()
+#include <chrono>
+
+#include "receive_window.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// (rfc 7323 - 2.3. Using the Window Scale Option)
+const uint8_t MAX_WINDOW_SCALE = 14;
+
+bool seq_lt(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+} // namespace
+
+receive_window::receive_window()
+  : rtt_(chrono::steady_clock::duration::zero()),
+    space_(0), copied_(0),
+    right_edge_(0), rtt_seq_(0), scale_(0),
+    advertised_(false), rtt_measuring_(false) {}
+
+uint8_t receive_window::scale_for(const size_t max_buffer_size) {
+  uint8_t scale = 0;
+  while (scale < MAX_WINDOW_SCALE &&
+         (static_cast<size_t>(UINT16_MAX) << scale) < max_buffer_size) {
+    scale++;
+  }
+  return scale;
+}
+
+void receive_window::set_scale(const uint8_t scale) {
+  scale_ = std::min(scale, MAX_WINDOW_SCALE);
+}
+
+uint8_t receive_window::get_scale() const {
+  return scale_;
+}
+
+size_t receive_window::get_max_window() const {
+  return static_cast<size_t>(UINT16_MAX) << scale_;
+}
+
+uint32_t receive_window::get_window(const uint32_t rcv_nxt) const {
+  if (!advertised_ || !seq_lt(rcv_nxt, right_edge_)) {
+    return 0;
+  }
+  return right_edge_ - rcv_nxt;
+}
+
+uint16_t receive_window::select(
+    const uint32_t rcv_nxt,
+    const size_t free_space,
+    const size_t buffer_size,
+    const uint32_t mss) const {
+  const uint32_t free = std::min(free_space, get_max_window());
+  const uint32_t current = get_window(rcv_nxt);
+  uint32_t window = current;
+  // receiver side SWS avoidance (rfc 1122 - 4.2.3.3)
+  if (!advertised_ ||
+      (free > current && free - current >= std::min<size_t>(buffer_size / 2, mss))) {
+    window = free;
+  }
+  // NOTE
+  // The window is rounded down, so the advertised right edge may be up to
+  // 2^scale - 1 bytes left of the previous one. It is not retracted: the
+  // previous edge is still honored (see on_advertised()), and rounding up
+  // instead would let the edge creep beyond the buffer one ACK at a time.
+  return std::min<uint32_t>(window >> scale_, UINT16_MAX);
+}
+
+void receive_window::on_advertised(
+    receive_window_stats& stats, const uint32_t rcv_nxt, const uint16_t window) {
+  const uint32_t right_edge = rcv_nxt + (static_cast<uint32_t>(window) << scale_);
+  if (!advertised_ || seq_lt(right_edge_, right_edge)) {
+    right_edge_ = right_edge;
+  }
+  advertised_ = true;
+  if (window == 0) {
+    stats.zero_windows++;
+  }
+}
+
+bool receive_window::update_due(
+    const uint32_t rcv_nxt,
+    const size_t free_space,
+    const size_t buffer_size,
+    const uint32_t mss) const {
+  // NOTE Like Linux's tcp_cleanup_rbuf()
+  const uint32_t current = get_window(rcv_nxt);
+  if (2 * static_cast<size_t>(current) > std::min(buffer_size, get_max_window())) {
+    return false;
+  }
+  const uint32_t window = static_cast<uint32_t>(select(rcv_nxt, free_space, buffer_size, mss)) << scale_;
+  return window != 0 && window >= 2 * current;
+}
+
+void receive_window::on_data_received(
+    const uint32_t rcv_nxt, const chrono::steady_clock::time_point now) {
+  if (rtt_measuring_ && seq_lt(rcv_nxt, rtt_seq_)) {
+    return;
+  }
+  if (rtt_measuring_) {
+    // A whole window has been received. The window limits the sender only
+    // if it is smaller than the bandwidth-delay product, so the shortest
+    // sample is the closest to the round trip time.
+    const chrono::steady_clock::duration sample = now - rtt_time_;
+    if (rtt_ == chrono::steady_clock::duration::zero() || sample < rtt_) {
+      rtt_ = std::max<chrono::steady_clock::duration>(sample, chrono::microseconds(1));
+    }
+  }
+  rtt_measuring_ = get_window(rcv_nxt) != 0;
+  rtt_seq_ = right_edge_;
+  rtt_time_ = now;
+}
+
+size_t receive_window::on_data_consumed(
+    const receive_window_policy& policy,
+    receive_window_stats& stats,
+    const size_t size,
+    const size_t buffer_size,
+    const chrono::steady_clock::time_point now) {
+  if (!policy.autotuning) {
+    return 0;
+  }
+  copied_ += size;
+  if (rtt_ == chrono::steady_clock::duration::zero()) {
+    return 0;
+  }
+  if (space_time_ == chrono::steady_clock::time_point()) {
+    space_time_ = now;
+  }
+  if (now - space_time_ < rtt_) {
+    return 0;
+  }
+  size_t wanted = 0;
+  if (copied_ > space_) {
+    space_ = copied_;
+    const size_t limit = std::min(policy.max_buffer_size, get_max_window());
+    wanted = std::min(2 * copied_, limit);
+    if (wanted > buffer_size) {
+      stats.buffer_grows++;
+    } else {
+      wanted = 0;
+    }
+  }
+  copied_ = 0;
+  space_time_ = now;
+  return wanted;
+}
+
+chrono::steady_clock::duration receive_window::get_rtt() const {
+  return rtt_;
+}
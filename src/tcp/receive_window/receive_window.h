@@ -0,0 +1,109 @@
+#ifndef RECEIVE_WINDOW_H_
+#define RECEIVE_WINDOW_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+
+struct receive_window_policy {
+  // true grows the receive buffer to what the application reads per round trip
+  bool autotuning;
+  // The receive buffer is not grown beyond this (like net.ipv4.tcp_rmem[2]).
+  size_t max_buffer_size;
+};
+
+const receive_window_policy DEFAULT_RECEIVE_WINDOW_POLICY = {
+  true,             // autotuning
+  4 * 1024 * 1024,  // max_buffer_size
+};
+
+struct receive_window_stats {
+  uint64_t zero_windows;  // ACKs advertising a zero window
+  uint64_t buffer_grows;  // times auto-tuning asked for a larger buffer
+};
+
+// NOTE
+// Window advertised to the peer.
+//
+// (rfc 1122 - 4.2.3.3 When to Send a Window Update)
+//   The suggested SWS avoidance algorithm for the receiver is to keep
+//   RCV.NXT+RCV.WND fixed until the reduction satisfies:
+//
+//     RCV.BUFF - RCV.USER - RCV.WND  >=
+//            min( Fr * RCV.BUFF, Eff.snd.MSS )
+//
+//   where Fr is a fraction whose recommended value is 1/2
+//
+// (rfc 7323 - 2.4. Addressing Window Retraction)
+//   the receiver MUST honor, as in window, any segment that would have been
+//   in window for any <ACK> sent by the receiver.
+//
+// The right edge never moves left. Scaled windows are rounded down, and
+// segments up to the largest edge advertised so far are still accepted.
+//
+// Receive buffer auto-tuning (dynamic right-sizing, like Linux's
+// tcp_rcv_space_adjust()): the round trip time is estimated as the time to
+// receive one advertised window of data, and the buffer is grown to twice
+// the bytes the application read in the last round trip, so that the window
+// does not limit a sender whose window is growing.
+class receive_window {
+ private:
+  std::chrono::steady_clock::time_point rtt_time_;
+  std::chrono::steady_clock::time_point space_time_;
+  std::chrono::steady_clock::duration rtt_;
+  // bytes read by the application in the last round trip
+  size_t space_;
+  // bytes read by the application since space_time_
+  size_t copied_;
+  // RCV.NXT + RCV.WND of the latest advertisement
+  uint32_t right_edge_;
+  // The round trip ends when RCV.NXT reaches rtt_seq_.
+  uint32_t rtt_seq_;
+  // shift applied to the windows advertised after SYN (0 if not negotiated)
+  uint8_t scale_;
+  bool advertised_ : 1;
+  bool rtt_measuring_ : 1;
+ public:
+  receive_window();
+  // Smallest shift which allows advertising max_buffer_size bytes.
+  static uint8_t scale_for(const size_t max_buffer_size);
+  void set_scale(const uint8_t scale);
+  uint8_t get_scale() const;
+  // Largest window which can be advertised.
+  size_t get_max_window() const;
+  // Window field for the next segment.
+  //   rcv_nxt     : RCV.NXT
+  //   free_space  : bytes the receive buffer can take
+  //   buffer_size : capacity of the receive buffer
+  //   mss         : estimation of the sender's MSS
+  uint16_t select(
+      const uint32_t rcv_nxt,
+      const size_t free_space,
+      const size_t buffer_size,
+      const uint32_t mss) const;
+  // Must be called whenever the window field is sent (with ACK).
+  void on_advertised(receive_window_stats& stats, const uint32_t rcv_nxt, const uint16_t window);
+  // Window left of the latest advertisement.
+  uint32_t get_window(const uint32_t rcv_nxt) const;
+  // Returns true if a window update should be sent without waiting for data:
+  // the advertised window is small and the buffer has room for twice as much.
+  bool update_due(
+      const uint32_t rcv_nxt,
+      const size_t free_space,
+      const size_t buffer_size,
+      const uint32_t mss) const;
+  // Called when in-order data is received (RCV.NXT advanced).
+  void on_data_received(const uint32_t rcv_nxt, const std::chrono::steady_clock::time_point now);
+  // Called when the application reads data. Returns the buffer size wanted
+  // by auto-tuning, or 0 if the buffer need not grow.
+  size_t on_data_consumed(
+      const receive_window_policy& policy,
+      receive_window_stats& stats,
+      const size_t size,
+      const size_t buffer_size,
+      const std::chrono::steady_clock::time_point now);
+  // Estimated round trip time (0 until measured).
+  std::chrono::steady_clock::duration get_rtt() const;
+};
+
+#endif  // RECEIVE_WINDOW_H_
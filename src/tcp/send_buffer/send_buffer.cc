@@ -0,0 +1,215 @@
+#include <algorithm>  // for std::min()
+#include <cstring>    // for std::memset()
+#include <stdexcept>
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+#include "send_buffer.h"
+
+send_buffer::send_buffer(const uint32_t mss, buffer_pool& pool)
+  : pool_(&pool), ring_(nullptr), capacity_(pool.get_ring_size()), unacked_(0),
+    mss_(mss), offload_size_(mss),
+    nodelay_(false), corked_(false), push_(false) {
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+send_buffer::~send_buffer() {
+  if (owns_ring()) {
+    delete ring_;
+    ring_ = nullptr;
+  }
+  release_ring();
+}
+
+bool send_buffer::owns_ring() const {
+  return capacity_ > pool_->get_ring_size();
+}
+
+void send_buffer::release_ring() {
+  if (ring_ != nullptr && !owns_ring()) {
+    pool_->release(ring_);
+    ring_ = nullptr;
+  }
+  unacked_ = 0;
+}
+
+size_t send_buffer::write(const uint8_t *data, const size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  if (ring_ == nullptr) {
+    ring_ = owns_ring() ? new byte_ring(capacity_) : pool_->acquire();
+  }
+  const size_t written = ring_->write(data, size);
+  stats_.writes++;
+  stats_.bytes += written;
+  return written;
+}
+
+void send_buffer::cork() {
+  corked_ = true;
+}
+
+void send_buffer::uncork() {
+  corked_ = false;
+  if (size() != 0) {
+    push_ = true;
+  }
+}
+
+void send_buffer::set_nodelay(const bool nodelay) {
+  nodelay_ = nodelay;
+}
+
+void send_buffer::set_mss(const uint32_t mss) {
+  if (mss == 0) {
+    throw std::invalid_argument("MSS must not be 0");
+  }
+  mss_ = mss;
+  if (offload_size_ < mss_) {
+    offload_size_ = mss_;
+  }
+}
+
+void send_buffer::set_offload_size(const uint32_t offload_size) {
+  offload_size_ = std::max(offload_size, mss_);
+}
+
+uint32_t send_buffer::get_mss() const {
+  return mss_;
+}
+
+size_t send_buffer::size() const {
+  if (ring_ == nullptr) {
+    return 0;
+  }
+  return ring_->size() - unacked_;
+}
+
+bool send_buffer::empty() const {
+  return size() == 0;
+}
+
+size_t send_buffer::unacked_size() const {
+  return unacked_;
+}
+
+size_t send_buffer::available() const {
+  return ring_ == nullptr ? capacity_ : ring_->available();
+}
+
+void send_buffer::set_capacity(const size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  byte_ring *ring = new byte_ring(capacity);
+  if (ring_ != nullptr) {
+    const byte_range buffered = ring_->peek(0, ring_->size());
+    ring->write(buffered.data, buffered.size);
+    if (owns_ring()) {
+      delete ring_;
+    } else {
+      pool_->release(ring_);
+    }
+  }
+  ring_ = ring;
+  // The ring may be larger than requested (rounded up to pages).
+  capacity_ = ring->capacity();
+  stats_.grows++;
+}
+
+size_t send_buffer::get_capacity() const {
+  return capacity_;
+}
+
+const send_buffer_stats& send_buffer::get_stats() const {
+  return stats_;
+}
+
+size_t send_buffer::get_memory_footprint() const {
+  if (ring_ == nullptr) {
+    return 0;
+  }
+  return ring_->capacity();
+}
+
+uint32_t send_buffer::next_segment_size(const bool data_in_flight, const uint32_t usable_window) {
+  const size_t unsent = size();
+  if (unsent == 0) {
+    return 0;
+  }
+  // Pack as many full-sized segments as the device accepts at once.
+  const uint32_t max_seg_size = offload_size_ - offload_size_ % mss_;
+  const uint32_t buffered = std::min<size_t>(unsent, UINT32_MAX);
+  uint32_t len = std::min({buffered, max_seg_size, usable_window});
+  if (len == 0) {
+    return 0;
+  }
+  if (len > mss_) {
+    // Keep segments handed to the device a multiple of MSS,
+    // so that it is split into full-sized segments.
+    return len - len % mss_;
+  }
+  if (len == mss_) {
+    return len;
+  }
+
+  // Only a partial segment can be sent.
+  if (len < buffered) {
+    // Limited by the send window. Wait for the window to open unless
+    // nothing is in flight (otherwise the connection could stall).
+    return data_in_flight ? 0 : len;
+  }
+  if (corked_) {
+    stats_.cork_holds++;
+    return 0;
+  }
+  if (data_in_flight && !nodelay_ && !push_) {
+    stats_.nagle_holds++;
+    return 0;
+  }
+  return len;
+}
+
+byte_range send_buffer::send(const uint32_t size) {
+  const size_t len = std::min<size_t>(size, this->size());
+  if (len == 0) {
+    return byte_range{nullptr, 0};
+  }
+  const byte_range range = ring_->peek(unacked_, len);
+  unacked_ += len;
+  stats_.segments++;
+  if (this->size() == 0) {
+    push_ = false;
+  }
+  return range;
+}
+
+void send_buffer::requeue() {
+  if (unacked_ != 0) {
+    unacked_ = 0;
+    push_ = true;
+  }
+}
+
+byte_range send_buffer::get_unacked(const size_t offset, const size_t size) const {
+  if (offset > unacked_ || size > unacked_ - offset) {
+    throw std::out_of_range("Range is not in the unacknowledged data");
+  }
+  if (size == 0) {
+    return byte_range{nullptr, 0};
+  }
+  return ring_->peek(offset, size);
+}
+
+void send_buffer::acknowledge(const size_t size) {
+  const size_t len = std::min(size, unacked_);
+  if (len == 0) {
+    return;
+  }
+  ring_->consume(len);
+  unacked_ -= len;
+  if (ring_->empty()) {
+    release_ring();
+  }
+}
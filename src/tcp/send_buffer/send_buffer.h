@@ -0,0 +1,115 @@
+#ifndef SEND_BUFFER_H_
+#define SEND_BUFFER_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+
+// Largest size the buffer is grown to (like the default maximum of
+// net.ipv4.tcp_wmem).
+const size_t SEND_BUFFER_MAX_SIZE = 4 * 1024 * 1024;
+
+struct send_buffer_stats {
+  uint64_t writes;       // write() calls
+  uint64_t bytes;        // bytes written
+  uint64_t segments;     // segments taken out of the buffer
+  uint64_t nagle_holds;  // times a small segment was held back by Nagle's algorithm
+  uint64_t cork_holds;   // times a small segment was held back by cork
+  uint64_t grows;        // times the buffer was grown
+};
+
+// NOTE
+// Data written by the application is not sent immediately, but accumulated
+// here until it can be sent as large segments.
+//
+// (rfc 1122 - 4.2.3.4 When to Send Data)
+//   If there is unacknowledged data (i.e., SND.NXT >
+//   SND.UNA), then the sending TCP buffers all user data
+//   (regardless of the PSH bit), until the outstanding data
+//   has been acknowledged or until the TCP can send a full-
+//   sized segment (Eff.snd.MSS bytes; see Section 4.2.2.6).
+//
+// Buffered bytes are stored in a byte_ring taken from a buffer_pool:
+//
+//   | sent, not acknowledged | not sent yet |  free  |
+//   ^ SND.UNA                ^ SND.NXT
+//
+// Segments refer to the ring instead of copying data out of it, and sent data
+// stays there until acknowledged so it can be retransmitted as is.
+// The ring is given back when the buffer becomes empty.
+//
+// The capacity starts at the ring size of the pool, which holds only 64 KiB
+// in flight, and can be grown to keep a larger window full (like Linux's
+// tcp_sndbuf_expand()). As in receive_buffer, a buffer larger than the pool
+// rings has a ring of its own, kept until the buffer is destroyed.
+class send_buffer {
+ private:
+  buffer_pool *pool_;
+  // nullptr while nothing is buffered
+  byte_ring *ring_;
+  size_t capacity_;
+  // bytes sent and not acknowledged yet (at the head of ring_)
+  size_t unacked_;
+  uint32_t mss_;
+  // Maximum size of one segment handed to the device. Larger than mss_ only
+  // if the device splits segments by itself (TSO/GSO).
+  uint32_t offload_size_;
+  // true disables Nagle's algorithm (like TCP_NODELAY)
+  bool nodelay_;
+  // true holds partial segments until uncork() (like TCP_CORK)
+  bool corked_;
+  // true if the buffered data must be sent regardless of Nagle's algorithm
+  bool push_;
+  send_buffer_stats stats_;
+
+  bool owns_ring() const;
+  void release_ring();
+ public:
+  send_buffer(const uint32_t mss, buffer_pool& pool);
+  send_buffer(const send_buffer&) = delete;
+  send_buffer& operator=(const send_buffer&) = delete;
+  ~send_buffer();
+  // Append up to the free space of the ring and return the number of appended bytes.
+  size_t write(const uint8_t *data, const size_t size);
+  void cork();
+  // Stop holding partial segments. Data buffered so far is pushed out at the next flush.
+  void uncork();
+  void set_nodelay(const bool nodelay);
+  void set_mss(const uint32_t mss);
+  void set_offload_size(const uint32_t offload_size);
+  uint32_t get_mss() const;
+  // Bytes not sent yet.
+  size_t size() const;
+  bool empty() const;
+  // Bytes sent and not acknowledged yet.
+  size_t unacked_size() const;
+  // Bytes which can be written without exceeding the buffer.
+  size_t available() const;
+  // Grow the buffer to at least capacity bytes (it never shrinks).
+  // Buffered data is moved to the new ring, so segments referring to the
+  // old one must have been marshaled.
+  void set_capacity(const size_t capacity);
+  size_t get_capacity() const;
+  const send_buffer_stats& get_stats() const;
+  // Memory held by the buffer (the ring while data is buffered).
+  size_t get_memory_footprint() const;
+  // Returns the size of the next segment which should be sent now, or 0 if
+  // nothing should be sent.
+  //   data_in_flight : true if sent data is not acknowledged yet (SND.NXT != SND.UNA)
+  //   usable_window  : bytes allowed to be sent by the send window
+  uint32_t next_segment_size(const bool data_in_flight, const uint32_t usable_window);
+  // Mark the first size bytes not sent yet as sent and return them.
+  // The range stays valid until the bytes are acknowledged.
+  byte_range send(const uint32_t size);
+  // Mark all bytes sent and not acknowledged yet as not sent, so that they
+  // are sent again as new segments (e.g. data in SYN the peer did not accept).
+  void requeue();
+  // Returns sent bytes [offset, offset + size) from SND.UNA (for retransmission).
+  byte_range get_unacked(const size_t offset, const size_t size) const;
+  // Drop size bytes acknowledged by the peer.
+  void acknowledge(const size_t size);
+};
+
+#endif  // SEND_BUFFER_H_
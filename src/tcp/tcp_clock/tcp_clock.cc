@@ -0,0 +1,9 @@
+#include <chrono>
+
+#include "tcp_clock.h"
+
+thread_local const std::chrono::steady_clock::time_point *tcp_virtual_now = nullptr;
+
+void set_tcp_virtual_clock(const std::chrono::steady_clock::time_point *now) {
+  tcp_virtual_now = now;
+}
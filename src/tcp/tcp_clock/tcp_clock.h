@@ -0,0 +1,25 @@
+#ifndef TCP_CLOCK_H_
+#define TCP_CLOCK_H_
+
+#include <chrono>
+
+// Virtual time of the calling thread, or nullptr to use steady_clock.
+extern thread_local const std::chrono::steady_clock::time_point *tcp_virtual_now;
+
+// NOTE
+// Clock of the TCP state (RTT samples, delayed ACKs, receive buffer
+// auto-tuning). It is steady_clock unless the thread has set a virtual clock,
+// which a simulation advances from event to event, so that a transfer of
+// minutes runs in milliseconds and gives the same result every time.
+//
+// Read on every segment, hence inline.
+inline std::chrono::steady_clock::time_point tcp_clock_now() {
+  const std::chrono::steady_clock::time_point *now = tcp_virtual_now;
+  return now != nullptr ? *now : std::chrono::steady_clock::now();
+}
+
+// Make tcp_clock_now() of the calling thread return *now (nullptr for
+// steady_clock again). The time point must outlive its use.
+void set_tcp_virtual_clock(const std::chrono::steady_clock::time_point *now);
+
+#endif  // TCP_CLOCK_H_
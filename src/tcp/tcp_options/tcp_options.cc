@@ -0,0 +1,133 @@
+#include <algorithm>  // for std::min()
+#include <cstdint>  // for uint8_t
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tcp_options.h"
+
+namespace {
+bool valid_fast_open_cookie_len(const size_t len) {
+  return len == 0 ||
+         (len >= TCP_FAST_OPEN_MIN_COOKIE_LEN && len <= TCP_FAST_OPEN_MAX_COOKIE_LEN && len % 2 == 0);
+}
+} // namespace
+
+tcp_options::tcp_options()
+  : has_mss_(false), mss_(0), has_window_scale_(false), window_scale_(0),
+    has_fast_open_(false) {}
+
+tcp_options::tcp_options(const std::vector<uint8_t> marshaled)
+  : has_mss_(false), mss_(0), has_window_scale_(false), window_scale_(0),
+    has_fast_open_(false) {
+  size_t i = 0;
+  while (i < marshaled.size()) {
+    const uint8_t kind = marshaled[i];
+    if (kind == TCP_OPTION_KIND_END) {
+      break;
+    }
+    if (kind == TCP_OPTION_KIND_NOP) {
+      i++;
+      continue;
+    }
+    if (i + 1 >= marshaled.size()) {
+      throw std::invalid_argument("Truncated tcp option: kind " + std::to_string(kind));
+    }
+    const uint8_t len = marshaled[i + 1];
+    if (len < 2 || i + len > marshaled.size()) {
+      throw std::invalid_argument("Invalid tcp option length: " + std::to_string(len));
+    }
+    if (kind == TCP_OPTION_KIND_MSS && len == TCP_OPTION_LEN_MSS) {
+      has_mss_ = true;
+      mss_ = (static_cast<uint16_t>(marshaled[i + 2]) << 8) + marshaled[i + 3];
+    }
+    if (kind == TCP_OPTION_KIND_WINDOW_SCALE && len == TCP_OPTION_LEN_WINDOW_SCALE) {
+      has_window_scale_ = true;
+      window_scale_ = std::min(marshaled[i + 2], TCP_MAX_WINDOW_SCALE);
+    }
+    // (rfc 7413 - 4.1.1. Fast Open Option)
+    //   Options with invalid Length values or without the SYN flag set MUST
+    //   be ignored.
+    // (the SYN flag is checked by the user of the options)
+    if (kind == TCP_OPTION_KIND_FAST_OPEN && valid_fast_open_cookie_len(len - 2)) {
+      has_fast_open_ = true;
+      fast_open_cookie_.assign(marshaled.begin() + i + 2, marshaled.begin() + i + len);
+    }
+    i += len;
+  }
+}
+
+std::vector<uint8_t> tcp_options::marshal() const {
+  std::vector<uint8_t> marshaled;
+  if (has_mss_) {
+    marshaled.push_back(TCP_OPTION_KIND_MSS);
+    marshaled.push_back(TCP_OPTION_LEN_MSS);
+    marshaled.push_back(static_cast<uint8_t>(mss_ >> 8));
+    marshaled.push_back(static_cast<uint8_t>(mss_ & 0xff));
+  }
+  if (has_window_scale_) {
+    // (rfc 7323 - 2.2. Window Scale Option)
+    //   The three-byte Window Scale option MAY be sent in a <SYN> segment
+    //   ... It MAY be preceded by a NOP
+    marshaled.push_back(TCP_OPTION_KIND_NOP);
+    marshaled.push_back(TCP_OPTION_KIND_WINDOW_SCALE);
+    marshaled.push_back(TCP_OPTION_LEN_WINDOW_SCALE);
+    marshaled.push_back(window_scale_);
+  }
+  if (has_fast_open_) {
+    marshaled.push_back(TCP_OPTION_KIND_FAST_OPEN);
+    marshaled.push_back(static_cast<uint8_t>(2 + fast_open_cookie_.size()));
+    marshaled.insert(marshaled.end(), fast_open_cookie_.begin(), fast_open_cookie_.end());
+  }
+  // NOTE
+  // (rfc 793 - 3.1. Header Format)
+  //   The TCP header padding is used to ensure that the TCP header ends
+  //   and data begins on a 32 bit boundary.  The padding is composed of
+  //   zeros.
+  while (marshaled.size() % 4 != 0) {
+    marshaled.push_back(TCP_OPTION_KIND_END);
+  }
+  return marshaled;
+}
+
+bool tcp_options::has_mss() const {
+  return has_mss_;
+}
+
+uint16_t tcp_options::get_mss() const {
+  return mss_;
+}
+
+void tcp_options::set_mss(const uint16_t mss) {
+  has_mss_ = true;
+  mss_ = mss;
+}
+
+bool tcp_options::has_window_scale() const {
+  return has_window_scale_;
+}
+
+uint8_t tcp_options::get_window_scale() const {
+  return window_scale_;
+}
+
+void tcp_options::set_window_scale(const uint8_t shift) {
+  has_window_scale_ = true;
+  window_scale_ = std::min(shift, TCP_MAX_WINDOW_SCALE);
+}
+
+bool tcp_options::has_fast_open() const {
+  return has_fast_open_;
+}
+
+const std::vector<uint8_t>& tcp_options::get_fast_open_cookie() const {
+  return fast_open_cookie_;
+}
+
+void tcp_options::set_fast_open_cookie(const std::vector<uint8_t>& cookie) {
+  if (!valid_fast_open_cookie_len(cookie.size())) {
+    throw std::invalid_argument("Invalid fast open cookie length: " + std::to_string(cookie.size()));
+  }
+  has_fast_open_ = true;
+  fast_open_cookie_ = cookie;
+}
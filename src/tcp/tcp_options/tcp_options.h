@@ -0,0 +1,88 @@
+#ifndef TCP_OPTIONS_H_
+#define TCP_OPTIONS_H_
+
+#include <cstdint>  // for uint8_t
+#include <vector>
+
+const uint8_t TCP_OPTION_KIND_END = 0;
+const uint8_t TCP_OPTION_KIND_NOP = 1;
+const uint8_t TCP_OPTION_KIND_MSS = 2;
+const uint8_t TCP_OPTION_KIND_WINDOW_SCALE = 3;
+const uint8_t TCP_OPTION_KIND_FAST_OPEN = 34;
+
+const uint8_t TCP_OPTION_LEN_MSS = 4;
+const uint8_t TCP_OPTION_LEN_WINDOW_SCALE = 3;
+
+// (rfc 7413 - 4.1.1. Fast Open Option)
+//   The cookie MUST be a multiple of 16 bits ... The minimum Cookie size is 4
+//   bytes ... The maximum Cookie size is 16 bytes.
+const uint8_t TCP_FAST_OPEN_MIN_COOKIE_LEN = 4;
+const uint8_t TCP_FAST_OPEN_MAX_COOKIE_LEN = 16;
+
+// (rfc 7323 - 2.3. Using the Window Scale Option)
+//   If a Window Scale option is received with a shift.cnt
+//   value larger than 14, the TCP SHOULD log the error but MUST use 14
+//   instead of the specified value.
+const uint8_t TCP_MAX_WINDOW_SCALE = 14;
+
+/*
+ * TCP Options
+ * (see: https://datatracker.ietf.org/doc/html/rfc793#section-3.1)
+ *
+ *   Options may occupy space at the end of the TCP header and are a
+ *   multiple of 8 bits in length.
+ *   There are two cases for the format of an option:
+ *     Case 1:  A single octet of option-kind.
+ *     Case 2:  An octet of option-kind, an octet of option-length, and
+ *              the actual option-data octets.
+ *
+ *   Maximum Segment Size
+ *   +--------+--------+---------+--------+
+ *   |00000010|00000100|   max seg size   |
+ *   +--------+--------+---------+--------+
+ *    Kind=2   Length=4
+ *
+ *   Window Scale (see: https://datatracker.ietf.org/doc/html/rfc7323#section-2.2)
+ *   +---------+---------+---------+
+ *   | Kind=3  |Length=3 |shift.cnt|
+ *   +---------+---------+---------+
+ *
+ *   Fast Open Cookie (see: https://datatracker.ietf.org/doc/html/rfc7413#section-4.1.1)
+ *   +---------+---------+
+ *   | Kind=34 | Length  |
+ *   +---------+---------+
+ *   |                   |
+ *   ~      Cookie       ~   (empty in a cookie request)
+ *   |                   |
+ *   +-------------------+
+ */
+class tcp_options {
+ private:
+  bool     has_mss_;
+  uint16_t mss_;
+  bool     has_window_scale_;
+  uint8_t  window_scale_;
+  bool     has_fast_open_;
+  std::vector<uint8_t> fast_open_cookie_;
+ public:
+  tcp_options();
+  // Parse options part of tcp header. Unknown options are skipped.
+  tcp_options(const std::vector<uint8_t> marshaled);
+  // Returns options padded to a multiple of 4 bytes.
+  std::vector<uint8_t> marshal() const;
+  bool     has_mss() const;
+  uint16_t get_mss() const;
+  void     set_mss(const uint16_t mss);
+  bool     has_window_scale() const;
+  // Returns the shift count (at most TCP_MAX_WINDOW_SCALE).
+  uint8_t  get_window_scale() const;
+  void     set_window_scale(const uint8_t shift);
+  bool     has_fast_open() const;
+  // Returns the cookie (empty for a cookie request).
+  const std::vector<uint8_t>& get_fast_open_cookie() const;
+  // An empty cookie makes the option a cookie request.
+  // Throws if the cookie is not of a valid size.
+  void     set_fast_open_cookie(const std::vector<uint8_t>& cookie);
+};
+
+#endif  // TCP_OPTIONS_H_
@@ -60,22 +60,29 @@ std::vector<uint8_t> tcp_pseudo_header::marshal() const {
   return marshaled;
 }
 
-uint16_t calc_checksum(const std::vector<uint8_t> segment) {
-  uint32_t sum = 0;
-  const size_t segment_size = segment.size();
-
-  // Add each 16 bits
-  for (int i = 0; i + 1 < segment_size; i += 2) {
-    uint16_t hextet = (segment[i] << 8) + segment[i + 1];
+// Add each 16 bits of data to sum. All data except the last one must have
+// even size so that 16 bit words do not span them.
+uint32_t add_checksum(uint32_t sum, const uint8_t *data, const size_t size) {
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    uint16_t hextet = (data[i] << 8) + data[i + 1];
     sum += hextet;
+    // Add upper bits to lower 16 bits before sum overflows
+    if (sum & 0x80000000) {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
   }
   // Add last 8 bit
-  if (segment_size % 2 != 0) {
-    sum += (segment[segment_size - 1] << 8);
+  if (size % 2 != 0) {
+    sum += (data[size - 1] << 8);
   }
+  return sum;
+}
 
+uint16_t fold_checksum(uint32_t sum) {
   // Add lower 16 bits and upper bits
-  sum = (sum & 0xffff) + (sum >> 16);
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
   return ~sum;
 }
 } // namespace
@@ -92,7 +99,7 @@ tcp_segment::tcp_segment(
     const uint16_t checksum, const uint16_t urgent_pointer,
     const std::vector<uint8_t> options,
     const std::vector<uint8_t> body)
-  : body_(body), options_(options) {
+  : options_(options), body_(body), body_view_(nullptr), body_view_size_(0) {
   std::memset(&header_, 0, sizeof(header_));
   header_.source  = htons(src_port);
   header_.dest    = htons(dst_port);
@@ -132,14 +139,45 @@ tcp_segment::tcp_segment(
     const uint16_t urgent_pointer,
     const std::vector<uint8_t> options,
     const std::vector<uint8_t> body)
-  : body_(body), options_(options) {
+  : tcp_segment(src_addr, dst_addr, src_port, dst_port, seq, ack_seq,
+                ns, cwr, ece, urg, ack, psh, rst, syn, fin,
+                window, urgent_pointer, options, body.data(), body.size()) {
+  // keep a copy instead of referring to the argument
+  body_ = body;
+  body_view_ = nullptr;
+  body_view_size_ = 0;
+}
+
+tcp_segment::tcp_segment(
+    const uint8_t *src_addr,
+    const uint8_t *dst_addr,
+    const uint16_t src_port,
+    const uint16_t dst_port,
+    const uint32_t seq,
+    const uint32_t ack_seq,
+    const bool ns,
+    const bool cwr,
+    const bool ece,
+    const bool urg,
+    const bool ack,
+    const bool psh,
+    const bool rst,
+    const bool syn,
+    const bool fin,
+    const uint16_t window,
+    const uint16_t urgent_pointer,
+    const std::vector<uint8_t> options,
+    const uint8_t *body,
+    const size_t body_size)
+  : options_(options), body_view_(body), body_view_size_(body_size) {
   const auto header_size_byte = 20;
   std::memset(&header_, 0, sizeof(header_));
   header_.source  = htons(src_port);
   header_.dest    = htons(dst_port);
   header_.seq     = htonl(seq);
   header_.ack_seq = htonl(ack_seq);
-  header_.doff    = header_size_byte + options_.size() + 1;
+  // NOTE data offset is in 4 bytes (= 32 bit) increments
+  header_.doff    = (header_size_byte + options_.size()) / 4;
   header_.res1    = ns;
   header_.res2    = (cwr << 1) + ece;
   header_.urg     = urg;
@@ -150,24 +188,32 @@ tcp_segment::tcp_segment(
   header_.fin     = fin;
   header_.window  = htons(window);
   header_.urg_ptr = htons(urgent_pointer);
+  set_checksum(src_addr, dst_addr);
+}
+
+void tcp_segment::set_checksum(const uint8_t *src_addr, const uint8_t *dst_addr) {
   const uint8_t reserved = 0;
   const uint8_t protocol_tcp = 6;
   tcp_pseudo_header pseudo_hdr(
       src_addr, dst_addr, reserved, protocol_tcp,
-      header_size_byte + options_.size() + body_.size());
+      sizeof(header_) + options_.size() + get_body_size());
 
+  // NOTE
+  // The checksum is calculated over the pieces in place, so that the body is
+  // not copied. Pseudo header (12 bytes), header (20 bytes) and options
+  // (multiple of 4 bytes) have even size.
+  header_.check = 0;
   const std::vector<uint8_t> marshaled_pseudo_hdr = pseudo_hdr.marshal();
-  const std::vector<uint8_t> marshaled_segment = marshal();
-  std::vector<uint8_t> checksum_calc_src;
-  std::copy(marshaled_pseudo_hdr.begin(), marshaled_pseudo_hdr.end(),
-            std::back_inserter(checksum_calc_src));
-  std::copy(marshaled_segment.begin(), marshaled_segment.end(),
-            std::back_inserter(checksum_calc_src));
-  const uint16_t checksum = calc_checksum(checksum_calc_src);
-  header_.check   = htons(checksum);
+  uint32_t sum = 0;
+  sum = add_checksum(sum, marshaled_pseudo_hdr.data(), marshaled_pseudo_hdr.size());
+  sum = add_checksum(sum, reinterpret_cast<const uint8_t *>(&header_), sizeof(header_));
+  sum = add_checksum(sum, options_.data(), options_.size());
+  sum = add_checksum(sum, get_body_data(), get_body_size());
+  header_.check = htons(fold_checksum(sum));
 }
 
-tcp_segment::tcp_segment(const std::vector<uint8_t>marshaled) {
+tcp_segment::tcp_segment(const std::vector<uint8_t>marshaled)
+  : body_view_(nullptr), body_view_size_(0) {
   const size_t min_hdr_size = 20;
   if (marshaled.size() < min_hdr_size) {
     std::string msg = "Invalid data size: " + std::to_string(marshaled.size());
@@ -200,17 +246,25 @@ tcp_segment::tcp_segment(const std::vector<uint8_t>marshaled) {
   header_.window  = (marshaled[15] << 8) + marshaled[14];
   header_.check   = (marshaled[17] << 8) + marshaled[16];
   header_.urg_ptr = (marshaled[19] << 8) + marshaled[18];
+
+  // NOTE data offset is in 4 bytes (= 32 bit) increments
+  const size_t hdr_size = header_.doff * 4;
+  if (hdr_size < min_hdr_size || hdr_size > marshaled.size()) {
+    std::string msg = "Invalid data offset: " + std::to_string(header_.doff);
+    throw std::invalid_argument(msg);
+  }
+  std::copy(marshaled.begin() + min_hdr_size, marshaled.begin() + hdr_size,
+            std::back_inserter(options_));
+  std::copy(marshaled.begin() + hdr_size, marshaled.end(), std::back_inserter(body_));
 }
 
 std::vector<uint8_t> tcp_segment::marshal() const {
+  const uint8_t *hdr = reinterpret_cast<const uint8_t *>(&header_);
   std::vector<uint8_t> marshaled;
-  struct tcphdr hdr_copy;
-  std::memcpy(&hdr_copy, &header_, sizeof(header_));
-  for (int i = 0; i < sizeof(hdr_copy); ++i) {
-    marshaled.push_back((reinterpret_cast<uint8_t *>(&hdr_copy))[i]);
-  }
-  std::copy(options_.begin(), options_.end(), std::back_inserter(marshaled));
-  std::copy(body_.begin(), body_.end(), std::back_inserter(marshaled));
+  marshaled.reserve(sizeof(header_) + options_.size() + get_body_size());
+  marshaled.insert(marshaled.end(), hdr, hdr + sizeof(header_));
+  marshaled.insert(marshaled.end(), options_.begin(), options_.end());
+  marshaled.insert(marshaled.end(), get_body_data(), get_body_data() + get_body_size());
   return marshaled;
 }
 
@@ -242,12 +296,13 @@ bool tcp_segment::get_ns() const {
   return header_.res1 & 0x1;
 }
 
+// NOTE res2 holds CWR (upper bit) and ECE (lower bit)
 bool tcp_segment::get_cwr() const {
-  return header_.res2 >> 7;
+  return (header_.res2 >> 1) & 0x1;
 }
 
 bool tcp_segment::get_ece() const {
-  return (header_.res2 >> 6) & 0x1;
+  return header_.res2 & 0x1;
 }
 
 bool tcp_segment::get_urg() const {
@@ -293,7 +348,13 @@ std::vector<uint8_t> tcp_segment::get_options() const {
 }
 
 std::vector<uint8_t> tcp_segment::get_body() const {
-  std::vector<uint8_t> body;
-  std::copy(body_.begin(), body_.end(), std::back_inserter(body));
-  return body;
+  return std::vector<uint8_t>(get_body_data(), get_body_data() + get_body_size());
+}
+
+const uint8_t *tcp_segment::get_body_data() const {
+  return body_view_ != nullptr ? body_view_ : body_.data();
+}
+
+size_t tcp_segment::get_body_size() const {
+  return body_view_ != nullptr ? body_view_size_ : body_.size();
 }
@@ -1,6 +1,7 @@
 #ifndef TCP_SEGMENT_H_
 #define TCP_SEGMENT_H_
 
+#include <cstddef>        // for size_t
 #include <cstdint>        // for uint8_t
 #include <netinet/tcp.h>  // for struct tcphdr
 #include <vector>
@@ -36,6 +37,11 @@ class tcp_segment {
   struct tcphdr header_;
   std::vector<uint8_t> options_;
   std::vector<uint8_t> body_;
+  // Body owned by someone else (e.g. a send_buffer), or nullptr if body_ is used.
+  const uint8_t *body_view_;
+  size_t body_view_size_;
+
+  void set_checksum(const uint8_t *src_addr, const uint8_t *dest_addr);
  public:
   tcp_segment(
       const uint16_t src_port,
@@ -79,6 +85,29 @@ class tcp_segment {
       const uint16_t urgent_pointer,
       const std::vector<uint8_t> options,
       const std::vector<uint8_t> body);
+  // Same as above, but the body is referred to instead of copied.
+  // The body must outlive the segment (data in a send_buffer stays until acknowledged).
+  tcp_segment(
+      const uint8_t *src_addr,
+      const uint8_t *dest_addr,
+      const uint16_t src_port,
+      const uint16_t dest_port,
+      const uint32_t seq,
+      const uint32_t ack_seq,
+      const bool ns,
+      const bool cwr,
+      const bool ece,
+      const bool urg,
+      const bool ack,
+      const bool psh,
+      const bool rst,
+      const bool syn,
+      const bool fin,
+      const uint16_t window,
+      const uint16_t urgent_pointer,
+      const std::vector<uint8_t> options,
+      const uint8_t *body,
+      const size_t body_size);
   tcp_segment(const std::vector<uint8_t>marshaled);
   std::vector<uint8_t> marshal() const;
   uint16_t get_src_port() const;
@@ -101,6 +130,9 @@ class tcp_segment {
   uint16_t get_urgent_pointer() const;
   std::vector<uint8_t> get_options() const;
   std::vector<uint8_t> get_body() const;
+  // Body without copying. Valid as long as the segment (or the referred body) is.
+  const uint8_t *get_body_data() const;
+  size_t   get_body_size() const;
 };
 
 #endif  // TCP_SEGMENT_H_
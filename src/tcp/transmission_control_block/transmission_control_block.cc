@@ -1,7 +1,19 @@
+#include <algorithm>  // for std::min()
 #include <chrono>
-#include <chrono>
+#include <cstring>  // for std::memset()
+#include <memory>
 #include <stdexcept>
 
+#include "buffer_pool.h"
+#include "byte_ring.h"
+#include "congestion_control.h"
+#include "connection_stats.h"
+#include "delayed_ack.h"
+#include "receive_buffer.h"
+#include "receive_window.h"
+#include "send_buffer.h"
+#include "tcp_clock.h"
+#include "tcp_options.h"
 #include "tcp_segment.h"
 #include "transmission_control_block.h"
 
@@ -43,10 +55,57 @@ uint32_t generate_initial_send_seq_number() {
   const uint32_t iss = (current_time_from_midnight / 4) % UINT32_MAX;
   return iss;
 }
+
+// NOTE
+// (rfc 1122 - 4.2.2.6 Maximum Segment Size Option)
+//   If an MSS option is not received at connection setup, TCP
+//   MUST assume a default send MSS of 536 (576-40).
+const uint32_t DEFAULT_MSS = 536;
+
+// NOTE
+// (rfc 793 - 3.3. Sequence Numbers)
+//   It is essential to remember that the actual sequence number space is
+//   finite, though very large.  This space ranges from 0 to 2**32 - 1.
+//   Since the space is finite, all arithmetic dealing with sequence
+//   numbers must be performed modulo 2**32.
+bool seq_lt(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+
+bool seq_leq(const uint32_t a, const uint32_t b) {
+  return static_cast<int32_t>(a - b) <= 0;
+}
+
+const delayed_ack_stats EMPTY_DELAYED_ACK_STATS = {};
+const send_buffer_stats EMPTY_SEND_BUFFER_STATS = {};
+const congestion_control_stats EMPTY_CONGESTION_CONTROL_STATS = {};
+const receive_window_stats EMPTY_RECEIVE_WINDOW_STATS = {};
 } // namespace
 
-transmission_control_block::transmission_control_block() {
+static_assert(sizeof(transmission_control_block) == 64,
+              "hot state of transmission_control_block must fit in one cache line");
+
+transmission_control_block::cold_state::cold_state(buffer_pool& pool)
+  : snd_up_(0), rcv_up_(0),
+    delayed_ack_policy_(DEFAULT_DELAYED_ACK_POLICY),
+    send_buffer_(DEFAULT_MSS, pool),
+    receive_buffer_(pool),
+    congestion_control_(congestion_algorithm::RENO, DEFAULT_MSS),
+    ecn_offered_(false), ecn_ok_(false), retransmit_due_(false),
+    rto_recovery_(false), rto_recover_(0), rto_retransmit_nxt_(0), ece_echo_(false),
+    receive_window_policy_(DEFAULT_RECEIVE_WINDOW_POLICY),
+    wscale_offered_(false), offered_wscale_(0), snd_wscale_(0) {
+  std::memset(&delayed_ack_stats_, 0, sizeof(delayed_ack_stats_));
+  std::memset(&receive_window_stats_, 0, sizeof(receive_window_stats_));
+}
+
+transmission_control_block::transmission_control_block()
+  : snd_una_(0), snd_nxt_(0), snd_wl1_(0), snd_wl2_(0), snd_wnd_(0), iss_(0),
+    rcv_nxt_(0), rcv_wnd_(0), irs_(0),
+    rcv_mss_(DEFAULT_MSS),
+    delayed_ack_(DEFAULT_DELAYED_ACK_POLICY) {
   const auto isn = generate_initial_send_seq_number();
+  snd_una_ = isn;
   snd_nxt_ = isn;
   iss_     = isn;
 }
@@ -69,6 +128,9 @@ tcp_segment transmission_control_block::create_send_segment(
     const uint16_t urg_ptr,
     const std::vector<uint8_t> options,
     const std::vector<uint8_t> body) {
+  if (syn_flag && !ack_flag) {
+    on_syn_sent(ece_flag && cwr_flag, options);
+  }
   tcp_segment seg(
       src_ip_bytes,
       dst_ip_bytes,
@@ -78,7 +140,7 @@ tcp_segment transmission_control_block::create_send_segment(
       rcv_nxt_,
       ns_flag,
       cwr_flag,
-      ece_flag,
+      ece_flag || (ack_flag && !syn_flag && echo_ce()),
       urg_flag,
       ack_flag,
       psh_flag,
@@ -89,46 +151,1029 @@ tcp_segment transmission_control_block::create_send_segment(
       urg_ptr,
       options,
       body);
-  // update snd_una_
-  snd_una_ = snd_nxt_;
-  // update snd_nxt_
-  if (syn_flag || fin_flag) {
+  if (connection_stats_recorder *recorder = stats()) {
+    connection_stats& counters = recorder->counters();
+    counters.segments_out++;
+    if (!body.empty()) {
+      counters.data_segments_out++;
+      counters.bytes_sent += body.size();
+    }
+  }
+  // update snd_nxt_ (SYN and FIN occupy one sequence number each)
+  snd_nxt_ += body.size();
+  if (syn_flag) {
+    snd_nxt_++;
+  }
+  if (fin_flag) {
     snd_nxt_++;
-  } else {
-    snd_nxt_ += body.size();
   }
   // update snd_up_
   if (urg_flag) {
-    snd_up_ = urg_ptr;
+    cold().snd_up_ = urg_ptr;
+  }
+  // Any segment with ACK flag acknowledges everything received so far.
+  if (ack_flag) {
+    delayed_ack_.on_ack_sent(cold().delayed_ack_stats_, tcp_clock_now());
+    if (!rst_flag) {
+      on_window_advertised(window);
+    }
   }
-  // update snd_wl1_
-  snd_wl1_ = window;
-  // update snd_wl2_
-  snd_wl2_ = rcv_nxt_;
   return seg;
 }
 
+tcp_segment transmission_control_block::create_syn_segment(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const bool ecn_setup,
+    const uint16_t window,
+    const std::vector<uint8_t> options,
+    const uint32_t max_data) {
+  on_syn_sent(ecn_setup, options);
+  // NOTE
+  // (rfc 7413 - 3. Protocol Overview)
+  //   Performing TCP Fast Open:
+  //   1. The client sends a SYN with data and the cookie in the Fast Open
+  //      option.
+  //   2. The server validates the cookie:
+  //      (a) If the cookie is valid, the server sends a SYN-ACK
+  //          acknowledging both the SYN and the data.  The server then
+  //          delivers the data to the application.
+  //      (b) Otherwise, the server drops the data and sends a SYN-ACK
+  //          acknowledging only the SYN sequence number.
+  byte_range body{nullptr, 0};
+  if (max_data != 0 && cold_) {
+    body = cold_->send_buffer_.send(max_data);
+  }
+  tcp_segment seg(
+      src_ip_bytes,
+      dst_ip_bytes,
+      src_port,
+      dst_port,
+      iss_,
+      0,        // ack seq
+      false,    // ns
+      ecn_setup,  // cwr
+      ecn_setup,  // ece
+      false,    // urg
+      false,    // ack
+      false,    // psh
+      false,    // rst
+      true,     // syn
+      false,    // fin
+      window,
+      0,        // urgent pointer
+      options,
+      body.data,
+      body.size);
+  snd_nxt_ = iss_ + 1 + body.size;
+  if (connection_stats_recorder *recorder = stats()) {
+    connection_stats& counters = recorder->counters();
+    counters.segments_out++;
+    if (body.size != 0) {
+      counters.data_segments_out++;
+      counters.bytes_sent += body.size;
+    }
+  }
+  return seg;
+}
+
+void transmission_control_block::on_syn_sent(
+    const bool ecn_setup, const std::vector<uint8_t>& options) {
+  // NOTE
+  // (rfc 3168 - 6.1.1. TCP Initialization)
+  //   Before a TCP connection can use ECN, Host A sends an ECN-setup SYN
+  //   packet, and Host B sends an ECN-setup SYN-ACK packet.
+  //   ...
+  //   An "ECN-setup SYN packet" is a SYN packet with the ECE and CWR flags set.
+  if (ecn_setup) {
+    cold().ecn_offered_ = true;
+  }
+  // (rfc 7323 - 2.2. Window Scale Option)
+  //   This option is an offer, not a promise; both sides MUST send Window
+  //   Scale options in their <SYN> segments to enable window scaling in
+  //   either direction.
+  if (!options.empty()) {
+    cold().syn_options_ = options;
+    const tcp_options syn_options(options);
+    if (syn_options.has_window_scale()) {
+      cold().wscale_offered_ = true;
+      cold().offered_wscale_ = syn_options.get_window_scale();
+    }
+  }
+}
+
+tcp_segment transmission_control_block::create_ack_segment(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window) {
+  return create_send_segment(
+      src_ip_bytes,
+      src_port,
+      dst_ip_bytes,
+      dst_port,
+      false,  // ns
+      false,  // cwr
+      false,  // ece
+      false,  // urg
+      true,   // ack
+      false,  // psh
+      false,  // rst
+      false,  // syn
+      false,  // fin
+      window,
+      0,      // urgent pointer
+      std::vector<uint8_t>(), // option
+      std::vector<uint8_t>()  // body
+    );
+}
+
 void transmission_control_block::apply_receive_segment(const tcp_segment& segment) {
-  // update snd_una_
+  apply_receive_segment(segment, false);
+}
+
+void transmission_control_block::apply_receive_segment(
+    const tcp_segment& segment, const bool ce_marked) {
+  if (segment.get_rst()) {
+    return;
+  }
+  // negotiate ECN and update the CE state echoed by ECE
+  bool ce_changed = false;
+  if (segment.get_syn() && segment.get_ack() && cold_ && cold_->ecn_offered_) {
+    // (rfc 3168 - 6.1.1. TCP Initialization)
+    //   An "ECN-setup SYN-ACK packet" is a SYN-ACK packet with the ECE flag set
+    //   but the CWR flag not set.
+    cold_->ecn_ok_ = segment.get_ece() && !segment.get_cwr();
+  } else if (cold_ && cold_->ecn_ok_ && segment.get_body_size() != 0) {
+    // NOTE Only data segments are sent with ECT, so only they carry the CE state.
+    if (cold_->congestion_control_.get_algorithm() == congestion_algorithm::DCTCP) {
+      // NOTE
+      // (rfc 8257 - 3.2. Echoing Congestion Information on the Receiver)
+      //   When a DCTCP receiver receives a packet with CE mark ... the receiver
+      //   sets the ECE flag on ACKs as long as the CE state is 1.
+      //   ...
+      //   If the CE codepoint differs from the current CE state, the receiver
+      //   MUST immediately send an ACK
+      // (the state is changed before the ACK is sent, so the ACK covering the
+      //  segments before the change carries the new state)
+      ce_changed = cold_->ece_echo_ != ce_marked;
+      cold_->ece_echo_ = ce_marked;
+    } else {
+      // (rfc 3168 - 6.1.3. The TCP Receiver)
+      //   After a TCP receiver sends an ACK packet with the ECN-Echo bit set,
+      //   that TCP receiver continues to set the ECN-Echo flag in all the ACK
+      //   packets it sends ... until it receives a CWR packet
+      if (segment.get_cwr()) {
+        cold_->ece_echo_ = false;
+      }
+      if (ce_marked) {
+        cold_->ece_echo_ = true;
+      }
+    }
+  }
+  // record the segment for delayed ACK (only segments which occupy sequence space are acknowledged)
+  const uint32_t seg_len = segment.get_body_size();
+  if (seg_len != 0 || segment.get_syn() || segment.get_fin()) {
+    // NOTE
+    // (rfc 5681 - 4.2. Generating Acknowledgments)
+    //   A TCP receiver SHOULD send an immediate duplicate ACK when an out-
+    //   of-order segment arrives.
+    const bool out_of_order = !segment.get_syn() && segment.get_seq() != rcv_nxt_;
+    if (out_of_order) {
+      delayed_ack_.enter_quick_ack(cold().delayed_ack_policy_);
+    }
+    if (connection_stats_recorder *recorder = stats()) {
+      connection_stats& counters = recorder->counters();
+      if (seg_len != 0) {
+        counters.data_segments_in++;
+        if (out_of_order) {
+          counters.reorder_events++;
+        }
+      }
+    }
+    if (seg_len > rcv_mss_) {
+      rcv_mss_ = seg_len;
+    }
+    cold_state& cold_st = cold();
+    delayed_ack_.on_segment_received(
+        cold_st.delayed_ack_policy_, cold_st.delayed_ack_stats_,
+        seg_len, rcv_mss_,
+        segment.get_syn() || segment.get_fin() || out_of_order || ce_changed,
+        tcp_clock_now());
+  }
+  // NOTE
+  // (rfc 793 - 3.9. Event Processing - SEGMENT ARRIVES)
+  //   If SND.UNA < SEG.ACK =< SND.NXT then, set SND.UNA <- SEG.ACK.
+  //   ...
+  //   If SND.UNA < SEG.ACK =< SND.NXT, the send window should be
+  //   updated.  If (SND.WL1 < SEG.SEQ or (SND.WL1 = SEG.SEQ and
+  //   SND.WL2 =< SEG.ACK)), set SND.WND <- SEG.WND, set
+  //   SND.WL1 <- SEG.SEQ, and set SND.WL2 <- SEG.ACK.
   if (segment.get_ack()) {
-    snd_una_ = segment.get_ack_seq() + 1;
+    const uint32_t seg_ack = segment.get_ack_seq();
+    const uint32_t seg_seq = segment.get_seq();
+    // update snd_una_ and drop acknowledged data from the send buffer
+    uint32_t acked = 0;
+    // (rfc 7323 - 2.3. Using the Window Scale Option)
+    //   The window field (SEG.WND) in the header of every incoming segment,
+    //   with the exception of <SYN> segments, MUST be left-shifted by
+    //   Snd.Wind.Shift bits before updating SND.WND
+    const uint8_t shift = (segment.get_syn() || !cold_) ? 0 : cold_->snd_wscale_;
+    const uint32_t seg_wnd = static_cast<uint32_t>(segment.get_window()) << shift;
+    // NOTE
+    // (rfc 5681 - 2. Definitions)
+    //   DUPLICATE ACKNOWLEDGMENT: An acknowledgment is considered a
+    //   "duplicate" in the following algorithms when (a) the receiver of
+    //   the ACK has outstanding data, (b) the incoming acknowledgment
+    //   carries no data, (c) the SYN and FIN bits are both off, (d) the
+    //   acknowledgment number is equal to the greatest acknowledgment
+    //   received on the given connection (TCP.UNA from [RFC793]) and (e)
+    //   the advertised window in the incoming acknowledgment equals the
+    //   advertised window in the last incoming acknowledgment.
+    const bool duplicate = seg_ack == snd_una_ && snd_una_ != snd_nxt_ &&
+                           seg_len == 0 && !segment.get_syn() && !segment.get_fin() &&
+                           seg_wnd == snd_wnd_;
+    if (seq_lt(snd_una_, seg_ack) && seq_leq(seg_ack, snd_nxt_)) {
+      acked = seg_ack - snd_una_;
+      if (snd_una_ == iss_) {
+        // SYN is acknowledged
+        acked--;
+        if (cold_) {
+          std::vector<uint8_t>().swap(cold_->syn_options_);
+        }
+      }
+      if (cold_) {
+        // NOTE FIN is not in the buffer, acknowledge() ignores it
+        cold_->send_buffer_.acknowledge(acked);
+      }
+      snd_una_ = seg_ack;
+      if (cold_ && cold_->rto_recovery_) {
+        if (!seq_lt(snd_una_, cold_->rto_recover_)) {
+          cold_->rto_recovery_ = false;
+        } else if (seq_lt(cold_->rto_retransmit_nxt_, snd_una_)) {
+          cold_->rto_retransmit_nxt_ = snd_una_;
+        }
+      }
+    }
+    // (rfc 7413 - 4.2.2. Client Handling of SYN-ACK)
+    //   If the SYN-ACK acknowledges only the initial sequence number, the
+    //   client SHOULD retransmit the data in the first ACK packet
+    // (the data is taken as not sent, and the next flush() sends it after
+    //  the ACK of the handshake)
+    if (segment.get_syn() && seg_ack == snd_una_ && snd_una_ != snd_nxt_ && cold_) {
+      cold_->send_buffer_.requeue();
+      snd_nxt_ = snd_una_;
+    }
+    // grow or shrink the congestion window
+    if (cold_ && !segment.get_syn() && seq_leq(seg_ack, snd_nxt_)) {
+      congestion_control& cc = cold_->congestion_control_;
+      const uint64_t rtt_samples = cc.get_stats().rtt_samples;
+      cc.on_ack(acked, cold_->ecn_ok_ && segment.get_ece(), snd_una_, snd_nxt_, tcp_clock_now());
+      if (stats() && cc.get_stats().rtt_samples != rtt_samples) {
+        stats()->on_rtt_sample(cc.get_latest_rtt());
+      }
+      // fast retransmit, or the next hole after a partial ACK
+      if (duplicate) {
+        if (cc.on_duplicate_ack(snd_nxt_ - snd_una_, snd_una_, snd_nxt_)) {
+          cold_->retransmit_due_ = true;
+        }
+      } else if (acked != 0 && cc.in_fast_recovery()) {
+        cold_->retransmit_due_ = true;
+      }
+    }
+    if (connection_stats_recorder *recorder = stats()) {
+      recorder->counters().bytes_acked += acked;
+      if (duplicate) {
+        recorder->counters().duplicate_acks++;
+      }
+      if (acked != 0) {
+        recorder->on_acked(snd_una_, tcp_clock_now());
+      }
+    }
+    // update snd_wnd_, snd_wl1_ and snd_wl2_
+    if (seg_ack == snd_una_ &&
+        (segment.get_syn() ||
+         seq_lt(snd_wl1_, seg_seq) ||
+         (snd_wl1_ == seg_seq && seq_leq(snd_wl2_, seg_ack)))) {
+      snd_wnd_ = seg_wnd;
+      snd_wl1_ = seg_seq;
+      snd_wl2_ = seg_ack;
+    }
+    // Grow the send buffer to twice what the windows let be in flight, so
+    // that they can be kept full while sent data waits to be acknowledged
+    // (like Linux's tcp_sndbuf_expand()).
+    if (acked != 0 && cold_) {
+      send_buffer& buffer = cold_->send_buffer_;
+      const size_t wanted =
+        2 * static_cast<size_t>(std::min(snd_wnd_, cold_->congestion_control_.get_cwnd()));
+      const size_t capacity = buffer.get_capacity();
+      if (wanted > capacity && capacity < SEND_BUFFER_MAX_SIZE) {
+        buffer.set_capacity(std::min(std::max(wanted, 2 * capacity), SEND_BUFFER_MAX_SIZE));
+      }
+    }
   }
-  // update rcv_nxt_
-  if (segment.get_syn() || segment.get_fin()) {
+  // update rcv_nxt_ and take in-order data into the receive buffer
+  // (out-of-order segments are dropped and acknowledged by a duplicate ACK)
+  if (segment.get_syn()) {
     rcv_nxt_ = segment.get_seq() + 1;
-  } else if (!segment.get_ack() && segment.get_body().size() == 0) {
+  } else if (!segment.get_ack() && seg_len == 0 && !segment.get_fin()) {
     rcv_nxt_ = segment.get_seq() + 1;
-  } else if (segment.get_body().size() != 0) {
-    rcv_nxt_ = segment.get_seq() + segment.get_body().size();
+  } else if (segment.get_seq() == rcv_nxt_) {
+    if (seg_len != 0) {
+      cold_state& cold_st = cold();
+      const uint32_t accepted = cold_st.receive_buffer_.write(segment.get_body_data(), seg_len);
+      rcv_nxt_ += accepted;
+      if (cold_st.stats_) {
+        cold_st.stats_->counters().bytes_received += accepted;
+      }
+      if (accepted != 0) {
+        cold_st.receive_window_.on_data_received(rcv_nxt_, tcp_clock_now());
+      }
+    }
+    // FIN is taken only if all data before it is
+    if (segment.get_fin() && rcv_nxt_ == segment.get_seq() + seg_len) {
+      rcv_nxt_++;
+    }
   }
-  // update rcv_wnd_
-  rcv_wnd_ = segment.get_window();
   // update rcv_up_
   if (segment.get_urg()) {
-    rcv_up_ = segment.get_urgent_pointer();
+    cold().rcv_up_ = segment.get_urgent_pointer();
   }
-  // update irs_
+  // update irs_ and the send MSS
   if (segment.get_syn()) {
     irs_ = segment.get_seq();
+    const tcp_options options(segment.get_options());
+    if (options.has_mss() && options.get_mss() != 0) {
+      cold().send_buffer_.set_mss(options.get_mss());
+      cold().congestion_control_.set_mss(options.get_mss());
+    }
+    // Windows are scaled only if both sides offered window scaling.
+    if (segment.get_ack() && cold_ && cold_->wscale_offered_ && options.has_window_scale()) {
+      cold_->snd_wscale_ = options.get_window_scale();
+      cold_->receive_window_.set_scale(cold_->offered_wscale_);
+    }
+  }
+  if (connection_stats_recorder *recorder = stats()) {
+    recorder->counters().segments_in++;
+    publish_stats();
+  }
+}
+
+size_t transmission_control_block::write(const uint8_t *data, const size_t size) {
+  const size_t written = cold().send_buffer_.write(data, size);
+  if (connection_stats_recorder *recorder = stats()) {
+    if (written != 0) {
+      // (data written before SYN is sent starts after it)
+      const uint32_t end_seq = snd_nxt_ + (snd_nxt_ == iss_ ? 1 : 0) + get_unsent_size();
+      recorder->on_write(end_seq, tcp_clock_now());
+    }
+    publish_stats();
+  }
+  return written;
+}
+
+size_t transmission_control_block::write(const std::vector<uint8_t>& data) {
+  return write(data.data(), data.size());
+}
+
+tcp_segment transmission_control_block::create_data_segment(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint32_t seq,
+    const bool cwr_flag,
+    const bool psh_flag,
+    const uint16_t window,
+    const byte_range body) {
+  tcp_segment seg(
+      src_ip_bytes,
+      dst_ip_bytes,
+      src_port,
+      dst_port,
+      seq,
+      rcv_nxt_,
+      false,    // ns
+      cwr_flag,
+      echo_ce(),
+      false,    // urg
+      true,     // ack
+      psh_flag,
+      false,    // rst
+      false,    // syn
+      false,    // fin
+      window,
+      0,        // urgent pointer
+      std::vector<uint8_t>(), // option
+      body.data,
+      body.size);
+  // The segment acknowledges everything received so far.
+  delayed_ack_.on_ack_sent(cold().delayed_ack_stats_, tcp_clock_now());
+  on_window_advertised(window);
+  if (connection_stats_recorder *recorder = stats()) {
+    connection_stats& counters = recorder->counters();
+    counters.segments_out++;
+    if (body.size != 0) {
+      counters.data_segments_out++;
+      counters.bytes_sent += body.size;
+    }
+  }
+  return seg;
+}
+
+std::vector<tcp_segment> transmission_control_block::flush(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window) {
+  return flush(src_ip_bytes, src_port, dst_ip_bytes, dst_port, window, SIZE_MAX);
+}
+
+std::vector<tcp_segment> transmission_control_block::flush(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window,
+    const size_t max_size) {
+  std::vector<tcp_segment> segments;
+  if (!cold_) {
+    return segments;
+  }
+  size_t budget = max_size;
+  send_buffer& buffer = cold_->send_buffer_;
+  congestion_control& cc = cold_->congestion_control_;
+  while (true) {
+    // (rfc 5681 - 3.1.) the sender MUST NOT send data with a sequence number
+    // greater than the sum of the highest acknowledged sequence number and
+    // the minimum of cwnd and rwnd.
+    const uint32_t in_flight = snd_nxt_ - snd_una_;
+    const uint32_t window_size = std::min(snd_wnd_, cc.get_cwnd());
+    const uint32_t usable_window = std::min<size_t>(
+        window_size > in_flight ? window_size - in_flight : 0, budget);
+    const uint32_t len = buffer.next_segment_size(in_flight != 0, usable_window);
+    if (len == 0) {
+      break;
+    }
+    const byte_range body = buffer.send(len);
+    // (rfc 3168 - 6.1.2. The TCP Sender)
+    //   the TCP sender ... sets the CWR flag in the TCP header of the first
+    //   new data packet sent after the window reduction
+    const bool cwr = cold_->ecn_ok_ && cc.take_cwr();
+    // psh is set on the last segment of the written data
+    segments.push_back(create_data_segment(
+        src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+        snd_nxt_, cwr, buffer.empty(), window, body));
+    snd_nxt_ += body.size;
+    budget -= body.size;
+    cc.on_data_sent(snd_nxt_, tcp_clock_now());
+  }
+  publish_stats();
+  return segments;
+}
+
+tcp_segment transmission_control_block::create_retransmit_segment(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window) {
+  if (snd_una_ == snd_nxt_) {
+    throw std::logic_error("Nothing to retransmit");
+  }
+  if (connection_stats_recorder *recorder = stats()) {
+    recorder->counters().retransmits++;
+  }
+  // SYN is not acknowledged yet
+  if (snd_una_ == iss_) {
+    return create_send_segment_at(
+        src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+        iss_, false, true, false, window);
+  }
+  const size_t unacked = get_unacked_size();
+  if (unacked == 0) {
+    // Only FIN (the last sequence number sent) is not acknowledged.
+    return create_send_segment_at(
+        src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+        snd_nxt_ - 1, true, false, true, window);
+  }
+  send_buffer& buffer = cold_->send_buffer_;
+  const size_t len = std::min<size_t>(unacked, buffer.get_mss());
+  if (connection_stats_recorder *recorder = stats()) {
+    recorder->counters().bytes_retransmitted += len;
+  }
+  return create_data_segment(
+      src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+      snd_una_, false, len == unacked, window, buffer.get_unacked(0, len));
+}
+
+std::vector<tcp_segment> transmission_control_block::flush_retransmissions(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window) {
+  std::vector<tcp_segment> segments;
+  if (!cold_ || !cold_->rto_recovery_) {
+    return segments;
+  }
+  cold_state& cold_st = *cold_;
+  send_buffer& buffer = cold_st.send_buffer_;
+  const uint32_t cwnd = cold_st.congestion_control_.get_cwnd();
+  const size_t unacked = get_unacked_size();
+  connection_stats_recorder *recorder = stats();
+  while (seq_lt(cold_st.rto_retransmit_nxt_, cold_st.rto_recover_)) {
+    // NOTE
+    // Everything sent before the timeout is taken as lost, so what is in
+    // flight is what has been resent since. The send window is not checked,
+    // as the data was in it when first sent.
+    const uint32_t offset = cold_st.rto_retransmit_nxt_ - snd_una_;
+    if (offset >= unacked) {
+      // Only FIN (the last sequence number sent before the timeout) is left.
+      if (offset >= cwnd) {
+        break;
+      }
+      segments.push_back(create_send_segment_at(
+          src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+          cold_st.rto_recover_ - 1, true, false, true, window));
+      if (recorder) {
+        recorder->counters().retransmits++;
+      }
+      cold_st.rto_retransmit_nxt_ = cold_st.rto_recover_;
+      break;
+    }
+    const size_t len = std::min<size_t>(
+        std::min<size_t>(unacked - offset, cold_st.rto_recover_ - cold_st.rto_retransmit_nxt_),
+        buffer.get_mss());
+    // (only full segments, but at least one after the timeout)
+    if (offset != 0 && (offset >= cwnd || len > cwnd - offset)) {
+      break;
+    }
+    if (recorder) {
+      recorder->counters().retransmits++;
+      recorder->counters().bytes_retransmitted += len;
+    }
+    segments.push_back(create_data_segment(
+        src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+        cold_st.rto_retransmit_nxt_, false, offset + len == unacked, window,
+        buffer.get_unacked(offset, len)));
+    cold_st.rto_retransmit_nxt_ += len;
+  }
+  publish_stats();
+  return segments;
+}
+
+tcp_segment transmission_control_block::create_send_segment_at(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint32_t seq,
+    const bool ack_flag,
+    const bool syn_flag,
+    const bool fin_flag,
+    const uint16_t window) {
+  // A retransmitted SYN offers ECN and the options of the first SYN again.
+  const bool ecn_setup = syn_flag && cold_ && cold_->ecn_offered_;
+  const std::vector<uint8_t> options =
+    syn_flag && cold_ ? cold_->syn_options_ : std::vector<uint8_t>();
+  tcp_segment seg(
+      src_ip_bytes,
+      dst_ip_bytes,
+      src_port,
+      dst_port,
+      seq,
+      ack_flag ? rcv_nxt_ : 0,
+      false,    // ns
+      ecn_setup,  // cwr
+      ecn_setup || (ack_flag && echo_ce()),  // ece
+      false,    // urg
+      ack_flag,
+      false,    // psh
+      false,    // rst
+      syn_flag,
+      fin_flag,
+      window,
+      0,        // urgent pointer
+      options,
+      std::vector<uint8_t>()  // body
+    );
+  if (ack_flag) {
+    delayed_ack_.on_ack_sent(cold().delayed_ack_stats_, tcp_clock_now());
+    on_window_advertised(window);
+  }
+  if (connection_stats_recorder *recorder = stats()) {
+    recorder->counters().segments_out++;
+  }
+  return seg;
+}
+
+bool transmission_control_block::echo_ce() const {
+  return cold_ && cold_->ecn_ok_ && cold_->ece_echo_;
+}
+
+void transmission_control_block::on_retransmission_timeout() {
+  cold_state& cold_st = cold();
+  cold_st.congestion_control_.on_retransmission_timeout(snd_nxt_ - snd_una_, snd_nxt_);
+  cold_st.retransmit_due_ = false;
+  // NOTE
+  // The segments sent before the timeout are all resent from SND.UNA as the
+  // window opens again in slow start (go-back-N, as BSD and Linux do), up to
+  // SND.NXT at the timeout (the "recover" of rfc 6582 - 3.2.).
+  cold_st.rto_recovery_ = snd_una_ != snd_nxt_;
+  cold_st.rto_recover_ = snd_nxt_;
+  cold_st.rto_retransmit_nxt_ = snd_una_;
+  if (connection_stats_recorder *recorder = stats()) {
+    recorder->counters().timeouts++;
+    publish_stats();
+  }
+}
+
+bool transmission_control_block::take_retransmit() {
+  if (!cold_ || !cold_->retransmit_due_) {
+    return false;
+  }
+  cold_->retransmit_due_ = false;
+  return snd_una_ != snd_nxt_;
+}
+
+chrono::microseconds transmission_control_block::get_rto() const {
+  if (!cold_) {
+    return congestion_control(congestion_algorithm::RENO, DEFAULT_MSS).get_rto();
+  }
+  return cold_->congestion_control_.get_rto();
+}
+
+void transmission_control_block::set_congestion_algorithm(const congestion_algorithm algorithm) {
+  cold().congestion_control_.set_algorithm(algorithm);
+}
+
+congestion_algorithm transmission_control_block::get_congestion_algorithm() const {
+  if (!cold_) {
+    return congestion_algorithm::RENO;
+  }
+  return cold_->congestion_control_.get_algorithm();
+}
+
+bool transmission_control_block::ecn_capable() const {
+  return cold_ && cold_->ecn_ok_;
+}
+
+uint64_t transmission_control_block::get_pacing_rate() const {
+  if (!cold_) {
+    return 0;
+  }
+  return cold_->congestion_control_.get_pacing_rate();
+}
+
+chrono::microseconds transmission_control_block::get_srtt() const {
+  if (!cold_) {
+    return chrono::microseconds::zero();
+  }
+  return cold_->congestion_control_.get_srtt();
+}
+
+uint32_t transmission_control_block::get_send_mss() const {
+  if (!cold_) {
+    return DEFAULT_MSS;
+  }
+  return cold_->send_buffer_.get_mss();
+}
+
+uint32_t transmission_control_block::get_cwnd() const {
+  if (!cold_) {
+    return congestion_control(congestion_algorithm::RENO, DEFAULT_MSS).get_cwnd();
+  }
+  return cold_->congestion_control_.get_cwnd();
+}
+
+const congestion_control_stats& transmission_control_block::get_congestion_control_stats() const {
+  if (!cold_) {
+    return EMPTY_CONGESTION_CONTROL_STATS;
+  }
+  return cold_->congestion_control_.get_stats();
+}
+
+size_t transmission_control_block::get_unacked_size() const {
+  if (!cold_) {
+    return 0;
+  }
+  return cold_->send_buffer_.unacked_size();
+}
+
+size_t transmission_control_block::get_unsent_size() const {
+  if (!cold_) {
+    return 0;
+  }
+  return cold_->send_buffer_.size();
+}
+
+uint32_t transmission_control_block::get_snd_una() const {
+  return snd_una_;
+}
+
+uint32_t transmission_control_block::get_snd_nxt() const {
+  return snd_nxt_;
+}
+
+uint32_t transmission_control_block::get_iss() const {
+  return iss_;
+}
+
+void transmission_control_block::set_iss(const uint32_t iss) {
+  if (snd_nxt_ != iss_) {
+    throw std::logic_error("ISS must be set before SYN is sent");
+  }
+  snd_una_ = iss;
+  snd_nxt_ = iss;
+  iss_     = iss;
+}
+
+uint32_t transmission_control_block::get_rcv_nxt() const {
+  return rcv_nxt_;
+}
+
+void transmission_control_block::on_window_advertised(const uint16_t window) {
+  cold_state& cold_st = cold();
+  cold_st.receive_window_.on_advertised(cold_st.receive_window_stats_, rcv_nxt_, window);
+  rcv_wnd_ = cold_st.receive_window_.get_window(rcv_nxt_);
+}
+
+uint16_t transmission_control_block::get_receive_window() const {
+  if (!cold_) {
+    return std::min<size_t>(default_buffer_pool().get_ring_size(), UINT16_MAX);
+  }
+  return cold_->receive_window_.select(
+      rcv_nxt_,
+      cold_->receive_buffer_.available(),
+      cold_->receive_buffer_.get_capacity(),
+      rcv_mss_);
+}
+
+uint8_t transmission_control_block::get_receive_window_scale() const {
+  const receive_window_policy& policy = get_receive_window_policy();
+  return receive_window::scale_for(
+      policy.autotuning ? policy.max_buffer_size : get_receive_buffer_size());
+}
+
+bool transmission_control_block::window_update_due() const {
+  if (!cold_) {
+    return false;
+  }
+  return cold_->receive_window_.update_due(
+      rcv_nxt_,
+      cold_->receive_buffer_.available(),
+      cold_->receive_buffer_.get_capacity(),
+      rcv_mss_);
+}
+
+void transmission_control_block::set_receive_window_policy(const receive_window_policy policy) {
+  cold().receive_window_policy_ = policy;
+}
+
+const receive_window_policy& transmission_control_block::get_receive_window_policy() const {
+  if (!cold_) {
+    return DEFAULT_RECEIVE_WINDOW_POLICY;
+  }
+  return cold_->receive_window_policy_;
+}
+
+const receive_window_stats& transmission_control_block::get_receive_window_stats() const {
+  if (!cold_) {
+    return EMPTY_RECEIVE_WINDOW_STATS;
+  }
+  return cold_->receive_window_stats_;
+}
+
+size_t transmission_control_block::get_receive_buffer_size() const {
+  if (!cold_) {
+    return default_buffer_pool().get_ring_size();
+  }
+  return cold_->receive_buffer_.get_capacity();
+}
+
+bool transmission_control_block::window_probe_needed() const {
+  return snd_wnd_ == 0 && snd_una_ == snd_nxt_ && get_unsent_size() != 0;
+}
+
+tcp_segment transmission_control_block::create_window_probe_segment(
+    const uint8_t *src_ip_bytes,
+    const uint16_t src_port,
+    const uint8_t *dst_ip_bytes,
+    const uint16_t dst_port,
+    const uint16_t window) {
+  // NOTE
+  // (rfc 1122 - 4.2.2.17 Probing Zero Windows)
+  //   Probing of zero (offered) windows MUST be supported.
+  //
+  // Like Linux, the probe carries no data: a segment whose sequence number is
+  // already acknowledged is not acceptable, and the peer answers it with an ACK.
+  return create_send_segment_at(
+      src_ip_bytes, src_port, dst_ip_bytes, dst_port,
+      snd_una_ - 1, true, false, false, window);
+}
+
+size_t transmission_control_block::get_send_space() const {
+  if (!cold_) {
+    return default_buffer_pool().get_ring_size();
+  }
+  return cold_->send_buffer_.available();
+}
+
+size_t transmission_control_block::get_send_buffer_size() const {
+  if (!cold_) {
+    return default_buffer_pool().get_ring_size();
+  }
+  return cold_->send_buffer_.get_capacity();
+}
+
+byte_range transmission_control_block::get_received() const {
+  if (!cold_) {
+    return byte_range{nullptr, 0};
+  }
+  return cold_->receive_buffer_.peek();
+}
+
+void transmission_control_block::consume_received(const size_t size) {
+  if (size == 0) {
+    return;
+  }
+  cold_state& cold_st = cold();
+  cold_st.receive_buffer_.consume(size);
+  const size_t wanted = cold_st.receive_window_.on_data_consumed(
+      cold_st.receive_window_policy_, cold_st.receive_window_stats_,
+      size, cold_st.receive_buffer_.get_capacity(), tcp_clock_now());
+  if (wanted != 0) {
+    cold_st.receive_buffer_.set_capacity(wanted);
+  }
+}
+
+void transmission_control_block::cork() {
+  cold().send_buffer_.cork();
+}
+
+void transmission_control_block::uncork() {
+  cold().send_buffer_.uncork();
+}
+
+void transmission_control_block::set_nodelay(const bool nodelay) {
+  cold().send_buffer_.set_nodelay(nodelay);
+}
+
+void transmission_control_block::set_offload_size(const uint32_t offload_size) {
+  cold().send_buffer_.set_offload_size(offload_size);
+}
+
+const send_buffer_stats& transmission_control_block::get_send_buffer_stats() const {
+  if (!cold_) {
+    return EMPTY_SEND_BUFFER_STATS;
+  }
+  return cold_->send_buffer_.get_stats();
+}
+
+transmission_control_block::cold_state& transmission_control_block::cold() {
+  if (!cold_) {
+    cold_.reset(new cold_state(default_buffer_pool()));
+  }
+  return *cold_;
+}
+
+connection_stats_recorder *transmission_control_block::stats() const {
+  return cold_ ? cold_->stats_.get() : nullptr;
+}
+
+void transmission_control_block::enable_connection_stats() {
+  cold_state& cold_st = cold();
+  if (!cold_st.stats_) {
+    cold_st.stats_.reset(new connection_stats_recorder());
+    publish_stats();
+  }
+}
+
+const connection_stats_recorder *transmission_control_block::get_connection_stats() const {
+  return stats();
+}
+
+send_limit transmission_control_block::get_send_limit() const {
+  if (snd_una_ == iss_) {
+    return send_limit::NONE;
+  }
+  const size_t unsent = get_unsent_size();
+  if (unsent == 0) {
+    return send_limit::APP;
+  }
+  // (the next segment would not fit in the window)
+  const uint32_t in_flight = snd_nxt_ - snd_una_;
+  const uint32_t next = in_flight + std::min<size_t>(unsent, get_send_mss());
+  if (next > snd_wnd_) {
+    return send_limit::RWND;
+  }
+  if (next > get_cwnd()) {
+    return send_limit::CWND;
+  }
+  return send_limit::BUSY;
+}
+
+void transmission_control_block::publish_stats() {
+  connection_stats_recorder *recorder = stats();
+  if (!recorder) {
+    return;
+  }
+  const congestion_control& cc = cold_->congestion_control_;
+  connection_stats& counters = recorder->counters();
+  counters.rtt_samples     = cc.get_stats().rtt_samples;
+  counters.min_rtt_us      = cc.get_min_rtt().count();
+  counters.srtt_us         = cc.get_srtt().count();
+  counters.rttvar_us       = cc.get_rttvar().count();
+  counters.cwnd            = cc.get_cwnd();
+  counters.ssthresh        = cc.get_ssthresh();
+  counters.snd_wnd         = snd_wnd_;
+  counters.send_mss        = cold_->send_buffer_.get_mss();
+  counters.bytes_in_flight = snd_nxt_ - snd_una_;
+  counters.pacing_rate     = cc.get_pacing_rate();
+  recorder->publish(get_send_limit(), tcp_clock_now());
+}
+
+bool transmission_control_block::has_cold_state() const {
+  return static_cast<bool>(cold_);
+}
+
+size_t transmission_control_block::get_memory_footprint() const {
+  if (!cold_) {
+    return 0;
+  }
+  return sizeof(cold_state) +
+         (cold_->stats_ ? sizeof(connection_stats_recorder) : 0) +
+         cold_->send_buffer_.get_memory_footprint() +
+         cold_->receive_buffer_.get_memory_footprint();
+}
+
+reset_action transmission_control_block::check_reset(const tcp_segment& segment) const {
+  // NOTE
+  // (rfc 5961 - 3.2. Mitigation)
+  //   1) If the RST bit is set and the sequence number is outside the
+  //      current receive window, silently drop the segment.
+  //
+  //   2) If the RST bit is set and the sequence number exactly matches the
+  //      next expected sequence number (RCV.NXT), then TCP MUST reset the
+  //      connection.
+  //
+  //   3) If the RST bit is set and the sequence number does not exactly
+  //      match the next expected sequence value, yet is within the current
+  //      receive window, TCP MUST send an acknowledgment (challenge ACK):
+  //
+  //      <SEQ=SND.NXT><ACK=RCV.NXT><CTL=ACK>
+  const uint32_t seq = segment.get_seq();
+  if (seq == rcv_nxt_) {
+    return reset_action::ACCEPT;
+  }
+  // (RCV.WND is the window of the latest ACK sent, and an old sequence
+  // number is far beyond it modulo 2**32)
+  if (seq - rcv_nxt_ >= rcv_wnd_) {
+    return reset_action::DROP;
+  }
+  return reset_action::CHALLENGE;
+}
+
+void transmission_control_block::begin_receive_burst() {
+  delayed_ack_.begin_burst();
+}
+
+void transmission_control_block::end_receive_burst() {
+  delayed_ack_.end_burst();
+}
+
+bool transmission_control_block::ack_due(const chrono::steady_clock::time_point now) const {
+  return delayed_ack_.ack_due(now);
+}
+
+bool transmission_control_block::ack_pending() const {
+  return delayed_ack_.ack_pending();
+}
+
+chrono::steady_clock::time_point transmission_control_block::get_ack_deadline() const {
+  return delayed_ack_.get_deadline();
+}
+
+void transmission_control_block::set_delayed_ack_policy(const delayed_ack_policy policy) {
+  cold().delayed_ack_policy_ = policy;
+  delayed_ack_.apply_policy(policy);
+}
+
+const delayed_ack_policy& transmission_control_block::get_delayed_ack_policy() const {
+  if (!cold_) {
+    return DEFAULT_DELAYED_ACK_POLICY;
+  }
+  return cold_->delayed_ack_policy_;
+}
+
+const delayed_ack_stats& transmission_control_block::get_delayed_ack_stats() const {
+  if (!cold_) {
+    return EMPTY_DELAYED_ACK_STATS;
   }
+  return cold_->delayed_ack_stats_;
 }
@@ -1,44 +1,165 @@
 #ifndef TRANSMISSION_CONTROL_BLOCK_H_
 #define TRANSMISSION_CONTROL_BLOCK_H_
 
+#include <chrono>
+#include <cstdint>  // for uint8_t
+#include <memory>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "byte_ring.h"
+#include "congestion_control.h"
+#include "connection_stats.h"
+#include "delayed_ack.h"
+#include "receive_buffer.h"
+#include "receive_window.h"
+#include "send_buffer.h"
 #include "tcp_segment.h"
 
+// What to do with a received RST (rfc 5961 - 3.2.).
+enum class reset_action {
+  // reset the connection
+  ACCEPT,
+  // keep the connection and send a challenge ACK
+  CHALLENGE,
+  // drop the segment
+  DROP,
+};
+
 // NOTE
 // (rfc 793 - 2.7. Connection Establishment and Clearing)
 //   There are several things that must be remembered
 //   about a connection. To store this information we imagine that there
 //   is a data structure called a Transmission Control Block (TCB).
-class transmission_control_block {
+//
+// The block is laid out to hold a large number of connections:
+//   - the sequence numbers, windows and the delayed ACK timer are packed in
+//     one cache line (64 bytes), which is all a block holds until it is used,
+//   - the rest (configuration, urgent pointers, statistics, congestion and ECN
+//     state, receive window tuning and the buffers) is kept in a separately
+//     allocated cold_state, created on first use (by the handshake at the
+//     latest) and kept until the block is released. An idle established
+//     connection holds it too, a few hundred bytes (see tcb_footprint_bench).
+//   - buffered data lives in rings of a shared buffer_pool and is given back
+//     as soon as it is consumed.
+//
+// So a data segment touches the hot line and several lines of cold_state
+// (congestion control, delayed ACK policy and statistics, ECN and the
+// receive window); a pure ACK of a connection without data in flight
+// touches fewer.
+class alignas(64) transmission_control_block {
  private:
+  struct cold_state {
+    uint32_t snd_up_;
+    uint32_t rcv_up_;
+    delayed_ack_policy delayed_ack_policy_;
+    delayed_ack_stats delayed_ack_stats_;
+    // Data written by the application and not acknowledged yet.
+    send_buffer send_buffer_;
+    // In-order data received and not read by the application yet.
+    receive_buffer receive_buffer_;
+    congestion_control congestion_control_;
+    // true if SYN was sent with ECE and CWR (ECN-setup SYN)
+    bool ecn_offered_;
+    // true if the peer replied with an ECN-setup SYN-ACK
+    bool ecn_ok_;
+    // true if the oldest unacknowledged segment should be retransmitted
+    // now (fast retransmit, see take_retransmit())
+    bool retransmit_due_;
+    // true after a retransmission timeout until rto_recover_ (SND.NXT at the
+    // timeout) is acknowledged. Data sent before the timeout is sent again
+    // from rto_retransmit_nxt_ as the congestion window opens (go-back-N).
+    bool rto_recovery_;
+    uint32_t rto_recover_;
+    uint32_t rto_retransmit_nxt_;
+    // true if ECE is set on outgoing ACKs: until CWR is received (rfc 3168),
+    // or while the last data segment was marked with CE (DCTCP, rfc 8257)
+    bool ece_echo_;
+    receive_window receive_window_;
+    receive_window_policy receive_window_policy_;
+    receive_window_stats receive_window_stats_;
+    // true if SYN was sent with the Window Scale option (of offered_wscale_)
+    bool wscale_offered_;
+    uint8_t offered_wscale_;
+    // shift of the windows received from the peer (0 if not negotiated)
+    uint8_t snd_wscale_;
+    // options of SYN (MSS, window scale, Fast Open), sent again with a
+    // retransmitted SYN and dropped once SYN is acknowledged
+    std::vector<uint8_t> syn_options_;
+    // statistics (nullptr unless enabled)
+    std::unique_ptr<connection_stats_recorder> stats_;
+    cold_state(buffer_pool& pool);
+  };
   // NOTE
   // (rfc 793 - 3.2. Terminology and 3.3. Sequence Numbers)
   //
   //   SND.UNA : unacknowledged sequence number
   //   SND.NXT : next sequence number to be sent
-  //   SND.UP  : send urgent pointer
+  //   SND.UP  : send urgent pointer (in cold_state)
   //   SND.WL1 : segment sequence number used for last window update
   //   SND.WL2 : segment acknowledgment number used for last window update
+  //   SND.WND : send window
   //   ISS     : initial send sequence number
   //
   uint32_t snd_una_;
   uint32_t snd_nxt_;
-  uint32_t snd_up_;
   uint32_t snd_wl1_;
   uint32_t snd_wl2_;
+  uint32_t snd_wnd_;
   uint32_t iss_;
   // NOTE
   // (rfc 793 - 3.2. Terminology and 3.3. Sequence Numbers)
   //
   //   RCV.NXT : next sequence number expected on an incoming segments, and
   //             is the left or lower edge of the receive window
-  //   RCV.WND : receive window
-  //   RCV,UP  : receive urgent pointer
+  //   RCV.WND : receive window (as of the latest ACK sent)
+  //   RCV,UP  : receive urgent pointer (in cold_state)
   //   IRS     : initial receive sequence number
   //
   uint32_t rcv_nxt_;
   uint32_t rcv_wnd_;
-  uint32_t rcv_up_;
   uint32_t irs_;
+  // NOTE
+  // Largest segment size received so far. This is used as the estimation of
+  // the sender's MSS to detect full-sized segments.
+  uint32_t rcv_mss_;
+  delayed_ack delayed_ack_;
+  std::unique_ptr<cold_state> cold_;
+
+  cold_state& cold();
+  // Statistics of the connection, or nullptr if they are not enabled.
+  connection_stats_recorder *stats() const;
+  // Update the gauges of the statistics and publish them.
+  void publish_stats();
+  send_limit get_send_limit() const;
+  // Returns true if ECE should be set on an outgoing ACK.
+  bool echo_ce() const;
+  // Record what SYN being sent offers (ECN, window scaling and its options).
+  void on_syn_sent(const bool ecn_setup, const std::vector<uint8_t>& options);
+  // Record the window field of a segment with ACK being sent.
+  void on_window_advertised(const uint16_t window);
+  // Create a segment carrying body at seq. The body is referred to, not copied.
+  tcp_segment create_data_segment(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint32_t seq,
+      const bool cwr_flag,
+      const bool psh_flag,
+      const uint16_t window,
+      const byte_range body);
+  // Create a segment without body at seq (for retransmitting SYN or FIN).
+  tcp_segment create_send_segment_at(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint32_t seq,
+      const bool ack_flag,
+      const bool syn_flag,
+      const bool fin_flag,
+      const uint16_t window);
  public:
   transmission_control_block();
   tcp_segment create_send_segment(
@@ -59,7 +180,185 @@ class transmission_control_block {
       const uint16_t urg_ptr,
       const std::vector<uint8_t> options,
       const std::vector<uint8_t> body);
+  // Create SYN carrying up to max_data bytes of the data written so far
+  // (TCP Fast Open, rfc 7413; 0 for a usual SYN). The options should carry
+  // the Fast Open cookie of the server. The data is referred to, not copied.
+  // If SYN-ACK acknowledges only SYN (the server did not accept the data),
+  // the data is sent again by flush().
+  //   ecn_setup : true to offer ECN (ECE and CWR are set)
+  tcp_segment create_syn_segment(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const bool ecn_setup,
+      const uint16_t window,
+      const std::vector<uint8_t> options,
+      const uint32_t max_data);
+  // Create a segment which only acknowledges received data.
+  tcp_segment create_ack_segment(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window);
+  // NOTE
+  // ECN (rfc 3168) is offered by setting ECE and CWR on SYN, and is used if the
+  // SYN-ACK has ECE and not CWR. Then ECE is set on ACKs in response to CE
+  // marks, CWR on the first data segment after the congestion window is
+  // reduced, and the caller should mark new data segments with ECT(0)
+  // (ecn_capable()).
+  //   ce_marked : true if the IP header carrying the segment was marked with CE
+  // Segments with RST are ignored; check them with check_reset() instead.
   void apply_receive_segment(const tcp_segment& segment);
+  void apply_receive_segment(const tcp_segment& segment, const bool ce_marked);
+  // Tell whether RST received in a synchronized state resets the connection.
+  // A challenge ACK is create_ack_segment().
+  reset_action check_reset(const tcp_segment& segment) const;
+  // Segments applied between begin_receive_burst() and end_receive_burst()
+  // are acknowledged by one ACK.
+  void begin_receive_burst();
+  void end_receive_burst();
+  // Returns true if a (delayed) ACK should be sent at the given time.
+  bool ack_due(const std::chrono::steady_clock::time_point now) const;
+  // Returns true if received data is waiting to be acknowledged.
+  bool ack_pending() const;
+  // Time by which the pending ACK must be sent.
+  std::chrono::steady_clock::time_point get_ack_deadline() const;
+  void set_delayed_ack_policy(const delayed_ack_policy policy);
+  const delayed_ack_policy& get_delayed_ack_policy() const;
+  const delayed_ack_stats& get_delayed_ack_stats() const;
+  // Append data to the send buffer and return the number of appended bytes,
+  // which is less than the size if the buffer is full. Data is sent by flush().
+  size_t write(const uint8_t *data, const size_t size);
+  size_t write(const std::vector<uint8_t>& data);
+  // Create data segments for the buffered data which is allowed to be sent now
+  // by the send window, Nagle's algorithm and cork.
+  // Segments refer to the send buffer, which keeps the data until it is
+  // acknowledged. Marshal them before applying the acknowledging segment.
+  std::vector<tcp_segment> flush(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window);
+  // Same as above, but sends at most max_size bytes (e.g. the quantum a
+  // pacer releases at a time).
+  std::vector<tcp_segment> flush(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window,
+      const size_t max_size);
+  // Create a segment resending the oldest unacknowledged part of the sequence
+  // space: SYN, data (up to MSS, straight from the send buffer) or FIN.
+  // Throws if nothing is waiting to be acknowledged.
+  tcp_segment create_retransmit_segment(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window);
+  // Must be called when the retransmission timer expires (shrinks the congestion
+  // window). Everything in flight is taken as lost: flush_retransmissions()
+  // sends it again, starting at SND.UNA.
+  void on_retransmission_timeout();
+  // Create segments resending the data (and FIN) sent before the last
+  // retransmission timeout and not acknowledged yet, as far as the congestion
+  // window allows. Send them before the segments of flush(). Segments refer to
+  // the send buffer, as those of flush() do.
+  std::vector<tcp_segment> flush_retransmissions(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window);
+  // Returns true once after the 3rd duplicate ACK in a row (fast retransmit,
+  // rfc 5681) and after each partial ACK in fast recovery (rfc 6582), when
+  // create_retransmit_segment() should be sent without waiting for the timer.
+  bool take_retransmit();
+  // Retransmission timeout from the measured round trip time (rfc 6298),
+  // before any backoff.
+  std::chrono::microseconds get_rto() const;
+  void set_congestion_algorithm(const congestion_algorithm algorithm);
+  congestion_algorithm get_congestion_algorithm() const;
+  // Returns true if ECN has been negotiated.
+  bool ecn_capable() const;
+  uint32_t get_cwnd() const;
+  // Rate at which data should be sent (bytes per second), or 0 if not known yet.
+  uint64_t get_pacing_rate() const;
+  // Smoothed round trip time (0 until measured).
+  std::chrono::microseconds get_srtt() const;
+  // MSS of the peer (segment size sent).
+  uint32_t get_send_mss() const;
+  const congestion_control_stats& get_congestion_control_stats() const;
+  // Bytes sent and not acknowledged yet.
+  size_t get_unacked_size() const;
+  // Bytes written and not sent yet.
+  size_t get_unsent_size() const;
+  uint32_t get_snd_una() const;
+  uint32_t get_snd_nxt() const;
+  uint32_t get_iss() const;
+  // Replace the initial send sequence number chosen at construction
+  // (e.g. to start above an old connection on the same 4-tuple).
+  // Must be called before SYN is sent.
+  void set_iss(const uint32_t iss);
+  uint32_t get_rcv_nxt() const;
+  // Window field for the next segment: free space of the receive buffer,
+  // scaled by the negotiated shift, and held back to avoid silly windows.
+  uint16_t get_receive_window() const;
+  // Shift to offer in the Window Scale option of SYN (enough for the
+  // largest buffer auto-tuning may choose). The window is scaled only if
+  // SYN has the option and SYN-ACK has it too.
+  uint8_t get_receive_window_scale() const;
+  // Returns true if the application has read enough data that the peer
+  // should be told about the larger window right away.
+  bool window_update_due() const;
+  void set_receive_window_policy(const receive_window_policy policy);
+  const receive_window_policy& get_receive_window_policy() const;
+  const receive_window_stats& get_receive_window_stats() const;
+  // Capacity of the receive buffer (grown by auto-tuning).
+  size_t get_receive_buffer_size() const;
+  // Returns true if data waits for the send window of the peer to open and
+  // nothing is in flight, so that the window should be probed.
+  bool window_probe_needed() const;
+  // Create a zero window probe: an ACK with an old sequence number, which
+  // the peer answers with an ACK carrying its current window.
+  tcp_segment create_window_probe_segment(
+      const uint8_t *src_ip_bytes,
+      const uint16_t src_port,
+      const uint8_t *dst_ip_bytes,
+      const uint16_t dst_port,
+      const uint16_t window);
+  // Bytes which can be written without exceeding the send buffer. The send
+  // buffer grows with the windows (up to SEND_BUFFER_MAX_SIZE) as data is
+  // acknowledged.
+  size_t get_send_space() const;
+  // Capacity of the send buffer.
+  size_t get_send_buffer_size() const;
+  // Received data not read yet, without copying. Valid until consume_received().
+  byte_range get_received() const;
+  // Drop size bytes read by the application. The receive buffer may be grown here.
+  void consume_received(const size_t size);
+  void cork();
+  void uncork();
+  void set_nodelay(const bool nodelay);
+  // Maximum segment size accepted by the device (TSO/GSO). Buffered data is
+  // packed into segments of up to this size at flush time.
+  void set_offload_size(const uint32_t offload_size);
+  const send_buffer_stats& get_send_buffer_stats() const;
+  // Collect statistics of the connection (connection_stats) from now on.
+  // They take a few KB per connection (mostly histograms), so they are off
+  // by default.
+  void enable_connection_stats();
+  // Statistics to be read by any thread, or nullptr if not enabled.
+  const connection_stats_recorder *get_connection_stats() const;
+  // Returns true if the cold state has been allocated.
+  bool has_cold_state() const;
+  // Memory held by this block besides the block itself (cold state and
+  // buffer rings), for footprint measurement.
+  size_t get_memory_footprint() const;
 };
 
 #endif  // TRANSMISSION_CONTROL_BLOCK_H_
@@ -0,0 +1,294 @@
+#include <algorithm>    // for std::min(), std::swap()
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>      // for std::exchange()
+#include <vector>
+
+#include "connection_table.h"
+#include "event_loop.h"
+#include "ip_packet.h"
+#include "packet_link.h"
+#include "raw_socket_link.h"
+#include "task.h"
+#include "tcp_clock.h"
+#include "tcp_connection.h"
+#include "tcp_segment.h"
+#include "trace_writer.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const chrono::milliseconds TIMER_TICK(1);
+// A segment of 1500 bytes takes 12 us at 1 Gbps. Pacers release about 1 ms
+// of data at a time, so this is fine enough.
+const chrono::microseconds PACING_TICK(10);
+// Interval at which TIME-WAIT entries whose 2 MSL has passed are dropped
+// (they are ignored meanwhile).
+const chrono::seconds TIME_WAIT_EXPIRY_INTERVAL(1);
+// Packets processed before coroutines get a chance to run.
+const int MAX_BATCH_PACKETS = 64;
+
+// IP and TCP headers without options
+const uint32_t IP_TCP_HEADER_SIZE = 20 + 20;
+// Advertised if the MTU of the link is unknown (Ethernet MTU)
+const uint16_t DEFAULT_ADVERTISED_MSS = 1500 - IP_TCP_HEADER_SIZE;
+} // namespace
+
+// Coroutine which owns a spawned task and counts it until it finishes.
+struct event_loop::detached_task {
+  struct promise_type : frame_allocated_promise {
+    detached_task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+event_loop::event_loop(const std::string& ifname)
+  : own_link_(std::make_unique<raw_socket_link>(ifname)),
+    link_(*own_link_),
+    timers_(TIMER_TICK, tcp_clock_now()),
+    pacer_(PACING_TICK, tcp_clock_now()),
+    pacing_(pacing_mode::INTERNAL),
+    time_wait_(tcp_clock_now()),
+    time_wait_timer_(on_time_wait_timer, this),
+    tasks_(0) {
+  link_.get_src_ip().host_order(src_ip_bytes_);
+}
+
+event_loop::event_loop(packet_link& link)
+  : link_(link),
+    timers_(TIMER_TICK, tcp_clock_now()),
+    pacer_(PACING_TICK, tcp_clock_now()),
+    pacing_(pacing_mode::INTERNAL),
+    time_wait_(tcp_clock_now()),
+    time_wait_timer_(on_time_wait_timer, this),
+    tasks_(0) {
+  link_.get_src_ip().host_order(src_ip_bytes_);
+}
+
+event_loop::~event_loop() = default;
+
+event_loop::detached_task event_loop::run_detached(event_loop& loop, task<void> t) {
+  try {
+    co_await t;
+  } catch (...) {
+    if (!loop.exception_) {
+      loop.exception_ = std::current_exception();
+    }
+  }
+  loop.tasks_--;
+}
+
+void event_loop::spawn(task<void> t) {
+  tasks_++;
+  run_detached(*this, std::move(t));
+}
+
+void event_loop::run() {
+  while (true) {
+    run_ready();
+    if (tasks_ == 0) {
+      break;
+    }
+    // Sleep until a packet arrives or the next timer expires.
+    const bool readable = link_.wait(std::min(timers_.get_next_expiry(), pacer_.get_next_expiry()));
+    if (readable) {
+      receive_batch();
+    }
+    const chrono::steady_clock::time_point now = tcp_clock_now();
+    pacer_.advance(now);
+    timers_.advance(now);
+  }
+  if (exception_) {
+    std::rethrow_exception(std::exchange(exception_, nullptr));
+  }
+}
+
+void event_loop::receive_batch() {
+  for (int i = 0; i < MAX_BATCH_PACKETS; ++i) {
+    if (!link_.try_recv(rcv_buf_)) {
+      break;
+    }
+    process_packet(rcv_buf_);
+  }
+  // Acknowledge and send data once per connection for the whole batch.
+  for (tcp_connection *conn : touched_) {
+    conn->end_burst();
+  }
+  touched_.clear();
+}
+
+void event_loop::process_packet(const std::vector<uint8_t>& packet) {
+  try {
+    const ip_packet pkt(packet);
+    if (pkt.get_protocol() != PROTOCOL_TCP) {
+      return;
+    }
+    const tcp_segment seg(pkt.get_body());
+    uint8_t saddr[IP_ADDR_LEN];
+    pkt.get_saddr(saddr);
+    uint8_t daddr[IP_ADDR_LEN];
+    pkt.get_daddr(daddr);
+    const connection_key key =
+      make_connection_key(daddr, seg.get_dst_port(), saddr, seg.get_src_port());
+    const uint32_t index = connections_.find(key);
+    if (index == CONNECTION_NOT_FOUND) {
+      process_time_wait_segment(key, saddr, seg);
+      return;
+    }
+    trace_segment(trace_direction::RECEIVED, pkt, seg);
+    tcp_connection *conn = owners_[index];
+    if (conn->begin_burst()) {
+      touched_.push_back(conn);
+    }
+    conn->on_segment(seg, pkt.get_ecn() == IP_ECN_CE);
+  } catch (const std::invalid_argument&) {
+    // Malformed packet
+  }
+}
+
+void event_loop::on_time_wait_timer(void *arg) {
+  event_loop& loop = *static_cast<event_loop *>(arg);
+  loop.time_wait_.expire(tcp_clock_now());
+  if (loop.time_wait_.size() != 0) {
+    loop.arm_time_wait_timer();
+  }
+}
+
+void event_loop::arm_time_wait_timer() {
+  if (!time_wait_timer_.armed()) {
+    timers_.arm_after(time_wait_timer_, TIME_WAIT_EXPIRY_INTERVAL);
+  }
+}
+
+bool event_loop::process_time_wait_segment(
+    const connection_key& key, const uint8_t *remote_ip_bytes, const tcp_segment& seg) {
+  time_wait_entry state;
+  bool ack = false;
+  if (!time_wait_.on_segment(key, seg.get_fin(), tcp_clock_now(), state, ack)) {
+    return false;
+  }
+  if (ack) {
+    // NOTE The peer is looked up in the neighbor cache again, as TIME-WAIT
+    // does not keep its link address. This is rare: only when our ACK of its
+    // FIN was lost. The loop must not wait for ARP, so on a miss the ACK is
+    // dropped and the neighbor is resolved in the background; the peer
+    // retransmits its FIN again.
+    mac_addr remote_mac;
+    try {
+      if (!link_.lookup_neighbor(remote_ip_bytes, remote_mac)) {
+        link_.resolve_neighbor(remote_ip_bytes, [](const ip_addr&, const bool, const mac_addr&) {});
+        return true;
+      }
+    } catch (const std::runtime_error&) {
+      // No route to the peer any more
+      return true;
+    }
+    uint8_t remote_mac_bytes[MAC_ADDR_LEN];
+    remote_mac.host_order(remote_mac_bytes);
+    const tcp_segment ack_seg(
+        src_ip_bytes_, remote_ip_bytes, key.local_port, key.remote_port,
+        state.snd_nxt, state.rcv_nxt,
+        false,  // ns
+        false,  // cwr
+        false,  // ece
+        false,  // urg
+        true,   // ack
+        false,  // psh
+        false,  // rst
+        false,  // syn
+        false,  // fin
+        state.window,
+        0,      // urgent pointer
+        std::vector<uint8_t>(), // option
+        std::vector<uint8_t>()  // body
+      );
+    send(remote_mac_bytes, remote_ip_bytes, ack_seg, IP_ECN_NOT_ECT);
+  }
+  return true;
+}
+
+uint16_t event_loop::get_advertised_mss() const {
+  // The MTU of the link applies to the connections opened from now on.
+  const uint32_t mtu = link_.get_mtu();
+  return mtu > IP_TCP_HEADER_SIZE ? mtu - IP_TCP_HEADER_SIZE : DEFAULT_ADVERTISED_MSS;
+}
+
+void event_loop::run_ready() {
+  std::vector<std::coroutine_handle<>> resuming;
+  while (!ready_.empty()) {
+    std::swap(resuming, ready_);
+    for (std::coroutine_handle<> h : resuming) {
+      h.resume();
+    }
+    resuming.clear();
+  }
+}
+
+void event_loop::wake(std::coroutine_handle<>& waiter) {
+  if (waiter) {
+    ready_.push_back(std::exchange(waiter, nullptr));
+  }
+}
+
+void event_loop::send(
+    const uint8_t *dst_mac_bytes,
+    const uint8_t *dst_ip_bytes,
+    const tcp_segment& seg,
+    const uint8_t tos) {
+  send(dst_mac_bytes, dst_ip_bytes, seg, tos, chrono::steady_clock::time_point());
+}
+
+void event_loop::send(
+    const uint8_t *dst_mac_bytes,
+    const uint8_t *dst_ip_bytes,
+    const tcp_segment& seg,
+    const uint8_t tos,
+    const chrono::steady_clock::time_point departure) {
+  const ip_packet packet(PROTOCOL_TCP, tos, src_ip_bytes_, dst_ip_bytes, seg.marshal());
+  trace_segment(trace_direction::SENT, packet, seg);
+  link_.send(
+      dst_mac_bytes, packet.marshal(),
+      pacing_ == pacing_mode::TXTIME ? departure : chrono::steady_clock::time_point());
+}
+
+void event_loop::set_pacing(const pacing_mode mode) {
+  pacing_ = mode;
+  if (mode == pacing_mode::TXTIME && !link_.enable_txtime()) {
+    pacing_ = pacing_mode::INTERNAL;
+  }
+}
+
+pacing_mode event_loop::get_pacing() const {
+  return pacing_;
+}
+
+const ip_addr& event_loop::get_src_ip() const {
+  return link_.get_src_ip();
+}
+
+timer_wheel& event_loop::get_timers() {
+  return timers_;
+}
+
+fast_open_cache& event_loop::get_fast_open_cache() {
+  return fast_open_;
+}
+
+const time_wait_table& event_loop::get_time_wait_table() const {
+  return time_wait_;
+}
+
+const port_allocator& event_loop::get_port_allocator() const {
+  return ports_;
+}
+
+void event_loop::set_capture(pcapng_writer *capture) {
+  link_.set_capture(capture);
+}
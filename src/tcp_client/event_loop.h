@@ -0,0 +1,144 @@
+#ifndef EVENT_LOOP_H_
+#define EVENT_LOOP_H_
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "connection_table.h"
+#include "fast_open_cache.h"
+#include "ip_addr.h"
+#include "packet_link.h"
+#include "port_allocator.h"
+#include "task.h"
+#include "tcb_slab.h"
+#include "tcp_segment.h"
+#include "time_wait_table.h"
+#include "timer_wheel.h"
+
+class tcp_connection;
+
+// How data segments of a connection are spread over time.
+enum class pacing_mode {
+  // Segments are sent as soon as the windows allow.
+  NONE,
+  // Segments are released by the loop at the pacing rate of each connection.
+  INTERNAL,
+  // Like INTERNAL, but segments are handed to the kernel a little ahead of
+  // time with their departure times (SO_TXTIME), so that a qdisc such as fq
+  // or etf sends them at the exact time.
+  TXTIME,
+};
+
+// NOTE
+// Single threaded loop driving any number of tcp_connections.
+//
+// The loop waits for packets of its packet_link (a raw socket of an
+// interface, or a simulated link) and for the earliest timer of the timer
+// wheel, on the clock of tcp_clock_now(). Received segments are demultiplexed to their
+// connection by the connection table, and coroutines waiting on a connection
+// are resumed once the whole batch of received packets has been processed,
+// so that the segments of a batch are acknowledged by one ACK.
+//
+// Transmissions are paced (see pacing_mode): each connection computes the
+// departure time of its next segments from its pacing rate, and waits for it
+// on a second, fine grained timer wheel. The wheel is the time-ordered
+// release queue shared by all connections, like the flows of the fq qdisc.
+//
+// All connections and tasks of a loop must be used on the thread running it.
+class event_loop {
+  friend class tcp_connection;
+ private:
+  struct detached_task;
+
+  // the link created by the loop (nullptr if given to it)
+  std::unique_ptr<packet_link> own_link_;
+  packet_link& link_;
+  uint8_t src_ip_bytes_[IP_ADDR_LEN];
+  timer_wheel timers_;
+  // pacing timers of connections
+  timer_wheel pacer_;
+  pacing_mode pacing_;
+  // Fast Open cookies of the servers connected to
+  fast_open_cache fast_open_;
+  tcb_slab tcbs_;
+  connection_table connections_;
+  // Connections closed actively, until 2 MSL has passed
+  time_wait_table time_wait_;
+  // Drops expired entries of time_wait_ (armed while it has entries)
+  timer_wheel_timer time_wait_timer_;
+  // Source ports of connections which do not choose one
+  port_allocator ports_;
+  // Connection which owns each block of tcbs_ (by index).
+  std::vector<tcp_connection *> owners_;
+  // Coroutines to be resumed.
+  std::vector<std::coroutine_handle<>> ready_;
+  // Connections which received segments in the current batch.
+  std::vector<tcp_connection *> touched_;
+  std::vector<uint8_t> rcv_buf_;
+  // Spawned tasks not finished yet.
+  size_t tasks_;
+  // Exception of the first spawned task which failed.
+  std::exception_ptr exception_;
+
+  static detached_task run_detached(event_loop& loop, task<void> t);
+  void receive_batch();
+  void process_packet(const std::vector<uint8_t>& packet);
+  // Acknowledge a retransmitted FIN of a connection in TIME-WAIT.
+  // Returns false if the connection is not in TIME-WAIT.
+  bool process_time_wait_segment(
+      const connection_key& key, const uint8_t *remote_ip_bytes, const tcp_segment& seg);
+  void run_ready();
+  static void on_time_wait_timer(void *arg);
+  // Used by tcp_connection when a connection enters TIME-WAIT.
+  void arm_time_wait_timer();
+  // MTU of the link minus ip and tcp headers
+  uint16_t get_advertised_mss() const;
+  // Used by tcp_connection
+  void wake(std::coroutine_handle<>& waiter);
+  //   tos : TOS of the IP header (e.g. IP_ECN_ECT_0 to mark the packet as ECN capable)
+  void send(
+      const uint8_t *dst_mac_bytes,
+      const uint8_t *dst_ip_bytes,
+      const tcp_segment& seg,
+      const uint8_t tos);
+  // Send a segment which should leave the host at the departure time.
+  void send(
+      const uint8_t *dst_mac_bytes,
+      const uint8_t *dst_ip_bytes,
+      const tcp_segment& seg,
+      const uint8_t tos,
+      const std::chrono::steady_clock::time_point departure);
+ public:
+  // Use the interface of the given name (its addresses are taken from the kernel).
+  // Throws std::runtime_error if there is no such interface or it has no IPv4 address.
+  explicit event_loop(const std::string& ifname);
+  // Use the given link (e.g. of a link_simulator), which must outlive the loop.
+  explicit event_loop(packet_link& link);
+  event_loop(const event_loop&) = delete;
+  event_loop& operator=(const event_loop&) = delete;
+  ~event_loop();
+  // Start the task. It runs until its first suspension right away, and the
+  // rest is driven by run().
+  void spawn(task<void> t);
+  // Run until all spawned tasks finish. Rethrows the exception of the first
+  // task which failed.
+  void run();
+  const ip_addr& get_src_ip() const;
+  timer_wheel& get_timers();
+  // TXTIME falls back to INTERNAL if the kernel does not support SO_TXTIME.
+  void set_pacing(const pacing_mode mode);
+  pacing_mode get_pacing() const;
+  fast_open_cache& get_fast_open_cache();
+  const time_wait_table& get_time_wait_table() const;
+  const port_allocator& get_port_allocator() const;
+  // Capture the frames (IP and ARP) of the loop (nullptr to stop).
+  void set_capture(pcapng_writer *capture);
+};
+
+#endif  // EVENT_LOOP_H_
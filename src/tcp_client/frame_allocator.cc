@@ -0,0 +1,69 @@
+#include <cstring>  // for std::memset()
+#include <new>
+
+#include "frame_allocator.h"
+
+namespace {
+// Sizes larger than the cached ones give a class >= FRAME_ALLOCATOR_CLASSES.
+size_t size_class(const size_t size) {
+  return size == 0 ? 0 : (size - 1) / FRAME_ALLOCATOR_GRANULE;
+}
+} // namespace
+
+frame_allocator::frame_allocator(const size_t max_cached_frames)
+  : max_cached_frames_(max_cached_frames) {
+  std::memset(free_lists_, 0, sizeof(free_lists_));
+  std::memset(free_counts_, 0, sizeof(free_counts_));
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+frame_allocator::~frame_allocator() {
+  for (size_t c = 0; c < FRAME_ALLOCATOR_CLASSES; ++c) {
+    while (free_lists_[c] != nullptr) {
+      free_frame *frame = free_lists_[c];
+      free_lists_[c] = frame->next_;
+      ::operator delete(frame);
+    }
+  }
+}
+
+void *frame_allocator::allocate(const size_t size) {
+  stats_.frames_in_use++;
+  const size_t c = size_class(size);
+  if (c >= FRAME_ALLOCATOR_CLASSES) {
+    stats_.heap_allocations++;
+    return ::operator new(size);
+  }
+  if (free_lists_[c] != nullptr) {
+    free_frame *frame = free_lists_[c];
+    free_lists_[c] = frame->next_;
+    free_counts_[c]--;
+    stats_.reuses++;
+    return frame;
+  }
+  stats_.heap_allocations++;
+  // Allocate the whole class so that the frame can serve any size of the class.
+  return ::operator new((c + 1) * FRAME_ALLOCATOR_GRANULE);
+}
+
+void frame_allocator::deallocate(void *frame, const size_t size) {
+  stats_.frames_in_use--;
+  const size_t c = size_class(size);
+  if (c >= FRAME_ALLOCATOR_CLASSES || free_counts_[c] >= max_cached_frames_) {
+    ::operator delete(frame);
+    return;
+  }
+  free_frame *f = static_cast<free_frame *>(frame);
+  f->next_ = free_lists_[c];
+  free_lists_[c] = f;
+  free_counts_[c]++;
+}
+
+const frame_allocator_stats& frame_allocator::get_stats() const {
+  return stats_;
+}
+
+frame_allocator& default_frame_allocator() {
+  thread_local frame_allocator allocator(DEFAULT_FRAME_ALLOCATOR_MAX_CACHED_FRAMES);
+  return allocator;
+}
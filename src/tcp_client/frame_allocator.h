@@ -0,0 +1,51 @@
+#ifndef FRAME_ALLOCATOR_H_
+#define FRAME_ALLOCATOR_H_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+const size_t FRAME_ALLOCATOR_GRANULE = 64;
+const size_t FRAME_ALLOCATOR_CLASSES = 16;  // frames up to 1024 bytes are cached
+const size_t DEFAULT_FRAME_ALLOCATOR_MAX_CACHED_FRAMES = 1024;  // per size class
+
+struct frame_allocator_stats {
+  uint64_t heap_allocations;  // frames allocated from the heap
+  uint64_t reuses;            // frames taken from a free list
+  uint64_t frames_in_use;
+};
+
+// NOTE
+// Allocator of coroutine frames.
+// Every call of a coroutine (e.g. tcp_connection::read()) needs a frame whose
+// size is fixed per coroutine function. Freed frames are kept in free lists
+// per size class (64 byte granularity), so that once the loop reaches a
+// steady state, awaiting an operation does not touch the heap.
+// Each list keeps at most max_cached_frames frames, which bounds the memory
+// kept after a burst of connections. Larger frames go to the heap directly.
+//
+// An allocator is not thread safe. Frames must be freed on the thread which
+// allocated them (see default_frame_allocator()).
+class frame_allocator {
+ private:
+  struct free_frame {
+    free_frame *next_;
+  };
+  free_frame *free_lists_[FRAME_ALLOCATOR_CLASSES];
+  size_t free_counts_[FRAME_ALLOCATOR_CLASSES];
+  size_t max_cached_frames_;
+  frame_allocator_stats stats_;
+ public:
+  frame_allocator(const size_t max_cached_frames);
+  frame_allocator(const frame_allocator&) = delete;
+  frame_allocator& operator=(const frame_allocator&) = delete;
+  ~frame_allocator();
+  void *allocate(const size_t size);
+  // size must be the one given to allocate().
+  void deallocate(void *frame, const size_t size);
+  const frame_allocator_stats& get_stats() const;
+};
+
+// Allocator of the calling thread.
+frame_allocator& default_frame_allocator();
+
+#endif  // FRAME_ALLOCATOR_H_
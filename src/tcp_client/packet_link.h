@@ -0,0 +1,60 @@
+#ifndef PACKET_LINK_H_
+#define PACKET_LINK_H_
+
+#include <chrono>
+#include <cstdint>  // for uint8_t, uint32_t
+#include <functional>
+#include <vector>
+
+#include "ip_addr.h"
+#include "mac_addr.h"
+
+class pcapng_writer;
+
+// Called once by packet_link::resolve_neighbor() with the next hop.
+// mac is all zero unless ok.
+using neighbor_callback =
+  std::function<void(const ip_addr& next_hop, const bool ok, const mac_addr& mac)>;
+
+// NOTE
+// Where an event_loop sends and receives its IP packets, and how it waits
+// for them. raw_socket_link is an interface of the kernel (a raw socket,
+// routes and ARP); link_sim has one which carries the packets over a
+// simulated link, so that the same loop and tcp_connections run there.
+//
+// The loop reads the time from tcp_clock_now(), so a link which simulates
+// time must also set the virtual clock of the thread (set_tcp_virtual_clock()).
+class packet_link {
+ public:
+  virtual ~packet_link() = default;
+  virtual const ip_addr& get_src_ip() const = 0;
+  // MTU of the link. It may change while the loop runs.
+  virtual uint32_t get_mtu() const = 0;
+  // Send an IP packet to the link address. It leaves at departure if the
+  // link supports departure times (see enable_txtime()), or right away
+  // (always for a departure of time_point()).
+  virtual void send(
+      const uint8_t *dst_mac_bytes,
+      const std::vector<uint8_t>& packet,
+      const std::chrono::steady_clock::time_point departure) = 0;
+  // Take a received IP packet. Returns false if there is none (it does not wait).
+  virtual bool try_recv(std::vector<uint8_t>& packet) = 0;
+  // Wait until packets arrive or the deadline (time_point::max() for none),
+  // and do the work of the link meanwhile (e.g. run neighbor callbacks).
+  // Returns true if packets may be received.
+  virtual bool wait(const std::chrono::steady_clock::time_point deadline) = 0;
+  // Take the link address of the next hop to the destination if it is known.
+  // Throws std::runtime_error if there is no route to the destination.
+  virtual bool lookup_neighbor(const uint8_t *dst_ip_bytes, mac_addr& mac) = 0;
+  // Resolve the link address of the next hop to the destination. The
+  // callback runs in wait() (or at once if the address is known).
+  // Throws std::runtime_error if there is no route to the destination.
+  virtual void resolve_neighbor(const uint8_t *dst_ip_bytes, const neighbor_callback& callback) = 0;
+  // Send packets at their departure times from now on. Returns false if the
+  // link cannot, and departure times are ignored.
+  virtual bool enable_txtime() = 0;
+  // Capture the frames of the link (nullptr to stop).
+  virtual void set_capture(pcapng_writer *capture) = 0;
+};
+
+#endif  // PACKET_LINK_H_
@@ -0,0 +1,188 @@
+#include <algorithm>    // for std::max(), std::min()
+#include <cerrno>       // for errno
+#include <chrono>
+#include <cstring>      // for std::strerror()
+#include <ctime>        // for struct timespec
+#include <net/ethernet.h>  // for ETH_P_IP
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>  // for epoll_create1(), epoll_ctl(), epoll_pwait2()
+#include <unistd.h>     // for close()
+#include <vector>
+
+#include "interface_table.h"
+#include "raw_socket_link.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// Large enough for any IPv4 packet.
+const size_t MAX_PACKET_SIZE = 65536;
+// Kernel queue of the socket. Room for the windows of many connections.
+const int SOCKET_RECEIVE_BUFFER_SIZE = 32 * 1024 * 1024;
+
+interface_info find_interface(const interface_table& interfaces, const std::string& ifname) {
+  interface_info info;
+  if (!interfaces.find(ifname, info)) {
+    throw std::runtime_error("No such interface: " + ifname);
+  }
+  if (info.addresses.empty()) {
+    throw std::runtime_error("No IPv4 address on " + ifname);
+  }
+  return info;
+}
+
+mac_addr get_mac_addr(const interface_info& info) {
+  mac_addr addr;
+  addr.from_host_order(info.mac);
+  return addr;
+}
+
+ip_addr get_ip_addr(const interface_info& info) {
+  ip_addr addr;
+  addr.from_host_order(info.addresses.front().ip);
+  return addr;
+}
+} // namespace
+
+raw_socket_link::raw_socket_link(const std::string& ifname)
+  : ifname_(ifname),
+    interface_(find_interface(interfaces_, ifname)),
+    ifindex_(interface_.ifindex),
+    src_mac_(get_mac_addr(interface_)),
+    src_ip_(get_ip_addr(interface_)),
+    sock_(ETH_P_IP),
+    epoll_fd_(-1),
+    resolver_(ifname, src_mac_, src_ip_, routes_),
+    txtime_(false) {
+  sock_.set_receive_buffer_size(SOCKET_RECEIVE_BUFFER_SIZE);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ == -1) {
+    std::string msg = "Failed to epoll_create1: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  // ARP frames are received as well, so that the neighbor cache learns
+  // (e.g. gratuitous ARP) and refreshes its entries without blocking, and
+  // so are changes of the interfaces, routes and neighbors of the kernel.
+  for (const int fd : {sock_.get_fd(), resolver_.get_fd(), routes_.get_fd(), interfaces_.get_fd()}) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      std::string msg = "Failed to epoll_ctl: ";
+      msg += std::strerror(errno);
+      close(epoll_fd_);
+      throw std::runtime_error(msg);
+    }
+  }
+}
+
+raw_socket_link::~raw_socket_link() {
+  close(epoll_fd_);
+}
+
+const ip_addr& raw_socket_link::get_src_ip() const {
+  return src_ip_;
+}
+
+uint32_t raw_socket_link::get_mtu() const {
+  return interface_.mtu;
+}
+
+void raw_socket_link::send(
+    const uint8_t *dst_mac_bytes,
+    const std::vector<uint8_t>& packet,
+    const chrono::steady_clock::time_point departure) {
+  if (!txtime_ || departure == chrono::steady_clock::time_point()) {
+    sock_.send(ifindex_, dst_mac_bytes, packet);
+    return;
+  }
+  // NOTE steady_clock is CLOCK_MONOTONIC, the clock given to SO_TXTIME.
+  const uint64_t txtime_ns =
+    chrono::duration_cast<chrono::nanoseconds>(departure.time_since_epoch()).count();
+  sock_.send(ifindex_, dst_mac_bytes, packet, txtime_ns);
+}
+
+bool raw_socket_link::try_recv(std::vector<uint8_t>& packet) {
+  packet.clear();
+  return sock_.try_recv(MAX_PACKET_SIZE, packet);
+}
+
+bool raw_socket_link::wait(const chrono::steady_clock::time_point deadline) {
+  // (epoll_pwait2() takes the timeout in nanoseconds, as pacing needs)
+  struct timespec timeout = {};
+  struct timespec *timeout_ptr = nullptr;
+  const chrono::steady_clock::time_point resolver_next = resolver_.get_next_expiry();
+  const chrono::steady_clock::time_point next = std::min(deadline, resolver_next);
+  if (next != chrono::steady_clock::time_point::max()) {
+    const chrono::nanoseconds wait = std::max<chrono::nanoseconds>(
+        next - chrono::steady_clock::now(), chrono::nanoseconds::zero());
+    timeout.tv_sec  = chrono::duration_cast<chrono::seconds>(wait).count();
+    timeout.tv_nsec = (wait % chrono::seconds(1)).count();
+    timeout_ptr = &timeout;
+  }
+  struct epoll_event events[4];
+  const int n = epoll_pwait2(epoll_fd_, events, 4, timeout_ptr, nullptr);
+  if (n == -1 && errno != EINTR) {
+    std::string msg = "Failed to epoll_pwait2: ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  bool readable = false;
+  bool arp_ready = false;
+  for (int i = 0; i < n; ++i) {
+    if (events[i].data.fd == sock_.get_fd()) {
+      readable = true;
+    } else if (events[i].data.fd == routes_.get_fd()) {
+      routes_.process();
+    } else if (events[i].data.fd == interfaces_.get_fd()) {
+      // The addresses stay those taken at construction, as connections are
+      // bound to them. The MTU applies to the connections opened from now on.
+      interfaces_.process();
+      interfaces_.find(ifindex_, interface_);
+    } else {
+      arp_ready = true;
+    }
+  }
+  if (arp_ready || chrono::steady_clock::now() >= resolver_next) {
+    resolver_.process();
+  }
+  return readable;
+}
+
+ip_addr raw_socket_link::get_next_hop(const uint8_t *dst_ip_bytes) const {
+  uint8_t next_hop_bytes[IP_ADDR_LEN];
+  ip_addr next_hop;
+  if (!routes_.lookup_route(dst_ip_bytes, ifindex_, next_hop_bytes)) {
+    next_hop.from_host_order(dst_ip_bytes);
+    throw std::runtime_error("No route to " + next_hop.to_string() + " via " + ifname_);
+  }
+  next_hop.from_host_order(next_hop_bytes);
+  return next_hop;
+}
+
+bool raw_socket_link::lookup_neighbor(const uint8_t *dst_ip_bytes, mac_addr& mac) {
+  // (rfc 1812 - 5.2.4.3) The link address is the one of the next hop.
+  return resolver_.lookup(get_next_hop(dst_ip_bytes), mac);
+}
+
+void raw_socket_link::resolve_neighbor(
+    const uint8_t *dst_ip_bytes, const neighbor_callback& callback) {
+  resolver_.resolve_async({get_next_hop(dst_ip_bytes)}, callback);
+}
+
+bool raw_socket_link::enable_txtime() {
+  try {
+    sock_.enable_txtime();
+    txtime_ = true;
+  } catch (const std::runtime_error&) {
+    txtime_ = false;
+  }
+  return txtime_;
+}
+
+void raw_socket_link::set_capture(pcapng_writer *capture) {
+  sock_.set_capture(capture);
+  resolver_.set_capture(capture);
+}
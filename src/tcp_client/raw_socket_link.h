@@ -0,0 +1,66 @@
+#ifndef RAW_SOCKET_LINK_H_
+#define RAW_SOCKET_LINK_H_
+
+#include <chrono>
+#include <cstdint>  // for uint8_t
+#include <string>
+#include <vector>
+
+#include "interface_table.h"
+#include "ip_addr.h"
+#include "mac_addr.h"
+#include "name_resolver.h"
+#include "packet_link.h"
+#include "route_table.h"
+#include "socket_wrapper.h"
+
+// NOTE
+// packet_link of an interface of the kernel: IP packets go through a raw
+// socket (AF_PACKET), to the link address of the next hop taken from the
+// routes of the kernel and resolved by ARP without blocking.
+//
+// wait() sleeps in epoll on the socket, the ARP socket and the netlink
+// sockets which report changes of the interfaces, routes and neighbors.
+class raw_socket_link : public packet_link {
+ private:
+  std::string ifname_;
+  // interfaces of the kernel
+  interface_table interfaces_;
+  // the interface, as of the last change
+  interface_info interface_;
+  int ifindex_;
+  mac_addr src_mac_;
+  ip_addr src_ip_;
+  socket_wrapper sock_;
+  int epoll_fd_;
+  // routes and neighbors of the kernel
+  route_table routes_;
+  name_resolver resolver_;
+  // true once SO_TXTIME is enabled
+  bool txtime_;
+
+  // Gateway to dst_ip_bytes, or dst_ip_bytes itself if it is on-link.
+  // Throws std::runtime_error if there is no route out of the interface.
+  ip_addr get_next_hop(const uint8_t *dst_ip_bytes) const;
+ public:
+  // Use the interface of the given name (its addresses are taken from the kernel).
+  // Throws std::runtime_error if there is no such interface or it has no IPv4 address.
+  explicit raw_socket_link(const std::string& ifname);
+  raw_socket_link(const raw_socket_link&) = delete;
+  raw_socket_link& operator=(const raw_socket_link&) = delete;
+  ~raw_socket_link() override;
+  const ip_addr& get_src_ip() const override;
+  uint32_t get_mtu() const override;
+  void send(
+      const uint8_t *dst_mac_bytes,
+      const std::vector<uint8_t>& packet,
+      const std::chrono::steady_clock::time_point departure) override;
+  bool try_recv(std::vector<uint8_t>& packet) override;
+  bool wait(const std::chrono::steady_clock::time_point deadline) override;
+  bool lookup_neighbor(const uint8_t *dst_ip_bytes, mac_addr& mac) override;
+  void resolve_neighbor(const uint8_t *dst_ip_bytes, const neighbor_callback& callback) override;
+  bool enable_txtime() override;
+  void set_capture(pcapng_writer *capture) override;
+};
+
+#endif  // RAW_SOCKET_LINK_H_
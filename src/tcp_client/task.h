@@ -0,0 +1,115 @@
+#ifndef TASK_H_
+#define TASK_H_
+
+#include <coroutine>
+#include <cstddef>  // for size_t
+#include <exception>
+#include <utility>  // for std::exchange()
+
+#include "frame_allocator.h"
+
+// NOTE
+// Frames of all coroutines of this library come from the frame allocator of
+// the calling thread.
+struct frame_allocated_promise {
+  static void *operator new(const size_t size) {
+    return default_frame_allocator().allocate(size);
+  }
+  static void operator delete(void *frame, const size_t size) {
+    default_frame_allocator().deallocate(frame, size);
+  }
+};
+
+template <typename T> class task;
+
+namespace task_detail {
+// Resumes the awaiting coroutine when the task finishes.
+struct final_awaiter {
+  bool await_ready() const noexcept { return false; }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) const noexcept {
+    const std::coroutine_handle<> continuation = h.promise().continuation_;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+  void await_resume() const noexcept {}
+};
+
+struct promise_base : frame_allocated_promise {
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr exception_;
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { exception_ = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+  T value_;
+
+  task<T> get_return_object();
+  void return_value(T value) { value_ = std::move(value); }
+  T result() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    return std::move(value_);
+  }
+};
+
+template <>
+struct promise<void> : promise_base {
+  task<void> get_return_object();
+  void return_void() {}
+  void result() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+};
+} // namespace task_detail
+
+// NOTE
+// Lazily started coroutine returning T.
+// The body starts when the task is awaited, and the awaiting coroutine is
+// resumed (by symmetric transfer, without growing the stack) when it finishes.
+// Exceptions thrown by the body are rethrown to the awaiting coroutine.
+template <typename T>
+class task {
+ public:
+  using promise_type = task_detail::promise<T>;
+
+  task(task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  task(const task&) = delete;
+  task& operator=(const task&) = delete;
+  ~task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation_ = awaiting;
+    return handle_;
+  }
+  T await_resume() { return handle_.promise().result(); }
+
+ private:
+  friend promise_type;
+  explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace task_detail {
+template <typename T>
+task<T> promise<T>::get_return_object() {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+} // namespace task_detail
+
+#endif  // TASK_H_
@@ -0,0 +1,759 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+#include <cstring>    // for std::memcpy()
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "connection_table.h"
+#include "event_loop.h"
+#include "fast_open_cache.h"
+#include "ip_packet.h"
+#include "port_allocator.h"
+#include "task.h"
+#include "tcp_clock.h"
+#include "tcp_connection.h"
+#include "tcp_options.h"
+#include "tcp_segment.h"
+#include "time_wait_table.h"
+#include "timer_wheel.h"
+#include "transmission_control_block.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// NOTE
+// (rfc 6298 - 2. The Basic Algorithm)
+//   A maximum value MAY be placed on RTO provided it is at least 60
+//   seconds.
+// (RTO itself comes from the round trip time measured by the TCB)
+const chrono::seconds MAX_RTO(60);
+// Retransmissions before giving up (like net.ipv4.tcp_syn_retries and tcp_retries2)
+const int MAX_SYN_RETRIES = 6;
+const int MAX_RETRIES = 15;
+// How far ahead of their departure times segments are handed to the kernel
+// in pacing_mode::TXTIME.
+const chrono::milliseconds TXTIME_HORIZON(2);
+// NOTE
+// (rfc 7413 - 4.1.3. Client Cookie Handling)
+//   Without a cached server MSS, the amount of data in the SYN packet is
+//   limited to the default MSS of 536 bytes for IPv4
+const uint16_t DEFAULT_SYN_DATA_MSS = 536;
+
+// Returns true if the segment acknowledges our SYN (and possibly data in it).
+// (rfc 793 - 3.9. Event Processing - SEGMENT ARRIVES)
+//   If the state is SYN-SENT then
+//   ...
+//     If SND.UNA =< SEG.ACK =< SND.NXT then the ACK is acceptable.
+bool acks_syn(const tcp_segment& seg, const transmission_control_block& tcb) {
+  const uint32_t syn_acked = tcb.get_iss() + 1;
+  return seg.get_ack() && seg.get_ack_seq() - syn_acked <= tcb.get_snd_nxt() - syn_acked;
+}
+} // namespace
+
+tcp_connection::tcp_connection(event_loop& loop)
+  : loop_(&loop),
+    handle_(loop.tcbs_.create()),
+    tcb_(loop.tcbs_.get(handle_)),
+    key_{},
+    registered_(false),
+    src_port_(0),
+    dst_port_(0),
+    state_(tcp_state::CLOSED),
+    fin_sent_(false),
+    fin_received_(false),
+    in_burst_(false),
+    ecn_(false),
+    fast_open_(false),
+    syn_data_acked_(false),
+    rto_timer_(on_rto, this),
+    ack_timer_(on_ack_timer, this),
+    persist_timer_(on_persist_timer, this),
+    pacing_timer_(on_pacing_timer, this),
+    rto_(tcb_->get_rto()),
+    persist_backoff_(rto_),
+    retries_(0) {
+  if (loop.owners_.size() <= handle_.index) {
+    loop.owners_.resize(handle_.index + 1, nullptr);
+  }
+  loop.owners_[handle_.index] = this;
+}
+
+tcp_connection::~tcp_connection() {
+  if (state_ != tcp_state::CLOSED && state_ != tcp_state::TIME_WAIT) {
+    try {
+      send(tcb_->create_send_segment(
+          loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_,
+          false,  // ns
+          false,  // cwr
+          false,  // ece
+          false,  // urg
+          true,   // ack
+          false,  // psh
+          true,   // rst
+          false,  // syn
+          false,  // fin
+          0,      // window
+          0,      // urgent pointer
+          std::vector<uint8_t>(), // option
+          std::vector<uint8_t>()  // body
+        ));
+    } catch (const std::exception&) {
+      // The peer resets the connection by itself later.
+    }
+  }
+  loop_->timers_.cancel(rto_timer_);
+  loop_->timers_.cancel(ack_timer_);
+  loop_->timers_.cancel(persist_timer_);
+  loop_->pacer_.cancel(pacing_timer_);
+  if (registered_) {
+    loop_->connections_.erase(key_);
+  }
+  loop_->owners_[handle_.index] = nullptr;
+  loop_->tcbs_.release(handle_);
+}
+
+task<void> tcp_connection::connect(
+    const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port) {
+  if (registered_) {
+    throw std::logic_error("Connection is already used");
+  }
+  co_await resolve_destination(dst_ip);
+  open(dst_ip, dst_port, src_port, false);
+  while (state_ == tcp_state::SYN_SENT) {
+    co_await waiter{&write_waiter_};
+  }
+  check_error();
+}
+
+task<size_t> tcp_connection::connect(
+    const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+    std::span<const uint8_t> data) {
+  if (registered_) {
+    throw std::logic_error("Connection is already used");
+  }
+  co_await resolve_destination(dst_ip);
+  const size_t written = tcb_->write(data.data(), data.size());
+  open(dst_ip, dst_port, src_port, true);
+  while (state_ == tcp_state::SYN_SENT) {
+    co_await waiter{&write_waiter_};
+  }
+  check_error();
+  co_return written;
+}
+
+task<void> tcp_connection::resolve_destination(const ip_addr dst_ip) {
+  uint8_t dst_ip_bytes[IP_ADDR_LEN];
+  dst_ip.host_order(dst_ip_bytes);
+  mac_addr dst_mac;
+  if (!loop_->link_.lookup_neighbor(dst_ip_bytes, dst_mac)) {
+    bool done = false;
+    bool resolved = false;
+    ip_addr next_hop;
+    // Called by the loop (or at once if the neighbor is known meanwhile).
+    loop_->link_.resolve_neighbor(dst_ip_bytes,
+        [&](const ip_addr& hop, const bool ok, const mac_addr& mac) {
+          done = true;
+          resolved = ok;
+          next_hop = hop;
+          dst_mac = mac;
+          loop_->wake(write_waiter_);
+        });
+    while (!done) {
+      co_await waiter{&write_waiter_};
+    }
+    if (!resolved) {
+      throw std::runtime_error("No ARP reply from " + next_hop.to_string());
+    }
+  }
+  dst_mac.host_order(dst_mac_bytes_);
+}
+
+void tcp_connection::open(
+    const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+    const bool fast_open) {
+  if (registered_ || state_ != tcp_state::CLOSED) {
+    throw std::logic_error("Connection is already used");
+  }
+  dst_ip.host_order(dst_ip_bytes_);
+  dst_port_ = dst_port;
+  // A port can be used unless a connection or a recent TIME-WAIT has the
+  // 4-tuple. An older TIME-WAIT is taken over, and may move our ISS.
+  const chrono::steady_clock::time_point now = tcp_clock_now();
+  uint32_t iss = tcb_->get_iss();
+  const auto claim = [&](const uint16_t port) {
+    const connection_key key =
+      make_connection_key(loop_->src_ip_bytes_, port, dst_ip_bytes_, dst_port_);
+    return loop_->connections_.find(key) == CONNECTION_NOT_FOUND &&
+           loop_->time_wait_.reuse(key, now, iss);
+  };
+  if (src_port == 0) {
+    src_port_ = loop_->ports_.allocate(loop_->src_ip_bytes_, dst_ip_bytes_, dst_port_, claim);
+    if (src_port_ == 0) {
+      throw std::runtime_error("No ephemeral port available");
+    }
+  } else {
+    if (!claim(src_port)) {
+      throw std::runtime_error("Connection already exists: port " + std::to_string(src_port));
+    }
+    src_port_ = src_port;
+  }
+  if (iss != tcb_->get_iss()) {
+    tcb_->set_iss(iss);
+  }
+  key_ = make_connection_key(loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_);
+  loop_->connections_.insert(key_, handle_.index);
+  registered_ = true;
+
+  tcp_options options;
+  options.set_mss(loop_->get_advertised_mss());
+  options.set_window_scale(tcb_->get_receive_window_scale());
+  uint32_t max_data = 0;
+  if (fast_open) {
+    std::vector<uint8_t> cookie;
+    uint16_t mss;
+    if (loop_->fast_open_.lookup(dst_ip_bytes_, tcp_clock_now(), cookie, mss)) {
+      options.set_fast_open_cookie(cookie);
+      // The options take room of the MSS like in any segment.
+      const size_t room = mss != 0 ? mss : DEFAULT_SYN_DATA_MSS;
+      const size_t options_len = options.marshal().size();
+      max_data = room > options_len ? room - options_len : 0;
+      fast_open_ = true;
+    } else if (cookie.empty()) {
+      // (rfc 7413 - 4.1.1. Fast Open Option)
+      //   The client requests a cookie with an empty cookie field
+      options.set_fast_open_cookie(cookie);
+      fast_open_ = true;
+    }
+    // NOTE Neither data nor a request is sent while SYNs with data to the
+    // server are being lost (see fast_open_cache).
+  }
+  // An ECN-setup SYN has both ECE and CWR (rfc 3168 - 6.1.1.)
+  send(tcb_->create_syn_segment(
+      loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_,
+      ecn_, tcb_->get_receive_window(), options.marshal(), max_data));
+  state_ = tcp_state::SYN_SENT;
+  restart_rto();
+}
+
+task<size_t> tcp_connection::write(std::span<const uint8_t> data) {
+  size_t written = 0;
+  while (true) {
+    check_error();
+    if ((state_ != tcp_state::ESTABLISHED && state_ != tcp_state::CLOSE_WAIT) || fin_sent_) {
+      throw std::logic_error("Connection is not open for writing");
+    }
+    written += tcb_->write(data.data() + written, data.size() - written);
+    send_data();
+    if (written == data.size()) {
+      break;
+    }
+    // Wait for acknowledgments to make room in the send buffer.
+    co_await waiter{&write_waiter_};
+  }
+  co_return written;
+}
+
+task<size_t> tcp_connection::read(std::span<uint8_t> buffer) {
+  while (true) {
+    const byte_range received = tcb_->get_received();
+    if (received.size != 0) {
+      const size_t len = std::min(received.size, buffer.size());
+      std::memcpy(buffer.data(), received.data, len);
+      tcb_->consume_received(len);
+      // Tell the peer at once if its sender was held back by our window.
+      if (state_ != tcp_state::CLOSED && tcb_->window_update_due()) {
+        send_ack();
+      }
+      co_return len;
+    }
+    check_error();
+    if (fin_received_ || state_ == tcp_state::CLOSED) {
+      co_return 0;
+    }
+    co_await waiter{&read_waiter_};
+  }
+}
+
+task<void> tcp_connection::close() {
+  while (state_ == tcp_state::SYN_SENT) {
+    co_await waiter{&write_waiter_};
+  }
+  check_error();
+  if (state_ == tcp_state::CLOSED) {
+    co_return;
+  }
+  if (!fin_sent_) {
+    // FIN follows all written data
+    send_data();
+    while (tcb_->get_unsent_size() != 0) {
+      co_await waiter{&write_waiter_};
+      check_error();
+      send_data();
+    }
+    send(tcb_->create_send_segment(
+        loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_,
+        false,  // ns
+        false,  // cwr
+        false,  // ece
+        false,  // urg
+        true,   // ack
+        false,  // psh
+        false,  // rst
+        false,  // syn
+        true,   // fin
+        tcb_->get_receive_window(),
+        0,      // urgent pointer
+        std::vector<uint8_t>(), // option
+        std::vector<uint8_t>()  // body
+      ));
+    fin_sent_ = true;
+    update_state();
+    restart_rto();
+  }
+  // NOTE TIME-WAIT is kept by the loop (see enter_time_wait()). The connection
+  // is done once our FIN is acknowledged and the FIN of the peer is acknowledged by us.
+  while (state_ != tcp_state::CLOSED && state_ != tcp_state::TIME_WAIT) {
+    co_await waiter{&write_waiter_};
+    check_error();
+  }
+}
+
+bool tcp_connection::begin_burst() {
+  if (in_burst_) {
+    return false;
+  }
+  in_burst_ = true;
+  tcb_->begin_receive_burst();
+  return true;
+}
+
+void tcp_connection::on_segment(const tcp_segment& seg, const bool ce_marked) {
+  if (state_ == tcp_state::CLOSED) {
+    return;
+  }
+  if (seg.get_rst()) {
+    // NOTE
+    // (rfc 793 - 3.9. Event Processing - SEGMENT ARRIVES)
+    //   If the state is SYN-SENT then
+    //   ...
+    //     If the RST bit is set
+    //
+    //       If the ACK was acceptable then signal the user "error:
+    //       connection reset", drop the segment, enter CLOSED state,
+    if (state_ == tcp_state::SYN_SENT) {
+      if (acks_syn(seg, *tcb_)) {
+        fail("Connection reset by peer");
+      }
+      return;
+    }
+    // A blind RST must hit RCV.NXT exactly (rfc 5961 - 3.2.).
+    switch (tcb_->check_reset(seg)) {
+      case reset_action::ACCEPT:
+        fail("Connection reset by peer");
+        break;
+      case reset_action::CHALLENGE:
+        send_ack();
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+  if (state_ == tcp_state::SYN_SENT) {
+    if (seg.get_ack() && !acks_syn(seg, *tcb_)) {
+      // NOTE
+      // (rfc 793 - 3.9. Event Processing - SEGMENT ARRIVES)
+      //   If the state is SYN-SENT then
+      //     If the ACK bit is set
+      //       If SEG.ACK =< ISS, or SEG.ACK > SND.NXT, send a reset (unless
+      //       the RST bit is set, if so drop the segment and return)
+      //         <SEQ=SEG.ACK><CTL=RST>
+      //
+      // e.g. the peer still has an old connection on the 4-tuple, which is
+      // cleared by the reset so that the retransmitted SYN gets through.
+      send_reset(seg.get_ack_seq());
+      return;
+    }
+    if (!seg.get_syn() || !seg.get_ack()) {
+      return;
+    }
+    if (fast_open_) {
+      on_fast_open_syn_ack(seg);
+    }
+    // SYN is acknowledged immediately at end_burst().
+    tcb_->apply_receive_segment(seg, ce_marked);
+    state_ = tcp_state::ESTABLISHED;
+    rto_ = tcb_->get_rto();
+    restart_rto();
+    loop_->wake(write_waiter_);
+    return;
+  }
+
+  const uint32_t snd_una = tcb_->get_snd_una();
+  const size_t received = tcb_->get_received().size;
+  tcb_->apply_receive_segment(seg, ce_marked);
+  if (seg.get_fin() && !fin_received_ &&
+      tcb_->get_rcv_nxt() == seg.get_seq() + seg.get_body_size() + 1) {
+    fin_received_ = true;
+  }
+  if (tcb_->get_snd_una() != snd_una) {
+    // New data is acknowledged
+    // (rfc 6298 - 5. Managing the RTO Timer)
+    //   (5.3) When an ACK is received that acknowledges new data, restart the
+    //         retransmission timer so that it will expire after RTO seconds
+    //         (for the current value of RTO).
+    // (and the backoff of earlier timeouts is dropped, like Linux)
+    retries_ = 0;
+    rto_ = tcb_->get_rto();
+    restart_rto();
+    loop_->wake(write_waiter_);
+  }
+  if (tcb_->take_retransmit()) {
+    // (rfc 5681 - 3.2. Fast Retransmit/Fast Recovery)
+    //   The lost segment starting at SND.UNA MUST be retransmitted
+    send(tcb_->create_retransmit_segment(
+        loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_, tcb_->get_receive_window()));
+  }
+  if (fin_received_ || tcb_->get_received().size != received) {
+    loop_->wake(read_waiter_);
+  }
+  update_state();
+}
+
+void tcp_connection::on_fast_open_syn_ack(const tcp_segment& seg) {
+  const uint32_t syn_data = tcb_->get_snd_nxt() - tcb_->get_iss() - 1;
+  syn_data_acked_ = syn_data != 0 && seg.get_ack_seq() == tcb_->get_snd_nxt();
+  const tcp_options options(seg.get_options());
+  // NOTE
+  // (rfc 7413 - 4.1.3. Client Cookie Handling)
+  //   the client should cache negative responses from the server in order
+  //   to avoid potential connection failures.  Negative responses include
+  //   the server not acknowledging the data in the SYN, ICMP error
+  //   messages, and (most importantly) no response (SYN-ACK) from the
+  //   server at all, i.e., connection timeout.
+  //
+  // Like Linux, SYN with data is taken as lost if SYN had to be retransmitted
+  // and SYN-ACK neither acknowledges the data nor carries a cookie (only the
+  // retransmitted SYN without data reached the server). A new cookie in
+  // SYN-ACK replaces the cached one.
+  const bool syn_lost =
+    retries_ != 0 && syn_data != 0 && !syn_data_acked_ && !options.has_fast_open();
+  loop_->fast_open_.update(
+      dst_ip_bytes_,
+      options.has_mss() ? options.get_mss() : 0,
+      options.get_fast_open_cookie(),
+      syn_lost,
+      tcp_clock_now());
+}
+
+void tcp_connection::end_burst() {
+  in_burst_ = false;
+  tcb_->end_receive_burst();
+  if (state_ == tcp_state::CLOSED && !error_.empty()) {
+    return;
+  }
+  // The peer may have opened the window.
+  send_data();
+  const chrono::steady_clock::time_point now = tcp_clock_now();
+  if (tcb_->ack_due(now)) {
+    send_ack();
+  } else if (tcb_->ack_pending()) {
+    loop_->timers_.arm(ack_timer_, tcb_->get_ack_deadline());
+  }
+}
+
+void tcp_connection::send(const tcp_segment& seg) {
+  send(seg, IP_ECN_NOT_ECT);
+}
+
+void tcp_connection::send(const tcp_segment& seg, const uint8_t tos) {
+  loop_->send(dst_mac_bytes_, dst_ip_bytes_, seg, tos);
+}
+
+void tcp_connection::send(
+    const tcp_segment& seg,
+    const uint8_t tos,
+    const chrono::steady_clock::time_point departure) {
+  loop_->send(dst_mac_bytes_, dst_ip_bytes_, seg, tos, departure);
+}
+
+void tcp_connection::send_reset(const uint32_t seq) {
+  send(tcp_segment(
+      loop_->src_ip_bytes_, dst_ip_bytes_, src_port_, dst_port_,
+      seq,
+      0,      // ack seq
+      false,  // ns
+      false,  // cwr
+      false,  // ece
+      false,  // urg
+      false,  // ack
+      false,  // psh
+      true,   // rst
+      false,  // syn
+      false,  // fin
+      0,      // window
+      0,      // urgent pointer
+      std::vector<uint8_t>(), // option
+      std::vector<uint8_t>()  // body
+    ));
+}
+
+void tcp_connection::send_ack() {
+  loop_->timers_.cancel(ack_timer_);
+  send(tcb_->create_ack_segment(
+      loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_, tcb_->get_receive_window()));
+}
+
+bool tcp_connection::send_retransmissions() {
+  const std::vector<tcp_segment> segs = tcb_->flush_retransmissions(
+      loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_, tcb_->get_receive_window());
+  for (const tcp_segment& seg : segs) {
+    send(seg);
+  }
+  return !segs.empty();
+}
+
+void tcp_connection::send_data() {
+  // Data lost to a retransmission timeout goes before new data.
+  const bool retransmitted = send_retransmissions();
+  // NOTE
+  // (rfc 3168 - 6.1.5. Retransmitted TCP packets)
+  //   the TCP data sender MUST NOT set either an ECT codepoint or the CE
+  //   codepoint in the IP header for retransmitted data packets
+  // and pure ACKs are not marked either (6.1.4.), so only new data is ECT(0).
+  const uint8_t tos = tcb_->ecn_capable() ? IP_ECN_ECT_0 : IP_ECN_NOT_ECT;
+  const uint64_t rate =
+    loop_->pacing_ == pacing_mode::NONE ? 0 : tcb_->get_pacing_rate();
+  bool sent;
+  if (rate != 0) {
+    sent = send_paced(rate, tos);
+  } else {
+    // Not paced until the round trip time is measured.
+    const std::vector<tcp_segment> segs = tcb_->flush(
+        loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_, tcb_->get_receive_window());
+    for (const tcp_segment& seg : segs) {
+      send(seg, tos);
+    }
+    sent = !segs.empty();
+  }
+  if (sent || retransmitted) {
+    // A data segment acknowledges everything received so far.
+    loop_->timers_.cancel(ack_timer_);
+    if (!rto_timer_.armed()) {
+      restart_rto();
+    }
+  }
+  update_persist_timer();
+}
+
+bool tcp_connection::send_paced(const uint64_t rate, const uint8_t tos) {
+  // NOTE
+  // Like Linux's internal pacing and the fq qdisc: every segment pushes the
+  // departure time of the next one by its transmission time at the rate.
+  // About 1 ms worth of data (at least 2 segments) is released at a time
+  // (see tcp_tso_autosize()), and idle time gives no credit for a burst.
+  const chrono::steady_clock::time_point now = tcp_clock_now();
+  const chrono::steady_clock::duration horizon =
+    loop_->pacing_ == pacing_mode::TXTIME ? chrono::steady_clock::duration(TXTIME_HORIZON)
+                                          : chrono::steady_clock::duration::zero();
+  const size_t quantum = std::max<uint64_t>(rate / 1000, 2 * tcb_->get_send_mss());
+  if (next_departure_ < now) {
+    next_departure_ = now;
+  }
+  bool sent = false;
+  while (next_departure_ <= now + horizon) {
+    const std::vector<tcp_segment> segs = tcb_->flush(
+        loop_->src_ip_bytes_, src_port_, dst_ip_bytes_, dst_port_,
+        tcb_->get_receive_window(), quantum);
+    if (segs.empty()) {
+      break;
+    }
+    for (const tcp_segment& seg : segs) {
+      send(seg, tos, next_departure_);
+      next_departure_ += chrono::nanoseconds(
+          static_cast<uint64_t>(seg.get_body_size()) * 1000000000 / rate);
+    }
+    sent = true;
+  }
+  if (tcb_->get_unsent_size() != 0 && next_departure_ > now + horizon) {
+    loop_->pacer_.arm(pacing_timer_, next_departure_ - horizon);
+  }
+  return sent;
+}
+
+void tcp_connection::on_pacing_timer(void *arg) {
+  tcp_connection& conn = *static_cast<tcp_connection *>(arg);
+  if (conn.state_ == tcp_state::CLOSED) {
+    return;
+  }
+  conn.send_data();
+}
+
+void tcp_connection::update_state() {
+  if (state_ == tcp_state::CLOSED || state_ == tcp_state::SYN_SENT) {
+    return;
+  }
+  const bool fin_acked = fin_sent_ && tcb_->get_snd_una() == tcb_->get_snd_nxt();
+  tcp_state next;
+  if (!fin_sent_) {
+    next = fin_received_ ? tcp_state::CLOSE_WAIT : tcp_state::ESTABLISHED;
+  } else if (state_ == tcp_state::CLOSE_WAIT || state_ == tcp_state::LAST_ACK) {
+    // The peer closed first
+    next = fin_acked ? tcp_state::CLOSED : tcp_state::LAST_ACK;
+  } else if (!fin_received_) {
+    next = fin_acked ? tcp_state::FIN_WAIT_2 : tcp_state::FIN_WAIT_1;
+  } else {
+    next = fin_acked ? tcp_state::TIME_WAIT : tcp_state::CLOSING;
+  }
+  if (next == state_) {
+    return;
+  }
+  state_ = next;
+  if (state_ == tcp_state::CLOSED || state_ == tcp_state::TIME_WAIT) {
+    loop_->timers_.cancel(rto_timer_);
+  }
+  if (state_ == tcp_state::TIME_WAIT) {
+    enter_time_wait();
+  }
+  loop_->wake(write_waiter_);
+}
+
+void tcp_connection::enter_time_wait() {
+  // The 4-tuple is handed over to the TIME-WAIT table, which answers
+  // retransmitted FINs, so that this connection (and its block) can go.
+  // NOTE The ACK of the FIN of the peer is sent at the end of the burst.
+  loop_->time_wait_.insert(
+      key_,
+      time_wait_entry{tcb_->get_snd_nxt(), tcb_->get_rcv_nxt(), tcb_->get_receive_window()},
+      tcp_clock_now());
+  loop_->arm_time_wait_timer();
+  loop_->connections_.erase(key_);
+  registered_ = false;
+}
+
+void tcp_connection::restart_rto() {
+  if (tcb_->get_snd_una() == tcb_->get_snd_nxt()) {
+    loop_->timers_.cancel(rto_timer_);
+    return;
+  }
+  loop_->timers_.arm_after(rto_timer_, rto_);
+}
+
+void tcp_connection::on_rto(void *arg) {
+  tcp_connection& conn = *static_cast<tcp_connection *>(arg);
+  conn.retries_++;
+  const int max_retries =
+    conn.state_ == tcp_state::SYN_SENT ? MAX_SYN_RETRIES : MAX_RETRIES;
+  if (conn.retries_ > max_retries) {
+    if (conn.state_ == tcp_state::SYN_SENT && conn.fast_open_ &&
+        conn.tcb_->get_snd_nxt() != conn.tcb_->get_iss() + 1) {
+      // No response at all to SYN with data (see on_fast_open_syn_ack())
+      conn.loop_->fast_open_.update(
+          conn.dst_ip_bytes_, 0, std::vector<uint8_t>(), true, tcp_clock_now());
+    }
+    conn.fail("Connection timed out");
+    return;
+  }
+  // (rfc 6298 - 5. Managing the RTO Timer)
+  //   (5.4) Retransmit the earliest segment that has not been acknowledged
+  //   (5.5) The host MUST set RTO <- RTO * 2 ("back off the timer").
+  if (conn.state_ == tcp_state::SYN_SENT) {
+    conn.send(conn.tcb_->create_retransmit_segment(
+        conn.loop_->src_ip_bytes_, conn.src_port_, conn.dst_ip_bytes_, conn.dst_port_,
+        conn.tcb_->get_receive_window()));
+  } else {
+    // The first segment goes now (the window is one segment), and the rest
+    // as ACKs open the window (see send_data()).
+    conn.tcb_->on_retransmission_timeout();
+    conn.send_retransmissions();
+  }
+  conn.rto_ = std::min<chrono::steady_clock::duration>(conn.rto_ * 2, MAX_RTO);
+  conn.loop_->timers_.arm_after(conn.rto_timer_, conn.rto_);
+}
+
+void tcp_connection::update_persist_timer() {
+  if (!tcb_->window_probe_needed()) {
+    loop_->timers_.cancel(persist_timer_);
+    persist_backoff_ = rto_;
+    return;
+  }
+  if (!persist_timer_.armed()) {
+    loop_->timers_.arm_after(persist_timer_, persist_backoff_);
+  }
+}
+
+void tcp_connection::on_persist_timer(void *arg) {
+  tcp_connection& conn = *static_cast<tcp_connection *>(arg);
+  if (conn.state_ == tcp_state::CLOSED || !conn.tcb_->window_probe_needed()) {
+    return;
+  }
+  // NOTE
+  // (rfc 1122 - 4.2.2.17 Probing Zero Windows)
+  //   The transmitting host SHOULD send the first zero-window
+  //   probe when a zero window has existed for the retransmission
+  //   timeout period, and SHOULD increase exponentially the
+  //   interval between successive probes.
+  conn.send(conn.tcb_->create_window_probe_segment(
+      conn.loop_->src_ip_bytes_, conn.src_port_, conn.dst_ip_bytes_, conn.dst_port_,
+      conn.tcb_->get_receive_window()));
+  conn.persist_backoff_ =
+    std::min<chrono::steady_clock::duration>(conn.persist_backoff_ * 2, MAX_RTO);
+  conn.loop_->timers_.arm_after(conn.persist_timer_, conn.persist_backoff_);
+}
+
+void tcp_connection::on_ack_timer(void *arg) {
+  tcp_connection& conn = *static_cast<tcp_connection *>(arg);
+  if (conn.state_ != tcp_state::CLOSED && conn.tcb_->ack_pending()) {
+    conn.send_ack();
+  }
+}
+
+void tcp_connection::fail(const std::string& reason) {
+  error_ = reason;
+  state_ = tcp_state::CLOSED;
+  loop_->timers_.cancel(rto_timer_);
+  loop_->timers_.cancel(ack_timer_);
+  loop_->timers_.cancel(persist_timer_);
+  loop_->pacer_.cancel(pacing_timer_);
+  loop_->wake(read_waiter_);
+  loop_->wake(write_waiter_);
+}
+
+void tcp_connection::check_error() const {
+  if (!error_.empty()) {
+    throw std::runtime_error(error_);
+  }
+}
+
+void tcp_connection::set_ecn(const bool ecn) {
+  if (registered_) {
+    throw std::logic_error("ECN must be set before connecting");
+  }
+  ecn_ = ecn;
+}
+
+void tcp_connection::set_congestion_algorithm(const congestion_algorithm algorithm) {
+  tcb_->set_congestion_algorithm(algorithm);
+}
+
+void tcp_connection::enable_stats() {
+  tcb_->enable_connection_stats();
+}
+
+tcp_state tcp_connection::get_state() const {
+  return state_;
+}
+
+uint16_t tcp_connection::get_src_port() const {
+  return src_port_;
+}
+
+bool tcp_connection::syn_data_acked() const {
+  return syn_data_acked_;
+}
+
+const transmission_control_block& tcp_connection::get_tcb() const {
+  return *tcb_;
+}
@@ -0,0 +1,187 @@
+#ifndef TCP_CONNECTION_H_
+#define TCP_CONNECTION_H_
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <span>
+#include <string>
+
+#include "connection_table.h"
+#include "ip_addr.h"
+#include "mac_addr.h"
+#include "task.h"
+#include "tcb_slab.h"
+#include "tcp_segment.h"
+#include "timer_wheel.h"
+#include "transmission_control_block.h"
+
+class event_loop;
+
+// (rfc 793 - 3.2. Terminology) states of the active opener
+enum class tcp_state {
+  CLOSED,
+  SYN_SENT,
+  ESTABLISHED,
+  FIN_WAIT_1,
+  FIN_WAIT_2,
+  CLOSING,
+  TIME_WAIT,
+  CLOSE_WAIT,
+  LAST_ACK,
+};
+
+// NOTE
+// Client side TCP connection driven by an event_loop, used from coroutines:
+//
+//   task<void> hello(event_loop& loop, const ip_addr dst_ip) {
+//     tcp_connection conn(loop);
+//     co_await conn.connect(dst_ip, 80, 50000);
+//     co_await conn.write(data);
+//     const size_t n = co_await conn.read(buffer);
+//     co_await conn.close();
+//   }
+//
+// Operations suspend the calling coroutine instead of blocking the thread,
+// so one thread drives as many connections as there are coroutines.
+// At most one read and one write (or connect/close) may wait at a time.
+// Failures (reset by the peer, retransmission timeout) are thrown as
+// std::runtime_error from the waiting operations.
+class tcp_connection {
+  friend class event_loop;
+ private:
+  // Awaitable which suspends the coroutine until the loop wakes the waiter.
+  struct waiter {
+    std::coroutine_handle<> *slot;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept { *slot = h; }
+    void await_resume() const noexcept {}
+  };
+
+  event_loop *loop_;
+  tcb_handle handle_;
+  transmission_control_block *tcb_;
+  connection_key key_;
+  bool registered_;
+  uint8_t dst_ip_bytes_[IP_ADDR_LEN];
+  uint8_t dst_mac_bytes_[MAC_ADDR_LEN];
+  uint16_t src_port_;
+  uint16_t dst_port_;
+  tcp_state state_;
+  // true once our FIN has been sent
+  bool fin_sent_;
+  // true once the FIN of the peer has been received
+  bool fin_received_;
+  bool in_burst_;
+  // true if ECN is offered in SYN
+  bool ecn_;
+  // true if SYN carries the Fast Open option (a cookie or a cookie request)
+  bool fast_open_;
+  // true if the server accepted the data in SYN
+  bool syn_data_acked_;
+  std::string error_;
+  std::coroutine_handle<> read_waiter_;
+  // connect(), write() and close()
+  std::coroutine_handle<> write_waiter_;
+  timer_wheel_timer rto_timer_;
+  timer_wheel_timer ack_timer_;
+  // zero window probe (persist) timer
+  timer_wheel_timer persist_timer_;
+  // Waits in the pacer of the loop for next_departure_.
+  timer_wheel_timer pacing_timer_;
+  // Earliest time the next data segment may leave (pacing)
+  std::chrono::steady_clock::time_point next_departure_;
+  std::chrono::steady_clock::duration rto_;
+  std::chrono::steady_clock::duration persist_backoff_;
+  int retries_;
+
+  // Take the link address of the next hop to the destination from the
+  // neighbor cache, or wait for ARP without blocking the other connections
+  // of the loop.
+  task<void> resolve_destination(const ip_addr dst_ip);
+  // Register the connection and send SYN (after resolve_destination()).
+  //   fast_open : true to send the written data in SYN if a cookie of the
+  //               server is cached, or to request a cookie otherwise
+  void open(
+      const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+      const bool fast_open);
+  // Record the Fast Open result of SYN-ACK (before it is applied to the TCB).
+  void on_fast_open_syn_ack(const tcp_segment& seg);
+  static void on_rto(void *arg);
+  static void on_ack_timer(void *arg);
+  static void on_persist_timer(void *arg);
+  static void on_pacing_timer(void *arg);
+  // Called by the event_loop for each received segment, between
+  // begin_burst() (returns false if already in a burst) and end_burst().
+  bool begin_burst();
+  void on_segment(const tcp_segment& seg, const bool ce_marked);
+  void end_burst();
+  // Send a segment in a Not-ECT packet (control segments and retransmissions).
+  void send(const tcp_segment& seg);
+  void send(const tcp_segment& seg, const uint8_t tos);
+  void send(
+      const tcp_segment& seg,
+      const uint8_t tos,
+      const std::chrono::steady_clock::time_point departure);
+  void send_ack();
+  // Send RST at seq without any state change (for segments of no connection).
+  void send_reset(const uint32_t seq);
+  // Send data lost to a retransmission timeout which the congestion window
+  // allows to be sent again now. Returns true if any segment was sent.
+  bool send_retransmissions();
+  // Send data allowed to be sent now (retransmissions first).
+  void send_data();
+  // Send data at the pacing rate (bytes per second). Returns true if any
+  // segment was sent.
+  bool send_paced(const uint64_t rate, const uint8_t tos);
+  void update_state();
+  // Hand the connection over to the TIME-WAIT table of the loop.
+  void enter_time_wait();
+  void restart_rto();
+  // Arm the persist timer while the peer's zero window holds data back.
+  void update_persist_timer();
+  void fail(const std::string& reason);
+  void check_error() const;
+ public:
+  tcp_connection(event_loop& loop);
+  tcp_connection(const tcp_connection&) = delete;
+  tcp_connection& operator=(const tcp_connection&) = delete;
+  // Resets the connection if it is not closed.
+  ~tcp_connection();
+  // Open the connection (three-way handshake).
+  // A src_port of 0 takes an ephemeral port (rfc 6056). Throws if the given
+  // port is in use, or is in TIME-WAIT for less than TIME_WAIT_REUSE_DELAY.
+  // NOTE The link address of the destination is taken from the neighbor cache
+  // of the loop, or resolved by ARP while the loop keeps running.
+  task<void> connect(const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port);
+  // Same as above, but the data is sent in SYN if the loop has a Fast Open
+  // cookie of the server (rfc 7413), which saves a round trip. Otherwise a
+  // cookie is requested for later connections, and the data is sent after
+  // the handshake. Returns the number of bytes written to the send buffer,
+  // which is less than the size if the buffer is full.
+  task<size_t> connect(
+      const ip_addr dst_ip, const uint16_t dst_port, const uint16_t src_port,
+      std::span<const uint8_t> data);
+  // Returns when all data has been written to the send buffer.
+  task<size_t> write(std::span<const uint8_t> data);
+  // Returns as soon as some data is received, or 0 at the end of the stream.
+  task<size_t> read(std::span<uint8_t> buffer);
+  // Send the rest of the data and FIN, and return when both sides are closed.
+  task<void> close();
+  // Offer ECN (rfc 3168) when connecting. Must be called before connect().
+  void set_ecn(const bool ecn);
+  // DCTCP (rfc 8257) also needs ECN.
+  void set_congestion_algorithm(const congestion_algorithm algorithm);
+  // Collect statistics (get_tcb().get_connection_stats()), which other
+  // threads may read while the loop runs.
+  void enable_stats();
+  tcp_state get_state() const;
+  // Source port (the allocated one if 0 was given to connect()).
+  uint16_t get_src_port() const;
+  // Returns true if the data sent in SYN was accepted (TCP Fast Open).
+  bool syn_data_acked() const;
+  const transmission_control_block& get_tcb() const;
+};
+
+#endif  // TCP_CONNECTION_H_
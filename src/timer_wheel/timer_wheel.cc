@@ -0,0 +1,260 @@
+#include <algorithm>  // for std::min()
+#include <chrono>
+#include <cstring>    // for std::memset()
+#include <stdexcept>
+
+#include "timer_wheel.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const uint64_t SLOT_MASK = TIMER_WHEEL_SLOTS - 1;
+// Maximum distance between the current tick and the slot a timer is put in.
+const uint64_t MAX_DELTA = (1ULL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+void list_init(timer_wheel_link& head) {
+  head.prev_ = &head;
+  head.next_ = &head;
+}
+
+bool list_empty(const timer_wheel_link& head) {
+  return head.next_ == &head;
+}
+
+void list_push_back(timer_wheel_link& head, timer_wheel_link& node) {
+  node.prev_ = head.prev_;
+  node.next_ = &head;
+  head.prev_->next_ = &node;
+  head.prev_ = &node;
+}
+
+void list_remove(timer_wheel_link& node) {
+  node.prev_->next_ = node.next_;
+  node.next_->prev_ = node.prev_;
+  node.prev_ = nullptr;
+  node.next_ = nullptr;
+}
+
+// Move all nodes of src to dst. src becomes empty.
+void list_splice(timer_wheel_link& src, timer_wheel_link& dst) {
+  if (list_empty(src)) {
+    list_init(dst);
+    return;
+  }
+  dst.next_ = src.next_;
+  dst.prev_ = src.prev_;
+  dst.next_->prev_ = &dst;
+  dst.prev_->next_ = &dst;
+  list_init(src);
+}
+} // namespace
+
+timer_wheel_timer::timer_wheel_timer(void (*callback)(void *arg), void *arg)
+  : wheel_(nullptr), expires_(0), callback_(callback), arg_(arg) {
+  prev_ = nullptr;
+  next_ = nullptr;
+}
+
+timer_wheel_timer::~timer_wheel_timer() {
+  if (wheel_ != nullptr) {
+    wheel_->cancel(*this);
+  }
+}
+
+bool timer_wheel_timer::armed() const {
+  return wheel_ != nullptr;
+}
+
+timer_wheel::timer_wheel(
+    const chrono::steady_clock::duration tick,
+    const chrono::steady_clock::time_point start)
+  : tick_(tick), start_(start), now_(0), size_(0) {
+  if (tick_ <= chrono::steady_clock::duration::zero()) {
+    throw std::invalid_argument("Tick of timer wheel must be positive");
+  }
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+    for (int index = 0; index < TIMER_WHEEL_SLOTS; ++index) {
+      list_init(slots_[level][index]);
+    }
+  }
+  std::memset(bitmaps_, 0, sizeof(bitmaps_));
+}
+
+timer_wheel::~timer_wheel() {
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+    for (int index = 0; index < TIMER_WHEEL_SLOTS; ++index) {
+      timer_wheel_link& head = slots_[level][index];
+      while (!list_empty(head)) {
+        auto *t = static_cast<timer_wheel_timer *>(head.next_);
+        list_remove(*t);
+        t->wheel_ = nullptr;
+      }
+    }
+  }
+}
+
+void timer_wheel::place(timer_wheel_timer& t) {
+  // NOTE
+  // Timers further than the wheel covers are put in the farthest slot and are
+  // placed again when the slot is cascaded.
+  const uint64_t delta = std::min(t.expires_ - now_, MAX_DELTA);
+  const uint64_t placed_expires = now_ + delta;
+  int level = 0;
+  while (level < TIMER_WHEEL_LEVELS - 1 &&
+         delta >= (1ULL << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+  const int index = (placed_expires >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+  list_push_back(slots_[level][index], t);
+  bitmaps_[level][index / 64] |= 1ULL << (index % 64);
+}
+
+void timer_wheel::unlink(timer_wheel_timer& t) {
+  // NOTE
+  // Occupancy bits are not cleared here. A bit of an emptied slot is cleared
+  // when the slot is processed.
+  list_remove(t);
+  t.wheel_ = nullptr;
+  size_--;
+}
+
+void timer_wheel::arm(timer_wheel_timer& t, const chrono::steady_clock::time_point expiry) {
+  if (t.wheel_ != nullptr && t.wheel_ != this) {
+    throw std::invalid_argument("Timer is armed on another timer wheel");
+  }
+  if (t.wheel_ == this) {
+    unlink(t);
+  }
+  // Round up so that timers never expire early.
+  uint64_t expires = now_ + 1;
+  if (expiry > start_) {
+    const auto elapsed = expiry - start_;
+    const uint64_t ticks = (elapsed + tick_ - chrono::steady_clock::duration(1)) / tick_;
+    expires = std::max(expires, ticks);
+  }
+  t.expires_ = expires;
+  t.wheel_ = this;
+  size_++;
+  place(t);
+}
+
+void timer_wheel::arm_after(timer_wheel_timer& t, const chrono::steady_clock::duration delay) {
+  arm(t, get_time() + delay);
+}
+
+void timer_wheel::cancel(timer_wheel_timer& t) {
+  if (t.wheel_ != this) {
+    return;
+  }
+  unlink(t);
+}
+
+void timer_wheel::cascade(const int level) {
+  const int index = (now_ >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+  bitmaps_[level][index / 64] &= ~(1ULL << (index % 64));
+  timer_wheel_link detached;
+  list_splice(slots_[level][index], detached);
+  while (!list_empty(detached)) {
+    auto *t = static_cast<timer_wheel_timer *>(detached.next_);
+    list_remove(*t);
+    place(*t);
+  }
+}
+
+size_t timer_wheel::expire_slot(const int index) {
+  bitmaps_[0][index / 64] &= ~(1ULL << (index % 64));
+  timer_wheel_link detached;
+  list_splice(slots_[0][index], detached);
+  size_t expired = 0;
+  // NOTE
+  // Callbacks may arm or cancel any timer, including the ones still in the
+  // detached list, so the list is consumed one by one.
+  while (!list_empty(detached)) {
+    auto *t = static_cast<timer_wheel_timer *>(detached.next_);
+    unlink(*t);
+    expired++;
+    t->callback_(t->arg_);
+  }
+  return expired;
+}
+
+int timer_wheel::find_slot(const int level, const int from) const {
+  for (int word = from / 64; word < TIMER_WHEEL_BITMAP_WORDS; ++word) {
+    uint64_t bits = bitmaps_[level][word];
+    if (word == from / 64) {
+      bits &= ~0ULL << (from % 64);
+    }
+    while (bits != 0) {
+      const int index = word * 64 + __builtin_ctzll(bits);
+      if (!list_empty(slots_[level][index])) {
+        return index;
+      }
+      bits &= bits - 1;
+    }
+  }
+  return -1;
+}
+
+size_t timer_wheel::advance(const chrono::steady_clock::time_point now) {
+  uint64_t target = 0;
+  if (now > start_) {
+    target = (now - start_) / tick_;
+  }
+  size_t expired = 0;
+  while (now_ < target) {
+    if (size_ == 0) {
+      now_ = target;
+      break;
+    }
+    const uint64_t rotation_base = now_ & ~SLOT_MASK;
+    const uint64_t boundary = rotation_base + TIMER_WHEEL_SLOTS;
+    const uint64_t last_in_rotation = std::min(target, boundary - 1);
+    if (last_in_rotation > now_) {
+      // Jump to the next occupied slot in the current rotation of level 0.
+      const int index = find_slot(0, (now_ + 1) & SLOT_MASK);
+      if (index >= 0 && rotation_base + index <= last_in_rotation) {
+        now_ = rotation_base + index;
+        expired += expire_slot(index);
+      } else {
+        now_ = last_in_rotation;
+      }
+      continue;
+    }
+    // Level 0 wraps around. Move timers of upper levels down, from the
+    // highest level whose slot boundary is reached.
+    now_ = boundary;
+    int top = 1;
+    while (top < TIMER_WHEEL_LEVELS - 1 &&
+           (now_ & ((1ULL << (TIMER_WHEEL_SLOT_BITS * (top + 1))) - 1)) == 0) {
+      top++;
+    }
+    for (int level = top; level >= 1; --level) {
+      cascade(level);
+    }
+    expired += expire_slot(0);
+  }
+  return expired;
+}
+
+chrono::steady_clock::time_point timer_wheel::get_next_expiry() const {
+  if (size_ == 0) {
+    return chrono::steady_clock::time_point::max();
+  }
+  const uint64_t rotation_base = now_ & ~SLOT_MASK;
+  uint64_t next = rotation_base + TIMER_WHEEL_SLOTS;
+  if ((now_ & SLOT_MASK) != SLOT_MASK) {
+    const int index = find_slot(0, (now_ + 1) & SLOT_MASK);
+    if (index >= 0) {
+      next = rotation_base + index;
+    }
+  }
+  return start_ + tick_ * next;
+}
+
+chrono::steady_clock::time_point timer_wheel::get_time() const {
+  return start_ + tick_ * now_;
+}
+
+size_t timer_wheel::size() const {
+  return size_;
+}
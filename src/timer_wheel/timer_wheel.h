@@ -0,0 +1,94 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+const int TIMER_WHEEL_LEVELS      = 4;
+const int TIMER_WHEEL_SLOT_BITS   = 8;
+const int TIMER_WHEEL_SLOTS       = 1 << TIMER_WHEEL_SLOT_BITS;  // slots per level
+const int TIMER_WHEEL_BITMAP_WORDS = TIMER_WHEEL_SLOTS / 64;
+
+class timer_wheel;
+
+// Doubly linked list node. Each slot of the wheel is a circular list whose
+// head is a bare node.
+struct timer_wheel_link {
+  timer_wheel_link *prev_;
+  timer_wheel_link *next_;
+};
+
+// NOTE
+// A timer is embedded in its owner (e.g. a connection), so arming a timer
+// never allocates. The owner must outlive the period in which the timer is armed.
+class timer_wheel_timer : private timer_wheel_link {
+  friend class timer_wheel;
+ private:
+  timer_wheel *wheel_;    // non-null while armed
+  uint64_t expires_;      // expiry in ticks
+  void (*callback_)(void *arg);
+  void *arg_;
+ public:
+  timer_wheel_timer(void (*callback)(void *arg), void *arg);
+  timer_wheel_timer(const timer_wheel_timer&) = delete;
+  timer_wheel_timer& operator=(const timer_wheel_timer&) = delete;
+  ~timer_wheel_timer();
+  bool armed() const;
+};
+
+// NOTE
+// Hierarchical timing wheel (see: Varghese and Lauck, "Hashed and Hierarchical
+// Timing Wheels", 1987).
+//
+// Level 0 has one slot per tick. A slot of level n covers 256^n ticks.
+// Timers are put in the lowest level which covers their expiry, and are moved
+// (cascaded) to a lower level when the lower level wraps around.
+// Arm, re-arm and cancel are O(1). Expiry processing skips empty slots by
+// per-level occupancy bitmaps, so advancing over idle periods is cheap.
+//
+//   level 0 : 256 ticks
+//   level 1 : 65536 ticks
+//   level 2 : 16777216 ticks
+//   level 3 : 4294967296 ticks (longer timers are placed again when cascaded)
+class timer_wheel {
+ private:
+  timer_wheel_link slots_[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  uint64_t bitmaps_[TIMER_WHEEL_LEVELS][TIMER_WHEEL_BITMAP_WORDS];
+  std::chrono::steady_clock::duration tick_;
+  std::chrono::steady_clock::time_point start_;
+  // last processed tick
+  uint64_t now_;
+  size_t size_;
+
+  void place(timer_wheel_timer& t);
+  void unlink(timer_wheel_timer& t);
+  void cascade(const int level);
+  size_t expire_slot(const int index);
+  int find_slot(const int level, const int from) const;
+ public:
+  timer_wheel(
+      const std::chrono::steady_clock::duration tick,
+      const std::chrono::steady_clock::time_point start);
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator=(const timer_wheel&) = delete;
+  ~timer_wheel();
+  // Arm the timer, or move it if it is already armed.
+  // Timers expiring in the past expire at the next tick.
+  void arm(timer_wheel_timer& t, const std::chrono::steady_clock::time_point expiry);
+  void arm_after(timer_wheel_timer& t, const std::chrono::steady_clock::duration delay);
+  // Disarm the timer. Cancelling a disarmed timer is a no-op.
+  void cancel(timer_wheel_timer& t);
+  // Run callbacks of all timers expired at the given time.
+  // All ticks elapsed since the last call are processed at once.
+  // Returns the number of expired timers.
+  size_t advance(const std::chrono::steady_clock::time_point now);
+  // Returns the time at which advance() should be called next, or
+  // time_point::max() if no timer is armed. The returned time is never later
+  // than the earliest expiry, so it can be used as a poll timeout.
+  std::chrono::steady_clock::time_point get_next_expiry() const;
+  std::chrono::steady_clock::time_point get_time() const;
+  size_t size() const;
+};
+
+#endif  // TIMER_WHEEL_H_
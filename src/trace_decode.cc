@@ -0,0 +1,112 @@
+#include <cstdio>   // for std::fopen(), std::fread()
+#include <cstring>  // for std::memcmp()
+#include <iostream>
+#include <vector>
+
+#include "trace_event.h"
+
+namespace {
+// Events read from the file at a time
+const size_t DECODE_BATCH_SIZE = 4096;
+
+void print_ip_header(std::ostream& os, const trace_event& e) {
+  os << "version   : " << static_cast<unsigned>(e.version)  << '\n';
+  os << "ihl       : " << static_cast<unsigned>(e.ihl)      << '\n';
+  os << "tos       : " << static_cast<unsigned>(e.tos)      << '\n';
+  os << "tot_len   : " << static_cast<unsigned>(e.tot_len)  << '\n';
+  os << "id        : " << static_cast<unsigned>(e.id)       << '\n';
+  os << "frag_off  : " << static_cast<unsigned>(e.frag_off) << '\n';
+  os << "ttl       : " << static_cast<unsigned>(e.ttl)      << '\n';
+  os << "protocol  : " << static_cast<unsigned>(e.protocol) << '\n';
+  os << "check     : " << static_cast<unsigned>(e.ip_check) << '\n';
+  os << "src addr  : "
+     << static_cast<unsigned>(e.saddr[0]) << "."
+     << static_cast<unsigned>(e.saddr[1]) << "."
+     << static_cast<unsigned>(e.saddr[2]) << "."
+     << static_cast<unsigned>(e.saddr[3]) << '\n';
+  os << "dst addr  : "
+     << static_cast<unsigned>(e.daddr[0]) << "."
+     << static_cast<unsigned>(e.daddr[1]) << "."
+     << static_cast<unsigned>(e.daddr[2]) << "."
+     << static_cast<unsigned>(e.daddr[3]) << '\n';
+}
+
+void print_flag(std::ostream& os, const char *label, const bool set) {
+  if (set) {
+    os << label << 1 << '\n';
+  }
+}
+
+void print_tcp_header(std::ostream& os, const trace_event& e) {
+  os << "src port    : " << static_cast<unsigned>(e.src_port)    << '\n';
+  os << "dst port    : " << static_cast<unsigned>(e.dst_port)    << '\n';
+  os << "seq         : " << static_cast<unsigned>(e.seq)         << '\n';
+  os << "ack seq     : " << static_cast<unsigned>(e.ack_seq)     << '\n';
+  os << "data offset : " << static_cast<unsigned>(e.data_offset) << '\n';
+  os << "reserved    : " << static_cast<unsigned>(e.reserved)    << '\n';
+  print_flag(os, "ns          : ", e.ns != 0);
+  print_flag(os, "cwr         : ", (e.flags & TRACE_FLAG_CWR) != 0);
+  print_flag(os, "ece         : ", (e.flags & TRACE_FLAG_ECE) != 0);
+  print_flag(os, "urg         : ", (e.flags & TRACE_FLAG_URG) != 0);
+  print_flag(os, "ack         : ", (e.flags & TRACE_FLAG_ACK) != 0);
+  print_flag(os, "psh         : ", (e.flags & TRACE_FLAG_PSH) != 0);
+  print_flag(os, "rst         : ", (e.flags & TRACE_FLAG_RST) != 0);
+  print_flag(os, "syn         : ", (e.flags & TRACE_FLAG_SYN) != 0);
+  print_flag(os, "fin         : ", (e.flags & TRACE_FLAG_FIN) != 0);
+  os << "window      : " << static_cast<unsigned>(e.window)   << '\n';
+  os << "checksum    : " << static_cast<unsigned>(e.checksum) << '\n';
+  if ((e.flags & TRACE_FLAG_URG) != 0) {
+    os << "urg_pointer : " << static_cast<unsigned>(e.urgent_pointer) << '\n';
+  }
+}
+
+// Same output as main printed for each segment before it was traced.
+void print_event(std::ostream& os, const trace_event& e) {
+  if (e.direction == static_cast<uint8_t>(trace_direction::SENT)) {
+    os << "======= sent ip packet ======" << '\n';
+    print_ip_header(os, e);
+    os << "=============================" << '\n';
+    os << "====== sent tcp segment =====" << '\n';
+  } else {
+    os << "===== received ip packet ====" << '\n';
+    print_ip_header(os, e);
+    os << "=============================" << '\n';
+    os << "==== received tcp segment ===" << '\n';
+  }
+  print_tcp_header(os, e);
+  os << "=============================" << '\n';
+}
+} // namespace
+
+int main(int argc, const char **argv) {
+  if (argc != 2) {
+    std::cout << "Usage: " << argv[0] << " <trace file>" << std::endl;
+    return 1;
+  }
+  FILE *file = std::fopen(argv[1], "rb");
+  if (file == nullptr) {
+    std::cerr << "Failed to open " << argv[1] << std::endl;
+    return 1;
+  }
+  trace_file_header header;
+  if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+      std::memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+    std::cerr << argv[1] << " is not a trace file" << std::endl;
+    std::fclose(file);
+    return 1;
+  }
+  if (header.version != TRACE_FILE_VERSION || header.event_size != sizeof(trace_event)) {
+    std::cerr << "Unsupported trace file version " << header.version << std::endl;
+    std::fclose(file);
+    return 1;
+  }
+  std::vector<trace_event> batch(DECODE_BATCH_SIZE);
+  size_t size;
+  while ((size = std::fread(batch.data(), sizeof(trace_event), batch.size(), file)) != 0) {
+    for (size_t i = 0; i < size; ++i) {
+      print_event(std::cout, batch[i]);
+    }
+  }
+  std::fclose(file);
+  std::cout.flush();
+}
@@ -0,0 +1,75 @@
+#ifndef TRACE_EVENT_H_
+#define TRACE_EVENT_H_
+
+#include <cstdint>  // for uint8_t
+
+// NOTE
+// Layout of a trace file: a trace_file_header, then trace_events until the
+// end of the file. Both are written in the byte order of the host, as the
+// file is decoded on the host (or one alike) which recorded it.
+const char TRACE_FILE_MAGIC[8] = {'T', 'C', 'P', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t TRACE_FILE_VERSION = 1;
+
+struct trace_file_header {
+  char magic[8];
+  uint32_t version;
+  // sizeof(trace_event) of the writer
+  uint32_t event_size;
+};
+
+enum class trace_direction : uint8_t {
+  SENT     = 0,
+  RECEIVED = 1,
+};
+
+// Bits of trace_event::flags (the same as in the 14th byte of the TCP header)
+const uint8_t TRACE_FLAG_FIN = 0x01;
+const uint8_t TRACE_FLAG_SYN = 0x02;
+const uint8_t TRACE_FLAG_RST = 0x04;
+const uint8_t TRACE_FLAG_PSH = 0x08;
+const uint8_t TRACE_FLAG_ACK = 0x10;
+const uint8_t TRACE_FLAG_URG = 0x20;
+const uint8_t TRACE_FLAG_ECE = 0x40;
+const uint8_t TRACE_FLAG_CWR = 0x80;
+
+// One segment sent or received: the fields of its IP and TCP headers (host
+// byte order, addresses as on the wire). It is one cache line, so that an
+// event is recorded with one copy and a file is read as an array.
+struct trace_event {
+  // CLOCK_REALTIME when the event was recorded
+  uint64_t timestamp_ns;
+  // ring (one per thread) which recorded the event
+  uint32_t thread;
+  uint8_t  saddr[4];
+  uint8_t  daddr[4];
+  uint32_t seq;
+  uint32_t ack_seq;
+  uint16_t src_port;
+  uint16_t dst_port;
+  uint16_t tot_len;
+  uint16_t id;
+  uint16_t frag_off;
+  uint16_t ip_check;
+  uint16_t window;
+  uint16_t checksum;
+  uint16_t urgent_pointer;
+  // bytes of TCP payload
+  uint16_t payload_len;
+  // trace_direction
+  uint8_t  direction;
+  uint8_t  version;
+  uint8_t  ihl;
+  uint8_t  tos;
+  uint8_t  ttl;
+  uint8_t  protocol;
+  uint8_t  data_offset;
+  uint8_t  reserved;
+  // TRACE_FLAG_*
+  uint8_t  flags;
+  uint8_t  ns;
+  uint8_t  padding[6];
+};
+
+static_assert(sizeof(trace_event) == 64, "trace_event must be one cache line");
+
+#endif  // TRACE_EVENT_H_
@@ -0,0 +1,197 @@
+#include <atomic>
+#include <cerrno>   // for errno
+#include <chrono>
+#include <cstdio>   // for std::fopen(), std::fwrite(), std::fclose()
+#include <cstring>  // for std::memcpy(), std::memset(), std::strerror()
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip_packet.h"
+#include "tcp_segment.h"
+#include "trace_event.h"
+#include "trace_writer.h"
+
+std::atomic<bool> trace_on(false);
+
+namespace {
+// Size of the stdio buffer of the file
+const size_t TRACE_FILE_BUFFER_SIZE = 1024 * 1024;
+
+// guards active_writer and the registration of rings
+std::mutex writers_mutex;
+trace_writer *active_writer = nullptr;
+// Incremented when a writer starts, so that each thread registers its ring
+// with the new writer at its next event.
+std::atomic<uint64_t> writer_generation(0);
+std::atomic<uint32_t> next_thread(0);
+
+struct thread_trace_state {
+  std::shared_ptr<trace_thread_ring> ring;
+  // generation of the writer the ring is registered with (0 if none)
+  uint64_t generation = 0;
+};
+thread_local thread_trace_state this_thread;
+
+// Returns nullptr if there is no writer.
+trace_thread_ring *get_ring() {
+  if (this_thread.generation == writer_generation.load(std::memory_order_acquire)) {
+    return this_thread.ring.get();
+  }
+  std::lock_guard<std::mutex> lock(writers_mutex);
+  if (active_writer == nullptr) {
+    return nullptr;
+  }
+  if (!this_thread.ring) {
+    this_thread.ring = std::make_shared<trace_thread_ring>(next_thread.fetch_add(1));
+  }
+  active_writer->add_ring(this_thread.ring);
+  this_thread.generation = writer_generation.load(std::memory_order_relaxed);
+  return this_thread.ring.get();
+}
+
+uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+trace_writer::trace_writer(const std::string& path)
+  : file_(nullptr), stopping_(false), events_(0) {
+  std::lock_guard<std::mutex> lock(writers_mutex);
+  if (active_writer != nullptr) {
+    throw std::runtime_error("Trace writer already exists");
+  }
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    std::string msg = "Failed to open " + path + ": ";
+    msg += std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+  std::setvbuf(file_, nullptr, _IOFBF, TRACE_FILE_BUFFER_SIZE);
+  trace_file_header header;
+  std::memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_FILE_VERSION;
+  header.event_size = sizeof(trace_event);
+  if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+    std::string msg = "Failed to write " + path + ": ";
+    msg += std::strerror(errno);
+    std::fclose(file_);
+    throw std::runtime_error(msg);
+  }
+  drainer_ = std::thread([this]() { drain_loop(); });
+  active_writer = this;
+  writer_generation.fetch_add(1, std::memory_order_release);
+  trace_on.store(true, std::memory_order_relaxed);
+}
+
+trace_writer::~trace_writer() {
+  {
+    std::lock_guard<std::mutex> lock(writers_mutex);
+    trace_on.store(false, std::memory_order_relaxed);
+    active_writer = nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_requested_.notify_one();
+  drainer_.join();
+  std::fclose(file_);
+}
+
+void trace_writer::add_ring(const std::shared_ptr<trace_thread_ring>& ring) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  rings_.push_back(ring);
+}
+
+void trace_writer::drain_loop() {
+  std::vector<trace_event> batch(TRACE_RING_CAPACITY);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    stop_requested_.wait_for(lock, TRACE_DRAIN_INTERVAL);
+    lock.unlock();
+    drain(batch);
+    lock.lock();
+  }
+  lock.unlock();
+  // (events recorded before trace_on was cleared)
+  drain(batch);
+  std::fflush(file_);
+}
+
+void trace_writer::drain(std::vector<trace_event>& batch) {
+  std::vector<std::shared_ptr<trace_thread_ring>> rings;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings = rings_;
+  }
+  for (const std::shared_ptr<trace_thread_ring>& ring : rings) {
+    size_t size;
+    while ((size = ring->events.pop_batch(batch.data(), batch.size())) != 0) {
+      const size_t written = std::fwrite(batch.data(), sizeof(trace_event), size, file_);
+      events_.fetch_add(written, std::memory_order_relaxed);
+    }
+  }
+}
+
+trace_writer_stats trace_writer::get_stats() {
+  trace_writer_stats stats;
+  stats.events = events_.load(std::memory_order_relaxed);
+  stats.dropped = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::shared_ptr<trace_thread_ring>& ring : rings_) {
+    stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+  }
+  stats.threads = rings_.size();
+  return stats;
+}
+
+void set_trace_enabled(const bool enabled) {
+  std::lock_guard<std::mutex> lock(writers_mutex);
+  trace_on.store(enabled && active_writer != nullptr, std::memory_order_relaxed);
+}
+
+void record_segment(const trace_direction direction, const ip_packet& pkt, const tcp_segment& seg) {
+  trace_thread_ring *ring = get_ring();
+  if (ring == nullptr) {
+    return;
+  }
+  trace_event e;
+  e.timestamp_ns   = now_ns();
+  e.thread         = ring->thread;
+  pkt.get_saddr(e.saddr);
+  pkt.get_daddr(e.daddr);
+  e.seq            = seg.get_seq();
+  e.ack_seq        = seg.get_ack_seq();
+  e.src_port       = seg.get_src_port();
+  e.dst_port       = seg.get_dst_port();
+  e.tot_len        = pkt.get_tot_len();
+  e.id             = pkt.get_id();
+  e.frag_off       = pkt.get_frag_off();
+  e.ip_check       = pkt.get_check();
+  e.window         = seg.get_window();
+  e.checksum       = seg.get_checksum();
+  e.urgent_pointer = seg.get_urgent_pointer();
+  e.payload_len    = static_cast<uint16_t>(seg.get_body_size());
+  e.direction      = static_cast<uint8_t>(direction);
+  e.version        = pkt.get_version();
+  e.ihl            = pkt.get_ihl();
+  e.tos            = pkt.get_tos();
+  e.ttl            = pkt.get_ttl();
+  e.protocol       = pkt.get_protocol();
+  e.data_offset    = seg.get_data_offset();
+  e.reserved       = seg.get_reserved();
+  e.flags          = (seg.get_fin() ? TRACE_FLAG_FIN : 0) | (seg.get_syn() ? TRACE_FLAG_SYN : 0) |
+                     (seg.get_rst() ? TRACE_FLAG_RST : 0) | (seg.get_psh() ? TRACE_FLAG_PSH : 0) |
+                     (seg.get_ack() ? TRACE_FLAG_ACK : 0) | (seg.get_urg() ? TRACE_FLAG_URG : 0) |
+                     (seg.get_ece() ? TRACE_FLAG_ECE : 0) | (seg.get_cwr() ? TRACE_FLAG_CWR : 0);
+  e.ns             = seg.get_ns();
+  std::memset(e.padding, 0, sizeof(e.padding));
+  if (!ring->events.try_push(e)) {
+    ring->dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
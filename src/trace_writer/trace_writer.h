@@ -0,0 +1,103 @@
+#ifndef TRACE_WRITER_H_
+#define TRACE_WRITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <cstdio>   // for FILE
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip_packet.h"
+#include "spsc_ring.h"
+#include "tcp_segment.h"
+#include "trace_event.h"
+
+// Events each thread may have recorded before the writer drains them
+// (512 KiB of events). Events are dropped while the ring is full.
+const size_t TRACE_RING_CAPACITY = 8192;
+// How often the writer drains the rings of all threads
+const std::chrono::milliseconds TRACE_DRAIN_INTERVAL(10);
+
+struct trace_writer_stats {
+  uint64_t events;   // events written to the file
+  uint64_t dropped;  // events dropped as the ring of their thread was full
+  uint64_t threads;  // threads which recorded events
+};
+
+// Ring of the events recorded by one thread.
+struct trace_thread_ring {
+  spsc_ring<trace_event> events;
+  std::atomic<uint64_t> dropped;
+  uint32_t thread;
+  trace_thread_ring(const uint32_t thread)
+    : events(TRACE_RING_CAPACITY), dropped(0), thread(thread) {}
+};
+
+// NOTE
+// Writes the segments sent and received by all threads to a binary trace
+// file, to be decoded offline (trace_decode) into the header dumps main
+// printed before.
+//
+// Each thread records events into a lock-free ring of its own (registered
+// with the writer at its first event), so recording is a copy of 64 bytes
+// and a release store. A thread of the writer drains all rings to the file
+// every TRACE_DRAIN_INTERVAL, so the threads never wait for the disk.
+//
+// Recording is switched on while a writer exists, and can be switched off
+// and on again by set_trace_enabled(). While off, trace_segment() costs one
+// relaxed load and a branch.
+class trace_writer {
+ private:
+  FILE *file_;
+  // guards rings_ and stopping_
+  std::mutex mutex_;
+  std::condition_variable stop_requested_;
+  bool stopping_;
+  std::vector<std::shared_ptr<trace_thread_ring>> rings_;
+  // written by the drainer, read by get_stats()
+  std::atomic<uint64_t> events_;
+  std::thread drainer_;
+
+  void drain_loop();
+  // Write what the rings hold now. Called by the drainer only.
+  void drain(std::vector<trace_event>& batch);
+ public:
+  // Create (or truncate) the file and start recording into it.
+  // Throws std::runtime_error if the file cannot be written, or if another
+  // writer exists.
+  explicit trace_writer(const std::string& path);
+  trace_writer(const trace_writer&) = delete;
+  trace_writer& operator=(const trace_writer&) = delete;
+  // Stop recording, write the events left and close the file.
+  ~trace_writer();
+  // Used by the threads at their first event.
+  void add_ring(const std::shared_ptr<trace_thread_ring>& ring);
+  trace_writer_stats get_stats();
+};
+
+// true while events are recorded (read on every segment, hence inline)
+extern std::atomic<bool> trace_on;
+
+inline bool trace_enabled() {
+  return trace_on.load(std::memory_order_relaxed);
+}
+
+// Switch recording off (or on again while a writer exists).
+void set_trace_enabled(const bool enabled);
+
+// Record the segment into the ring of the calling thread.
+void record_segment(const trace_direction direction, const ip_packet& pkt, const tcp_segment& seg);
+
+inline void trace_segment(const trace_direction direction, const ip_packet& pkt, const tcp_segment& seg) {
+  if (trace_enabled()) {
+    record_segment(direction, pkt, seg);
+  }
+}
+
+#endif  // TRACE_WRITER_H_
@@ -0,0 +1,32 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <cstdlib>   // for std::exit()
+#include <iostream>
+
+// NOTE
+// Checks of the unit tests. Unlike assert(), they are kept in release builds.
+// A failed check prints the expression (and both values for CHECK_EQ) and
+// exits with 1, which ctest reports as a failure.
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    if (!(cond)) {                                                         \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" \
+                << std::endl;                                              \
+      std::exit(1);                                                        \
+    }                                                                      \
+  } while (false)
+
+#define CHECK_EQ(actual, expected)                                         \
+  do {                                                                     \
+    const auto& check_actual_ = (actual);                                  \
+    const auto& check_expected_ = (expected);                              \
+    if (!(check_actual_ == check_expected_)) {                             \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ(" #actual ", " \
+                << #expected ") failed: " << +check_actual_ << " != "      \
+                << +check_expected_ << std::endl;                          \
+      std::exit(1);                                                        \
+    }                                                                      \
+  } while (false)
+
+#endif  // CHECK_H_
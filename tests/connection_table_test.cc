@@ -0,0 +1,157 @@
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t, uint32_t, uint64_t
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "check.h"
+#include "connection_table.h"
+
+namespace {
+connection_key make_key(const uint32_t local_ip, const uint16_t local_port,
+                        const uint32_t remote_ip, const uint16_t remote_port) {
+  return connection_key{local_ip, remote_ip, local_port, remote_port};
+}
+
+struct key_hash {
+  size_t operator()(const connection_key& key) const {
+    return (static_cast<uint64_t>(key.local_ip) * 31 + key.remote_ip) * 65537 +
+           (static_cast<uint64_t>(key.local_port) << 16 | key.remote_port);
+  }
+};
+
+void test_insert_find_erase() {
+  connection_table table;
+  const connection_key key = make_key(0x0100000a, 40000, 0x0200000a, 80);
+  CHECK_EQ(table.find(key), CONNECTION_NOT_FOUND);
+  CHECK(table.insert(key, 7));
+  CHECK_EQ(table.size(), 1u);
+  CHECK_EQ(table.find(key), 7u);
+  // the key is unique
+  CHECK(!table.insert(key, 8));
+  CHECK_EQ(table.find(key), 7u);
+  CHECK(table.erase(key));
+  CHECK(!table.erase(key));
+  CHECK_EQ(table.find(key), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.size(), 0u);
+  // a key can come back after being erased
+  CHECK(table.insert(key, 9));
+  CHECK_EQ(table.find(key), 9u);
+}
+
+void test_every_field_is_compared() {
+  connection_table table;
+  const connection_key key = make_key(1, 2, 3, 4);
+  CHECK(table.insert(key, 0));
+  // the same numbers in other fields are other connections
+  CHECK_EQ(table.find(make_key(3, 4, 1, 2)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.find(make_key(1, 4, 3, 2)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.find(make_key(2, 2, 3, 4)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.find(make_key(1, 3, 3, 4)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.find(make_key(1, 2, 4, 4)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.find(make_key(1, 2, 3, 5)), CONNECTION_NOT_FOUND);
+  CHECK(table.insert(make_key(1, 2, 3, 5), 1));
+  CHECK_EQ(table.find(key), 0u);
+  CHECK_EQ(table.find(make_key(1, 2, 3, 5)), 1u);
+}
+
+void test_values() {
+  connection_table table;
+  CHECK(table.insert(make_key(1, 1, 1, 1), 0));
+  CHECK(table.insert(make_key(2, 2, 2, 2), CONNECTION_TABLE_MAX_VALUE));
+  CHECK_EQ(table.find(make_key(2, 2, 2, 2)), CONNECTION_TABLE_MAX_VALUE);
+  // values above the maximum mark free slots
+  bool thrown = false;
+  try {
+    table.insert(make_key(3, 3, 3, 3), CONNECTION_TABLE_MAX_VALUE + 1);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK_EQ(table.find(make_key(3, 3, 3, 3)), CONNECTION_NOT_FOUND);
+  CHECK_EQ(table.size(), 2u);
+}
+
+void test_make_connection_key() {
+  const uint8_t local_ip[] = {10, 0, 0, 1};
+  const uint8_t remote_ip[] = {10, 0, 0, 2};
+  const connection_key key = make_connection_key(local_ip, 40000, remote_ip, 80);
+  // addresses as in the ip header, ports in host byte order
+  const uint8_t *local = reinterpret_cast<const uint8_t *>(&key.local_ip);
+  const uint8_t *remote = reinterpret_cast<const uint8_t *>(&key.remote_ip);
+  CHECK(local[0] == 10 && local[3] == 1);
+  CHECK(remote[0] == 10 && remote[3] == 2);
+  CHECK_EQ(key.local_port, 40000);
+  CHECK_EQ(key.remote_port, 80);
+  CHECK(key == make_connection_key(local_ip, 40000, remote_ip, 80));
+  CHECK(key != make_connection_key(remote_ip, 80, local_ip, 40000));
+}
+
+void test_reserve() {
+  connection_table table;
+  table.reserve(10000);
+  const size_t capacity = table.capacity();
+  CHECK(capacity >= 10000);
+  CHECK_EQ(capacity % CONNECTION_TABLE_GROUP_SIZE, 0u);
+  for (uint32_t i = 0; i < 10000; ++i) {
+    CHECK(table.insert(make_key(i, 1, 2, 3), i));
+  }
+  // no rehash up to the reserved size
+  CHECK_EQ(table.capacity(), capacity);
+  CHECK_EQ(table.size(), 10000u);
+}
+
+// Random inserts and erases, checked against std::unordered_map. Keys share
+// most fields (one client, one server port), as connections of a client do,
+// and erases leave tombstones which later inserts reuse or rehash away.
+void test_against_unordered_map() {
+  connection_table table;
+  std::unordered_map<connection_key, uint32_t, key_hash> expected;
+  std::vector<connection_key> keys;
+  std::mt19937 rng(1);
+  for (uint32_t i = 0; i < 20000; ++i) {
+    keys.push_back(make_key(0x0100000a, 1024 + i % 60000, 0x0200000a + (i / 60000), 80));
+  }
+  for (int op = 0; op < 400000; ++op) {
+    const connection_key& key = keys[rng() % keys.size()];
+    const uint32_t value = rng() % 1000000;
+    switch (rng() % 3) {
+      case 0:
+      case 1: {
+        const bool inserted = expected.emplace(key, value).second;
+        CHECK_EQ(table.insert(key, value), inserted);
+        break;
+      }
+      default: {
+        CHECK_EQ(table.erase(key), expected.erase(key) == 1);
+        break;
+      }
+    }
+    CHECK_EQ(table.size(), expected.size());
+  }
+  // at most 7/8 full
+  CHECK(table.size() * 8 <= table.capacity() * 7);
+  for (const connection_key& key : keys) {
+    const auto it = expected.find(key);
+    CHECK_EQ(table.find(key), it == expected.end() ? CONNECTION_NOT_FOUND : it->second);
+  }
+  for (const auto& [key, value] : expected) {
+    CHECK(table.erase(key));
+  }
+  CHECK_EQ(table.size(), 0u);
+  for (const connection_key& key : keys) {
+    CHECK_EQ(table.find(key), CONNECTION_NOT_FOUND);
+  }
+}
+} // namespace
+
+int main() {
+  test_insert_find_erase();
+  test_every_field_is_compared();
+  test_values();
+  test_make_connection_key();
+  test_reserve();
+  test_against_unordered_map();
+  return 0;
+}
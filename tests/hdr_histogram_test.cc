@@ -0,0 +1,100 @@
+#include <cstdint>  // for uint64_t, UINT64_MAX
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "hdr_histogram.h"
+
+namespace {
+const uint64_t MAX_VALUE = (static_cast<uint64_t>(1) << HDR_MAX_VALUE_BITS) - 1;
+
+// Highest value of the bucket which counts the value.
+uint64_t bucket_end(const uint64_t value) {
+  std::unique_ptr<hdr_histogram> histogram(new hdr_histogram());
+  histogram->record(value);
+  return histogram->get_percentile(1.0);
+}
+
+void test_empty() {
+  hdr_histogram histogram;
+  CHECK_EQ(histogram.get_count(), 0u);
+  CHECK_EQ(histogram.get_min(), 0u);
+  CHECK_EQ(histogram.get_max(), 0u);
+  CHECK_EQ(histogram.get_percentile(0.5), 0u);
+}
+
+void test_small_values_are_exact() {
+  for (uint64_t value = 0; value < (1 << HDR_SUB_BUCKET_BITS); ++value) {
+    CHECK_EQ(bucket_end(value), value);
+  }
+}
+
+// Buckets are contiguous, each one ends at or above its values within the
+// stated precision, and the next value starts the next bucket.
+void check_bucket(const uint64_t value) {
+  const uint64_t end = bucket_end(value);
+  CHECK(end >= value);
+  CHECK((end - value) << (HDR_SUB_BUCKET_BITS - 1) <= value);
+  CHECK_EQ(bucket_end(end), end);
+  if (end < MAX_VALUE) {
+    CHECK(bucket_end(end + 1) > end);
+  }
+}
+
+void test_bucket_boundaries() {
+  for (uint64_t value = 0; value < 4096; ++value) {
+    check_bucket(value);
+  }
+  for (int bits = HDR_SUB_BUCKET_BITS; bits < HDR_MAX_VALUE_BITS; ++bits) {
+    const uint64_t power = static_cast<uint64_t>(1) << bits;
+    check_bucket(power - 1);
+    check_bucket(power);
+    check_bucket(power + 1);
+  }
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < 2000; ++i) {
+    check_bucket(rng() & MAX_VALUE);
+  }
+}
+
+// Values beyond the range are counted as the largest one.
+void test_max_value() {
+  check_bucket(MAX_VALUE);
+  CHECK_EQ(bucket_end(MAX_VALUE), MAX_VALUE);
+  hdr_histogram histogram;
+  histogram.record(MAX_VALUE + 1);
+  histogram.record(UINT64_MAX);
+  CHECK_EQ(histogram.get_count(), 2u);
+  CHECK_EQ(histogram.get_max(), MAX_VALUE);
+  CHECK_EQ(histogram.get_percentile(1.0), MAX_VALUE);
+}
+
+void test_percentiles() {
+  hdr_histogram histogram;
+  for (uint64_t value = 1; value <= 100; ++value) {
+    histogram.record(value);
+  }
+  CHECK_EQ(histogram.get_count(), 100u);
+  CHECK_EQ(histogram.get_min(), 1u);
+  CHECK_EQ(histogram.get_max(), 100u);
+  CHECK_EQ(histogram.get_percentile(0), 1u);
+  CHECK_EQ(histogram.get_percentile(0.25), 25u);
+  // (the bucket of 50 is [50, 51])
+  CHECK_EQ(histogram.get_percentile(0.5), 51u);
+  CHECK_EQ(histogram.get_percentile(0.99), 99u);
+  CHECK_EQ(histogram.get_percentile(1.0), bucket_end(100));
+  // out of range fractions are clamped
+  CHECK_EQ(histogram.get_percentile(-1), 1u);
+  CHECK_EQ(histogram.get_percentile(2), bucket_end(100));
+}
+} // namespace
+
+int main() {
+  test_empty();
+  test_small_values_are_exact();
+  test_bucket_boundaries();
+  test_max_value();
+  test_percentiles();
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <cstdint>  // for uint8_t, uint16_t
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "port_allocator.h"
+
+namespace {
+const uint8_t LOCAL_IP[]  = {10, 0, 0, 1};
+const uint8_t REMOTE_IP[] = {10, 0, 0, 2};
+
+void test_range() {
+  bool thrown = false;
+  try {
+    port_allocator ports(0, 100);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  thrown = false;
+  try {
+    port_allocator ports(2000, 1000);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  port_allocator ports;
+  CHECK_EQ(ports.get_min(), DEFAULT_EPHEMERAL_PORT_MIN);
+  CHECK_EQ(ports.get_max(), DEFAULT_EPHEMERAL_PORT_MAX);
+  for (int i = 0; i < 1000; ++i) {
+    const uint16_t port = ports.allocate(LOCAL_IP, REMOTE_IP, 80, [](uint16_t) { return true; });
+    CHECK(port >= DEFAULT_EPHEMERAL_PORT_MIN && port <= DEFAULT_EPHEMERAL_PORT_MAX);
+  }
+}
+
+// Connections to one destination walk the range in order, so that a port
+// is reused as late as possible.
+void test_walks_in_order() {
+  const uint16_t min = 40000;
+  const uint16_t max = 40009;
+  port_allocator ports(min, max);
+  const auto any = [](uint16_t) { return true; };
+  uint16_t prev = ports.allocate(LOCAL_IP, REMOTE_IP, 80, any);
+  for (int i = 0; i < 100; ++i) {
+    const uint16_t port = ports.allocate(LOCAL_IP, REMOTE_IP, 80, any);
+    CHECK_EQ(port, prev == max ? min : prev + 1);
+    prev = port;
+  }
+  CHECK_EQ(ports.get_stats().allocations, 101u);
+  CHECK_EQ(ports.get_stats().probes, 101u);
+}
+
+void test_skips_unsuitable_ports() {
+  port_allocator ports(50000, 50099);
+  for (int i = 0; i < 100; ++i) {
+    const uint16_t port =
+      ports.allocate(LOCAL_IP, REMOTE_IP, 80, [](uint16_t p) { return p % 2 == 1; });
+    CHECK_EQ(port % 2, 1);
+  }
+  CHECK_EQ(ports.allocate(LOCAL_IP, REMOTE_IP, 80, [](uint16_t) { return false; }), 0);
+  CHECK_EQ(ports.get_stats().failures, 1u);
+}
+
+// Every port of the range is found before the allocator gives up, wherever
+// the walk of the destination starts.
+void test_uses_the_whole_range() {
+  for (int round = 0; round < 8; ++round) {
+    port_allocator ports;
+    const uint32_t num_ports = DEFAULT_EPHEMERAL_PORT_MAX - DEFAULT_EPHEMERAL_PORT_MIN + 1;
+    std::vector<bool> used(65536, false);
+    const auto unused = [&used](uint16_t port) { return !used[port]; };
+    for (uint32_t i = 0; i < num_ports; ++i) {
+      const uint16_t port = ports.allocate(LOCAL_IP, REMOTE_IP, 443, unused);
+      CHECK(port != 0);
+      CHECK(!used[port]);
+      used[port] = true;
+    }
+    CHECK_EQ(ports.allocate(LOCAL_IP, REMOTE_IP, 443, unused), 0);
+    // other destinations do not share the ports
+    CHECK(ports.allocate(LOCAL_IP, REMOTE_IP, 80, [](uint16_t) { return true; }) != 0);
+  }
+}
+} // namespace
+
+int main() {
+  test_range();
+  test_walks_in_order();
+  test_skips_unsuitable_ports();
+  test_uses_the_whole_range();
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <cstdint>  // for uint32_t
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "prefix_table.h"
+
+namespace {
+uint32_t make_ip(const uint32_t a, const uint32_t b, const uint32_t c, const uint32_t d) {
+  return a << 24 | b << 16 | c << 8 | d;
+}
+
+// gateway of the route found, or 1 if the route is on-link and 0 if none
+uint32_t next_hop(const prefix_table& table, const uint32_t dst, const int ifindex = 1) {
+  const prefix_route *route = table.lookup(dst, ifindex);
+  if (route == nullptr) {
+    return 0;
+  }
+  return route->gateway == 0 ? 1 : route->gateway;
+}
+
+void test_longest_match() {
+  prefix_table table;
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 2, 3)), 0u);
+  table.add(0, 0, prefix_route{100, 1, 0});
+  table.add(make_ip(10, 0, 0, 0), 8, prefix_route{108, 1, 0});
+  table.add(make_ip(10, 1, 0, 0), 16, prefix_route{0, 1, 0});
+  table.add(make_ip(10, 1, 2, 0), 24, prefix_route{124, 1, 0});
+  table.add(make_ip(10, 1, 2, 3), 32, prefix_route{132, 1, 0});
+  CHECK_EQ(table.size(), 5u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 2, 3)), 132u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 2, 4)), 124u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 3, 3)), 1u);
+  CHECK_EQ(next_hop(table, make_ip(10, 2, 2, 3)), 108u);
+  CHECK_EQ(next_hop(table, make_ip(11, 1, 2, 3)), 100u);
+  // the bits of a prefix beyond its length are ignored
+  table.add(make_ip(192, 168, 1, 77), 24, prefix_route{0, 1, 0});
+  CHECK_EQ(next_hop(table, make_ip(192, 168, 1, 200)), 1u);
+  CHECK(table.remove(make_ip(192, 168, 1, 0), 24, 0));
+  CHECK_EQ(next_hop(table, make_ip(192, 168, 1, 200)), 100u);
+  bool thrown = false;
+  try {
+    table.add(0, 33, prefix_route{1, 1, 0});
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+// A shorter prefix is used when the longer ones are out of other interfaces,
+// and a lower metric wins among routes of the same prefix.
+void test_interface_and_metric() {
+  prefix_table table;
+  table.add(make_ip(10, 0, 0, 0), 8, prefix_route{1, 1, 0});
+  table.add(make_ip(10, 1, 0, 0), 16, prefix_route{2, 2, 0});
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 1), 1u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 2), 2u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 3), 0u);
+  table.add(make_ip(10, 1, 0, 0), 16, prefix_route{30, 2, 300});
+  table.add(make_ip(10, 1, 0, 0), 16, prefix_route{10, 2, 100});
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 2), 2u);
+  CHECK(table.remove(make_ip(10, 1, 0, 0), 16, 0));
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 2), 10u);
+  // a route of the same prefix and metric is replaced
+  table.add(make_ip(10, 1, 0, 0), 16, prefix_route{11, 2, 100});
+  CHECK_EQ(table.size(), 3u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 2), 11u);
+  CHECK(!table.remove(make_ip(10, 1, 0, 0), 16, 200));
+  CHECK(!table.remove(make_ip(10, 2, 0, 0), 16, 100));
+  CHECK(table.remove(make_ip(10, 1, 0, 0), 16, 100));
+  CHECK(table.remove(make_ip(10, 1, 0, 0), 16, 300));
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 2), 0u);
+  table.clear();
+  CHECK_EQ(table.size(), 0u);
+  CHECK_EQ(next_hop(table, make_ip(10, 1, 0, 1), 1), 0u);
+}
+
+struct reference_route {
+  uint32_t prefix;
+  unsigned int len;
+  uint32_t gateway;
+};
+
+// Random routes, checked against a linear scan for the longest match.
+void test_against_linear_scan() {
+  prefix_table table;
+  std::vector<reference_route> routes;
+  std::mt19937 rng(1);
+  for (uint32_t i = 1; i <= 2000; ++i) {
+    const unsigned int len = rng() % 33;
+    const uint32_t mask = len == 0 ? 0 : ~static_cast<uint32_t>(0) << (32 - len);
+    // few distinct leading bits, so that prefixes nest
+    const uint32_t prefix = (rng() & 0xf0f0f0f0) & mask;
+    bool duplicate = false;
+    for (const reference_route& r : routes) {
+      duplicate = duplicate || (r.prefix == prefix && r.len == len);
+    }
+    if (duplicate) {
+      continue;
+    }
+    table.add(prefix, len, prefix_route{i, 1, 0});
+    routes.push_back(reference_route{prefix, len, i});
+  }
+  CHECK_EQ(table.size(), routes.size());
+  for (int n = 0; n < 20000; ++n) {
+    const uint32_t dst = rng() & 0xf1f1f1f1;
+    const reference_route *best = nullptr;
+    for (const reference_route& r : routes) {
+      const uint32_t mask = r.len == 0 ? 0 : ~static_cast<uint32_t>(0) << (32 - r.len);
+      if ((dst & mask) == r.prefix && (best == nullptr || r.len > best->len)) {
+        best = &r;
+      }
+    }
+    CHECK_EQ(next_hop(table, dst), best == nullptr ? 0u : best->gateway);
+  }
+}
+} // namespace
+
+int main() {
+  test_longest_match();
+  test_interface_and_metric();
+  test_against_linear_scan();
+  return 0;
+}
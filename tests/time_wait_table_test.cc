@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdint>  // for uint32_t
+
+#include "check.h"
+#include "connection_table.h"
+#include "time_wait_table.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+// Any clock will do (e.g. the virtual clock of the link simulator).
+const chrono::steady_clock::time_point START = chrono::steady_clock::time_point() + chrono::hours(5);
+
+const connection_key KEY = connection_key{0x0100000a, 0x0200000a, 40000, 80};
+const connection_key OTHER_KEY = connection_key{0x0100000a, 0x0200000a, 40001, 80};
+
+void test_acknowledges_fin() {
+  time_wait_table table(START);
+  table.insert(KEY, time_wait_entry{1000, 2000, 512}, START);
+  CHECK_EQ(table.size(), 1u);
+  CHECK(table.contains(KEY, START));
+  CHECK(!table.contains(OTHER_KEY, START));
+  time_wait_entry state{0, 0, 0};
+  bool ack = true;
+  // other segments are ignored (rfc 1337)
+  CHECK(table.on_segment(KEY, false, START + chrono::seconds(1), state, ack));
+  CHECK(!ack);
+  CHECK(table.on_segment(KEY, true, START + chrono::seconds(1), state, ack));
+  CHECK(ack);
+  CHECK_EQ(state.snd_nxt, 1000u);
+  CHECK_EQ(state.rcv_nxt, 2000u);
+  CHECK_EQ(state.window, 512);
+  CHECK_EQ(table.get_stats().fin_acks, 1u);
+  CHECK(!table.on_segment(OTHER_KEY, true, START, state, ack));
+  // inserting the 4-tuple again replaces the entry
+  table.insert(KEY, time_wait_entry{3000, 4000, 1024}, START + chrono::seconds(2));
+  CHECK_EQ(table.size(), 1u);
+  CHECK(table.on_segment(KEY, true, START + chrono::seconds(2), state, ack));
+  CHECK_EQ(state.snd_nxt, 3000u);
+}
+
+// Expired entries are ignored at once, and dropped by whichever of find()
+// or expire() comes first.
+void test_expiry() {
+  time_wait_table table(START);
+  table.insert(KEY, time_wait_entry{1, 2, 3}, START);
+  table.insert(OTHER_KEY, time_wait_entry{1, 2, 3}, START + chrono::seconds(10));
+  const chrono::steady_clock::time_point expiry = START + TIME_WAIT_DURATION;
+  CHECK(table.contains(KEY, expiry - chrono::milliseconds(1)));
+  time_wait_entry state;
+  bool ack = false;
+  CHECK(!table.on_segment(KEY, true, expiry, state, ack));
+  CHECK_EQ(table.size(), 1u);
+  CHECK_EQ(table.get_stats().expired, 1u);
+  // a stale expiry record of the dropped entry does nothing
+  table.expire(expiry);
+  CHECK_EQ(table.size(), 1u);
+  table.expire(expiry + chrono::seconds(9));
+  CHECK_EQ(table.size(), 1u);
+  table.expire(expiry + chrono::seconds(10));
+  CHECK_EQ(table.size(), 0u);
+  CHECK_EQ(table.get_stats().expired, 2u);
+  CHECK(!table.contains(OTHER_KEY, expiry + chrono::seconds(10)));
+}
+
+// (rfc 793) a retransmitted FIN restarts the 2 MSL timeout.
+void test_fin_restarts_timeout() {
+  time_wait_table table(START);
+  table.insert(KEY, time_wait_entry{1, 2, 3}, START);
+  const chrono::steady_clock::time_point fin_time = START + chrono::seconds(30);
+  time_wait_entry state;
+  bool ack = false;
+  CHECK(table.on_segment(KEY, true, fin_time, state, ack));
+  // the record of the first timeout is stale
+  table.expire(START + TIME_WAIT_DURATION + chrono::seconds(1));
+  CHECK_EQ(table.size(), 1u);
+  CHECK(table.contains(KEY, fin_time + TIME_WAIT_DURATION - chrono::milliseconds(1)));
+  table.expire(fin_time + TIME_WAIT_DURATION);
+  CHECK_EQ(table.size(), 0u);
+}
+
+void test_reuse() {
+  time_wait_table table(START);
+  uint32_t iss = 5;
+  // not in TIME-WAIT
+  CHECK(table.reuse(KEY, START, iss));
+  CHECK_EQ(iss, 5u);
+  table.insert(KEY, time_wait_entry{0xffffff00, 2, 3}, START);
+  CHECK(!table.reuse(KEY, START + TIME_WAIT_REUSE_DELAY - chrono::milliseconds(1), iss));
+  CHECK_EQ(table.size(), 1u);
+  // the new ISS is raised above the old sequence space (across the wrap)
+  CHECK(table.reuse(KEY, START + TIME_WAIT_REUSE_DELAY, iss));
+  CHECK_EQ(iss, 0xffffff00u + 65535 + 2);
+  CHECK_EQ(table.size(), 0u);
+  CHECK_EQ(table.get_stats().reused, 1u);
+  // an ISS already above it is kept
+  table.insert(KEY, time_wait_entry{1000, 2, 3}, START);
+  iss = 1000000;
+  CHECK(table.reuse(KEY, START + chrono::seconds(2), iss));
+  CHECK_EQ(iss, 1000000u);
+  // the slot of a reused entry is used again
+  table.insert(OTHER_KEY, time_wait_entry{1, 2, 3}, START + chrono::seconds(3));
+  CHECK_EQ(table.size(), 1u);
+  CHECK(table.contains(OTHER_KEY, START + chrono::seconds(3)));
+  CHECK(!table.contains(KEY, START + chrono::seconds(3)));
+}
+} // namespace
+
+int main() {
+  test_acknowledges_fin();
+  test_expiry();
+  test_fin_restarts_timeout();
+  test_reuse();
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cstddef>  // for size_t
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "timer_wheel.h"
+
+namespace {
+namespace chrono = std::chrono;
+
+const chrono::milliseconds TICK(1);
+const chrono::steady_clock::time_point START = chrono::steady_clock::time_point() + chrono::hours(1);
+
+// Records the time given to the advance() which runs the callback.
+struct test_timer {
+  const chrono::steady_clock::time_point *now;
+  std::vector<chrono::steady_clock::time_point> fired;
+  timer_wheel_timer timer;
+  test_timer() : now(nullptr), timer(on_expire, this) {}
+  static void on_expire(void *arg) {
+    auto *self = static_cast<test_timer *>(arg);
+    self->fired.push_back(*self->now);
+  }
+};
+
+void test_expires_at_its_tick() {
+  timer_wheel wheel(TICK, START);
+  chrono::steady_clock::time_point now = START;
+  test_timer t;
+  t.now = &now;
+  wheel.arm(t.timer, START + chrono::milliseconds(5));
+  CHECK(t.timer.armed());
+  CHECK_EQ(wheel.size(), 1u);
+  now = START + chrono::milliseconds(4);
+  CHECK_EQ(wheel.advance(now), 0u);
+  CHECK(t.fired.empty());
+  now = START + chrono::milliseconds(5);
+  CHECK_EQ(wheel.advance(now), 1u);
+  CHECK_EQ(t.fired.size(), 1u);
+  CHECK(!t.timer.armed());
+  CHECK_EQ(wheel.size(), 0u);
+  // fired once only
+  now = START + chrono::milliseconds(100);
+  CHECK_EQ(wheel.advance(now), 0u);
+  CHECK_EQ(t.fired.size(), 1u);
+}
+
+void test_cancel_and_rearm() {
+  timer_wheel wheel(TICK, START);
+  chrono::steady_clock::time_point now = START;
+  test_timer cancelled;
+  test_timer moved;
+  cancelled.now = &now;
+  moved.now = &now;
+  wheel.arm(cancelled.timer, START + chrono::milliseconds(10));
+  wheel.cancel(cancelled.timer);
+  // cancelling a disarmed timer is a no-op
+  wheel.cancel(cancelled.timer);
+  CHECK(!cancelled.timer.armed());
+  wheel.arm(moved.timer, START + chrono::milliseconds(10));
+  wheel.arm(moved.timer, START + chrono::milliseconds(3));
+  CHECK_EQ(wheel.size(), 1u);
+  now = START + chrono::milliseconds(3);
+  CHECK_EQ(wheel.advance(now), 1u);
+  now = START + chrono::milliseconds(20);
+  CHECK_EQ(wheel.advance(now), 0u);
+  CHECK(cancelled.fired.empty());
+  CHECK_EQ(moved.fired.size(), 1u);
+  CHECK(moved.fired[0] == START + chrono::milliseconds(3));
+}
+
+void test_past_expiry_fires_at_next_tick() {
+  timer_wheel wheel(TICK, START);
+  chrono::steady_clock::time_point now = START + chrono::milliseconds(50);
+  wheel.advance(now);
+  test_timer t;
+  t.now = &now;
+  wheel.arm(t.timer, START);
+  CHECK(wheel.get_next_expiry() <= now + TICK);
+  now += TICK;
+  CHECK_EQ(wheel.advance(now), 1u);
+  CHECK_EQ(t.fired.size(), 1u);
+}
+
+// Timers on every level fire at their own tick, neither early nor late,
+// whether the wheel is advanced tick by tick or in one step.
+void test_levels(const bool tick_by_tick) {
+  timer_wheel wheel(TICK, START);
+  chrono::steady_clock::time_point now = START;
+  std::mt19937_64 rng(tick_by_tick ? 1 : 2);
+  // up to level 2 (more than 65536 ticks)
+  std::uniform_int_distribution<int> delay_ms(1, 200000);
+  const size_t num_timers = 2000;
+  std::unique_ptr<test_timer[]> timers(new test_timer[num_timers]);
+  std::vector<chrono::steady_clock::time_point> expiries(num_timers);
+  for (size_t i = 0; i < num_timers; ++i) {
+    timers[i].now = &now;
+    expiries[i] = START + chrono::milliseconds(delay_ms(rng));
+    wheel.arm(timers[i].timer, expiries[i]);
+  }
+  CHECK_EQ(wheel.size(), num_timers);
+  const chrono::steady_clock::time_point end = START + chrono::milliseconds(200000);
+  size_t expired = 0;
+  if (tick_by_tick) {
+    while (now < end) {
+      now += TICK;
+      expired += wheel.advance(now);
+    }
+  } else {
+    now = end;
+    expired = wheel.advance(now);
+  }
+  CHECK_EQ(expired, num_timers);
+  CHECK_EQ(wheel.size(), 0u);
+  for (size_t i = 0; i < num_timers; ++i) {
+    CHECK_EQ(timers[i].fired.size(), 1u);
+    if (tick_by_tick) {
+      CHECK(timers[i].fired[0] == expiries[i]);
+    }
+  }
+  CHECK(wheel.get_next_expiry() == chrono::steady_clock::time_point::max());
+}
+
+void test_next_expiry() {
+  timer_wheel wheel(TICK, START);
+  CHECK(wheel.get_next_expiry() == chrono::steady_clock::time_point::max());
+  chrono::steady_clock::time_point now = START;
+  test_timer near;
+  test_timer far;
+  near.now = &now;
+  far.now = &now;
+  wheel.arm(far.timer, START + chrono::seconds(100));
+  wheel.arm(near.timer, START + chrono::milliseconds(700));
+  // never later than the earliest expiry, even if it is on a higher level
+  CHECK(wheel.get_next_expiry() <= START + chrono::milliseconds(700));
+  // polling at the returned times reaches the expiry without running early
+  while (near.fired.empty()) {
+    now = wheel.get_next_expiry();
+    CHECK(now <= START + chrono::milliseconds(700));
+    wheel.advance(now);
+  }
+  CHECK(near.fired[0] == START + chrono::milliseconds(700));
+  CHECK(far.fired.empty());
+  CHECK(wheel.get_next_expiry() <= START + chrono::seconds(100));
+}
+
+struct periodic_timer {
+  timer_wheel *wheel;
+  int runs;
+  timer_wheel_timer timer;
+  periodic_timer() : wheel(nullptr), runs(0), timer(on_expire, this) {}
+  static void on_expire(void *arg) {
+    auto *self = static_cast<periodic_timer *>(arg);
+    self->runs++;
+    self->wheel->arm_after(self->timer, chrono::milliseconds(10));
+  }
+};
+
+void test_rearm_from_callback() {
+  timer_wheel wheel(TICK, START);
+  periodic_timer t;
+  t.wheel = &wheel;
+  wheel.arm_after(t.timer, chrono::milliseconds(10));
+  for (chrono::steady_clock::time_point now = START; now < START + chrono::milliseconds(100); ) {
+    now += TICK;
+    wheel.advance(now);
+  }
+  CHECK_EQ(t.runs, 10);
+  CHECK(t.timer.armed());
+}
+} // namespace
+
+int main() {
+  test_expires_at_its_tick();
+  test_cancel_and_rearm();
+  test_past_expiry_fires_at_next_tick();
+  test_levels(true);
+  test_levels(false);
+  test_next_expiry();
+  test_rearm_from_callback();
+  return 0;
+}